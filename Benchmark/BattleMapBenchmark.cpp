@@ -0,0 +1,60 @@
+#include "Benchmark.h"
+#include "BattleMap.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	string MakeMapText(uint32 size)
+	{
+		string text = "size " + to_string(size) + " " + to_string(size) + "\ntiles\n";
+		char const terrain[] = ".f^~#";
+		for (uint32 y = 0; y < size; ++y)
+		{
+			for (uint32 x = 0; x < size; ++x)
+			{
+				text += terrain[(x / 7 + y / 5) % 5];
+			}
+			text += '\n';
+		}
+		for (uint32 unit = 0; unit < 64; ++unit)
+		{
+			text += "unit " + to_string(unit * 13 % size) + " " + to_string(unit * 29 % size) + " " + to_string(unit % 2) + " s Soldier " + to_string(unit) + "\n";
+		}
+		return text;
+	}
+
+	/*
+	*	Opening maps of very different sizes should cost the same, only the chunks that are read get paged in.
+	*/
+	void RunOpen(BenchmarkRunner& runner, uint32 size)
+	{
+		vector<uint8> file;
+		if (!ConvertBattleMapText(MakeMapText(size), file).empty())
+		{
+			return;
+		}
+		string path = "BattleMapBenchmark" + to_string(size) + ".srpm";
+		ofstream(path, ios::binary).write(reinterpret_cast<char const*>(file.data()), file.size());
+
+		uint32 sum = 0;
+		runner.Run("BattleMap/OpenAndReadTile/" + to_string(size), 1, [&]
+		{
+			Ptr<BattleMap> map = BattleMap::Open(path);
+			sum += map->GetTile(size / 2, size / 2).height;
+		});
+		remove(path.c_str());
+	}
+
+	void RunBattleMapBenchmarks(BenchmarkRunner& runner)
+	{
+		RunOpen(runner, 64);
+		RunOpen(runner, 4096);
+	}
+
+	BenchmarkRegistration registration("BattleMap", &RunBattleMapBenchmarks);
+}
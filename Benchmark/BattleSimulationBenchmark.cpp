@@ -0,0 +1,109 @@
+#include "Benchmark.h"
+#include "BattleSimulation.h"
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const MapSize = 64;
+	uint32 const PairCount = 24;
+
+	/*
+	*	Open terrain with forests and mountains, the two teams face each other in pairs along the middle rows.
+	*/
+	Ptr<BattleMap> MakeMap()
+	{
+		string text = "size " + to_string(MapSize) + " " + to_string(MapSize) + "\ntiles\n";
+		char const terrain[] = "..f.^";
+		for (uint32 y = 0; y < MapSize; ++y)
+		{
+			for (uint32 x = 0; x < MapSize; ++x)
+			{
+				text += terrain[(x / 3 + y / 2) % 5];
+			}
+			text += '\n';
+		}
+		for (uint32 pair = 0; pair < PairCount; ++pair)
+		{
+			text += "unit " + to_string(pair * 2 + 4) + " 31 0 s Soldier\n";
+			text += "unit " + to_string(pair * 2 + 4) + " 32 1 n Soldier\n";
+		}
+		vector<uint8> file;
+		if (!ConvertBattleMapText(text, file).empty())
+		{
+			return nullptr;
+		}
+		return BattleMap::Create(move(file));
+	}
+
+	void RunBattleSimulationBenchmarks(BenchmarkRunner& runner)
+	{
+		Ptr<BattleMap> map = MakeMap();
+		if (!map)
+		{
+			return;
+		}
+		BattleSimulation simulation(map, 1);
+
+		uint32 sum = 0;
+		runner.Run("Battle/GetTile", MapSize * MapSize, [&]
+		{
+			for (uint32 y = 0; y < MapSize; ++y)
+			{
+				for (uint32 x = 0; x < MapSize; ++x)
+				{
+					sum += map->GetTile(x, y).height;
+				}
+			}
+		});
+
+		runner.Run("Battle/FindUnit", MapSize * MapSize, [&]
+		{
+			for (uint16 y = 0; y < MapSize; ++y)
+			{
+				for (uint16 x = 0; x < MapSize; ++x)
+				{
+					sum += simulation.FindUnit(x, y);
+				}
+			}
+		});
+
+		// The tiles a selected unit can reach, what the move overlay asks for every unit of the current team.
+		uint32 const RangeTiles = 2 * BattleSimulation::MoveRange * (BattleSimulation::MoveRange + 1) + 1;
+		runner.Run("Battle/MoveRange", PairCount * RangeTiles, [&]
+		{
+			for (uint16 unit = 0; unit < simulation.GetUnits().size(); ++unit)
+			{
+				BattleUnit const& placed = simulation.GetUnits()[unit];
+				if (placed.team != simulation.GetCurrentTeam())
+				{
+					continue;
+				}
+				sint32 range = sint32(BattleSimulation::MoveRange);
+				for (sint32 dy = -range; dy <= range; ++dy)
+				{
+					sint32 width = range - (dy < 0 ? -dy : dy);
+					for (sint32 dx = -width; dx <= width; ++dx)
+					{
+						sum += simulation.CanMove(unit, uint16(placed.x + dx), uint16(placed.y + dy)) ? 1 : 0;
+					}
+				}
+			}
+		});
+
+		// Every pair fights once on a copy of the battle, as previewing the outcome of an attack does.
+		runner.Run("Battle/ResolveAttacks", PairCount, [&]
+		{
+			BattleSimulation preview = simulation;
+			for (uint16 pair = 0; pair < PairCount; ++pair)
+			{
+				preview.Apply({ BattleCommand::Type::Attack, uint16(pair * 2), 0, 0, uint16(pair * 2 + 1) });
+			}
+			sum += preview.GetChecksum();
+		});
+	}
+
+	BenchmarkRegistration registration("Battle", &RunBattleSimulationBenchmarks);
+}
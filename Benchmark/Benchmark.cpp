@@ -0,0 +1,131 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	struct RegisteredBenchmark
+	{
+		char const* name;
+		void(*function)(BenchmarkRunner& runner);
+	};
+
+	vector<RegisteredBenchmark>& GetRegistry()
+	{
+		static vector<RegisteredBenchmark> registry;
+		return registry;
+	}
+
+	string GetCompiler()
+	{
+#if defined(_MSC_VER)
+		return "msvc " + to_string(_MSC_VER);
+#elif defined(__clang__)
+		return "clang " + to_string(__clang_major__) + "." + to_string(__clang_minor__);
+#elif defined(__GNUC__)
+		return "gcc " + to_string(__GNUC__) + "." + to_string(__GNUC_MINOR__);
+#else
+		return "unknown";
+#endif
+	}
+
+	void WriteJsonString(ostream& stream, string const& text)
+	{
+		stream << '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				stream << '\\';
+			}
+			stream << c;
+		}
+		stream << '"';
+	}
+
+	/*
+	*	One object per result plus what the numbers depend on, so runs from different machines or builds are not
+	*	compared by accident.
+	*/
+	bool WriteJson(string const& path, vector<BenchmarkResult> const& results)
+	{
+		ofstream file(path);
+		file << "{\n\t\"compiler\": ";
+		WriteJsonString(file, GetCompiler());
+#ifdef NDEBUG
+		file << ",\n\t\"configuration\": \"release\"";
+#else
+		file << ",\n\t\"configuration\": \"debug\"";
+#endif
+		file << ",\n\t\"hardwareThreads\": " << thread::hardware_concurrency();
+		file << ",\n\t\"results\": [";
+		char number[64];
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			BenchmarkResult const& result = results[i];
+			file << (i == 0 ? "\n" : ",\n") << "\t\t{ \"name\": ";
+			WriteJsonString(file, result.name);
+			file << ", \"iterations\": " << result.iterations;
+			snprintf(number, sizeof(number), "%.9g", result.secondsPerIteration);
+			file << ", \"secondsPerIteration\": " << number;
+			snprintf(number, sizeof(number), "%.9g", result.itemsPerSecond);
+			file << ", \"itemsPerSecond\": " << number << " }";
+		}
+		file << "\n\t]\n}\n";
+		return bool(file);
+	}
+}
+
+BenchmarkRegistration::BenchmarkRegistration(char const* name, void(*function)(BenchmarkRunner& runner))
+{
+	GetRegistry().push_back({ name, function });
+}
+
+void BenchmarkRunner::Report(BenchmarkResult const& result)
+{
+	printf("%-48s %12llu iterations %14.3f us/iteration %16.0f items/s\n",
+		result.name.c_str(), (unsigned long long)result.iterations, result.secondsPerIteration * 1e6, result.itemsPerSecond);
+	_results.push_back(result);
+}
+
+/*
+*	Usage: Benchmark [filter] [--json path]
+*	Only benchmarks whose registered name contains filter are run. --json also writes the results to path.
+*/
+int main(int argc, char** argv)
+{
+	char const* filter = nullptr;
+	char const* jsonPath = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			jsonPath = argv[++i];
+		}
+		else
+		{
+			filter = argv[i];
+		}
+	}
+
+	BenchmarkRunner runner;
+	for (auto const& benchmark : GetRegistry())
+	{
+		if (filter == nullptr || strstr(benchmark.name, filter) != nullptr)
+		{
+			benchmark.function(runner);
+		}
+	}
+	if (jsonPath && !WriteJson(jsonPath, runner.GetResults()))
+	{
+		fprintf(stderr, "Could not write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
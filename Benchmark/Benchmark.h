@@ -0,0 +1,67 @@
+#pragma once
+#include "BasicType.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace X
+{
+	struct BenchmarkResult
+	{
+		std::string name;
+		uint64 iterations;
+		float64 secondsPerIteration;
+		float64 itemsPerSecond;
+	};
+
+	class BenchmarkRunner
+	{
+	public:
+		/*
+		*	Calls body repeatedly for about minimumSeconds after one warm up call.
+		*	@items: work items processed by a single call of body, used to report throughput.
+		*/
+		template <class Body>
+		void Run(std::string name, uint64 items, Body&& body)
+		{
+			using Clock = std::chrono::steady_clock;
+			body();
+
+			uint64 iterations = 0;
+			Clock::time_point start = Clock::now();
+			std::chrono::duration<float64> elapsed;
+			do
+			{
+				body();
+				++iterations;
+				elapsed = Clock::now() - start;
+			} while (elapsed.count() < _minimumSeconds);
+
+			BenchmarkResult result;
+			result.name = std::move(name);
+			result.iterations = iterations;
+			result.secondsPerIteration = elapsed.count() / iterations;
+			result.itemsPerSecond = float64(items) / result.secondsPerIteration;
+			Report(result);
+		}
+
+		std::vector<BenchmarkResult> const& GetResults() const
+		{
+			return _results;
+		}
+
+	private:
+		void Report(BenchmarkResult const& result);
+
+		float64 _minimumSeconds = 0.5;
+		std::vector<BenchmarkResult> _results;
+	};
+
+	/*
+	*	Benchmarks register themselves through a static BenchmarkRegistration in their own translation unit.
+	*/
+	struct BenchmarkRegistration
+	{
+		BenchmarkRegistration(char const* name, void(*function)(BenchmarkRunner& runner));
+	};
+}
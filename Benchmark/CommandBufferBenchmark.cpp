@@ -0,0 +1,166 @@
+#include "Benchmark.h"
+#include "CommandBuffer.h"
+#include "JobSystem.h"
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	// A sprite batch per draw: texture, scissor, 4 vertices and 6 indices, the usual UI and 2D map draw.
+	uint32 const SpritesPerThread = 16384;
+	uint32 const CommandsPerSprite = 4;
+
+	void RecordSprites(CommandBuffer& commands, uint32 first)
+	{
+		uint16 const indices[] = { 0, 1, 2, 0, 2, 3 };
+		for (uint32 i = 0; i < SpritesPerThread; ++i)
+		{
+			float32 x = float32((first + i) % 256 * 8);
+			float32 y = float32((first + i) / 256 % 256 * 8);
+			ParticleVertex* vertices = static_cast<ParticleVertex*>(commands.SetVertices(4, sizeof(ParticleVertex)));
+			vertices[0] = { x, y, 0, 0, 0xFFFFFFFF };
+			vertices[1] = { x + 8, y, 1, 0, 0xFFFFFFFF };
+			vertices[2] = { x + 8, y + 8, 1, 1, 0xFFFFFFFF };
+			vertices[3] = { x, y + 8, 0, 1, 0xFFFFFFFF };
+			commands.SetTexture(reinterpret_cast<void*>(uintptr_t(i % 8 + 1)));
+			commands.SetScissor(0, 0, 2048, 2048);
+			commands.DrawIndexed(indices, 6, 0);
+		}
+	}
+
+	// Laid out like ImDrawVert, ImGui itself is not part of this project.
+	struct GuiVertex
+	{
+		float32 x, y, u, v;
+		uint32 color;
+	};
+
+	struct GuiDrawList
+	{
+		vector<GuiVertex> vertices;
+		vector<uint16> indices;
+		vector<uint32> commandCounts;	// indices per draw, scissor and texture change between them
+	};
+
+	/*
+	*	A busy debug UI: 16 windows of 2000 vertices, mostly text quads, 12 draws each.
+	*/
+	vector<GuiDrawList> MakeGuiDrawLists()
+	{
+		vector<GuiDrawList> lists(16);
+		for (GuiDrawList& list : lists)
+		{
+			uint32 const QuadCount = 500;
+			for (uint32 quad = 0; quad < QuadCount; ++quad)
+			{
+				float32 x = float32(quad % 50 * 7);
+				float32 y = float32(quad / 50 * 13);
+				uint16 first = uint16(list.vertices.size());
+				list.vertices.push_back({ x, y, 0, 0, 0xFFFFFFFF });
+				list.vertices.push_back({ x + 7, y, 1, 0, 0xFFFFFFFF });
+				list.vertices.push_back({ x + 7, y + 13, 1, 1, 0xFFFFFFFF });
+				list.vertices.push_back({ x, y + 13, 0, 1, 0xFFFFFFFF });
+				uint16 const quadIndices[] = { 0, 1, 2, 0, 2, 3 };
+				for (uint16 index : quadIndices)
+				{
+					list.indices.push_back(uint16(first + index));
+				}
+			}
+			uint32 const DrawCount = 12;
+			for (uint32 draw = 0; draw < DrawCount; ++draw)
+			{
+				list.commandCounts.push_back(QuadCount / DrawCount * 6);
+			}
+			list.commandCounts.back() += QuadCount % DrawCount * 6;
+		}
+		return lists;
+	}
+
+	/*
+	*	Everything the ImGui renderer records per frame: viewport, projection, then per list its vertices and a texture,
+	*	scissor and draw per command.
+	*/
+	void RecordGuiDrawLists(CommandBuffer& commands, vector<GuiDrawList> const& lists)
+	{
+		commands.SetViewport(0, 0, 1280, 800);
+		float32 const projection[4][4] = {};
+		commands.SetProjection(projection);
+		for (GuiDrawList const& list : lists)
+		{
+			commands.SetVertices(list.vertices.data(), uint32(list.vertices.size()), sizeof(GuiVertex));
+			uint16 const* indices = list.indices.data();
+			for (uint32 count : list.commandCounts)
+			{
+				commands.SetTexture(reinterpret_cast<void*>(uintptr_t(1)));
+				commands.SetScissor(0, 0, 1280, 800);
+				commands.DrawIndexed(indices, count, 0);
+				indices += count;
+			}
+		}
+	}
+
+	/*
+	*	Every thread records into a buffer of its own, items are the commands of one thread so the result is commands
+	*	per second per core.
+	*/
+	void RunCommandBufferBenchmarks(BenchmarkRunner& runner)
+	{
+		uint32 hardwareThreads = max(thread::hardware_concurrency(), 1u);
+		for (uint32 threads = 1; threads <= hardwareThreads; threads *= 2)
+		{
+			Ptr<JobSystem> jobs = JobSystem::Create(threads);
+			vector<CommandBuffer> buffers(threads);
+			runner.Run("CommandBuffer/Record/" + to_string(threads) + "Threads", SpritesPerThread * CommandsPerSprite, [&]
+			{
+				JobCounter counter;
+				for (uint32 i = 0; i < threads; ++i)
+				{
+					jobs->Run([&buffers, i]
+					{
+						buffers[i].Reset();
+						RecordSprites(buffers[i], i * SpritesPerThread);
+					}, &counter);
+				}
+				jobs->Wait(counter);
+			});
+
+			// Always end on all cores, also when their count is not a power of two.
+			if (threads < hardwareThreads && threads * 2 > hardwareThreads)
+			{
+				threads = hardwareThreads / 2;
+			}
+		}
+
+		// Replaying the single thread recording without a GPU, the decoding cost the D3D11 backend pays as well.
+		CommandBuffer commands;
+		RecordSprites(commands, 0);
+		HeadlessCommandBackend backend;
+		CommandBuffer const* buffers[] = { &commands };
+		runner.Run("CommandBuffer/ReplayHeadless", SpritesPerThread * CommandsPerSprite, [&]
+		{
+			backend.Execute(buffers, 1);
+		});
+
+		// Items are vertices, the copies dominate.
+		vector<GuiDrawList> lists = MakeGuiDrawLists();
+		uint64 guiVertices = 0;
+		for (GuiDrawList const& list : lists)
+		{
+			guiVertices += list.vertices.size();
+		}
+		CommandBuffer guiCommands;
+		runner.Run("CommandBuffer/RecordImGuiDrawLists", guiVertices, [&]
+		{
+			guiCommands.Reset();
+			RecordGuiDrawLists(guiCommands, lists);
+		});
+	}
+
+	BenchmarkRegistration registration("CommandBuffer", &RunCommandBufferBenchmarks);
+}
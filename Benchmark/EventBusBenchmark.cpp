@@ -0,0 +1,89 @@
+#include "Benchmark.h"
+#include "BattleSimulation.h"
+#include "EventBus.h"
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const Count = 4096;
+
+	struct Presentation
+	{
+		sint64 damage = 0;
+		uint32 moves = 0;
+		uint32 deaths = 0;
+
+		void OnMoved(UnitMovedEvent const& event)
+		{
+			moves += event.toX + event.toY;
+		}
+		void OnDamaged(UnitDamagedEvent const& event)
+		{
+			damage += event.damage;
+		}
+		void OnDied(UnitDiedEvent const&)
+		{
+			++deaths;
+		}
+	};
+
+	/*
+	*	Three subscribers to one event, called through delegates and through the std::function list they replaced. Then a
+	*	frame of battle events queued and dispatched, which must not allocate once the queues have grown.
+	*/
+	void RunEventBusBenchmarks(BenchmarkRunner& runner)
+	{
+		Presentation presentation;
+		BattleEvents events;
+		events.Subscribe<UnitMovedEvent>(Delegate<void(UnitMovedEvent const&)>::Bind<Presentation, &Presentation::OnMoved>(&presentation));
+		events.Subscribe<UnitDamagedEvent>(Delegate<void(UnitDamagedEvent const&)>::Bind<Presentation, &Presentation::OnDamaged>(&presentation));
+		events.Subscribe<UnitDamagedEvent>([&presentation](UnitDamagedEvent const& event) { presentation.damage += event.health; });
+		events.Subscribe<UnitDamagedEvent>([&presentation](UnitDamagedEvent const& event) { presentation.damage ^= event.unit; });
+		events.Subscribe<UnitDiedEvent>(Delegate<void(UnitDiedEvent const&)>::Bind<Presentation, &Presentation::OnDied>(&presentation));
+
+		vector<function<void(UnitDamagedEvent const&)>> functions;
+		functions.push_back([&presentation](UnitDamagedEvent const& event) { presentation.OnDamaged(event); });
+		functions.push_back([&presentation](UnitDamagedEvent const& event) { presentation.damage += event.health; });
+		functions.push_back([&presentation](UnitDamagedEvent const& event) { presentation.damage ^= event.unit; });
+
+		runner.Run("EventBus/Publish", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				events.Publish(UnitDamagedEvent{ uint16(index), 0, sint32(index & 15), 40 });
+			}
+		});
+		runner.Run("EventBus/StdFunction", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				UnitDamagedEvent event = { uint16(index), 0, sint32(index & 15), 40 };
+				for (auto const& handler : functions)
+				{
+					handler(event);
+				}
+			}
+		});
+
+		runner.Run("EventBus/QueueDispatch", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; index += 4)
+			{
+				events.Queue(UnitMovedEvent{ uint16(index), 1, 1, 2, 2 });
+				events.Queue(UnitDamagedEvent{ uint16(index), uint16(index + 1), 9, 31 });
+				events.Queue(UnitDamagedEvent{ uint16(index + 1), uint16(index), 7, 0 });
+				events.Queue(UnitDiedEvent{ uint16(index + 1), 1 });
+			}
+			events.Dispatch();
+		});
+
+		printf("    %u moves %u deaths dispatched, %lld damage\n", presentation.moves, presentation.deaths, (long long)presentation.damage);
+	}
+
+	BenchmarkRegistration registration("EventBus", &RunEventBusBenchmarks);
+}
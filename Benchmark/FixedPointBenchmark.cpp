@@ -0,0 +1,98 @@
+#include "Benchmark.h"
+#include "FixedPoint.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const Count = 4096;
+
+	uint32 NextRandom(uint32& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	void RunFixedPointBenchmarks(BenchmarkRunner& runner)
+	{
+		uint32 state = 1;
+		vector<Fixed16> positions(Count), velocities(Count), results(Count), batchResults(Count);
+		vector<float32> floatPositions(Count), floatVelocities(Count), floatResults(Count);
+		vector<uint32> angles(Count);
+		for (uint32 index = 0; index < Count; ++index)
+		{
+			positions[index] = Fixed16::FromRaw(sint32(NextRandom(state) % (1000u << 16)));
+			velocities[index] = Fixed16::FromRaw(sint32(NextRandom(state) % (20u << 16)) - (10 << 16));
+			floatPositions[index] = float32(positions[index].ToDouble());
+			floatVelocities[index] = float32(velocities[index].ToDouble());
+			angles[index] = NextRandom(state);
+		}
+		Fixed16 const step = Fixed16::FromRatio(1, 60);
+		vector<Fixed16> steps(Count, step);
+		float32 const floatStep = 1.0f / 60;
+
+		runner.Run("FixedPoint/MultiplyAdd", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				results[index] = velocities[index] * step + positions[index];
+			}
+		});
+		runner.Run("FixedPoint/MultiplyAddBatch", Count, [&]
+		{
+			MultiplyAddBatch(velocities.data(), steps.data(), positions.data(), batchResults.data(), Count);
+		});
+		runner.Run("FixedPoint/FloatMultiplyAdd", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				floatResults[index] = floatVelocities[index] * floatStep + floatPositions[index];
+			}
+		});
+
+		runner.Run("FixedPoint/Sqrt", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				results[index] = Sqrt(positions[index]);
+			}
+		});
+		runner.Run("FixedPoint/FloatSqrt", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				floatResults[index] = sqrt(floatPositions[index]);
+			}
+		});
+
+		runner.Run("FixedPoint/Sin", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				results[index] = Sin<Fixed16>(angles[index]);
+			}
+		});
+		runner.Run("FixedPoint/FloatSin", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				floatResults[index] = sin(float32(angles[index]) * (6.2831853f / 4294967296.0f));
+			}
+		});
+
+		for (uint32 index = 0; index < Count; ++index)
+		{
+			results[index] = velocities[index] * step + positions[index];
+		}
+		MultiplyAddBatch(velocities.data(), steps.data(), positions.data(), batchResults.data(), Count);
+		printf("    batch %s scalar\n", results == batchResults ? "matches" : "DIFFERS FROM");
+	}
+
+	BenchmarkRegistration registration("FixedPoint", &RunFixedPointBenchmarks);
+}
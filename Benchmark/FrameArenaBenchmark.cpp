@@ -0,0 +1,63 @@
+#include "Benchmark.h"
+#include "FrameArena.h"
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const AllocationCount = 10000;
+
+	/*
+	*	A frame's worth of small transient allocations, from the arena and from the heap for comparison.
+	*/
+	void RunFrameArenaBenchmarks(BenchmarkRunner& runner)
+	{
+		FrameArena arena(4 * 1024 * 1024);
+		runner.Run("FrameArena/Allocate", AllocationCount, [&]
+		{
+			arena.BeginFrame();
+			for (uint32 i = 0; i < AllocationCount; ++i)
+			{
+				static_cast<uint8*>(arena.Allocate(16 + i % 8 * 16))[0] = uint8(i);
+			}
+		});
+
+		vector<void*> blocks(AllocationCount);
+		runner.Run("FrameArena/HeapAllocate", AllocationCount, [&]
+		{
+			for (uint32 i = 0; i < AllocationCount; ++i)
+			{
+				blocks[i] = malloc(16 + i % 8 * 16);
+				static_cast<uint8*>(blocks[i])[0] = uint8(i);
+			}
+			for (void* block : blocks)
+			{
+				free(block);
+			}
+		});
+
+		// Growing containers, the draw lists and visible sets built every frame.
+		runner.Run("FrameArena/FrameVector", AllocationCount, [&]
+		{
+			arena.BeginFrame();
+			FrameVector<uint32> values(arena);
+			for (uint32 i = 0; i < AllocationCount; ++i)
+			{
+				values.push_back(i);
+			}
+		});
+		runner.Run("FrameArena/HeapVector", AllocationCount, [&]
+		{
+			vector<uint32> values;
+			for (uint32 i = 0; i < AllocationCount; ++i)
+			{
+				values.push_back(i);
+			}
+		});
+	}
+
+	BenchmarkRegistration registration("FrameArena", &RunFrameArenaBenchmarks);
+}
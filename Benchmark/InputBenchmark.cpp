@@ -0,0 +1,39 @@
+#include "Benchmark.h"
+#include "Input.h"
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const KeyCount = 4096;
+
+	/*
+	*	A stream of virtual keys as typing and mouse buttons produce them, mostly letters, digits and modifiers.
+	*/
+	void RunInputBenchmarks(BenchmarkRunner& runner)
+	{
+		vector<uint32> keys;
+		uint32 random = 12345;
+		for (uint32 i = 0; i < KeyCount; ++i)
+		{
+			random = random * 1664525u + 1013904223u;
+			uint32 const modifiers[] = { 0x01, 0x02, 0xA0, 0xA2, 0xA4, 0x20, 0x0D, 0x1B };
+			// VK_A to VK_Z and VK_0 to VK_9 are their ASCII characters.
+			uint32 character = (random >> 8) % 36;
+			keys.push_back(random % 4 == 0 ? modifiers[(random >> 8) % 8] : character < 26 ? 'A' + character : '0' + character - 26);
+		}
+
+		uint32 sum = 0;
+		runner.Run("Input/TranslateWindowsVK", KeyCount, [&]
+		{
+			for (uint32 key : keys)
+			{
+				sum += uint32(InputSemanticFromWindowsVK(key));
+			}
+		});
+	}
+
+	BenchmarkRegistration registration("Input", &RunInputBenchmarks);
+}
@@ -0,0 +1,82 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const ItemCount = 1 << 18;
+	uint32 const TaskCount = 4096;
+
+	// Enough arithmetic per item that the result measures scheduling and not memory bandwidth.
+	float32 Work(float32 value)
+	{
+		for (uint32 i = 0; i < 16; ++i)
+		{
+			value = sqrt(value * value + 1.0f);
+		}
+		return value;
+	}
+
+	/*
+	*	Same work over 1 to all cores worth of workers: a flat ParallelFor, and small independent jobs that each start a nested
+	*	ParallelFor, which is the case stealing is for.
+	*/
+	void RunJobSystemBenchmarks(BenchmarkRunner& runner)
+	{
+		vector<float32> values(ItemCount, 1.0f);
+		uint32 hardwareThreads = max(thread::hardware_concurrency(), 1u);
+		for (uint32 workers = 1; workers <= hardwareThreads; workers *= 2)
+		{
+			// The thread calling ParallelFor or Wait works along with them.
+			Ptr<JobSystem> jobs = JobSystem::Create(workers);
+			string suffix = "/" + to_string(workers) + "Workers";
+
+			runner.Run("JobSystem/ParallelFor" + suffix, ItemCount, [&]
+			{
+				jobs->ParallelFor(ItemCount, 0, [&](uint32 begin, uint32 end)
+				{
+					for (uint32 i = begin; i < end; ++i)
+					{
+						values[i] = Work(values[i]);
+					}
+				});
+			});
+
+			runner.Run("JobSystem/NestedJobs" + suffix, ItemCount, [&]
+			{
+				JobCounter counter;
+				uint32 const itemsPerTask = ItemCount / TaskCount;
+				for (uint32 task = 0; task < TaskCount; ++task)
+				{
+					jobs->Run([&, task]
+					{
+						float32* taskValues = &values[task * itemsPerTask];
+						jobs->ParallelFor(itemsPerTask, 16, [taskValues](uint32 begin, uint32 end)
+						{
+							for (uint32 i = begin; i < end; ++i)
+							{
+								taskValues[i] = Work(taskValues[i]);
+							}
+						});
+					}, &counter);
+				}
+				jobs->Wait(counter);
+			});
+
+			// Always end on all cores, also when their count is not a power of two.
+			if (workers < hardwareThreads && workers * 2 > hardwareThreads)
+			{
+				workers = hardwareThreads / 2;
+			}
+		}
+	}
+
+	BenchmarkRegistration registration("JobSystem", &RunJobSystemBenchmarks);
+}
@@ -0,0 +1,101 @@
+#include "Benchmark.h"
+#include "Lockstep.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const TicksPerRun = 600;
+	uint32 const InputDelay = 6;
+
+	Ptr<BattleMap> MakeMap()
+	{
+		string text = "size 24 24\ntiles\n";
+		for (uint32 y = 0; y < 24; ++y)
+		{
+			for (uint32 x = 0; x < 24; ++x)
+			{
+				text += (x + y * 2) % 7 == 0 ? 'f' : '.';
+			}
+			text += '\n';
+		}
+		for (uint32 index = 0; index < 8; ++index)
+		{
+			text += "unit " + to_string(4 + index * 2) + " 10 0 s Blue\n";
+			text += "unit " + to_string(4 + index * 2) + " 13 1 n Red\n";
+		}
+		vector<uint8> file;
+		ConvertBattleMapText(text, file);
+		return BattleMap::Create(move(file));
+	}
+
+	struct MatchResult
+	{
+		uint32 checksum;
+		uint32 ticks;
+		bool desynced;
+		LockstepSession::Statistics statistics[2];
+	};
+
+	/*
+	*	Ten seconds of a match between two sessions over a connection with 60 ms latency and 10% loss, both players
+	*	moving a unit now and then.
+	*/
+	MatchResult PlayMatch(Ptr<BattleMap> const& map, uint32 inputDelay)
+	{
+		BattleSimulation simulations[2] = { BattleSimulation(map, 5), BattleSimulation(map, 5) };
+		SimulatedNetwork network({ 60, 15, 0.1, 11 });
+		LockstepSession session0(simulations[0], network.GetEndpoint(0), 0, inputDelay);
+		LockstepSession session1(simulations[1], network.GetEndpoint(1), 1, inputDelay);
+		LockstepSession* sessions[2] = { &session0, &session1 };
+		for (uint32 step = 0; session0.GetTick() < TicksPerRun && step < TicksPerRun * 4; ++step)
+		{
+			for (uint8 player = 0; player < 2; ++player)
+			{
+				if (step % 10 == player * 5)
+				{
+					uint16 unit = uint16((step / 10) % 8 * 2 + player);
+					BattleUnit const& placed = simulations[player].GetUnits()[unit];
+					sessions[player]->Queue({ BattleCommand::Type::Move, unit, uint16(placed.x + step % 3), placed.y, 0 });
+					sessions[player]->Queue({ BattleCommand::Type::EndTurn, 0, 0, 0, 0 });
+				}
+			}
+			network.Advance(1000.0 / 60);
+			session0.Update(2);
+			session1.Update(2);
+		}
+		return { simulations[0].GetChecksum(), session0.GetTick(), session0.IsDesynced() || session1.IsDesynced(),
+			{ session0.GetStatistics(), session1.GetStatistics() } };
+	}
+
+	/*
+	*	Measures the protocol around the simulation, not the network. The traffic shows what the input delay buys:
+	*	commands that arrive within it are sent about once, without it every packet repeats the ones of a round trip.
+	*/
+	void RunLockstepBenchmarks(BenchmarkRunner& runner)
+	{
+		Ptr<BattleMap> map = MakeMap();
+		uint32 sum = 0;
+		runner.Run("Lockstep/TwoPeers", TicksPerRun, [&]
+		{
+			MatchResult result = PlayMatch(map, InputDelay);
+			sum += result.checksum + result.statistics[0].stalls;
+		});
+
+		uint32 const inputDelays[] = { 0, 2, InputDelay };
+		for (uint32 inputDelay : inputDelays)
+		{
+			MatchResult result = PlayMatch(map, inputDelay);
+			LockstepSession::Statistics const& statistics = result.statistics[0];
+			printf("    input delay %u: %.1f bytes/tick, %.2f packets/tick, %u stalls in %u ticks, %u checksums, %s\n", inputDelay,
+				float64(statistics.bytesSent) / max(result.ticks, 1u), float64(statistics.packetsSent) / max(result.ticks, 1u),
+				statistics.stalls, result.ticks, statistics.checksumsCompared, result.desynced ? "DESYNCED" : "in sync");
+		}
+	}
+
+	BenchmarkRegistration registration("Lockstep", &RunLockstepBenchmarks);
+}
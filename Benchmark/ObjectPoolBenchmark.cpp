@@ -0,0 +1,102 @@
+#include "Benchmark.h"
+#include "ObjectPool.h"
+#include "ReferenceCount.h"
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const ObjectCount = 4096;
+
+	// A small game object, the size of a status effect or a pending command.
+	struct Payload
+	{
+		uint32 unit;
+		sint32 value;
+		uint32 remainingTurns;
+		float32 x, y;
+	};
+
+	struct HeapObject : public ReferenceCountBase<true>
+	{
+		Payload payload;
+	};
+
+	struct PooledObject : public ReferenceCountBase<true>, public PoolAllocated<true>
+	{
+		Payload payload;
+	};
+
+	struct SingleThreadHeapObject : public ReferenceCountBase<false>
+	{
+		Payload payload;
+	};
+
+	struct SingleThreadPooledObject : public ReferenceCountBase<false>, public PoolAllocated<false>
+	{
+		Payload payload;
+	};
+
+	/*
+	*	Creates a frame's worth of objects and releases them in a different order than they were made.
+	*/
+	template <class T>
+	void RunCreateRelease(BenchmarkRunner& runner, string name)
+	{
+		vector<Ptr<T>> objects(ObjectCount);
+		runner.Run(move(name), ObjectCount, [&]
+		{
+			for (uint32 i = 0; i < ObjectCount; ++i)
+			{
+				objects[i] = CreatePtr<T>();
+				objects[i]->payload.unit = i;
+			}
+			for (uint32 i = 0; i < ObjectCount; i += 2)
+			{
+				objects[i] = nullptr;
+			}
+			for (uint32 i = 1; i < ObjectCount; i += 2)
+			{
+				objects[i] = nullptr;
+			}
+		});
+	}
+
+	/*
+	*	Copies every pointer into a container and drops the copies again, as capturing them into lambdas does.
+	*/
+	template <class T>
+	void RunCopy(BenchmarkRunner& runner, string name)
+	{
+		vector<Ptr<T>> objects;
+		for (uint32 i = 0; i < ObjectCount; ++i)
+		{
+			objects.push_back(CreatePtr<T>());
+		}
+		vector<Ptr<T>> copies;
+		copies.reserve(ObjectCount);
+		runner.Run(move(name), ObjectCount, [&]
+		{
+			for (Ptr<T> const& object : objects)
+			{
+				copies.push_back(object);
+			}
+			copies.clear();
+		});
+	}
+
+	void RunObjectPoolBenchmarks(BenchmarkRunner& runner)
+	{
+		RunCreateRelease<HeapObject>(runner, "ObjectPool/CreateRelease/Heap/Atomic");
+		RunCreateRelease<PooledObject>(runner, "ObjectPool/CreateRelease/Pool/Atomic");
+		RunCreateRelease<SingleThreadHeapObject>(runner, "ObjectPool/CreateRelease/Heap/NonAtomic");
+		RunCreateRelease<SingleThreadPooledObject>(runner, "ObjectPool/CreateRelease/Pool/NonAtomic");
+
+		RunCopy<HeapObject>(runner, "ObjectPool/PtrCopy/Atomic");
+		RunCopy<SingleThreadHeapObject>(runner, "ObjectPool/PtrCopy/NonAtomic");
+	}
+
+	BenchmarkRegistration registration("ObjectPool", &RunObjectPoolBenchmarks);
+}
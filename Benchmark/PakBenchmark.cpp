@@ -0,0 +1,113 @@
+#include "Benchmark.h"
+#include "PakFile.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const FileCount = 2000;
+
+	/*
+	*	Text-like content between 1 and 32 KB, compresses about as well as scripts and shader blobs.
+	*/
+	vector<uint8> MakeContent(uint32 index)
+	{
+		static char const* const words[] = { "unit", "attack", "move", "tile", "turn", "damage", "heal", "wait", "skill", "range" };
+		uint32 seed = index * 2654435761u + 1;
+		uint32 size = 1024 + (index * 7919) % (31 * 1024);
+		vector<uint8> content;
+		while (content.size() < size)
+		{
+			seed ^= seed << 13;
+			seed ^= seed >> 17;
+			seed ^= seed << 5;
+			char const* word = words[seed % 10];
+			content.insert(content.end(), word, word + strlen(word));
+			content.push_back(seed & 0x100 ? '\n' : ' ');
+		}
+		content.resize(size);
+		return content;
+	}
+
+	string LoosePath(uint32 index)
+	{
+		return "PakBenchmark" + to_string(index) + ".bin";
+	}
+
+	/*
+	*	The files stay in the OS file cache between iterations, so this measures the per-file open and read
+	*	overhead of a warm start, not disk latency.
+	*/
+	void RunPakBenchmarks(BenchmarkRunner& runner)
+	{
+		PakWriter writer;
+		uint64 totalBytes = 0;
+		for (uint32 index = 0; index < FileCount; ++index)
+		{
+			vector<uint8> content = MakeContent(index);
+			totalBytes += content.size();
+			ofstream(LoosePath(index), ios::binary).write(reinterpret_cast<char const*>(content.data()), content.size());
+			writer.Add("data/" + LoosePath(index), move(content));
+		}
+		string pakPath = "PakBenchmark.pak";
+		if (!writer.Save(pakPath).empty())
+		{
+			return;
+		}
+
+		uint64 readBytes = 0;
+		runner.Run("Pak/LooseFiles/" + to_string(FileCount), FileCount, [&]
+		{
+			for (uint32 index = 0; index < FileCount; ++index)
+			{
+				ifstream file(LoosePath(index), ios::binary);
+				vector<uint8> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+				readBytes += data.size();
+			}
+		});
+
+		runner.Run("Pak/Archive/" + to_string(FileCount), FileCount, [&]
+		{
+			Ptr<PakFile> pak = PakFile::Open(pakPath);
+			vector<uint8> data;
+			for (uint32 index = 0; index < FileCount; ++index)
+			{
+				pak->Read("data/" + LoosePath(index), data);
+				readBytes += data.size();
+			}
+		});
+
+		Ptr<JobSystem> jobs = JobSystem::Create();
+		runner.Run("Pak/ArchiveAsync/Workers" + to_string(jobs->GetWorkerCount()), FileCount, [&]
+		{
+			Ptr<PakFile> pak = PakFile::Open(pakPath);
+			atomic<uint64> asyncBytes{ 0 };
+			JobCounter counter;
+			for (uint32 index = 0; index < FileCount; ++index)
+			{
+				pak->ReadAsync(*jobs, "data/" + LoosePath(index), [&](bool, vector<uint8> data)
+				{
+					asyncBytes += data.size();
+				}, &counter);
+			}
+			jobs->Wait(counter);
+			readBytes += asyncBytes;
+		});
+
+		for (uint32 index = 0; index < FileCount; ++index)
+		{
+			remove(LoosePath(index).c_str());
+		}
+		remove(pakPath.c_str());
+	}
+
+	BenchmarkRegistration registration("Pak", &RunPakBenchmarks);
+}
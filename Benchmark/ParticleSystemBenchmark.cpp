@@ -0,0 +1,72 @@
+#include "Benchmark.h"
+#include "ParticleSystem.h"
+#include "JobSystem.h"
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const ParticleBudget = 200000;
+
+	ParticleEmitterDesc MakeDesc(uint32 capacity, uint32 priority, float32 lifetime)
+	{
+		ParticleEmitterDesc desc = {};
+		desc.capacity = capacity;
+		desc.priority = priority;
+		desc.minLifetime = lifetime * 0.5f;
+		desc.maxLifetime = lifetime;
+		desc.minSpeed = 20;
+		desc.maxSpeed = 120;
+		desc.minAngle = 0;
+		desc.maxAngle = 6.2831853f;
+		desc.gravityY = 98;
+		desc.drag = 0.8f;
+		desc.startSize = 8;
+		desc.endSize = 1;
+		desc.startColor = 0xFF40C0FF;
+		desc.endColor = 0x00FFFFFF;
+		desc.u1 = desc.v1 = 1;
+		return desc;
+	}
+
+	/*
+	*	Keeps the system saturated at the budget: every frame refills what died, spread over a grid of emitters.
+	*/
+	void RunFrame(BenchmarkRunner& runner, string name, JobSystem* jobs)
+	{
+		ParticleSystem particles(ParticleBudget);
+		ParticleSystem::EmitterTypeID types[] =
+		{
+			particles.RegisterEmitterType(MakeDesc(100000, 0, 1.5f)),	// spell
+			particles.RegisterEmitterType(MakeDesc(60000, 1, 0.8f)),	// hit sparks
+			particles.RegisterEmitterType(MakeDesc(40000, 2, 2.0f)),	// smoke
+		};
+		vector<ParticleVertex> vertices(ParticleBudget * 4);
+		// Scrolled and zoomed, from world to screen pixels.
+		Transform2D camera = Transform2D::Make({ -320, -180 }, 0, { 1.5f, 1.5f });
+
+		uint32 frame = 0;
+		runner.Run(move(name), ParticleBudget, [&]
+		{
+			for (uint32 emitter = 0; emitter < 64; ++emitter)
+			{
+				particles.Emit(types[(emitter + frame) % 3], float32(emitter % 8) * 100, float32(emitter / 8) * 100, ParticleBudget / 64 / 30);
+			}
+			particles.Update(1.0f / 60, jobs);
+			particles.WriteVertices(vertices.data(), camera, jobs);
+			++frame;
+		});
+	}
+
+	void RunParticleSystemBenchmarks(BenchmarkRunner& runner)
+	{
+		RunFrame(runner, "ParticleSystem/UpdateAndWrite/SingleThread", nullptr);
+
+		Ptr<JobSystem> jobs = JobSystem::Create();
+		RunFrame(runner, "ParticleSystem/UpdateAndWrite/Workers" + to_string(jobs->GetWorkerCount()), &*jobs);
+	}
+
+	BenchmarkRegistration registration("ParticleSystem", &RunParticleSystemBenchmarks);
+}
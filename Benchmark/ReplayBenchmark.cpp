@@ -0,0 +1,138 @@
+#include "Benchmark.h"
+#include "Replay.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const TicksPerSecond = 60;
+	// Time the game spends animating each command.
+	uint32 const TicksPerCommand = 20;
+
+	Ptr<BattleMap> MakeMap()
+	{
+		string text = "size 32 32\ntiles\n";
+		for (uint32 y = 0; y < 32; ++y)
+		{
+			for (uint32 x = 0; x < 32; ++x)
+			{
+				text += (x * 7 + y * 3) % 11 == 0 ? '~' : (x + y) % 5 == 0 ? 'f' : '.';
+			}
+			text += '\n';
+		}
+		for (uint32 index = 0; index < 12; ++index)
+		{
+			text += "unit " + to_string(2 + index * 2) + " 1 0 s Blue\n";
+			text += "unit " + to_string(3 + index * 2) + " 30 1 n Red\n";
+		}
+		vector<uint8> file;
+		ConvertBattleMapText(text, file);
+		return BattleMap::Create(move(file));
+	}
+
+	void Wait(ReplayRecorder& recorder, BattleSimulation& simulation)
+	{
+		for (uint32 tick = 0; tick < TicksPerCommand; ++tick)
+		{
+			recorder.Tick(simulation);
+		}
+	}
+
+	/*
+	*	Every unit walks towards the closest enemy and attacks it once adjacent.
+	*/
+	void PlayTurn(ReplayRecorder& recorder, BattleSimulation& simulation)
+	{
+		vector<BattleUnit> const& units = simulation.GetUnits();
+		for (uint16 index = 0; index < units.size(); ++index)
+		{
+			if (units[index].health <= 0 || units[index].team != simulation.GetCurrentTeam())
+			{
+				continue;
+			}
+			uint16 closest = 0xFFFF;
+			sint32 closestDistance = 0;
+			for (uint16 other = 0; other < units.size(); ++other)
+			{
+				if (units[other].health > 0 && units[other].team != units[index].team)
+				{
+					sint32 distance = abs(units[other].x - units[index].x) + abs(units[other].y - units[index].y);
+					if (closest == 0xFFFF || distance < closestDistance)
+					{
+						closest = other;
+						closestDistance = distance;
+					}
+				}
+			}
+			if (closest == 0xFFFF)
+			{
+				return;
+			}
+
+			BattleUnit const& target = units[closest];
+			uint16 bestX = units[index].x, bestY = units[index].y;
+			sint32 bestDistance = closestDistance;
+			for (sint32 dy = -4; dy <= 4; ++dy)
+			{
+				for (sint32 dx = -4; dx <= 4; ++dx)
+				{
+					sint32 x = units[index].x + dx, y = units[index].y + dy;
+					if (x < 0 || y < 0 || !simulation.CanMove(index, uint16(x), uint16(y)))
+					{
+						continue;
+					}
+					sint32 distance = abs(target.x - x) + abs(target.y - y);
+					if (distance >= 1 && distance < bestDistance)
+					{
+						bestX = uint16(x);
+						bestY = uint16(y);
+						bestDistance = distance;
+					}
+				}
+			}
+			if (recorder.Apply(simulation, { BattleCommand::Type::Move, index, bestX, bestY, 0 }))
+			{
+				Wait(recorder, simulation);
+			}
+			if (recorder.Apply(simulation, { BattleCommand::Type::Attack, index, 0, 0, closest }))
+			{
+				Wait(recorder, simulation);
+			}
+		}
+		recorder.Apply(simulation, { BattleCommand::Type::EndTurn, 0, 0, 0, 0 });
+		Wait(recorder, simulation);
+	}
+
+	void RunReplayBenchmarks(BenchmarkRunner& runner)
+	{
+		Ptr<BattleMap> map = MakeMap();
+		uint64 seed = 20170611;
+		BattleSimulation recorded(map, seed);
+		ReplayRecorder recorder("benchmark.srpm", recorded, seed);
+		for (uint32 turn = 0; turn < 400 && recorded.GetWinner() == 0xFF; ++turn)
+		{
+			PlayTurn(recorder, recorded);
+		}
+		vector<uint8> data = recorder.Finish(recorded);
+
+		ReplayPlayer player;
+		player.Load(data);
+		uint32 ticks = recorded.GetTick();
+		ReplayPlayer::Result result = {};
+		runner.Run("Replay/HeadlessPlayback", ticks, [&]
+		{
+			BattleSimulation simulation(map, player.GetSeed());
+			result = player.Play(simulation);
+		});
+		printf("    %u ticks, %u commands in %u bytes, %u checksums, %s\n", ticks, result.commands, uint32(data.size()), result.checksumsVerified,
+			result.completed ? "completed" : "desync");
+		BenchmarkResult const& playback = runner.GetResults().back();
+		printf("    %.0fx real time at %u ticks per second\n", playback.itemsPerSecond / TicksPerSecond, TicksPerSecond);
+	}
+
+	BenchmarkRegistration registration("Replay", &RunReplayBenchmarks);
+}
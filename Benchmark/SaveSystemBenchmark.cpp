@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+#include "SaveSystem.h"
+#include <cstdio>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const UnitCount = 200;
+
+	struct SavedUnit
+	{
+		uint32 id;
+		sint32 health;
+		sint32 x, y;
+		uint32 statusEffects[16];
+		uint32 inventory[40];
+	};
+
+	/*
+	*	A 200 unit battle on a 128x128 map, between two saves a few units move and take damage.
+	*/
+	void RunSaveSystemBenchmarks(BenchmarkRunner& runner)
+	{
+		SaveState state;
+		SaveState::SectionID units = state.AddSection("units", sizeof(SavedUnit), UnitCount);
+		SaveState::SectionID tiles = state.AddSection("tiles", 2, 128 * 128);
+		for (uint32 index = 0; index < UnitCount; ++index)
+		{
+			SavedUnit& unit = state.Modify<SavedUnit>(units, index);
+			unit.id = index;
+			unit.health = 100;
+		}
+		uint32 turn = 0;
+		auto playTurn = [&]
+		{
+			for (uint32 index = 0; index < 8; ++index)
+			{
+				SavedUnit& unit = state.Modify<SavedUnit>(units, (turn * 37 + index * 11) % UnitCount);
+				unit.x += 1;
+				unit.health -= 3;
+			}
+			state.Modify<uint16>(tiles, turn % (128 * 128)) = uint16(turn);
+			++turn;
+		};
+
+		Ptr<JobSystem> jobs = JobSystem::Create();
+		Ptr<SaveSystem> saves = CreatePtr<SaveSystem>(jobs, "SaveSystemBenchmark.sav");
+		saves->Save(state);
+		saves->Wait();
+
+		// A whole save including the background write, the pause the game thread sees is printed after it.
+		runner.Run("SaveSystem/DeltaSave/200Units", UnitCount, [&]
+		{
+			playTurn();
+			saves->Save(state);
+			saves->Wait();
+		});
+		SaveSystem::Statistics statistics = saves->GetStatistics();
+		printf("    last pause %.4f ms, last write %.3f ms, %u of %u pages, %llu bytes\n", statistics.lastPauseMilliseconds, statistics.lastWriteMilliseconds,
+			statistics.lastChangedPages, statistics.lastTotalPages, (unsigned long long)statistics.lastWrittenBytes);
+
+		runner.Run("SaveSystem/TakeSnapshot/200Units", UnitCount, [&]
+		{
+			SaveState::Snapshot snapshot = state.TakeSnapshot();
+			playTurn();
+		});
+
+		saves = nullptr;
+		remove("SaveSystemBenchmark.sav");
+		remove("SaveSystemBenchmark.sav.delta");
+	}
+
+	BenchmarkRegistration registration("SaveSystem", &RunSaveSystemBenchmarks);
+}
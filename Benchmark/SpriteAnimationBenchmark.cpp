@@ -0,0 +1,63 @@
+#include "Benchmark.h"
+#include "SpriteAnimation.h"
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const SpriteCount = 50000;
+
+	Ptr<AnimationClip> MakeClip(uint32 firstSprite, uint32 frameCount, float32 framesPerSecond, bool looping)
+	{
+		vector<AnimationClip::Frame> frames;
+		for (uint32 i = 0; i < frameCount; ++i)
+		{
+			frames.push_back({ firstSprite + i, float32(i % 3), float32(i % 2) * 2.0f });
+		}
+		return CreatePtr<AnimationClip>(move(frames), framesPerSecond, looping);
+	}
+
+	/*
+	*	50k units on a 250x200 grid of 32 pixel tiles, cycling idle / walk / attack.
+	*	@visibleFraction: fraction of the grid columns inside the visible region, the rest sleeps.
+	*/
+	void RunUpdate(BenchmarkRunner& runner, char const* name, float32 visibleFraction)
+	{
+		SpriteAnimationSystem system;
+		SpriteAnimationSystem::ClipID clips[] =
+		{
+			system.RegisterClip(MakeClip(0, 4, 6, true)),	// idle
+			system.RegisterClip(MakeClip(4, 8, 12, true)),	// walk
+			system.RegisterClip(MakeClip(12, 6, 15, false)),	// attack
+		};
+
+		uint32 const columns = 250;
+		vector<SpriteAnimationSystem::InstanceID> instances;
+		for (uint32 i = 0; i < SpriteCount; ++i)
+		{
+			instances.push_back(system.CreateInstance(clips[i % 3], float32(i % columns) * 32, float32(i / columns) * 32));
+		}
+		system.SetVisibleRegion(0, 0, columns * 32 * visibleFraction, 200 * 32, 0);
+
+		uint32 frame = 0;
+		runner.Run(name, SpriteCount, [&]
+		{
+			system.Update(1.0f / 60);
+			// Restart a slice of finished attacks every frame so the attack clip keeps running.
+			for (uint32 i = (frame % 60) * 3 + 2; i < SpriteCount; i += 180)
+			{
+				system.Play(instances[i], clips[2]);
+			}
+			++frame;
+		});
+	}
+
+	void RunSpriteAnimationBenchmarks(BenchmarkRunner& runner)
+	{
+		RunUpdate(runner, "SpriteAnimation/Update50k/AllVisible", 1.0f);
+		RunUpdate(runner, "SpriteAnimation/Update50k/QuarterVisible", 0.25f);
+	}
+
+	BenchmarkRegistration registration("SpriteAnimation", &RunSpriteAnimationBenchmarks);
+}
@@ -0,0 +1,79 @@
+#include "Benchmark.h"
+#include "VectorMath.h"
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const Count = 16384;
+
+	/*
+	*	The camera transform applied to every particle or sprite position before it is expanded to a quad, scalar loops
+	*	next to the batch functions.
+	*/
+	void RunVectorMathBenchmarks(BenchmarkRunner& runner)
+	{
+		vector<float32> x(Count), y(Count), resultX(Count), resultY(Count);
+		vector<Vec2> points(Count), resultPoints(Count);
+		vector<Vec3> points3(Count);
+		vector<Vec4> result4(Count);
+		uint32 state = 7;
+		for (uint32 index = 0; index < Count; ++index)
+		{
+			state = state * 1664525u + 1013904223u;
+			x[index] = float32(state >> 20);
+			y[index] = float32(state & 0xFFF);
+			points[index] = { x[index], y[index] };
+			points3[index] = { x[index], y[index], 0.5f };
+		}
+		Transform2D camera = Transform2D::Make({ -320, -180 }, 0.1f, { 1.5f, 1.5f });
+		Mat4 projection = camera.ToMat4() * Mat4::OrthographicOffCenter(0, 1280, 720, 0, -1, 1);
+
+		runner.Run("VectorMath/TransformSoAScalar", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				Vec2 transformed = camera.Apply({ x[index], y[index] });
+				resultX[index] = transformed.x;
+				resultY[index] = transformed.y;
+			}
+		});
+		runner.Run("VectorMath/TransformSoA", Count, [&]
+		{
+			TransformPoints(camera, x.data(), y.data(), resultX.data(), resultY.data(), Count);
+		});
+
+		runner.Run("VectorMath/TransformVec2Scalar", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				resultPoints[index] = camera.Apply(points[index]);
+			}
+		});
+		runner.Run("VectorMath/TransformVec2", Count, [&]
+		{
+			TransformPoints(camera, points.data(), resultPoints.data(), Count);
+		});
+
+		runner.Run("VectorMath/TransformMat4Scalar", Count, [&]
+		{
+			for (uint32 index = 0; index < Count; ++index)
+			{
+				Vec3 const& point = points3[index];
+				Vec4& result = result4[index];
+				result.x = point.x * projection.m[0][0] + point.y * projection.m[1][0] + point.z * projection.m[2][0] + projection.m[3][0];
+				result.y = point.x * projection.m[0][1] + point.y * projection.m[1][1] + point.z * projection.m[2][1] + projection.m[3][1];
+				result.z = point.x * projection.m[0][2] + point.y * projection.m[1][2] + point.z * projection.m[2][2] + projection.m[3][2];
+				result.w = point.x * projection.m[0][3] + point.y * projection.m[1][3] + point.z * projection.m[2][3] + projection.m[3][3];
+			}
+		});
+		runner.Run("VectorMath/TransformMat4", Count, [&]
+		{
+			TransformPoints(projection, points3.data(), result4.data(), Count);
+		});
+	}
+
+	BenchmarkRegistration registration("VectorMath", &RunVectorMathBenchmarks);
+}
@@ -0,0 +1,619 @@
+/*
+*	Compiles designer tables from CSV into GameData tables and the header with their row structs and id constants.
+*
+*	DataCompiler <output directory> <generated header> <table.csv>... [--pak <data directory> <file>...]
+*
+*	--pak packs the files into Data.pak in the output directory, named by their path below the data directory, e.g.
+*	Data/Textures/Portrait.tga as Textures/Portrait.tga.
+*
+*	The first CSV row names the columns as name:type, the first column must be the id column:
+*
+*	id:id,name:string,job:ref:classes,hp:int,move:uint,crit:float,flying:bool
+*
+*	ids are C identifiers in snake_case, they become PascalCase constants in GameDataID::<Table>.
+*	ref columns hold the id of a row of another table and are stored as its row index.
+*/
+#include "GameData.h"
+#include "PakFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	enum class ColumnType
+	{
+		ID,
+		Int,
+		UInt,
+		Float,
+		Bool,
+		String,
+		Ref,
+	};
+
+	struct Column
+	{
+		string name;
+		string typeName;
+		ColumnType type;
+		string refTable;
+	};
+
+	struct Table
+	{
+		string name;
+		string path;
+		vector<Column> columns;
+		vector<vector<string>> rows;
+		vector<uint32> displacements;
+		vector<uint32> slots;					// row in the CSV to row in the compiled table
+		map<string, uint32> slotOfID;
+	};
+
+	string ReadText(string const& path)
+	{
+		ifstream file(path, ios::binary);
+		if (!file)
+		{
+			throw runtime_error("can not open " + path);
+		}
+		return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	}
+
+	vector<vector<string>> ParseCSV(string const& text)
+	{
+		vector<vector<string>> records;
+		vector<string> record;
+		string field;
+		bool quoted = false;
+		bool anyField = false;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			char c = text[i];
+			if (quoted)
+			{
+				if (c == '"' && i + 1 < text.size() && text[i + 1] == '"')
+				{
+					field += '"';
+					++i;
+				}
+				else if (c == '"')
+				{
+					quoted = false;
+				}
+				else
+				{
+					field += c;
+				}
+			}
+			else if (c == '"')
+			{
+				quoted = true;
+				anyField = true;
+			}
+			else if (c == ',')
+			{
+				record.push_back(move(field));
+				field.clear();
+				anyField = true;
+			}
+			else if (c == '\n' || c == '\r')
+			{
+				if (anyField || !field.empty())
+				{
+					record.push_back(move(field));
+					records.push_back(move(record));
+				}
+				field.clear();
+				record.clear();
+				anyField = false;
+			}
+			else
+			{
+				field += c;
+			}
+		}
+		if (anyField || !field.empty())
+		{
+			record.push_back(move(field));
+			records.push_back(move(record));
+		}
+		return records;
+	}
+
+	bool IsIdentifier(string const& text)
+	{
+		if (text.empty() || isdigit(uint8(text[0])))
+		{
+			return false;
+		}
+		return all_of(text.begin(), text.end(), [](char c) { return isalnum(uint8(c)) || c == '_'; });
+	}
+
+	bool IsKeyword(string const& text)
+	{
+		static char const* const keywords[] =
+		{
+			"alignas", "alignof", "auto", "bool", "break", "case", "catch", "char", "class", "const", "constexpr", "continue",
+			"default", "delete", "do", "double", "else", "enum", "explicit", "export", "extern", "false", "float", "for",
+			"friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "nullptr", "operator",
+			"private", "protected", "public", "register", "return", "short", "signed", "sizeof", "static", "struct", "switch",
+			"template", "this", "throw", "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+			"virtual", "void", "volatile", "while",
+		};
+		return any_of(begin(keywords), end(keywords), [&](char const* keyword) { return text == keyword; });
+	}
+
+	string PascalCase(string const& text)
+	{
+		string result;
+		bool upper = true;
+		for (char c : text)
+		{
+			if (c == '_')
+			{
+				upper = true;
+				continue;
+			}
+			result += upper ? char(toupper(uint8(c))) : c;
+			upper = false;
+		}
+		return result;
+	}
+
+	string Location(Table const& table, size_t row)
+	{
+		return table.path + " line " + to_string(row + 2) + ": ";
+	}
+
+	Table LoadTable(string const& path)
+	{
+		Table table;
+		table.path = path;
+		size_t nameBegin = path.find_last_of("/\\");
+		nameBegin = nameBegin == string::npos ? 0 : nameBegin + 1;
+		size_t nameEnd = path.find('.', nameBegin);
+		table.name = path.substr(nameBegin, nameEnd == string::npos ? string::npos : nameEnd - nameBegin);
+		if (!IsIdentifier(table.name))
+		{
+			throw runtime_error(path + ": table name must be an identifier");
+		}
+
+		vector<vector<string>> records = ParseCSV(ReadText(path));
+		if (records.empty())
+		{
+			throw runtime_error(path + ": missing header row");
+		}
+		for (string const& header : records[0])
+		{
+			Column column;
+			size_t colon = header.find(':');
+			column.name = header.substr(0, colon);
+			column.typeName = colon == string::npos ? "" : header.substr(colon + 1);
+			static pair<char const*, ColumnType> const types[] =
+			{
+				{ "id", ColumnType::ID }, { "int", ColumnType::Int }, { "uint", ColumnType::UInt }, { "float", ColumnType::Float },
+				{ "bool", ColumnType::Bool }, { "string", ColumnType::String },
+			};
+			auto type = find_if(begin(types), end(types), [&](pair<char const*, ColumnType> const& t) { return column.typeName == t.first; });
+			if (type != end(types))
+			{
+				column.type = type->second;
+			}
+			else if (column.typeName.compare(0, 4, "ref:") == 0 && IsIdentifier(column.typeName.substr(4)))
+			{
+				column.type = ColumnType::Ref;
+				column.refTable = column.typeName.substr(4);
+			}
+			else
+			{
+				throw runtime_error(path + ": column " + header + " has no valid type");
+			}
+			if (!IsIdentifier(column.name) || IsKeyword(column.name))
+			{
+				throw runtime_error(path + ": column name " + column.name + " must be an identifier and not a C++ keyword");
+			}
+			if ((column.type == ColumnType::ID) != table.columns.empty())
+			{
+				throw runtime_error(path + ": the id column must be the first and only one");
+			}
+			table.columns.push_back(column);
+		}
+
+		table.rows.assign(records.begin() + 1, records.end());
+		for (size_t row = 0; row < table.rows.size(); ++row)
+		{
+			if (table.rows[row].size() != table.columns.size())
+			{
+				throw runtime_error(Location(table, row) + "expected " + to_string(table.columns.size()) + " fields");
+			}
+			string const& id = table.rows[row][0];
+			if (!IsIdentifier(id))
+			{
+				throw runtime_error(Location(table, row) + "id " + id + " must be an identifier");
+			}
+			if (!table.slotOfID.emplace(id, 0).second)
+			{
+				throw runtime_error(Location(table, row) + "duplicated id " + id);
+			}
+		}
+		return table;
+	}
+
+	/*
+	*	Hash and displace: keys are grouped into buckets by one hash, then starting with the largest bucket a seed is
+	*	searched that sends all keys of the bucket to free slots. With about 4 keys per bucket it takes a few tries each.
+	*/
+	void BuildPerfectHash(Table& table)
+	{
+		uint32 count = uint32(table.rows.size());
+		uint32 bucketCount = max(1u, (count + 3) / 4);
+		vector<vector<uint32>> buckets(bucketCount);
+		for (uint32 row = 0; row < count; ++row)
+		{
+			string const& id = table.rows[row][0];
+			buckets[GameDataHash(id.data(), id.size(), 0) % bucketCount].push_back(row);
+		}
+		vector<uint32> order(bucketCount);
+		for (uint32 i = 0; i < bucketCount; ++i)
+		{
+			order[i] = i;
+		}
+		stable_sort(order.begin(), order.end(), [&](uint32 a, uint32 b) { return buckets[a].size() > buckets[b].size(); });
+
+		table.displacements.assign(bucketCount, 0);
+		table.slots.assign(count, 0);
+		vector<bool> used(count, false);
+		vector<uint32> slots;
+		for (uint32 bucket : order)
+		{
+			if (buckets[bucket].empty())
+			{
+				break;
+			}
+			for (uint32 seed = 1;; ++seed)
+			{
+				if (seed == 0)
+				{
+					throw runtime_error(table.path + ": no perfect hash found");
+				}
+				slots.clear();
+				for (uint32 row : buckets[bucket])
+				{
+					string const& id = table.rows[row][0];
+					uint32 slot = uint32(GameDataHash(id.data(), id.size(), seed) % count);
+					if (used[slot] || find(slots.begin(), slots.end(), slot) != slots.end())
+					{
+						break;
+					}
+					slots.push_back(slot);
+				}
+				if (slots.size() == buckets[bucket].size())
+				{
+					table.displacements[bucket] = seed;
+					for (size_t i = 0; i < slots.size(); ++i)
+					{
+						used[slots[i]] = true;
+						table.slots[buckets[bucket][i]] = slots[i];
+						table.slotOfID[table.rows[buckets[bucket][i]][0]] = slots[i];
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	/*
+	*	Covers the ids as well, the generated id constants are only valid for the table they were generated with.
+	*/
+	uint32 LayoutHash(Table const& table)
+	{
+		string layout;
+		for (Column const& column : table.columns)
+		{
+			layout += column.name + ":" + column.typeName + ";";
+		}
+		vector<string const*> ids(table.rows.size());
+		for (size_t row = 0; row < table.rows.size(); ++row)
+		{
+			ids[table.slots[row]] = &table.rows[row][0];
+		}
+		for (string const* id : ids)
+		{
+			layout += *id + ";";
+		}
+		return uint32(GameDataHash(layout.data(), layout.size(), 0));
+	}
+
+	template <class T>
+	void Store(vector<uint8>& file, size_t offset, T const& value)
+	{
+		memcpy(file.data() + offset, &value, sizeof(value));
+	}
+
+	uint32 ParseField(Table const& table, size_t row, Column const& column, string const& text, map<string, Table> const& tables,
+		vector<uint8>& strings, map<string, uint32>& stringOffsets)
+	{
+		char* end = nullptr;
+		switch (column.type)
+		{
+		case ColumnType::ID:
+		case ColumnType::String:
+		{
+			auto inserted = stringOffsets.emplace(text, uint32(strings.size()));
+			if (inserted.second)
+			{
+				strings.insert(strings.end(), text.begin(), text.end());
+				strings.push_back(0);
+			}
+			return inserted.first->second;
+		}
+		case ColumnType::Int:
+		{
+			long long value = strtoll(text.c_str(), &end, 10);
+			if (text.empty() || *end != 0 || value < INT32_MIN || value > INT32_MAX)
+			{
+				break;
+			}
+			return uint32(sint32(value));
+		}
+		case ColumnType::UInt:
+		{
+			unsigned long long value = strtoull(text.c_str(), &end, 10);
+			if (text.empty() || *end != 0 || text[0] == '-' || value > UINT32_MAX)
+			{
+				break;
+			}
+			return uint32(value);
+		}
+		case ColumnType::Float:
+		{
+			float32 value = strtof(text.c_str(), &end);
+			if (text.empty() || *end != 0)
+			{
+				break;
+			}
+			uint32 bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+		case ColumnType::Bool:
+			if (text == "true" || text == "1")
+			{
+				return 1;
+			}
+			if (text == "false" || text == "0" || text.empty())
+			{
+				return 0;
+			}
+			break;
+		case ColumnType::Ref:
+		{
+			if (text.empty())
+			{
+				return ~0u;
+			}
+			Table const& target = tables.at(column.refTable);
+			auto found = target.slotOfID.find(text);
+			if (found == target.slotOfID.end())
+			{
+				throw runtime_error(Location(table, row) + column.name + ": no " + text + " in " + column.refTable);
+			}
+			return found->second;
+		}
+		}
+		throw runtime_error(Location(table, row) + column.name + ": " + text + " is not a valid " + column.typeName);
+	}
+
+	vector<uint8> CompileTable(Table const& table, map<string, Table> const& tables)
+	{
+		uint32 rowCount = uint32(table.rows.size());
+		uint32 rowSize = uint32(table.columns.size() * sizeof(uint32));
+		vector<uint32> rows(size_t(rowCount) * table.columns.size());
+		vector<uint8> strings;
+		map<string, uint32> stringOffsets;
+		for (uint32 row = 0; row < rowCount; ++row)
+		{
+			uint32* fields = &rows[size_t(table.slots[row]) * table.columns.size()];
+			for (size_t column = 0; column < table.columns.size(); ++column)
+			{
+				fields[column] = ParseField(table, row, table.columns[column], table.rows[row][column], tables, strings, stringOffsets);
+			}
+		}
+
+		GameDataTableHeader header = {};
+		header.magic = GameDataMagic;
+		header.version = GameDataVersion;
+		header.headerSize = sizeof(GameDataTableHeader);
+		header.layoutHash = LayoutHash(table);
+		header.rowCount = rowCount;
+		header.rowSize = rowSize;
+		header.bucketCount = uint32(table.displacements.size());
+		header.displacementsOffset = sizeof(GameDataTableHeader);
+		header.rowsOffset = header.displacementsOffset + header.bucketCount * sizeof(uint32);
+		header.stringsOffset = header.rowsOffset + rowCount * rowSize;
+		header.stringsSize = uint32(strings.size());
+		header.fileSize = header.stringsOffset + header.stringsSize;
+
+		vector<uint8> file(header.fileSize);
+		Store(file, 0, header);
+		memcpy(file.data() + header.displacementsOffset, table.displacements.data(), header.bucketCount * sizeof(uint32));
+		if (!rows.empty())
+		{
+			memcpy(file.data() + header.rowsOffset, rows.data(), rows.size() * sizeof(uint32));
+		}
+		if (!strings.empty())
+		{
+			memcpy(file.data() + header.stringsOffset, strings.data(), strings.size());
+		}
+		return file;
+	}
+
+	string GenerateHeader(vector<Table const*> const& tables)
+	{
+		static char const* const fieldTypes[] = { "GameDataString", "sint32", "uint32", "float32", "uint32", "GameDataString", "uint32" };
+		ostringstream out;
+		out << "// Generated by DataCompiler from the tables in Data/Tables, do not edit.\n";
+		out << "#pragma once\n#include \"GameData.h\"\n\nnamespace X\n{\n";
+		for (Table const* table : tables)
+		{
+			char layoutHash[16];
+			snprintf(layoutHash, sizeof(layoutHash), "0x%08X", LayoutHash(*table));
+			out << "\tstruct " << PascalCase(table->name) << "Row\n\t{\n";
+			out << "\t\tstatic constexpr uint32 LayoutHash = " << layoutHash << ";\n\n";
+			for (Column const& column : table->columns)
+			{
+				out << "\t\t" << fieldTypes[int(column.type)] << " " << column.name << ";";
+				if (column.type == ColumnType::Ref)
+				{
+					out << "\t\t// " << PascalCase(column.refTable) << "Row index, ~0u if empty";
+				}
+				out << "\n";
+			}
+			out << "\t};\n\n";
+		}
+		out << "\tnamespace GameDataID\n\t{\n";
+		for (size_t i = 0; i < tables.size(); ++i)
+		{
+			Table const& table = *tables[i];
+			vector<pair<uint32, string>> ids;
+			for (auto const& id : table.slotOfID)
+			{
+				ids.emplace_back(id.second, id.first);
+			}
+			sort(ids.begin(), ids.end());
+			out << (i ? "\n" : "") << "\t\tnamespace " << PascalCase(table.name) << "\n\t\t{\n";
+			out << "\t\t\tconstexpr uint32 Count = " << ids.size() << ";\n";
+			for (auto const& id : ids)
+			{
+				out << "\t\t\tconstexpr uint32 " << PascalCase(id.second) << " = " << id.first << ";\n";
+			}
+			out << "\t\t}\n";
+		}
+		out << "\t}\n}\n";
+		return out.str();
+	}
+
+	/*
+	*	The path below directory, without the separator in between.
+	*/
+	string RelativePath(string const& path, string const& directory)
+	{
+		if (path.compare(0, directory.size(), directory) != 0)
+		{
+			throw runtime_error(path + " is not in " + directory);
+		}
+		size_t start = directory.size();
+		while (start < path.size() && (path[start] == '/' || path[start] == '\\'))
+		{
+			++start;
+		}
+		return path.substr(start);
+	}
+
+	void WriteFile(string const& path, void const* data, size_t size)
+	{
+		ofstream file(path, ios::binary);
+		file.write(static_cast<char const*>(data), size);
+		if (!file)
+		{
+			throw runtime_error("can not write " + path);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		printf("DataCompiler <output directory> <generated header> <table.csv>... [--pak <data directory> <file>...]\n");
+		return 1;
+	}
+	try
+	{
+		int tableEnd = 3;
+		while (tableEnd < argc && strcmp(argv[tableEnd], "--pak") != 0)
+		{
+			++tableEnd;
+		}
+
+		map<string, Table> tables;
+		vector<Table const*> order;
+		for (int i = 3; i < tableEnd; ++i)
+		{
+			Table table = LoadTable(argv[i]);
+			string name = table.name;
+			if (tables.count(name))
+			{
+				throw runtime_error(string(argv[i]) + ": table " + name + " is given twice");
+			}
+			BuildPerfectHash(table);
+			order.push_back(&tables.emplace(name, move(table)).first->second);
+		}
+		for (Table const* table : order)
+		{
+			for (Column const& column : table->columns)
+			{
+				if (column.type == ColumnType::Ref && !tables.count(column.refTable))
+				{
+					throw runtime_error(table->path + ": column " + column.name + " refers to the missing table " + column.refTable);
+				}
+			}
+		}
+
+		string outputDirectory = argv[1];
+		for (Table const* table : order)
+		{
+			vector<uint8> file = CompileTable(*table, tables);
+			WriteFile(outputDirectory + "/" + table->name + ".tbl", file.data(), file.size());
+			printf("%s: %u rows\n", table->name.c_str(), uint32(table->rows.size()));
+		}
+
+		if (tableEnd < argc)
+		{
+			if (tableEnd + 1 >= argc)
+			{
+				throw runtime_error("--pak needs the data directory");
+			}
+			string dataDirectory = argv[tableEnd + 1];
+			PakWriter writer;
+			for (int i = tableEnd + 2; i < argc; ++i)
+			{
+				string text = ReadText(argv[i]);
+				writer.Add(RelativePath(argv[i], dataDirectory), vector<uint8>(text.begin(), text.end()));
+			}
+			string error = writer.Save(outputDirectory + "/Data.pak");
+			if (!error.empty())
+			{
+				throw runtime_error(error);
+			}
+			printf("Data.pak: %d files\n", argc - tableEnd - 2);
+		}
+
+		// Leave the header alone when nothing changed, it is included all over the game.
+		string header = GenerateHeader(order);
+		ifstream existing(argv[2], ios::binary);
+		if (!existing || string((istreambuf_iterator<char>(existing)), istreambuf_iterator<char>()) != header)
+		{
+			existing.close();
+			WriteFile(argv[2], header.data(), header.size());
+		}
+	}
+	catch (exception const& e)
+	{
+		fprintf(stderr, "DataCompiler: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
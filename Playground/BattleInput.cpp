@@ -0,0 +1,148 @@
+#include "BattleInput.h"
+#include <algorithm>
+
+using namespace std;
+using namespace X;
+
+BattleInputController::BattleInputController(BattleSimulation const& simulation, CommandSink sink) :
+	_simulation(simulation),
+	_sink(sink),
+	_left(0),
+	_top(0),
+	_tileSize(32),
+	_viewHeight(0),
+	_cursorX(0),
+	_cursorY(0),
+	_selected(0xFFFF)
+{
+}
+
+void BattleInputController::SetView(uint32 left, uint32 top, uint32 tileSize, uint32 viewHeight)
+{
+	_left = left;
+	_top = top;
+	_tileSize = max(tileSize, 1u);
+	_viewHeight = viewHeight;
+}
+
+void BattleInputController::OnKeyDown(InputSemantic key)
+{
+	switch (key)
+	{
+	case InputSemantic::K_LeftArrow: MoveCursor(-1, 0); break;
+	case InputSemantic::K_RightArrow: MoveCursor(1, 0); break;
+	case InputSemantic::K_UpArrow: MoveCursor(0, -1); break;
+	case InputSemantic::K_DownArrow: MoveCursor(0, 1); break;
+	case InputSemantic::K_Enter:
+	case InputSemantic::K_NumPadEnter:
+		Confirm();
+		break;
+	case InputSemantic::K_Escape:
+		_selected = 0xFFFF;
+		break;
+	case InputSemantic::K_W:
+		if (_selected != 0xFFFF)
+		{
+			Send({ BattleCommand::Type::Wait, _selected, 0, 0, 0 });
+		}
+		break;
+	case InputSemantic::K_E:
+		Send({ BattleCommand::Type::EndTurn, 0, 0, 0, 0 });
+		break;
+	default:
+		break;
+	}
+}
+
+void BattleInputController::OnKeyUp(InputSemantic)
+{
+}
+
+void BattleInputController::OnMouseDown(InputSemantic key, uint32 x, uint32 y)
+{
+	if (key == InputSemantic::M_Button0 && PickTile(x, y))
+	{
+		Confirm();
+	}
+	else if (key == InputSemantic::M_Button1)
+	{
+		_selected = 0xFFFF;
+	}
+}
+
+void BattleInputController::OnMouseUp(InputSemantic, uint32, uint32)
+{
+}
+
+void BattleInputController::OnMouseWheel(InputSemantic, uint32, uint32, sint32)
+{
+}
+
+void BattleInputController::OnMouseMove(InputSemantic, uint32 x, uint32 y)
+{
+	PickTile(x, y);
+}
+
+void BattleInputController::MoveCursor(sint32 dx, sint32 dy)
+{
+	BattleMap const& map = _simulation.GetMap();
+	_cursorX = uint16(min<sint32>(max<sint32>(_cursorX + dx, 0), sint32(map.GetWidth()) - 1));
+	_cursorY = uint16(min<sint32>(max<sint32>(_cursorY + dy, 0), sint32(map.GetHeight()) - 1));
+}
+
+bool BattleInputController::PickTile(uint32 x, uint32 y)
+{
+	if (y >= _viewHeight || x < _left || _viewHeight - 1 - y < _top)
+	{
+		return false;
+	}
+	uint32 tileX = (x - _left) / _tileSize;
+	uint32 tileY = (_viewHeight - 1 - y - _top) / _tileSize;
+	if (tileX >= _simulation.GetMap().GetWidth() || tileY >= _simulation.GetMap().GetHeight())
+	{
+		return false;
+	}
+	_cursorX = uint16(tileX);
+	_cursorY = uint16(tileY);
+	return true;
+}
+
+void BattleInputController::Confirm()
+{
+	uint16 unit = _simulation.FindUnit(_cursorX, _cursorY);
+	if (_selected == 0xFFFF)
+	{
+		if (unit != 0xFFFF && _simulation.GetUnits()[unit].team == _simulation.GetCurrentTeam())
+		{
+			_selected = unit;
+		}
+		return;
+	}
+
+	if (unit == _selected)
+	{
+		_selected = 0xFFFF;
+	}
+	else if (unit != 0xFFFF && _simulation.CanAttack(_selected, unit))
+	{
+		Send({ BattleCommand::Type::Attack, _selected, 0, 0, unit });
+		_selected = 0xFFFF;
+	}
+	else if (_simulation.CanMove(_selected, _cursorX, _cursorY))
+	{
+		// Stays selected, so an attack can follow the move.
+		Send({ BattleCommand::Type::Move, _selected, _cursorX, _cursorY, 0 });
+	}
+	else if (unit != 0xFFFF && _simulation.GetUnits()[unit].team == _simulation.GetCurrentTeam())
+	{
+		_selected = unit;
+	}
+}
+
+void BattleInputController::Send(BattleCommand const& command)
+{
+	if (_sink)
+	{
+		_sink(command);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "Input.h"
+#include "BattleSimulation.h"
+#include "EventBus.h"
+
+namespace X
+{
+	/*
+	*	Turns input semantics into battle commands. Only the resulting commands reach the simulation and the replay,
+	*	cursor and selection are presentation state.
+	*
+	*	Arrows move the cursor, Enter or the left button selects a unit of the current team and then moves it or
+	*	attacks with it, Escape or the right button cancels, W makes the selected unit wait and E ends the turn.
+	*/
+	class BattleInputController : public InputHandler
+	{
+	public:
+		typedef Delegate<void(BattleCommand const& command)> CommandSink;
+
+		BattleInputController(BattleSimulation const& simulation, CommandSink sink);
+
+		/*
+		*	Mouse positions come from Window with the origin at the bottom left of a view viewHeight pixels high, the
+		*	map is drawn left and top pixels from its top left corner.
+		*/
+		void SetView(uint32 left, uint32 top, uint32 tileSize, uint32 viewHeight);
+
+		uint16 GetCursorX() const
+		{
+			return _cursorX;
+		}
+		uint16 GetCursorY() const
+		{
+			return _cursorY;
+		}
+		/*
+		*	@return: 0xFFFF if no unit is selected.
+		*/
+		uint16 GetSelectedUnit() const
+		{
+			return _selected;
+		}
+
+		virtual void OnKeyDown(InputSemantic key) override;
+		virtual void OnKeyUp(InputSemantic key) override;
+		virtual void OnMouseDown(InputSemantic key, uint32 x, uint32 y) override;
+		virtual void OnMouseUp(InputSemantic key, uint32 x, uint32 y) override;
+		virtual void OnMouseWheel(InputSemantic key, uint32 x, uint32 y, sint32 wheelDelta) override;
+		virtual void OnMouseMove(InputSemantic key, uint32 x, uint32 y) override;
+
+	private:
+		void MoveCursor(sint32 dx, sint32 dy);
+		bool PickTile(uint32 x, uint32 y);
+		void Confirm();
+		void Send(BattleCommand const& command);
+
+		BattleSimulation const& _simulation;
+		CommandSink _sink;
+		uint32 _left;
+		uint32 _top;
+		uint32 _tileSize;
+		uint32 _viewHeight;
+		uint16 _cursorX, _cursorY;
+		uint16 _selected;
+	};
+}
@@ -0,0 +1,374 @@
+#include "BattleMap.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint64 AlignUp(uint64 value)
+	{
+		return (value + BattleMapAlignment - 1) & ~(BattleMapAlignment - 1);
+	}
+
+	bool IsInside(uint64 offset, uint64 size, size_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+
+	string LineError(uint32 line, string const& message)
+	{
+		return "line " + to_string(line) + ": " + message;
+	}
+
+	bool TerrainFromChar(char c, Terrain& terrain)
+	{
+		switch (c)
+		{
+		case '_': terrain = Terrain::Void; return true;
+		case '.': terrain = Terrain::Plain; return true;
+		case 'f': terrain = Terrain::Forest; return true;
+		case '^': terrain = Terrain::Mountain; return true;
+		case '~': terrain = Terrain::Water; return true;
+		case '#': terrain = Terrain::Wall; return true;
+		}
+		return false;
+	}
+
+	struct TextUnit
+	{
+		BattleMapUnit unit;
+		string name;
+	};
+}
+
+BattleMap::BattleMap(Ptr<MappedFile> mapped, vector<uint8> buffer) :
+	_mapped(move(mapped)),
+	_buffer(move(buffer))
+{
+	if (_mapped)
+	{
+		_data = _mapped->GetData();
+		_size = _mapped->GetSize();
+	}
+	else
+	{
+		_data = _buffer.data();
+		_size = _buffer.size();
+	}
+	_header = reinterpret_cast<BattleMapHeader const*>(_data);
+}
+
+Ptr<BattleMap> BattleMap::Open(string const& path)
+{
+	Ptr<MappedFile> mapped = MappedFile::Open(path);
+	if (!mapped)
+	{
+		return nullptr;
+	}
+	Ptr<BattleMap> map = CreatePtr<BattleMap>(mapped, vector<uint8>());
+	if (!map->CheckHeader())
+	{
+		return nullptr;
+	}
+	return map;
+}
+
+Ptr<BattleMap> BattleMap::Create(vector<uint8> file)
+{
+	Ptr<BattleMap> map = CreatePtr<BattleMap>(nullptr, move(file));
+	if (!map->CheckHeader())
+	{
+		return nullptr;
+	}
+	return map;
+}
+
+bool BattleMap::CheckHeader() const
+{
+	// Only fixed size checks here, everything that grows with the map is left to Validate.
+	if (_size < sizeof(BattleMapHeader))
+	{
+		return false;
+	}
+	BattleMapHeader const& header = *_header;
+	if (header.magic != BattleMapMagic || header.version != BattleMapVersion || header.headerSize != sizeof(BattleMapHeader) || header.fileSize != _size)
+	{
+		return false;
+	}
+	if (header.chunkSize == 0 || header.chunkCountX != (header.width + header.chunkSize - 1) / header.chunkSize || header.chunkCountY != (header.height + header.chunkSize - 1) / header.chunkSize)
+	{
+		return false;
+	}
+	uint64 chunkCount = uint64(header.chunkCountX) * header.chunkCountY;
+	return header.chunkTableOffset % 4 == 0 && IsInside(header.chunkTableOffset, chunkCount * sizeof(uint32), _size) &&
+		header.unitsOffset % 4 == 0 && IsInside(header.unitsOffset, uint64(header.unitCount) * sizeof(BattleMapUnit), _size) &&
+		IsInside(header.namesOffset, header.namesSize, _size);
+}
+
+string BattleMap::Validate() const
+{
+	BattleMapHeader const& header = *_header;
+	uint64 chunkBytes = uint64(header.chunkSize) * header.chunkSize * sizeof(BattleTile);
+	uint32 const* chunkOffsets = At<uint32>(header.chunkTableOffset);
+	for (uint32 chunk = 0; chunk < header.chunkCountX * header.chunkCountY; ++chunk)
+	{
+		uint32 offset = chunkOffsets[chunk];
+		if (offset % alignof(BattleTile) != 0 || !IsInside(offset, chunkBytes, _size))
+		{
+			return "chunk " + to_string(chunk) + " is outside of the file";
+		}
+		BattleTile const* tiles = At<BattleTile>(offset);
+		for (uint64 tile = 0; tile < chunkBytes / sizeof(BattleTile); ++tile)
+		{
+			if (tiles[tile].terrain >= Terrain::Count)
+			{
+				return "chunk " + to_string(chunk) + " has an unknown terrain";
+			}
+		}
+	}
+
+	char const* names = At<char>(header.namesOffset);
+	for (uint32 index = 0; index < header.unitCount; ++index)
+	{
+		BattleMapUnit const& unit = GetUnit(index);
+		if (unit.x >= header.width || unit.y >= header.height)
+		{
+			return "unit " + to_string(index) + " is outside of the map";
+		}
+		if (unit.facing > 3)
+		{
+			return "unit " + to_string(index) + " has an unknown facing";
+		}
+		if (unit.nameOffset >= header.namesSize || memchr(names + unit.nameOffset, 0, header.namesSize - unit.nameOffset) == nullptr)
+		{
+			return "unit " + to_string(index) + " has no terminated name";
+		}
+	}
+	return string();
+}
+
+BattleTile const* BattleMap::GetChunk(uint32 chunkX, uint32 chunkY) const
+{
+	return At<BattleTile>(At<uint32>(_header->chunkTableOffset)[chunkY * _header->chunkCountX + chunkX]);
+}
+
+BattleTile BattleMap::GetTile(uint32 x, uint32 y) const
+{
+	uint32 chunkSize = _header->chunkSize;
+	return GetChunk(x / chunkSize, y / chunkSize)[(y % chunkSize) * chunkSize + x % chunkSize];
+}
+
+BattleMapUnit const& BattleMap::GetUnit(uint32 index) const
+{
+	return At<BattleMapUnit>(_header->unitsOffset)[index];
+}
+
+char const* BattleMap::GetUnitName(uint32 index) const
+{
+	return At<char>(_header->namesOffset + GetUnit(index).nameOffset);
+}
+
+string X::ConvertBattleMapText(string const& text, vector<uint8>& file)
+{
+	uint32 width = 0, height = 0, chunkSize = 16;
+	uint32 sizeLine = 0;
+	vector<BattleTile> grid;
+	bool hasTiles = false;
+	vector<TextUnit> units;
+
+	istringstream input(text);
+	string line;
+	uint32 lineNumber = 0;
+	// Reads the rows of a tiles or heights block into the grid.
+	auto readRows = [&](char const* block, bool (*apply)(char, BattleTile&)) -> string
+	{
+		if (grid.empty())
+		{
+			return LineError(lineNumber, string(block) + " before size");
+		}
+		for (uint32 y = 0; y < height; ++y)
+		{
+			++lineNumber;
+			if (!getline(input, line))
+			{
+				return LineError(lineNumber, string(block) + " has fewer rows than the map height");
+			}
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			if (line.size() != width)
+			{
+				return LineError(lineNumber, "row length differs from the map width");
+			}
+			for (uint32 x = 0; x < width; ++x)
+			{
+				if (!apply(line[x], grid[y * width + x]))
+				{
+					return LineError(lineNumber, string("unknown ") + block + " character '" + line[x] + "'");
+				}
+			}
+		}
+		return string();
+	};
+
+	while (getline(input, line))
+	{
+		++lineNumber;
+		istringstream words(line);
+		string keyword;
+		if (!(words >> keyword) || keyword[0] == '#')
+		{
+			continue;
+		}
+
+		if (keyword == "size")
+		{
+			if (!(words >> width >> height) || width == 0 || height == 0 || width > 0xFFFF || height > 0xFFFF)
+			{
+				return LineError(lineNumber, "size needs a width and height between 1 and 65535");
+			}
+			// The tiles alone, before allocating the grid. The exact layout is checked once the chunk size is known.
+			if (uint64(width) * height * sizeof(BattleTile) > 0xFFFFFFFF)
+			{
+				return LineError(lineNumber, "the map would be larger than the 4 GB the format addresses, use fewer tiles");
+			}
+			grid.assign(size_t(width) * height, BattleTile{ Terrain::Void, 0 });
+			sizeLine = lineNumber;
+		}
+		else if (keyword == "chunk")
+		{
+			if (!(words >> chunkSize) || chunkSize == 0 || chunkSize > 256)
+			{
+				return LineError(lineNumber, "chunk needs a size between 1 and 256");
+			}
+		}
+		else if (keyword == "tiles")
+		{
+			string error = readRows("tiles", [](char c, BattleTile& tile) { return TerrainFromChar(c, tile.terrain); });
+			if (!error.empty())
+			{
+				return error;
+			}
+			hasTiles = true;
+		}
+		else if (keyword == "heights")
+		{
+			string error = readRows("heights", [](char c, BattleTile& tile)
+			{
+				tile.height = uint8(c - '0');
+				return c >= '0' && c <= '9';
+			});
+			if (!error.empty())
+			{
+				return error;
+			}
+		}
+		else if (keyword == "unit")
+		{
+			TextUnit unit = {};
+			uint32 x, y, team;
+			string facing;
+			if (!(words >> x >> y >> team >> facing) || team > 0xFF)
+			{
+				return LineError(lineNumber, "unit needs x, y, team and facing");
+			}
+			if (x >= width || y >= height)
+			{
+				return LineError(lineNumber, "unit is outside of the map");
+			}
+			size_t facingIndex = string("nesw").find(facing);
+			if (facing.size() != 1 || facingIndex == string::npos)
+			{
+				return LineError(lineNumber, "facing must be one of n e s w");
+			}
+			getline(words >> ws, unit.name);
+			if (!unit.name.empty() && unit.name.back() == '\r')
+			{
+				unit.name.pop_back();
+			}
+			unit.unit.x = uint16(x);
+			unit.unit.y = uint16(y);
+			unit.unit.team = uint8(team);
+			unit.unit.facing = uint8(facingIndex);
+			units.push_back(move(unit));
+		}
+		else
+		{
+			return LineError(lineNumber, "unknown keyword '" + keyword + "'");
+		}
+	}
+	if (!hasTiles)
+	{
+		return "the map has no tiles";
+	}
+
+	BattleMapHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BattleMapMagic;
+	header.version = BattleMapVersion;
+	header.headerSize = sizeof(BattleMapHeader);
+	header.width = width;
+	header.height = height;
+	header.chunkSize = chunkSize;
+	header.chunkCountX = (width + chunkSize - 1) / chunkSize;
+	header.chunkCountY = (height + chunkSize - 1) / chunkSize;
+	uint32 chunkCount = header.chunkCountX * header.chunkCountY;
+	uint32 chunkBytes = chunkSize * chunkSize * sizeof(BattleTile);
+
+	// In 64 bits, the largest maps need more than the 32 bit offsets of the format can address.
+	uint64 chunkStride = AlignUp(chunkBytes);
+	uint64 firstChunk = AlignUp(AlignUp(sizeof(BattleMapHeader)) + uint64(chunkCount) * sizeof(uint32));
+	uint64 unitsOffset = AlignUp(firstChunk + chunkCount * chunkStride);
+	uint64 namesOffset = unitsOffset + uint64(units.size()) * sizeof(BattleMapUnit);
+	uint64 namesSize = 0;
+	for (TextUnit& unit : units)
+	{
+		unit.unit.nameOffset = uint32(min<uint64>(namesSize, 0xFFFFFFFF));
+		namesSize += uint64(unit.name.size()) + 1;
+	}
+	uint64 fileSize = namesOffset + namesSize;
+	if (fileSize > 0xFFFFFFFF || fileSize > uint64(SIZE_MAX))
+	{
+		return LineError(sizeLine, "the map would be larger than the 4 GB the format addresses, use fewer tiles or larger chunks");
+	}
+
+	header.chunkTableOffset = uint32(AlignUp(sizeof(BattleMapHeader)));
+	header.unitsOffset = uint32(unitsOffset);
+	header.unitCount = uint32(units.size());
+	header.namesOffset = uint32(namesOffset);
+	header.namesSize = uint32(namesSize);
+	header.fileSize = uint32(fileSize);
+
+	file.assign(header.fileSize, 0);
+	memcpy(file.data(), &header, sizeof(header));
+	uint32* chunkOffsets = reinterpret_cast<uint32*>(file.data() + header.chunkTableOffset);
+	for (uint32 chunkY = 0; chunkY < header.chunkCountY; ++chunkY)
+	{
+		for (uint32 chunkX = 0; chunkX < header.chunkCountX; ++chunkX)
+		{
+			uint32 chunk = chunkY * header.chunkCountX + chunkX;
+			uint32 offset = uint32(firstChunk + chunk * chunkStride);
+			chunkOffsets[chunk] = offset;
+			// The zeroed file already holds Void tiles for the padding.
+			BattleTile* tiles = reinterpret_cast<BattleTile*>(file.data() + offset);
+			for (uint32 y = chunkY * chunkSize; y < min(height, (chunkY + 1) * chunkSize); ++y)
+			{
+				uint32 x = chunkX * chunkSize;
+				uint32 count = min(width, x + chunkSize) - x;
+				memcpy(&tiles[(y % chunkSize) * chunkSize], &grid[size_t(y) * width + x], count * sizeof(BattleTile));
+			}
+		}
+	}
+	for (uint32 index = 0; index < units.size(); ++index)
+	{
+		TextUnit const& unit = units[index];
+		memcpy(file.data() + header.unitsOffset + index * sizeof(BattleMapUnit), &unit.unit, sizeof(BattleMapUnit));
+		memcpy(file.data() + header.namesOffset + unit.unit.nameOffset, unit.name.c_str(), unit.name.size() + 1);
+	}
+	return string();
+}
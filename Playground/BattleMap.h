@@ -0,0 +1,156 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Binary battle map layout. Everything is little-endian and addressed by byte offsets from the start of the file,
+	*	so the file is used in place after mapping it. Sections start at multiples of BattleMapAlignment.
+	*
+	*	header | chunk offset table | chunks | units | names
+	*
+	*	The grid is split into square chunks stored one after the other, tiles inside a chunk are row-major.
+	*	Chunks on the right and bottom border are padded with Void tiles.
+	*/
+	uint32 const BattleMapMagic = 0x4D505253;	// "SRPM"
+	uint16 const BattleMapVersion = 1;
+	uint32 const BattleMapAlignment = 64;
+
+	enum class Terrain : uint8
+	{
+		Void,
+		Plain,
+		Forest,
+		Mountain,
+		Water,
+		Wall,
+		Count,
+	};
+
+	struct BattleTile
+	{
+		Terrain terrain;
+		uint8 height;
+	};
+
+	struct BattleMapUnit
+	{
+		uint16 x, y;
+		uint8 team;
+		uint8 facing;		// 0 north, 1 east, 2 south, 3 west
+		uint16 reserved;
+		uint32 nameOffset;	// null terminated UTF-8, relative to the names section
+	};
+
+	struct BattleMapHeader
+	{
+		uint32 magic;
+		uint16 version;
+		uint16 headerSize;
+		uint32 fileSize;
+		uint32 width, height;		// in tiles
+		uint32 chunkSize;			// tiles per chunk side
+		uint32 chunkCountX, chunkCountY;
+		uint32 chunkTableOffset;	// chunkCountX * chunkCountY uint32 offsets, row-major
+		uint32 unitsOffset;
+		uint32 unitCount;
+		uint32 namesOffset;
+		uint32 namesSize;
+		uint32 reserved[3];
+	};
+
+	static_assert(sizeof(BattleTile) == 2, "BattleTile is part of the file format");
+	static_assert(sizeof(BattleMapUnit) == 12, "BattleMapUnit is part of the file format");
+	static_assert(sizeof(BattleMapHeader) == 64, "BattleMapHeader is part of the file format");
+
+	/*
+	*	A battle map read in place from a mapped file or a buffer.
+	*	Opening only checks the header, so it costs the same for any map size, chunks are paged in when first read.
+	*	Call Validate once on maps that do not come from the converter, e.g. in tools or debug builds.
+	*/
+	class BattleMap : public ReferenceCountBase<true>
+	{
+	public:
+		/*
+		*	@return: nullptr if the file can not be mapped or the header is not a supported battle map.
+		*/
+		static Ptr<BattleMap> Open(std::string const& path);
+		static Ptr<BattleMap> Create(std::vector<uint8> file);
+
+		/*
+		*	Checks every offset, tile and unit against the file.
+		*	@return: empty if the map is consistent, otherwise a description of the first problem.
+		*/
+		std::string Validate() const;
+
+		uint32 GetWidth() const
+		{
+			return _header->width;
+		}
+		uint32 GetHeight() const
+		{
+			return _header->height;
+		}
+		uint32 GetChunkSize() const
+		{
+			return _header->chunkSize;
+		}
+		uint32 GetChunkCountX() const
+		{
+			return _header->chunkCountX;
+		}
+		uint32 GetChunkCountY() const
+		{
+			return _header->chunkCountY;
+		}
+
+		/*
+		*	@return: GetChunkSize() * GetChunkSize() tiles, row-major.
+		*/
+		BattleTile const* GetChunk(uint32 chunkX, uint32 chunkY) const;
+		BattleTile GetTile(uint32 x, uint32 y) const;
+
+		uint32 GetUnitCount() const
+		{
+			return _header->unitCount;
+		}
+		BattleMapUnit const& GetUnit(uint32 index) const;
+		char const* GetUnitName(uint32 index) const;
+
+		BattleMap(Ptr<MappedFile> mapped, std::vector<uint8> buffer);
+
+	private:
+		bool CheckHeader() const;
+
+		template <class T>
+		T const* At(uint32 offset) const
+		{
+			return reinterpret_cast<T const*>(_data + offset);
+		}
+
+		Ptr<MappedFile> _mapped;
+		std::vector<uint8> _buffer;
+		uint8 const* _data;
+		size_t _size;
+		BattleMapHeader const* _header;
+	};
+
+	/*
+	*	Converts the editable text format into the binary one.
+	*
+	*	# comment
+	*	size <width> <height>
+	*	chunk <tiles per side>				optional, 16 by default
+	*	tiles								followed by <height> rows of <width> characters:
+	*										'_' void, '.' plain, 'f' forest, '^' mountain, '~' water, '#' wall
+	*	heights								optional, followed by <height> rows of <width> digits
+	*	unit <x> <y> <team> <facing> <name>	facing is one of n e s w, the name is the rest of the line
+	*
+	*	@return: empty on success, otherwise the first error with its line number.
+	*/
+	std::string ConvertBattleMapText(std::string const& text, std::vector<uint8>& file);
+}
@@ -0,0 +1,265 @@
+#include "BattleServer.h"
+#include "Varint.h"
+#include <algorithm>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	// Commands of a match between two polls, a few hundred bytes in practice. Larger bursts overflow to the heap.
+	size_t const MatchArenaSize = 16 * 1024;
+
+	struct PendingCommand
+	{
+		uint32 connection;
+		ServerCommand command;
+		chrono::steady_clock::time_point received;
+	};
+
+	float64 MillisecondsBetween(chrono::steady_clock::time_point from, chrono::steady_clock::time_point to)
+	{
+		return chrono::duration<float64, milli>(to - from).count();
+	}
+}
+
+struct BattleServer::Match
+{
+	Match(uint32 id, Ptr<BattleMap> map, uint64 seed, vector<uint32> players) :
+		id(id),
+		simulation(move(map), seed),
+		players(move(players)),
+		arena(MatchArenaSize),
+		pending(arena)
+	{
+	}
+
+	uint32 id;
+	BattleSimulation simulation;
+	vector<uint32> players;
+	FrameArena arena;
+	FrameVector<PendingCommand> pending;
+	uint64 lastPoll = ~0ull;
+
+	// Filled by RunMatch on a worker, collected by Poll.
+	vector<float32> latenciesMs;
+	uint32 commands = 0;
+	uint32 ticks = 0;
+	float64 busySeconds = 0;
+};
+
+vector<uint8> X::EncodeServerCommand(ServerCommand const& command)
+{
+	vector<uint8> bytes;
+	AppendVarint(bytes, command.match);
+	AppendVarint(bytes, command.sequence);
+	AppendBattleCommand(bytes, command.command);
+	return bytes;
+}
+
+bool X::DecodeServerCommand(vector<uint8> const& bytes, ServerCommand& command)
+{
+	uint8 const* position = bytes.data();
+	uint8 const* end = position + bytes.size();
+	uint64 match, sequence;
+	if (!ReadVarint(position, end, match) || !ReadVarint(position, end, sequence) ||
+		!ReadBattleCommand(position, end, command.command) || position != end)
+	{
+		return false;
+	}
+	command.match = uint32(match);
+	command.sequence = uint32(sequence);
+	return true;
+}
+
+vector<uint8> X::EncodeServerReply(ServerReply const& reply)
+{
+	vector<uint8> bytes;
+	AppendVarint(bytes, reply.match);
+	AppendVarint(bytes, reply.sequence);
+	bytes.push_back(reply.accepted ? 1 : 0);
+	AppendVarint(bytes, reply.tick);
+	AppendVarint(bytes, reply.checksum);
+	return bytes;
+}
+
+bool X::DecodeServerReply(vector<uint8> const& bytes, ServerReply& reply)
+{
+	uint8 const* position = bytes.data();
+	uint8 const* end = position + bytes.size();
+	uint64 match, sequence, tick, checksum;
+	if (!ReadVarint(position, end, match) || !ReadVarint(position, end, sequence) || position == end)
+	{
+		return false;
+	}
+	bool accepted = *position++ != 0;
+	if (!ReadVarint(position, end, tick) || !ReadVarint(position, end, checksum) || position != end)
+	{
+		return false;
+	}
+	reply = { uint32(match), uint32(sequence), accepted, uint32(tick), uint32(checksum) };
+	return true;
+}
+
+BattleServer::BattleServer(JobSystem& jobs, ServerTransport& transport, uint32 tickRate) :
+	_jobs(jobs),
+	_transport(transport),
+	_tickInterval(chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<float64>(1.0 / max(tickRate, 1u)))),
+	_nextTick(chrono::steady_clock::now() + _tickInterval),
+	_windowStart(chrono::steady_clock::now())
+{
+}
+
+BattleServer::~BattleServer() = default;
+
+uint32 BattleServer::CreateMatch(Ptr<BattleMap> map, uint64 seed, vector<uint32> players)
+{
+	uint32 id;
+	if (_freeMatches.empty())
+	{
+		id = uint32(_matches.size());
+		_matches.emplace_back();
+	}
+	else
+	{
+		id = _freeMatches.back();
+		_freeMatches.pop_back();
+	}
+	_matches[id].reset(new Match(id, move(map), seed, move(players)));
+	return id;
+}
+
+void BattleServer::EndMatch(uint32 match)
+{
+	if (match < _matches.size() && _matches[match])
+	{
+		_matches[match].reset();
+		_freeMatches.push_back(match);
+	}
+}
+
+void BattleServer::Poll()
+{
+	++_poll;
+	_packets.clear();
+	_transport.Receive(_packets, _nextTick);
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	bool tick = now >= _nextTick;
+	if (tick)
+	{
+		// A server that fell behind skips ticks instead of running a burst of them.
+		_nextTick = max(_nextTick + _tickInterval, now);
+	}
+	Route(_packets);
+	_busySeconds += chrono::duration<float64>(chrono::steady_clock::now() - now).count();
+
+	_due.clear();
+	for (auto& match : _matches)
+	{
+		if (match && (tick || !match->pending.empty()))
+		{
+			_due.push_back(match.get());
+		}
+	}
+	_jobs.ParallelFor(uint32(_due.size()), 0, [this, tick](uint32 begin, uint32 end)
+	{
+		for (uint32 i = begin; i < end; ++i)
+		{
+			RunMatch(*_due[i], tick);
+		}
+	});
+
+	for (Match* match : _due)
+	{
+		_latenciesMs.insert(_latenciesMs.end(), match->latenciesMs.begin(), match->latenciesMs.end());
+		match->latenciesMs.clear();
+		_commands += match->commands;
+		_ticks += match->ticks;
+		_busySeconds += match->busySeconds;
+		match->commands = 0;
+		match->ticks = 0;
+		match->busySeconds = 0;
+	}
+}
+
+void BattleServer::Route(vector<ServerPacket>& packets)
+{
+	for (ServerPacket& packet : packets)
+	{
+		ServerCommand command;
+		if (!DecodeServerCommand(packet.bytes, command))
+		{
+			continue;
+		}
+		Match* match = command.match < _matches.size() ? _matches[command.match].get() : nullptr;
+		if (!match)
+		{
+			_transport.Send(packet.connection, EncodeServerReply({ command.match, command.sequence, false, 0, 0 }));
+			continue;
+		}
+		// The first command of a poll starts a new arena frame, the commands of the poll before are handled by now.
+		if (match->lastPoll != _poll)
+		{
+			match->lastPoll = _poll;
+			match->arena.BeginFrame();
+		}
+		match->pending.push_back({ packet.connection, command, packet.received });
+	}
+}
+
+void BattleServer::RunMatch(Match& match, bool tick)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (PendingCommand const& pending : match.pending)
+	{
+		auto player = find(match.players.begin(), match.players.end(), pending.connection);
+		bool accepted = player != match.players.end() && uint8(player - match.players.begin()) == match.simulation.GetCurrentTeam() &&
+			match.simulation.Apply(pending.command.command);
+		ServerReply reply = { match.id, pending.command.sequence, accepted, match.simulation.GetTick(), match.simulation.GetChecksum() };
+		_transport.Send(pending.connection, EncodeServerReply(reply));
+		match.latenciesMs.push_back(float32(MillisecondsBetween(pending.received, chrono::steady_clock::now())));
+	}
+	match.commands += uint32(match.pending.size());
+	// Nothing is freed in an arena, the next poll starts from an empty vector in the next frame.
+	match.pending = FrameVector<PendingCommand>(match.arena);
+
+	if (tick)
+	{
+		match.simulation.Tick();
+		++match.ticks;
+	}
+	match.busySeconds += chrono::duration<float64>(chrono::steady_clock::now() - start).count();
+}
+
+BattleServer::Statistics BattleServer::TakeStatistics()
+{
+	Statistics statistics = {};
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	statistics.seconds = chrono::duration<float64>(now - _windowStart).count();
+	for (auto const& match : _matches)
+	{
+		statistics.matches += match ? 1 : 0;
+	}
+	statistics.commands = _commands;
+	statistics.ticks = _ticks;
+	if (!_latenciesMs.empty())
+	{
+		auto percentile = [this](float64 fraction)
+		{
+			auto at = _latenciesMs.begin() + size_t(fraction * (_latenciesMs.size() - 1));
+			nth_element(_latenciesMs.begin(), at, _latenciesMs.end());
+			return float64(*at);
+		};
+		statistics.p50LatencyMs = percentile(0.5);
+		statistics.p99LatencyMs = percentile(0.99);
+	}
+	statistics.busyCores = statistics.seconds > 0 ? _busySeconds / statistics.seconds : 0;
+	statistics.matchesPerCore = statistics.busyCores > 0 ? statistics.matches / statistics.busyCores : 0;
+
+	_windowStart = now;
+	_latenciesMs.clear();
+	_commands = 0;
+	_ticks = 0;
+	_busySeconds = 0;
+	return statistics;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "BasicType.h"
+#include "BattleSimulation.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "ServerTransport.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	A command of a player for one of the matches, as sent by clients.
+	*/
+	struct ServerCommand
+	{
+		uint32 match;
+		uint32 sequence;		// chosen by the client, sent back in the reply
+		BattleCommand command;
+	};
+
+	struct ServerReply
+	{
+		uint32 match;
+		uint32 sequence;
+		bool accepted;
+		uint32 tick;
+		uint32 checksum;		// of the match after the command, clients compare it with their own simulation
+	};
+
+	std::vector<uint8> EncodeServerCommand(ServerCommand const& command);
+	bool DecodeServerCommand(std::vector<uint8> const& bytes, ServerCommand& command);
+	std::vector<uint8> EncodeServerReply(ServerReply const& reply);
+	bool DecodeServerReply(std::vector<uint8> const& bytes, ServerReply& reply);
+
+	/*
+	*	Hosts many battles in one process without a window or a device. Every Poll takes the packets that arrived,
+	*	and the matches that got commands or are due to tick run on the job system, each on one thread at a time.
+	*	A match lives in its own arena for what it builds per poll, so matches do not share an allocator lock.
+	*
+	*	Players are connections. The connection at index i of a match plays team i, commands for units of other teams
+	*	or outside its turn are refused.
+	*/
+	class BattleServer
+	{
+	public:
+		struct Statistics
+		{
+			uint32 matches;
+			uint64 commands;
+			uint64 ticks;
+			float64 p50LatencyMs;		// from the packet arriving to the reply being sent
+			float64 p99LatencyMs;
+			float64 busyCores;			// average cores spent routing and running matches over the window
+			float64 matchesPerCore;
+			float64 seconds;
+		};
+
+		/*
+		*	@tickRate: simulation steps per second of every match.
+		*/
+		BattleServer(JobSystem& jobs, ServerTransport& transport, uint32 tickRate = 10);
+		~BattleServer();
+		BattleServer(BattleServer const&) = delete;
+		BattleServer& operator=(BattleServer const&) = delete;
+
+		uint32 CreateMatch(Ptr<BattleMap> map, uint64 seed, std::vector<uint32> players);
+		void EndMatch(uint32 match);
+
+		/*
+		*	Waits for packets until the next tick is due at most, then handles everything that arrived.
+		*/
+		void Poll();
+
+		/*
+		*	Since the last call.
+		*/
+		Statistics TakeStatistics();
+
+	private:
+		struct Match;
+
+		void Route(std::vector<ServerPacket>& packets);
+		void RunMatch(Match& match, bool tick);
+
+		JobSystem& _jobs;
+		ServerTransport& _transport;
+		std::chrono::steady_clock::duration _tickInterval;
+		std::chrono::steady_clock::time_point _nextTick;
+
+		std::vector<std::unique_ptr<Match>> _matches;		// nullptr for ended ones, ids are indices
+		std::vector<uint32> _freeMatches;
+		std::vector<ServerPacket> _packets;
+		std::vector<Match*> _due;
+		uint64 _poll = 0;
+
+		std::chrono::steady_clock::time_point _windowStart;
+		std::vector<float32> _latenciesMs;
+		uint64 _commands = 0;
+		uint64 _ticks = 0;
+		float64 _busySeconds = 0;
+	};
+}
@@ -0,0 +1,290 @@
+#include "BattleSimulation.h"
+#include "Varint.h"
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 Distance(BattleUnit const& a, uint16 x, uint16 y)
+	{
+		return uint32(abs(sint32(a.x) - sint32(x)) + abs(sint32(a.y) - sint32(y)));
+	}
+
+	sint32 TerrainDefense(Terrain terrain)
+	{
+		switch (terrain)
+		{
+		case Terrain::Forest: return 2;
+		case Terrain::Mountain: return 4;
+		default: return 0;
+		}
+	}
+
+	bool IsWalkable(Terrain terrain)
+	{
+		return terrain == Terrain::Plain || terrain == Terrain::Forest || terrain == Terrain::Mountain;
+	}
+}
+
+void X::AppendBattleCommand(vector<uint8>& bytes, BattleCommand const& command)
+{
+	bytes.push_back(uint8(command.type));
+	switch (command.type)
+	{
+	case BattleCommand::Type::Move:
+		AppendVarint(bytes, command.unit);
+		AppendVarint(bytes, command.x);
+		AppendVarint(bytes, command.y);
+		break;
+	case BattleCommand::Type::Attack:
+		AppendVarint(bytes, command.unit);
+		AppendVarint(bytes, command.target);
+		break;
+	case BattleCommand::Type::Wait:
+		AppendVarint(bytes, command.unit);
+		break;
+	default:
+		break;
+	}
+}
+
+bool X::ReadBattleCommand(uint8 const*& position, uint8 const* end, BattleCommand& command)
+{
+	if (position == end || *position >= uint8(BattleCommand::Type::Count))
+	{
+		return false;
+	}
+	command = {};
+	command.type = BattleCommand::Type(*position++);
+	uint64 unit = 0, x = 0, y = 0, target = 0;
+	switch (command.type)
+	{
+	case BattleCommand::Type::Move:
+		if (!ReadVarint(position, end, unit) || !ReadVarint(position, end, x) || !ReadVarint(position, end, y))
+		{
+			return false;
+		}
+		break;
+	case BattleCommand::Type::Attack:
+		if (!ReadVarint(position, end, unit) || !ReadVarint(position, end, target))
+		{
+			return false;
+		}
+		break;
+	case BattleCommand::Type::Wait:
+		if (!ReadVarint(position, end, unit))
+		{
+			return false;
+		}
+		break;
+	default:
+		break;
+	}
+	command.unit = uint16(unit);
+	command.x = uint16(x);
+	command.y = uint16(y);
+	command.target = uint16(target);
+	return true;
+}
+
+BattleSimulation::BattleSimulation(Ptr<BattleMap> map, uint64 seed) :
+	_map(move(map)),
+	_teamCount(0),
+	_currentTeam(0),
+	_tick(0),
+	// xorshift64* must not start at zero.
+	_random(seed ? seed : 0x9E3779B97F4A7C15ull)
+{
+	for (uint32 index = 0; index < _map->GetUnitCount(); ++index)
+	{
+		BattleMapUnit const& placed = _map->GetUnit(index);
+		BattleUnit unit = { placed.x, placed.y, StartHealth, placed.team, false, false };
+		_units.push_back(unit);
+		_teamCount = max<uint8>(_teamCount, placed.team + 1);
+	}
+}
+
+uint32 BattleSimulation::NextRandom()
+{
+	_random ^= _random >> 12;
+	_random ^= _random << 25;
+	_random ^= _random >> 27;
+	return uint32((_random * 2685821657736338717ull) >> 32);
+}
+
+uint16 BattleSimulation::FindUnit(uint16 x, uint16 y) const
+{
+	for (uint16 index = 0; index < _units.size(); ++index)
+	{
+		BattleUnit const& unit = _units[index];
+		if (unit.health > 0 && unit.x == x && unit.y == y)
+		{
+			return index;
+		}
+	}
+	return 0xFFFF;
+}
+
+bool BattleSimulation::CanMove(uint16 index, uint16 x, uint16 y) const
+{
+	if (index >= _units.size() || x >= _map->GetWidth() || y >= _map->GetHeight())
+	{
+		return false;
+	}
+	BattleUnit const& unit = _units[index];
+	return unit.health > 0 && unit.team == _currentTeam && !unit.moved && !unit.acted && Distance(unit, x, y) <= MoveRange &&
+		IsWalkable(_map->GetTile(x, y).terrain) && (FindUnit(x, y) == 0xFFFF || FindUnit(x, y) == index);
+}
+
+bool BattleSimulation::CanAttack(uint16 index, uint16 target) const
+{
+	if (index >= _units.size() || target >= _units.size())
+	{
+		return false;
+	}
+	BattleUnit const& unit = _units[index];
+	BattleUnit const& other = _units[target];
+	return unit.health > 0 && other.health > 0 && unit.team == _currentTeam && other.team != unit.team && !unit.acted && Distance(unit, other.x, other.y) == 1;
+}
+
+bool BattleSimulation::Apply(BattleCommand const& command, BattleEvents* events)
+{
+	switch (command.type)
+	{
+	case BattleCommand::Type::Move:
+	{
+		if (!CanMove(command.unit, command.x, command.y))
+		{
+			return false;
+		}
+		BattleUnit& unit = _units[command.unit];
+		if (events)
+		{
+			events->Queue(UnitMovedEvent{ command.unit, unit.x, unit.y, command.x, command.y });
+		}
+		unit.x = command.x;
+		unit.y = command.y;
+		unit.moved = true;
+		return true;
+	}
+
+	case BattleCommand::Type::Attack:
+	{
+		if (!CanAttack(command.unit, command.target))
+		{
+			return false;
+		}
+		BattleUnit& unit = _units[command.unit];
+		BattleUnit& target = _units[command.target];
+		BattleTile from = _map->GetTile(unit.x, unit.y);
+		BattleTile to = _map->GetTile(target.x, target.y);
+		sint32 damage = 8 + sint32(NextRandom() % 6) - TerrainDefense(to.terrain) + (from.height > to.height ? 2 : 0);
+		Damage(command.target, command.unit, max(damage, 1), events);
+		unit.moved = unit.acted = true;
+		return true;
+	}
+
+	case BattleCommand::Type::Wait:
+		if (command.unit >= _units.size() || _units[command.unit].team != _currentTeam || _units[command.unit].health <= 0)
+		{
+			return false;
+		}
+		_units[command.unit].moved = _units[command.unit].acted = true;
+		return true;
+
+	case BattleCommand::Type::EndTurn:
+		EndTurn();
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void BattleSimulation::EndTurn()
+{
+	for (BattleUnit& unit : _units)
+	{
+		unit.moved = unit.acted = false;
+	}
+	if (_teamCount > 0)
+	{
+		_currentTeam = uint8((_currentTeam + 1) % _teamCount);
+	}
+}
+
+void BattleSimulation::Damage(uint16 index, uint16 attacker, sint32 damage, BattleEvents* events)
+{
+	BattleUnit& unit = _units[index];
+	unit.health -= damage;
+	if (events)
+	{
+		events->Queue(UnitDamagedEvent{ index, attacker, damage, unit.health });
+		if (unit.health <= 0)
+		{
+			events->Queue(UnitDiedEvent{ index, unit.team });
+		}
+	}
+}
+
+void BattleSimulation::Tick(BattleEvents* events)
+{
+	++_tick;
+	// Units on water lose health every second at 60 ticks per second, a rule that only exists to make ticks matter.
+	if (_tick % 60 == 0)
+	{
+		for (uint16 index = 0; index < _units.size(); ++index)
+		{
+			BattleUnit const& unit = _units[index];
+			if (unit.health > 0 && _map->GetTile(unit.x, unit.y).terrain == Terrain::Water)
+			{
+				Damage(index, 0xFFFF, 1, events);
+			}
+		}
+	}
+}
+
+uint32 BattleSimulation::GetChecksum() const
+{
+	// FNV-1a over the fields one by one, BattleUnit has padding.
+	uint32 hash = 2166136261u;
+	auto mix = [&hash](uint32 value)
+	{
+		for (uint32 shift = 0; shift < 32; shift += 8)
+		{
+			hash = (hash ^ ((value >> shift) & 0xFF)) * 16777619u;
+		}
+	};
+	mix(_tick);
+	mix(_currentTeam);
+	mix(uint32(_random));
+	mix(uint32(_random >> 32));
+	for (BattleUnit const& unit : _units)
+	{
+		mix(unit.x | (uint32(unit.y) << 16));
+		mix(uint32(unit.health));
+		mix(unit.team | (unit.moved ? 0x100 : 0) | (unit.acted ? 0x200 : 0));
+	}
+	return hash;
+}
+
+uint8 BattleSimulation::GetWinner() const
+{
+	uint8 winner = 0xFF;
+	for (BattleUnit const& unit : _units)
+	{
+		if (unit.health <= 0)
+		{
+			continue;
+		}
+		if (winner != 0xFF && winner != unit.team)
+		{
+			return 0xFF;
+		}
+		winner = unit.team;
+	}
+	return winner;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "BasicType.h"
+#include "BattleMap.h"
+#include "EventBus.h"
+#include <vector>
+
+namespace X
+{
+	/*
+	*	A player decision, the only input the simulation takes. Recording these is enough to replay a battle.
+	*/
+	struct BattleCommand
+	{
+		enum class Type : uint8
+		{
+			Move,		// unit to (x, y)
+			Attack,		// unit attacks target
+			Wait,		// unit ends its action
+			EndTurn,	// the current team ends its turn
+			Count,
+		};
+
+		Type type;
+		uint16 unit;
+		uint16 x, y;
+		uint16 target;
+	};
+
+	/*
+	*	Only the fields the type uses, as varints: a move takes 4 bytes, an end of turn 1. Shared by replays and the network.
+	*/
+	void AppendBattleCommand(std::vector<uint8>& bytes, BattleCommand const& command);
+
+	/*
+	*	@return: false if the data ends inside the command or the type is unknown.
+	*/
+	bool ReadBattleCommand(uint8 const*& position, uint8 const* end, BattleCommand& command);
+
+	struct UnitMovedEvent
+	{
+		uint16 unit;
+		uint16 fromX, fromY;
+		uint16 toX, toY;
+	};
+
+	struct UnitDamagedEvent
+	{
+		uint16 unit;
+		uint16 attacker;		// 0xFFFF for terrain
+		sint32 damage;
+		sint32 health;			// left after the damage
+	};
+
+	struct UnitDiedEvent
+	{
+		uint16 unit;
+		uint8 team;
+	};
+
+	/*
+	*	What happened in the battle, for presentation: animations, sounds, the log. Queued while commands and ticks run
+	*	and dispatched once per frame. Never read back by the simulation.
+	*/
+	typedef EventBus<UnitMovedEvent, UnitDamagedEvent, UnitDiedEvent> BattleEvents;
+
+	struct BattleUnit
+	{
+		uint16 x, y;
+		sint32 health;
+		uint8 team;
+		bool moved;
+		bool acted;
+	};
+
+	/*
+	*	Turn based battle rules on integers only, so the same seed and commands give the same battle on every
+	*	platform and build. Commands are applied in Tick in the order they were queued, invalid ones are dropped.
+	*	Nothing here depends on the window or the renderer, replays and servers run it headless.
+	*/
+	class BattleSimulation
+	{
+	public:
+		static uint32 const MoveRange = 4;
+		static sint32 const StartHealth = 40;
+
+		BattleSimulation(Ptr<BattleMap> map, uint64 seed);
+
+		/*
+		*	@events: what the command caused is queued there, may be nullptr, e.g. for replays fast forwarding.
+		*	@return: false if the command is not valid in the current state, it is dropped then.
+		*/
+		bool Apply(BattleCommand const& command, BattleEvents* events = nullptr);
+
+		/*
+		*	Advances the simulation by one fixed step.
+		*/
+		void Tick(BattleEvents* events = nullptr);
+
+		/*
+		*	Hash of everything that influences future ticks, equal on all machines that simulated the same battle.
+		*/
+		uint32 GetChecksum() const;
+
+		uint32 GetTick() const
+		{
+			return _tick;
+		}
+		uint8 GetCurrentTeam() const
+		{
+			return _currentTeam;
+		}
+		std::vector<BattleUnit> const& GetUnits() const
+		{
+			return _units;
+		}
+		BattleMap const& GetMap() const
+		{
+			return *_map;
+		}
+		/*
+		*	@return: the only team with units left, or 0xFF while the battle goes on.
+		*/
+		uint8 GetWinner() const;
+
+		/*
+		*	@return: index of the unit at (x, y), or 0xFFFF.
+		*/
+		uint16 FindUnit(uint16 x, uint16 y) const;
+		bool CanMove(uint16 unit, uint16 x, uint16 y) const;
+		bool CanAttack(uint16 unit, uint16 target) const;
+
+	private:
+		uint32 NextRandom();
+		void EndTurn();
+		void Damage(uint16 index, uint16 attacker, sint32 damage, BattleEvents* events);
+
+		Ptr<BattleMap> _map;
+		std::vector<BattleUnit> _units;
+		uint8 _teamCount;
+		uint8 _currentTeam;
+		uint32 _tick;
+		uint64 _random;
+	};
+}
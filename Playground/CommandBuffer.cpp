@@ -0,0 +1,192 @@
+#include "CommandBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	// Commands hold pointers, every command starts 8 byte aligned.
+	uint32 const CommandAlignment = 8;
+
+	uint32 AlignCommandSize(uint64 size)
+	{
+		uint64 aligned = (size + CommandAlignment - 1) / CommandAlignment * CommandAlignment;
+		if (aligned > 0xFFFFFFFFu)
+		{
+			throw length_error("CommandBuffer: command larger than 4 GB.");
+		}
+		return uint32(aligned);
+	}
+}
+
+CommandBuffer::CommandBuffer(uint32 blockSize) :
+	_blockSize(AlignCommandSize(max(blockSize, 1024u)))
+{
+}
+
+void CommandBuffer::Reset()
+{
+	for (Block& block : _blocks)
+	{
+		block.used = 0;
+	}
+	_currentBlock = 0;
+	_commandCount = 0;
+	_byteSize = 0;
+}
+
+void* CommandBuffer::AllocateBytes(uint32 size)
+{
+	// Blocks left from earlier frames are reused in order, one too small for a large command is skipped and stays empty.
+	while (_currentBlock < _blocks.size() && _blocks[_currentBlock].capacity - _blocks[_currentBlock].used < size)
+	{
+		++_currentBlock;
+	}
+	if (_currentBlock == _blocks.size())
+	{
+		uint32 capacity = max(_blockSize, size);
+		_blocks.push_back({ unique_ptr<uint8[]>(new uint8[capacity]), capacity, 0 });
+	}
+	Block& block = _blocks[_currentBlock];
+	void* memory = block.memory.get() + block.used;
+	block.used += size;
+	_byteSize += size;
+	++_commandCount;
+	return memory;
+}
+
+template <class Command>
+Command* CommandBuffer::Allocate(CommandType type, uint32 payloadSize)
+{
+	uint32 size = AlignCommandSize(uint64(sizeof(Command)) + payloadSize);
+	Command* command = static_cast<Command*>(AllocateBytes(size));
+	command->header.type = type;
+	command->header.reserved = 0;
+	command->header.size = size;
+	return command;
+}
+
+void CommandBuffer::Clear(float32 red, float32 green, float32 blue, float32 alpha)
+{
+	ClearCommand* command = Allocate<ClearCommand>(CommandType::Clear);
+	command->color[0] = red;
+	command->color[1] = green;
+	command->color[2] = blue;
+	command->color[3] = alpha;
+}
+
+void CommandBuffer::SetViewport(float32 x, float32 y, float32 width, float32 height)
+{
+	SetViewportCommand* command = Allocate<SetViewportCommand>(CommandType::SetViewport);
+	command->x = x;
+	command->y = y;
+	command->width = width;
+	command->height = height;
+}
+
+void CommandBuffer::SetScissor(sint32 left, sint32 top, sint32 right, sint32 bottom)
+{
+	SetScissorCommand* command = Allocate<SetScissorCommand>(CommandType::SetScissor);
+	command->left = left;
+	command->top = top;
+	command->right = right;
+	command->bottom = bottom;
+}
+
+void CommandBuffer::SetTexture(void* texture)
+{
+	Allocate<SetTextureCommand>(CommandType::SetTexture)->texture = texture;
+}
+
+void CommandBuffer::SetProjection(float32 const (&matrix)[4][4])
+{
+	memcpy(Allocate<SetProjectionCommand>(CommandType::SetProjection)->matrix, matrix, sizeof(matrix));
+}
+
+void* CommandBuffer::SetVertices(uint32 count, uint32 stride)
+{
+	SetVerticesCommand* command = Allocate<SetVerticesCommand>(CommandType::SetVertices, AlignCommandSize(uint64(count) * stride));
+	command->count = count;
+	command->stride = stride;
+	return command + 1;
+}
+
+void CommandBuffer::SetVertices(void const* vertices, uint32 count, uint32 stride)
+{
+	memcpy(SetVertices(count, stride), vertices, size_t(count) * stride);
+}
+
+void CommandBuffer::DrawIndexed(void const* indices, uint32 count, uint32 indexSize, sint32 baseVertex)
+{
+	DrawIndexedCommand* command = Allocate<DrawIndexedCommand>(CommandType::DrawIndexed, AlignCommandSize(uint64(count) * indexSize));
+	command->count = count;
+	command->indexSize = indexSize;
+	command->baseVertex = baseVertex;
+	command->reserved = 0;
+	memcpy(command + 1, indices, size_t(count) * indexSize);
+}
+
+void CommandBuffer::DrawIndexed(uint16 const* indices, uint32 count, sint32 baseVertex)
+{
+	DrawIndexed(indices, count, sizeof(uint16), baseVertex);
+}
+
+void CommandBuffer::DrawIndexed(uint32 const* indices, uint32 count, sint32 baseVertex)
+{
+	DrawIndexed(indices, count, sizeof(uint32), baseVertex);
+}
+
+void CommandBuffer::Callback(void (*function)(void const* first, void const* second), void const* first, void const* second)
+{
+	CallbackCommand* command = Allocate<CallbackCommand>(CommandType::Callback);
+	command->function = function;
+	command->first = first;
+	command->second = second;
+}
+
+void HeadlessCommandBackend::Execute(CommandBuffer const* const* buffers, uint32 count)
+{
+	for (uint32 i = 0; i < count; ++i)
+	{
+		SetVerticesCommand const* vertices = nullptr;
+		buffers[i]->ForEach([&](CommandHeader const& header)
+		{
+			++_statistics.commands;
+			switch (header.type)
+			{
+			case CommandType::SetVertices:
+				vertices = reinterpret_cast<SetVerticesCommand const*>(&header);
+				_statistics.vertices += vertices->count;
+				break;
+			case CommandType::DrawIndexed:
+			{
+				DrawIndexedCommand const& draw = reinterpret_cast<DrawIndexedCommand const&>(header);
+				++_statistics.draws;
+				_statistics.triangles += draw.count / 3;
+				uint32 highest = 0;
+				for (uint32 index = 0; index < draw.count; ++index)
+				{
+					uint32 value = draw.indexSize == 2 ? static_cast<uint16 const*>(draw.GetIndices())[index] : static_cast<uint32 const*>(draw.GetIndices())[index];
+					highest = max(highest, value);
+				}
+				if (!vertices || draw.baseVertex < 0 || (draw.count > 0 && uint64(draw.baseVertex) + highest >= vertices->count))
+				{
+					++_statistics.invalidDraws;
+				}
+				break;
+			}
+			case CommandType::Callback:
+			{
+				CallbackCommand const& callback = reinterpret_cast<CallbackCommand const&>(header);
+				callback.function(callback.first, callback.second);
+				break;
+			}
+			default:
+				break;
+			}
+		});
+	}
+}
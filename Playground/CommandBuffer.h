@@ -0,0 +1,232 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include <memory>
+#include <vector>
+
+namespace X
+{
+	enum class CommandType : uint16
+	{
+		Clear,
+		SetViewport,
+		SetScissor,
+		SetTexture,
+		SetProjection,
+		SetVertices,
+		DrawIndexed,
+		Callback,
+	};
+
+	/*
+	*	Every command starts with this. size covers the command and its inline payload, the next command follows it.
+	*/
+	struct CommandHeader
+	{
+		CommandType type;
+		uint16 reserved;
+		uint32 size;
+	};
+
+	struct ClearCommand
+	{
+		CommandHeader header;
+		float32 color[4];
+	};
+
+	struct SetViewportCommand
+	{
+		CommandHeader header;
+		float32 x, y, width, height;
+	};
+
+	struct SetScissorCommand
+	{
+		CommandHeader header;
+		sint32 left, top, right, bottom;
+	};
+
+	struct SetTextureCommand
+	{
+		CommandHeader header;
+		void* texture;			// backend handle, an ID3D11ShaderResourceView* like ImTextureID for D3D11
+	};
+
+	struct SetProjectionCommand
+	{
+		CommandHeader header;
+		float32 matrix[4][4];
+	};
+
+	/*
+	*	Followed by count * stride bytes of vertices, which later draws of the same buffer index into.
+	*/
+	struct SetVerticesCommand
+	{
+		CommandHeader header;
+		uint32 count;
+		uint32 stride;
+
+		void const* GetVertices() const
+		{
+			return this + 1;
+		}
+	};
+
+	/*
+	*	Followed by count indices of indexSize bytes, relative to baseVertex in the last vertices set.
+	*/
+	struct DrawIndexedCommand
+	{
+		CommandHeader header;
+		uint32 count;
+		uint32 indexSize;		// 2 or 4
+		sint32 baseVertex;
+		uint32 reserved;
+
+		void const* GetIndices() const
+		{
+			return this + 1;
+		}
+	};
+
+	/*
+	*	Runs arbitrary code in order during replay, the arguments have to stay valid until then.
+	*/
+	struct CallbackCommand
+	{
+		CommandHeader header;
+		void (*function)(void const* first, void const* second);
+		void const* first;
+		void const* second;
+	};
+
+	/*
+	*	A list of plain data draw commands, independent of the graphics API. Commands and their vertices and indices are
+	*	bump allocated in blocks that are kept over Reset, so recording a frame allocates nothing once warm.
+	*
+	*	A buffer is recorded by one thread at a time, threads record into buffers of their own and a CommandBackend
+	*	replays them in order.
+	*/
+	class CommandBuffer
+	{
+	public:
+		explicit CommandBuffer(uint32 blockSize = 64 * 1024);
+		CommandBuffer(CommandBuffer&&) = default;
+		CommandBuffer& operator=(CommandBuffer&&) = default;
+
+		/*
+		*	Forgets the commands, keeps the memory.
+		*/
+		void Reset();
+
+		void Clear(float32 red, float32 green, float32 blue, float32 alpha);
+		void SetViewport(float32 x, float32 y, float32 width, float32 height);
+		void SetScissor(sint32 left, sint32 top, sint32 right, sint32 bottom);
+		void SetTexture(void* texture);
+		void SetProjection(float32 const (&matrix)[4][4]);
+
+		/*
+		*	@return: memory for count * stride bytes of vertices, to be filled before the buffer is replayed.
+		*/
+		void* SetVertices(uint32 count, uint32 stride);
+		void SetVertices(void const* vertices, uint32 count, uint32 stride);
+
+		void DrawIndexed(uint16 const* indices, uint32 count, sint32 baseVertex);
+		void DrawIndexed(uint32 const* indices, uint32 count, sint32 baseVertex);
+
+		void Callback(void (*function)(void const* first, void const* second), void const* first, void const* second);
+
+		uint32 GetCommandCount() const
+		{
+			return _commandCount;
+		}
+
+		/*
+		*	Bytes of commands and payload recorded since the last Reset.
+		*/
+		uint64 GetByteSize() const
+		{
+			return _byteSize;
+		}
+
+		/*
+		*	Calls visitor with the CommandHeader of every command in recording order. Cast to the command struct of its type.
+		*/
+		template <class Visitor>
+		void ForEach(Visitor&& visitor) const
+		{
+			for (Block const& block : _blocks)
+			{
+				uint8 const* memory = block.memory.get();
+				for (uint32 offset = 0; offset < block.used; )
+				{
+					CommandHeader const& header = *reinterpret_cast<CommandHeader const*>(memory + offset);
+					visitor(header);
+					offset += header.size;
+				}
+			}
+		}
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<uint8[]> memory;
+			uint32 capacity;
+			uint32 used;
+		};
+
+		template <class Command>
+		Command* Allocate(CommandType type, uint32 payloadSize = 0);
+		void* AllocateBytes(uint32 size);
+		void DrawIndexed(void const* indices, uint32 count, uint32 indexSize, sint32 baseVertex);
+
+		uint32 _blockSize;
+		std::vector<Block> _blocks;
+		size_t _currentBlock = 0;
+		uint32 _commandCount = 0;
+		uint64 _byteSize = 0;
+	};
+
+	/*
+	*	Replays command buffers in the order given.
+	*/
+	class CommandBackend : public ReferenceCountBase<true>
+	{
+	public:
+		virtual ~CommandBackend() = default;
+
+		virtual void Execute(CommandBuffer const* const* buffers, uint32 count) = 0;
+	};
+
+	/*
+	*	Replays without a GPU, for servers and for measuring. Counts what would have been drawn and checks every index
+	*	against the vertices set when it is drawn.
+	*/
+	class HeadlessCommandBackend : public CommandBackend
+	{
+	public:
+		struct Statistics
+		{
+			uint64 commands;
+			uint64 draws;
+			uint64 vertices;
+			uint64 triangles;
+			uint64 invalidDraws;	// without vertices, or indexing past them
+		};
+
+		virtual void Execute(CommandBuffer const* const* buffers, uint32 count) override;
+
+		Statistics GetStatistics() const
+		{
+			return _statistics;
+		}
+		void ResetStatistics()
+		{
+			_statistics = {};
+		}
+
+	private:
+		Statistics _statistics = {};
+	};
+}
@@ -0,0 +1,220 @@
+#include "D3D11CommandBackend.h"
+#include "D3DHelper.h"
+#include <algorithm>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const InitialVertexBytes = 1024 * 1024;
+	uint32 const InitialIndexBytes = 256 * 1024;
+
+	// Vertex data starts 16 byte aligned, indices 4 byte aligned so both index sizes can start anywhere.
+	uint32 AlignUp(uint32 value, uint32 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	ComPtr<ID3D11Buffer> CreateDynamicBuffer(ID3D11Device* device, uint32 byteSize, UINT bindFlags, char const* name)
+	{
+		D3D11_BUFFER_DESC desc;
+		memset(&desc, 0, sizeof(D3D11_BUFFER_DESC));
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = byteSize;
+		desc.BindFlags = bindFlags;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ComPtr<ID3D11Buffer> buffer;
+		ThrowIfFailed(device->CreateBuffer(&desc, nullptr, &buffer));
+		SetDebugName(buffer.Get(), name);
+		return buffer;
+	}
+}
+
+D3D11CommandBackend::D3D11CommandBackend(ID3D11Device* device, ID3D11DeviceContext* context) :
+	_device(device),
+	_context(context),
+	_indexBufferSize(InitialIndexBytes)
+{
+	_vertices = CreatePtr<DynamicVertexRing>(device, InitialVertexBytes);
+	_indices = CreateDynamicBuffer(device, _indexBufferSize, D3D11_BIND_INDEX_BUFFER, "Command Indices");
+	_projection = CreateDynamicBuffer(device, sizeof(float32) * 16, D3D11_BIND_CONSTANT_BUFFER, "Command Projection");
+}
+
+bool D3D11CommandBackend::Upload(CommandBuffer const* const* buffers, uint32 count)
+{
+	uint32 vertexBytes = 0;
+	uint32 indexBytes = 0;
+	for (uint32 i = 0; i < count; ++i)
+	{
+		buffers[i]->ForEach([&](CommandHeader const& header)
+		{
+			if (header.type == CommandType::SetVertices)
+			{
+				SetVerticesCommand const& vertices = reinterpret_cast<SetVerticesCommand const&>(header);
+				vertexBytes = AlignUp(vertexBytes, 16) + vertices.count * vertices.stride;
+			}
+			else if (header.type == CommandType::DrawIndexed)
+			{
+				DrawIndexedCommand const& draw = reinterpret_cast<DrawIndexedCommand const&>(header);
+				indexBytes = AlignUp(indexBytes, 4) + draw.count * draw.indexSize;
+			}
+		});
+	}
+
+	// Grown for the largest frame so far, the ring then keeps appending without a discard for a while.
+	if (vertexBytes > _vertices->GetByteSize())
+	{
+		_vertices = CreatePtr<DynamicVertexRing>(_device, max(vertexBytes, _vertices->GetByteSize() * 2));
+	}
+	if (indexBytes > _indexBufferSize)
+	{
+		_indexBufferSize = max(indexBytes, _indexBufferSize * 2);
+		_indices = CreateDynamicBuffer(_device, _indexBufferSize, D3D11_BIND_INDEX_BUFFER, "Command Indices");
+	}
+
+	DynamicVertexRing::Allocation vertexAllocation = { nullptr, 0 };
+	if (vertexBytes > 0)
+	{
+		vertexAllocation = _vertices->Map(_context, vertexBytes, 16);
+		if (!vertexAllocation.data)
+		{
+			return false;
+		}
+	}
+	D3D11_MAPPED_SUBRESOURCE indexMapping = {};
+	if (indexBytes > 0 && FAILED(_context->Map(_indices.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &indexMapping)))
+	{
+		if (vertexAllocation.data)
+		{
+			_vertices->Unmap(_context);
+		}
+		return false;
+	}
+
+	_uploadOffsets.clear();
+	uint32 vertexOffset = 0;
+	uint32 indexOffset = 0;
+	for (uint32 i = 0; i < count; ++i)
+	{
+		buffers[i]->ForEach([&](CommandHeader const& header)
+		{
+			if (header.type == CommandType::SetVertices)
+			{
+				SetVerticesCommand const& vertices = reinterpret_cast<SetVerticesCommand const&>(header);
+				vertexOffset = AlignUp(vertexOffset, 16);
+				memcpy(static_cast<uint8*>(vertexAllocation.data) + vertexOffset, vertices.GetVertices(), vertices.count * vertices.stride);
+				_uploadOffsets.push_back(vertexAllocation.offset + vertexOffset);
+				vertexOffset += vertices.count * vertices.stride;
+			}
+			else if (header.type == CommandType::DrawIndexed)
+			{
+				DrawIndexedCommand const& draw = reinterpret_cast<DrawIndexedCommand const&>(header);
+				indexOffset = AlignUp(indexOffset, 4);
+				memcpy(static_cast<uint8*>(indexMapping.pData) + indexOffset, draw.GetIndices(), draw.count * draw.indexSize);
+				_uploadOffsets.push_back(indexOffset);
+				indexOffset += draw.count * draw.indexSize;
+			}
+		});
+	}
+
+	if (vertexAllocation.data)
+	{
+		_vertices->Unmap(_context);
+	}
+	if (indexMapping.pData)
+	{
+		_context->Unmap(_indices.Get(), 0);
+	}
+	return true;
+}
+
+void D3D11CommandBackend::Execute(CommandBuffer const* const* buffers, uint32 count)
+{
+	if (!Upload(buffers, count))
+	{
+		return;
+	}
+
+	ID3D11Buffer* vertexBuffer = _vertices->GetBuffer();
+	ID3D11Buffer* projection = _projection.Get();
+	uint32 boundIndexSize = 0;
+	size_t upload = 0;
+	for (uint32 i = 0; i < count; ++i)
+	{
+		buffers[i]->ForEach([&](CommandHeader const& header)
+		{
+			switch (header.type)
+			{
+			case CommandType::Clear:
+			{
+				ID3D11RenderTargetView* target = nullptr;
+				_context->OMGetRenderTargets(1, &target, nullptr);
+				if (target)
+				{
+					_context->ClearRenderTargetView(target, reinterpret_cast<ClearCommand const&>(header).color);
+					target->Release();
+				}
+				break;
+			}
+			case CommandType::SetViewport:
+			{
+				SetViewportCommand const& command = reinterpret_cast<SetViewportCommand const&>(header);
+				D3D11_VIEWPORT viewport = { command.x, command.y, command.width, command.height, 0.0f, 1.0f };
+				_context->RSSetViewports(1, &viewport);
+				break;
+			}
+			case CommandType::SetScissor:
+			{
+				SetScissorCommand const& command = reinterpret_cast<SetScissorCommand const&>(header);
+				D3D11_RECT rect = { command.left, command.top, command.right, command.bottom };
+				_context->RSSetScissorRects(1, &rect);
+				break;
+			}
+			case CommandType::SetTexture:
+			{
+				ID3D11ShaderResourceView* view = static_cast<ID3D11ShaderResourceView*>(reinterpret_cast<SetTextureCommand const&>(header).texture);
+				_context->PSSetShaderResources(0, 1, &view);
+				break;
+			}
+			case CommandType::SetProjection:
+			{
+				D3D11_MAPPED_SUBRESOURCE mapped;
+				if (SUCCEEDED(_context->Map(projection, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+				{
+					memcpy(mapped.pData, reinterpret_cast<SetProjectionCommand const&>(header).matrix, sizeof(float32) * 16);
+					_context->Unmap(projection, 0);
+				}
+				_context->VSSetConstantBuffers(0, 1, &projection);
+				break;
+			}
+			case CommandType::SetVertices:
+			{
+				UINT stride = reinterpret_cast<SetVerticesCommand const&>(header).stride;
+				UINT offset = _uploadOffsets[upload++];
+				_context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+				break;
+			}
+			case CommandType::DrawIndexed:
+			{
+				DrawIndexedCommand const& draw = reinterpret_cast<DrawIndexedCommand const&>(header);
+				if (draw.indexSize != boundIndexSize)
+				{
+					_context->IASetIndexBuffer(_indices.Get(), draw.indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+					boundIndexSize = draw.indexSize;
+				}
+				_context->DrawIndexed(draw.count, _uploadOffsets[upload++] / draw.indexSize, draw.baseVertex);
+				break;
+			}
+			case CommandType::Callback:
+			{
+				CallbackCommand const& callback = reinterpret_cast<CallbackCommand const&>(header);
+				callback.function(callback.first, callback.second);
+				// The callback may have bound an index buffer of its own.
+				boundIndexSize = 0;
+				break;
+			}
+			}
+		});
+	}
+}
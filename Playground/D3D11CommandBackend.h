@@ -0,0 +1,34 @@
+#pragma once
+#include "CommandBuffer.h"
+#include "ComPtr.h"
+#include "DynamicVertexRing.h"
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Replays command buffers on the immediate context. The vertices and indices of all buffers are uploaded in one go
+	*	first, then the commands are issued in order.
+	*
+	*	Shaders, input layout and blend, rasterizer and depth states are left to the caller, they are bound before Execute.
+	*	The projection goes to vertex shader constant buffer 0 and textures to pixel shader slot 0.
+	*/
+	class D3D11CommandBackend : public CommandBackend
+	{
+	public:
+		D3D11CommandBackend(ID3D11Device* device, ID3D11DeviceContext* context);
+
+		virtual void Execute(CommandBuffer const* const* buffers, uint32 count) override;
+
+	private:
+		bool Upload(CommandBuffer const* const* buffers, uint32 count);
+
+		ID3D11Device* _device;
+		ID3D11DeviceContext* _context;
+		Ptr<DynamicVertexRing> _vertices;
+		ComPtr<ID3D11Buffer> _indices;
+		uint32 _indexBufferSize;
+		ComPtr<ID3D11Buffer> _projection;
+		std::vector<uint32> _uploadOffsets;		// per SetVertices and DrawIndexed in replay order
+	};
+}
@@ -0,0 +1,60 @@
+#include "D3D11GlyphAtlas.h"
+#include "D3DHelper.h"
+#include "Utility.h"
+
+#ifdef _DEBUG
+#include "GlyphPixelShader.hlsl.Debug.pcsh"
+#else
+#include "GlyphPixelShader.hlsl.Release.pcsh"
+#endif
+
+using namespace std;
+using namespace X;
+
+D3D11GlyphAtlas::D3D11GlyphAtlas(ID3D11Device* device, ID3D11DeviceContext* context, uint32 pageSize) :
+	_context(context)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(desc));
+	desc.Width = pageSize;
+	desc.Height = pageSize;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+
+	// Starts cleared, so cells that were never written sample as empty.
+	vector<uint8> zero(size_t(pageSize) * pageSize);
+	D3D11_SUBRESOURCE_DATA subResource;
+	subResource.pSysMem = zero.data();
+	subResource.SysMemPitch = pageSize;
+	subResource.SysMemSlicePitch = 0;
+	ThrowIfFailed(device->CreateTexture2D(&desc, &subResource, &_texture));
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	ZeroMemory(&srvDesc, sizeof(srvDesc));
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	ThrowIfFailed(device->CreateShaderResourceView(_texture.Get(), &srvDesc, &_view));
+	SetDebugName(_view.Get(), "Glyph Atlas SRV");
+
+	ThrowIfFailed(device->CreatePixelShader(CompiledShaderCode_GlyphPixelShader_main, ArraySize(CompiledShaderCode_GlyphPixelShader_main), nullptr, &_pixelShader));
+	SetDebugName(_pixelShader.Get(), "Glyph Pixel Shader");
+}
+
+void D3D11GlyphAtlas::UpdateRegion(uint32 x, uint32 y, uint32 width, uint32 height, uint8 const* alpha, uint32 pitch)
+{
+	D3D11_BOX box;
+	box.left = x;
+	box.top = y;
+	box.front = 0;
+	box.right = x + width;
+	box.bottom = y + height;
+	box.back = 1;
+	_context->UpdateSubresource(_texture.Get(), 0, &box, alpha, pitch, 0);
+}
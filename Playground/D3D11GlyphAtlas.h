@@ -0,0 +1,38 @@
+#pragma once
+#include "GlyphCache.h"
+#include "ComPtr.h"
+#include <d3d11.h>
+
+namespace X
+{
+	/*
+	*	The GPU side of a GlyphCache page: one R8 texture in default usage, changed cells are copied in with UpdateSubresource.
+	*	Glyph quads use the ImGui vertex layout and vertex shader, with GetPixelShader in place of the ImGui pixel shader
+	*	because the coverage is stored in the red channel.
+	*/
+	class D3D11GlyphAtlas : public GlyphAtlasUploader
+	{
+	public:
+		D3D11GlyphAtlas(ID3D11Device* device, ID3D11DeviceContext* context, uint32 pageSize);
+
+		virtual void UpdateRegion(uint32 x, uint32 y, uint32 width, uint32 height, uint8 const* alpha, uint32 pitch) override;
+
+		/*
+		*	Usable as ImTextureID.
+		*/
+		ID3D11ShaderResourceView* GetShaderResourceView() const
+		{
+			return _view.Get();
+		}
+		ID3D11PixelShader* GetPixelShader() const
+		{
+			return _pixelShader.Get();
+		}
+
+	private:
+		ID3D11DeviceContext* _context;
+		ComPtr<ID3D11Texture2D> _texture;
+		ComPtr<ID3D11ShaderResourceView> _view;
+		ComPtr<ID3D11PixelShader> _pixelShader;
+	};
+}
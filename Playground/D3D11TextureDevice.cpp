@@ -0,0 +1,55 @@
+#include "D3D11TextureDevice.h"
+#include "D3DHelper.h"
+
+using namespace std;
+using namespace X;
+
+D3D11TextureDevice::D3D11TextureDevice(ID3D11Device* device) :
+	_device(device)
+{
+}
+
+void* D3D11TextureDevice::CreateTexture(uint32 width, uint32 height, void const* rgbaPixels)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(desc));
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA subResource;
+	subResource.pSysMem = rgbaPixels;
+	subResource.SysMemPitch = width * 4;
+	subResource.SysMemSlicePitch = 0;
+
+	ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(_device->CreateTexture2D(&desc, &subResource, &texture)))
+	{
+		return nullptr;
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	ZeroMemory(&srvDesc, sizeof(srvDesc));
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+
+	ID3D11ShaderResourceView* view = nullptr;
+	if (FAILED(_device->CreateShaderResourceView(texture.Get(), &srvDesc, &view)))
+	{
+		return nullptr;
+	}
+	return view;
+}
+
+void D3D11TextureDevice::ReleaseTexture(void* texture)
+{
+	static_cast<ID3D11ShaderResourceView*>(texture)->Release();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "TextureStreamer.h"
+
+struct ID3D11Device;
+
+namespace X
+{
+	/*
+	*	Creates immutable RGBA8 textures with their initial data, returns their ID3D11ShaderResourceView* so they can be used as ImTextureID.
+	*/
+	class D3D11TextureDevice : public TextureDevice
+	{
+	public:
+		explicit D3D11TextureDevice(ID3D11Device* device);
+
+		virtual void* CreateTexture(uint32 width, uint32 height, void const* rgbaPixels) override;
+		virtual void ReleaseTexture(void* texture) override;
+
+	private:
+		ID3D11Device* _device;
+	};
+}
@@ -5,6 +5,7 @@
 #include <string>
 #include <d3d11_3.h>
 #include "ComPtr.h"
+#include "Profiler.h"
 
 namespace X
 {
@@ -59,15 +60,26 @@ namespace X
 				_annotation->EndEvent();
 			}
 		}
-		DXEventSection(DXEventSection&& other) : _annotation(other._annotation)
+		DXEventSection(DXEventSection&& other) : _annotation(other._annotation), _zone(std::move(other._zone))
 		{
 			other._annotation = nullptr;
 		}
 	private:
 		friend class DeviceAndContext;
 		ID3DUserDefinedAnnotation* _annotation = nullptr;
+		// The section shows in the profiler timeline as well, also without a graphics debugger attached.
+		ProfileZone _zone;
 
-		DXEventSection(ID3DUserDefinedAnnotation* annotation, std::wstring const& section) : _annotation(annotation)
+		static char const* GetZoneName(wchar_t const* section)
+		{
+#ifndef SRPG_NO_PROFILER
+			return Profiler::InternName(section);
+#else
+			return nullptr;
+#endif
+		}
+
+		DXEventSection(ID3DUserDefinedAnnotation* annotation, std::wstring const& section) : _annotation(annotation), _zone(GetZoneName(section.c_str()))
 		{
 			if (_annotation && _annotation->GetStatus())
 			{
@@ -78,7 +90,7 @@ namespace X
 				_annotation = nullptr;
 			}
 		}
-		DXEventSection(ID3DUserDefinedAnnotation* annotation, wchar_t* section) : _annotation(annotation)
+		DXEventSection(ID3DUserDefinedAnnotation* annotation, wchar_t* section) : _annotation(annotation), _zone(GetZoneName(section))
 		{
 			if (_annotation && _annotation->GetStatus())
 			{
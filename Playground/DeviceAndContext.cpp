@@ -110,6 +110,9 @@ void DeviceAndContext::CreateDeviceAndContext()
 	SetDebugName(_d3dDevice, "Device");
 	SetDebugName(_d3dContext, "Context");
 
+	// States of a previous device can not be used with the new one.
+	_stateObjectCache = CreatePtr<StateObjectCache>(_d3dDevice.Get());
+
 #ifdef _DEBUG
 	CreateDebugFacility();
 #endif
@@ -206,6 +209,7 @@ void DeviceAndContext::FreeAllDXObjects()
 {
 	_d3dContext->ClearState();
 	_d3dContext->Flush1(D3D11_CONTEXT_TYPE_ALL, nullptr);
+	_stateObjectCache = nullptr;
 	_d3dDevice = nullptr;
 	_d3dContext = nullptr;
 	_swapChain = nullptr;
@@ -7,6 +7,7 @@
 #include <dxgidebug.h>
 #include <D3D11SDKLayers.h>
 #include "D3DHelper.h"
+#include "StateObjectCache.h"
 
 namespace X
 {
@@ -51,6 +52,14 @@ namespace X
 			return _screenViewport;
 		}
 
+		/*
+		*	Lives as long as the device, window resizes do not touch it.
+		*/
+		Ptr<StateObjectCache> const& GetStateObjectCache() const
+		{
+			return _stateObjectCache;
+		}
+
 		DXEventSection StartEventSection(std::wstring const& name);
 		DXEventSection StartEventSection(wchar_t* name);
 
@@ -66,6 +75,7 @@ namespace X
 		ComPtr<ID3D11Device3>			_d3dDevice;
 		ComPtr<ID3D11DeviceContext3>	_d3dContext;
 		ComPtr<IDXGISwapChain3>			_swapChain;
+		Ptr<StateObjectCache>			_stateObjectCache;
 
 
 
@@ -0,0 +1,53 @@
+#include "DynamicVertexRing.h"
+#include "D3DHelper.h"
+#include <cstring>
+
+using namespace std;
+using namespace X;
+
+DynamicVertexRing::DynamicVertexRing(ID3D11Device* device, uint32 byteSize) :
+	_byteSize(byteSize),
+	_writeOffset(0)
+{
+	D3D11_BUFFER_DESC desc;
+	memset(&desc, 0, sizeof(D3D11_BUFFER_DESC));
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = byteSize;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ThrowIfFailed(device->CreateBuffer(&desc, nullptr, &_buffer));
+	SetDebugName(_buffer.Get(), "Dynamic Vertex Ring");
+}
+
+DynamicVertexRing::Allocation DynamicVertexRing::Map(ID3D11DeviceContext* context, uint32 size, uint32 stride)
+{
+	Allocation allocation = { nullptr, 0 };
+	if (size > _byteSize)
+	{
+		return allocation;
+	}
+
+	// Vertex offsets have to be multiples of the stride to be usable as a vertex index base.
+	uint32 offset = (_writeOffset + stride - 1) / stride * stride;
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (offset + size > _byteSize)
+	{
+		offset = 0;
+		mapType = D3D11_MAP_WRITE_DISCARD;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(_buffer.Get(), 0, mapType, 0, &mapped)))
+	{
+		return allocation;
+	}
+	_writeOffset = offset + size;
+	allocation.data = static_cast<uint8*>(mapped.pData) + offset;
+	allocation.offset = offset;
+	return allocation;
+}
+
+void DynamicVertexRing::Unmap(ID3D11DeviceContext* context)
+{
+	context->Unmap(_buffer.Get(), 0);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "ComPtr.h"
+#include <d3d11.h>
+
+namespace X
+{
+	/*
+	*	One dynamic vertex buffer that is sub-allocated front to back every frame.
+	*	Allocations append with D3D11_MAP_WRITE_NO_OVERWRITE and only wrap around with D3D11_MAP_WRITE_DISCARD,
+	*	so data of earlier draws in the same frame is never stalled on or overwritten.
+	*/
+	class DynamicVertexRing : public ReferenceCountBase<true>
+	{
+	public:
+		struct Allocation
+		{
+			void* data;
+			uint32 offset;	// in bytes from the start of the buffer, pass it to IASetVertexBuffers
+		};
+
+		DynamicVertexRing(ID3D11Device* device, uint32 byteSize);
+
+		/*
+		*	Maps size bytes aligned to stride. Call Unmap before drawing from the buffer.
+		*	@return: data is nullptr when size is larger than the whole ring or mapping failed.
+		*/
+		Allocation Map(ID3D11DeviceContext* context, uint32 size, uint32 stride);
+		void Unmap(ID3D11DeviceContext* context);
+
+		ID3D11Buffer* GetBuffer() const
+		{
+			return _buffer.Get();
+		}
+		uint32 GetByteSize() const
+		{
+			return _byteSize;
+		}
+
+	private:
+		ComPtr<ID3D11Buffer> _buffer;
+		uint32 _byteSize;
+		uint32 _writeOffset;
+	};
+}
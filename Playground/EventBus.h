@@ -0,0 +1,191 @@
+#pragma once
+#include "BasicType.h"
+#include <cassert>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace X
+{
+	template <class Signature>
+	class Delegate;
+
+	/*
+	*	A callable stored inline in three pointers, called through one function pointer. Unlike std::function it never
+	*	allocates: lambdas have to capture pointers and references only, which keeps them trivially copyable, and a
+	*	capture that does not fit is a compile error.
+	*/
+	template <class Return, class... Arguments>
+	class Delegate<Return(Arguments...)>
+	{
+	public:
+		enum : size_t
+		{
+			StorageSize = 3 * sizeof(void*),
+		};
+
+		Delegate() = default;
+
+		template <class Function, class = typename std::enable_if<!std::is_same<typename std::decay<Function>::type, Delegate>::value>::type>
+		Delegate(Function function)
+		{
+			static_assert(sizeof(Function) <= StorageSize, "Capture less, or a pointer to the state instead.");
+			static_assert(alignof(Function) <= alignof(void*), "The storage is only aligned for pointers.");
+			static_assert(std::is_trivially_copyable<Function>::value && std::is_trivially_destructible<Function>::value,
+				"Delegates are copied bitwise and never destroyed, capture pointers and references only.");
+			new (&_storage) Function(function);
+			_call = [](void const* storage, Arguments... arguments) -> Return
+			{
+				return (*static_cast<Function const*>(storage))(std::forward<Arguments>(arguments)...);
+			};
+		}
+
+		/*
+		*	Delegate<void(int)>::Bind<Unit, &Unit::OnHit>(unit)
+		*/
+		template <class Object, Return(Object::*Method)(Arguments...)>
+		static Delegate Bind(Object* object)
+		{
+			return Delegate([object](Arguments... arguments) -> Return { return (object->*Method)(std::forward<Arguments>(arguments)...); });
+		}
+
+		Return operator()(Arguments... arguments) const
+		{
+			return _call(&_storage, std::forward<Arguments>(arguments)...);
+		}
+
+		explicit operator bool() const
+		{
+			return _call != nullptr;
+		}
+
+	private:
+		typedef Return(*Call)(void const* storage, Arguments... arguments);
+
+		Call _call = nullptr;
+		typename std::aligned_storage<StorageSize, alignof(void*)>::type _storage;
+	};
+
+	/*
+	*	Events checked at compile time: every event type has its own subscriber list, publishing a type the bus was not
+	*	declared with does not compile. Subscribers live inline, up to MaxSubscribers per type.
+	*
+	*	Publish calls the subscribers right away. Queue keeps events until Dispatch, once per frame, which delivers them per
+	*	type in the order they were queued. The queues keep their memory, so after the first frames nothing allocates.
+	*
+	*	Not thread safe. Subscribers must not subscribe to or unsubscribe from the type being delivered to them, events
+	*	they queue are delivered by the next Dispatch.
+	*/
+	template <class... Events>
+	class EventBus
+	{
+	public:
+		typedef uint32 SubscriptionID;
+		static uint32 const MaxSubscribers = 8;
+
+		template <class Event>
+		SubscriptionID Subscribe(Delegate<void(Event const&)> handler)
+		{
+			Channel<Event>& channel = GetChannel<Event>();
+			// Subscribers live inline, raise MaxSubscribers if this fires.
+			assert(channel.count < MaxSubscribers);
+			SubscriptionID id = _nextSubscription++;
+			channel.subscribers[channel.count++] = { handler, id };
+			return id;
+		}
+
+		template <class Event>
+		void Unsubscribe(SubscriptionID id)
+		{
+			Channel<Event>& channel = GetChannel<Event>();
+			for (uint32 index = 0; index < channel.count; ++index)
+			{
+				if (channel.subscribers[index].id == id)
+				{
+					// Shifted down, the others keep their order.
+					for (--channel.count; index < channel.count; ++index)
+					{
+						channel.subscribers[index] = channel.subscribers[index + 1];
+					}
+					return;
+				}
+			}
+		}
+
+		void UnsubscribeAll()
+		{
+			int expand[] = { 0, (GetChannel<Events>().count = 0, 0)... };
+			(void)expand;
+		}
+
+		template <class Event>
+		void Publish(Event const& event) const
+		{
+			Channel<Event> const& channel = GetChannel<Event>();
+			for (uint32 index = 0; index < channel.count; ++index)
+			{
+				channel.subscribers[index].handler(event);
+			}
+		}
+
+		template <class Event>
+		void Queue(Event const& event)
+		{
+			GetChannel<Event>().queued.push_back(event);
+		}
+
+		/*
+		*	Delivers the queued events of each type, in the order the types were declared.
+		*/
+		void Dispatch()
+		{
+			int expand[] = { 0, (DispatchChannel<Events>(), 0)... };
+			(void)expand;
+		}
+
+	private:
+		template <class Event>
+		struct Channel
+		{
+			struct Subscriber
+			{
+				Delegate<void(Event const&)> handler;
+				SubscriptionID id;
+			};
+
+			Subscriber subscribers[MaxSubscribers];
+			uint32 count = 0;
+			std::vector<Event> queued;
+			std::vector<Event> delivering;
+		};
+
+		template <class Event>
+		Channel<Event>& GetChannel()
+		{
+			return std::get<Channel<Event>>(_channels);
+		}
+		template <class Event>
+		Channel<Event> const& GetChannel() const
+		{
+			return std::get<Channel<Event>>(_channels);
+		}
+
+		template <class Event>
+		void DispatchChannel()
+		{
+			Channel<Event>& channel = GetChannel<Event>();
+			// Swapped out, so subscribers can queue more while these are delivered.
+			channel.delivering.swap(channel.queued);
+			for (Event const& event : channel.delivering)
+			{
+				Publish(event);
+			}
+			channel.delivering.clear();
+		}
+
+		std::tuple<Channel<Events>...> _channels;
+		SubscriptionID _nextSubscription = 0;
+	};
+}
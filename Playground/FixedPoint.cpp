@@ -0,0 +1,224 @@
+#include "FixedPoint.h"
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	struct UInt128
+	{
+		uint64 high;
+		uint64 low;
+	};
+
+	UInt128 MultiplyUnsigned(uint64 a, uint64 b)
+	{
+		uint64 aLow = a & 0xFFFFFFFF, aHigh = a >> 32;
+		uint64 bLow = b & 0xFFFFFFFF, bHigh = b >> 32;
+		uint64 lowLow = aLow * bLow;
+		uint64 lowHigh = aLow * bHigh;
+		uint64 highLow = aHigh * bLow;
+		uint64 middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+		return { aHigh * bHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32), (middle << 32) | (lowLow & 0xFFFFFFFF) };
+	}
+
+	bool LessOrEqual(UInt128 a, UInt128 b)
+	{
+		return a.high < b.high || (a.high == b.high && a.low <= b.low);
+	}
+
+	/*
+	*	A quarter of a sine wave as Q1.30, one entry more for interpolating the last interval. Computed with a Taylor
+	*	series in integers, a table from std::sin would depend on the C runtime it was made with.
+	*/
+	uint32 const SineTableBits = 10;
+	uint32 const SineTableSize = 1u << SineTableBits;
+
+	struct SineTable
+	{
+		sint32 values[SineTableSize + 1];
+
+		SineTable()
+		{
+			// pi / 2 as Q2.62.
+			uint64 const halfPi = 7244019458077122842ull;
+			auto multiply = [](sint64 a, sint64 b) { return (a * b + (sint64(1) << 29)) >> 30; };
+			for (uint32 index = 0; index <= SineTableSize; ++index)
+			{
+				sint64 x = sint64(((halfPi >> SineTableBits) * index + (1ull << 31)) >> 32);
+				sint64 xSquared = multiply(x, x);
+				sint64 term = x;
+				sint64 sum = x;
+				for (sint64 k = 1; term != 0; ++k)
+				{
+					term = -multiply(term, xSquared) / (2 * k * (2 * k + 1));
+					sum += term;
+				}
+				values[index] = sint32(sum);
+			}
+		}
+	} const sineTable;
+
+	__m128i SaturatingAdd4(__m128i a, __m128i b)
+	{
+		__m128i sum = _mm_add_epi32(a, b);
+		__m128i overflowed = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, sum), _mm_xor_si128(b, sum)), 31);
+		__m128i saturated = _mm_xor_si128(_mm_srai_epi32(a, 31), _mm_set1_epi32(INT32_MAX));
+		return _mm_or_si128(_mm_and_si128(overflowed, saturated), _mm_andnot_si128(overflowed, sum));
+	}
+
+	static_assert(sizeof(Fixed16) == sizeof(sint32), "Fixed16 is loaded 4 at a time.");
+
+	__m128i Load(Fixed16 const* values)
+	{
+		return _mm_loadu_si128(reinterpret_cast<__m128i const*>(values));
+	}
+
+	void Store(Fixed16* values, __m128i value)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(values), value);
+	}
+}
+
+sint64 X::MultiplyFixedRaw(sint64 a, sint64 b, uint32 fractionBits)
+{
+	// Unsigned product of the two's complement values. The signed one differs by b * 2^64 for negative a and a * 2^64
+	// for negative b, which only touches the high half.
+	UInt128 product = MultiplyUnsigned(uint64(a), uint64(b));
+	product.high -= (a < 0 ? uint64(b) : 0) + (b < 0 ? uint64(a) : 0);
+	uint64 round = 1ull << (fractionBits - 1);
+	product.low += round;
+	product.high += product.low < round ? 1 : 0;
+
+	sint64 overflow = sint64(product.high) >> (fractionBits - 1);
+	if (overflow != 0 && overflow != -1)
+	{
+		return sint64(product.high) < 0 ? INT64_MIN : INT64_MAX;
+	}
+	return sint64((product.high << (64 - fractionBits)) | (product.low >> fractionBits));
+}
+
+sint64 X::DivideFixedRaw(sint64 a, sint64 b, uint32 fractionBits)
+{
+	bool negative = (a < 0) != (b < 0);
+	if (b == 0)
+	{
+		return a < 0 ? INT64_MIN : INT64_MAX;
+	}
+
+	// Long division of the magnitudes, the shifted dividend has up to 64 + fractionBits bits.
+	uint64 dividend = a < 0 ? 0 - uint64(a) : uint64(a);
+	uint64 divisor = b < 0 ? 0 - uint64(b) : uint64(b);
+	UInt128 shifted = { dividend >> (64 - fractionBits), dividend << fractionBits };
+	uint64 remainder = 0;
+	uint64 quotient = 0;
+	for (sint32 bit = sint32(63 + fractionBits); bit >= 0; --bit)
+	{
+		uint64 carry = remainder >> 63;
+		remainder = (remainder << 1) | ((bit >= 64 ? shifted.high >> (bit - 64) : shifted.low >> bit) & 1);
+		if (carry || remainder >= divisor)
+		{
+			remainder -= divisor;
+			if (bit >= 64)
+			{
+				return negative ? INT64_MIN : INT64_MAX;
+			}
+			quotient |= 1ull << bit;
+		}
+	}
+	if (quotient > uint64(INT64_MAX))
+	{
+		return negative ? INT64_MIN : INT64_MAX;
+	}
+	return negative ? -sint64(quotient) : sint64(quotient);
+}
+
+sint32 X::SqrtFixedRaw(sint32 value, uint32 fractionBits)
+{
+	if (value <= 0)
+	{
+		return 0;
+	}
+	// The square has at most 53 bits, so the double is exact and its root at most one off. Corrected with integers,
+	// the result does not depend on the floating point unit.
+	uint64 square = uint64(value) << fractionBits;
+	uint64 root = uint64(sqrt(float64(square)));
+	while (root * root > square)
+	{
+		--root;
+	}
+	while ((root + 1) * (root + 1) <= square)
+	{
+		++root;
+	}
+	return sint32(root);
+}
+
+sint64 X::SqrtFixedRaw(sint64 value, uint32 fractionBits)
+{
+	if (value <= 0)
+	{
+		return 0;
+	}
+	UInt128 square = { uint64(value) >> (64 - fractionBits), uint64(value) << fractionBits };
+	uint64 root = uint64(sqrt(float64(square.high) * 18446744073709551616.0 + float64(square.low)));
+	while (!LessOrEqual(MultiplyUnsigned(root, root), square))
+	{
+		--root;
+	}
+	while (LessOrEqual(MultiplyUnsigned(root + 1, root + 1), square))
+	{
+		++root;
+	}
+	return sint64(root);
+}
+
+sint32 X::SineQ30(uint32 angle)
+{
+	uint32 quadrant = angle >> 30;
+	uint32 offset = angle & 0x3FFFFFFF;
+	if (quadrant & 1)
+	{
+		// Falling back towards 0, mirrored.
+		offset = 0x40000000 - offset;
+	}
+	uint32 const FractionBits = 30 - SineTableBits;
+	uint32 index = min(offset >> FractionBits, SineTableSize - 1);
+	sint64 fraction = offset - (index << FractionBits);
+	sint64 low = sineTable.values[index];
+	sint64 high = sineTable.values[index + 1];
+	sint32 sine = sint32(low + (((high - low) * fraction + (sint64(1) << (FractionBits - 1))) >> FractionBits));
+	return quadrant & 2 ? -sine : sine;
+}
+
+void X::AddBatch(Fixed16 const* a, Fixed16 const* b, Fixed16* result, size_t count)
+{
+	size_t index = 0;
+	for (; index + 4 <= count; index += 4)
+	{
+		Store(result + index, SaturatingAdd4(Load(a + index), Load(b + index)));
+	}
+	for (; index < count; ++index)
+	{
+		result[index] = a[index] + b[index];
+	}
+}
+
+void X::MultiplyBatch(Fixed16 const* a, Fixed16 const* b, Fixed16* result, size_t count)
+{
+	for (size_t index = 0; index < count; ++index)
+	{
+		result[index] = a[index] * b[index];
+	}
+}
+
+void X::MultiplyAddBatch(Fixed16 const* a, Fixed16 const* b, Fixed16 const* c, Fixed16* result, size_t count)
+{
+	for (size_t index = 0; index < count; ++index)
+	{
+		result[index] = a[index] * b[index] + c[index];
+	}
+}
@@ -0,0 +1,333 @@
+#pragma once
+#include "BasicType.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace X
+{
+	/*
+	*	Integer arithmetic that gives the same bits with every compiler, optimization level and CPU, for everything that
+	*	feeds the simulation checksums. Overflow saturates instead of wrapping, multiplication rounds half up and
+	*	division rounds towards zero.
+	*/
+	inline sint32 SaturatingAdd(sint32 a, sint32 b)
+	{
+		sint64 sum = sint64(a) + b;
+		return sum > INT32_MAX ? INT32_MAX : sum < INT32_MIN ? INT32_MIN : sint32(sum);
+	}
+	inline sint64 SaturatingAdd(sint64 a, sint64 b)
+	{
+		uint64 sum = uint64(a) + uint64(b);
+		// Overflowed if both operands have a different sign than the result.
+		if (sint64((uint64(a) ^ sum) & (uint64(b) ^ sum)) < 0)
+		{
+			return a < 0 ? INT64_MIN : INT64_MAX;
+		}
+		return sint64(sum);
+	}
+	inline sint32 SaturatingSubtract(sint32 a, sint32 b)
+	{
+		sint64 difference = sint64(a) - b;
+		return difference > INT32_MAX ? INT32_MAX : difference < INT32_MIN ? INT32_MIN : sint32(difference);
+	}
+	inline sint64 SaturatingSubtract(sint64 a, sint64 b)
+	{
+		uint64 difference = uint64(a) - uint64(b);
+		if (sint64((uint64(a) ^ uint64(b)) & (uint64(a) ^ difference)) < 0)
+		{
+			return a < 0 ? INT64_MIN : INT64_MAX;
+		}
+		return sint64(difference);
+	}
+
+	/*
+	*	(a * b) >> fractionBits and (a << fractionBits) / b of the raw values, saturated. Q32.32 goes through 128 bits,
+	*	written out with 64 bit operations because not every compiler has a 128 bit type.
+	*/
+	inline sint32 MultiplyFixedRaw(sint32 a, sint32 b, uint32 fractionBits)
+	{
+		sint64 product = (sint64(a) * b + (sint64(1) << (fractionBits - 1))) >> fractionBits;
+		return product > INT32_MAX ? INT32_MAX : product < INT32_MIN ? INT32_MIN : sint32(product);
+	}
+	sint64 MultiplyFixedRaw(sint64 a, sint64 b, uint32 fractionBits);
+	inline sint32 DivideFixedRaw(sint32 a, sint32 b, uint32 fractionBits)
+	{
+		if (b == 0)
+		{
+			return a < 0 ? INT32_MIN : INT32_MAX;
+		}
+		sint64 quotient = sint64(a) * (sint64(1) << fractionBits) / b;
+		return quotient > INT32_MAX ? INT32_MAX : quotient < INT32_MIN ? INT32_MIN : sint32(quotient);
+	}
+	sint64 DivideFixedRaw(sint64 a, sint64 b, uint32 fractionBits);
+
+	/*
+	*	Rounded down, 0 for negative values. Exact, the floating point estimate inside is corrected with integers.
+	*/
+	sint32 SqrtFixedRaw(sint32 value, uint32 fractionBits);
+	sint64 SqrtFixedRaw(sint64 value, uint32 fractionBits);
+
+	/*
+	*	Sine of a binary angle, 2^32 is a full turn, as Q1.30. From a table computed with integers only, interpolated
+	*	linearly, within 3e-7 of the exact value.
+	*/
+	sint32 SineQ30(uint32 angle);
+
+	template <class Raw, uint32 FractionBits>
+	class Fixed
+	{
+	public:
+		typedef Raw RawType;
+		static uint32 const Fraction = FractionBits;
+
+		Fixed() = default;
+
+		static Fixed FromRaw(Raw raw)
+		{
+			Fixed value;
+			value._raw = raw;
+			return value;
+		}
+		static Fixed FromInt(sint32 value)
+		{
+			sint64 const limit = sint64(std::numeric_limits<Raw>::max() >> FractionBits);
+			return FromRaw(value > limit ? std::numeric_limits<Raw>::max() : value < -limit - 1 ? std::numeric_limits<Raw>::min() :
+				Raw(Raw(value) * (Raw(1) << FractionBits)));
+		}
+		static Fixed FromRatio(sint32 numerator, sint32 denominator)
+		{
+			return FromInt(numerator) / FromInt(denominator);
+		}
+		/*
+		*	For constants and authored data, a double converts the same everywhere as long as it is exactly representable
+		*	or the conversion happens once when the data is built.
+		*/
+		static Fixed FromDouble(float64 value)
+		{
+			float64 scaled = value * float64(Raw(1) << FractionBits);
+			float64 const limit = float64(std::numeric_limits<Raw>::max());
+			return FromRaw(scaled >= limit ? std::numeric_limits<Raw>::max() : scaled <= -limit ? std::numeric_limits<Raw>::min() :
+				Raw(scaled < 0 ? scaled - 0.5 : scaled + 0.5));
+		}
+		static Fixed Max()
+		{
+			return FromRaw(std::numeric_limits<Raw>::max());
+		}
+		static Fixed Min()
+		{
+			return FromRaw(std::numeric_limits<Raw>::min());
+		}
+
+		Raw GetRaw() const
+		{
+			return _raw;
+		}
+		/*
+		*	Rounded down.
+		*/
+		sint32 ToInt() const
+		{
+			return sint32(_raw >> FractionBits);
+		}
+		sint32 Round() const
+		{
+			return sint32(SaturatingAdd(_raw, Raw(1) << (FractionBits - 1)) >> FractionBits);
+		}
+		/*
+		*	For display only, nothing computed from it may flow back into the simulation.
+		*/
+		float64 ToDouble() const
+		{
+			return float64(_raw) / float64(Raw(1) << FractionBits);
+		}
+
+		Fixed operator-() const
+		{
+			return FromRaw(SaturatingSubtract(Raw(0), _raw));
+		}
+		Fixed operator+(Fixed other) const
+		{
+			return FromRaw(SaturatingAdd(_raw, other._raw));
+		}
+		Fixed operator-(Fixed other) const
+		{
+			return FromRaw(SaturatingSubtract(_raw, other._raw));
+		}
+		Fixed operator*(Fixed other) const
+		{
+			return FromRaw(MultiplyFixedRaw(_raw, other._raw, FractionBits));
+		}
+		/*
+		*	Dividing by zero gives the largest value with the sign of the dividend.
+		*/
+		Fixed operator/(Fixed other) const
+		{
+			return FromRaw(DivideFixedRaw(_raw, other._raw, FractionBits));
+		}
+		Fixed& operator+=(Fixed other)
+		{
+			return *this = *this + other;
+		}
+		Fixed& operator-=(Fixed other)
+		{
+			return *this = *this - other;
+		}
+		Fixed& operator*=(Fixed other)
+		{
+			return *this = *this * other;
+		}
+		Fixed& operator/=(Fixed other)
+		{
+			return *this = *this / other;
+		}
+
+		bool operator==(Fixed other) const
+		{
+			return _raw == other._raw;
+		}
+		bool operator!=(Fixed other) const
+		{
+			return _raw != other._raw;
+		}
+		bool operator<(Fixed other) const
+		{
+			return _raw < other._raw;
+		}
+		bool operator<=(Fixed other) const
+		{
+			return _raw <= other._raw;
+		}
+		bool operator>(Fixed other) const
+		{
+			return _raw > other._raw;
+		}
+		bool operator>=(Fixed other) const
+		{
+			return _raw >= other._raw;
+		}
+
+	private:
+		Raw _raw;
+	};
+
+	/*
+	*	Q16.16 for positions and rates, Q32.32 where sums over a whole battle would not fit.
+	*/
+	typedef Fixed<sint32, 16> Fixed16;
+	typedef Fixed<sint64, 32> Fixed32;
+
+	template <class Raw, uint32 FractionBits>
+	Fixed<Raw, FractionBits> Abs(Fixed<Raw, FractionBits> value)
+	{
+		return value.GetRaw() < 0 ? -value : value;
+	}
+
+	template <class Raw, uint32 FractionBits>
+	Fixed<Raw, FractionBits> Sqrt(Fixed<Raw, FractionBits> value)
+	{
+		return Fixed<Raw, FractionBits>::FromRaw(SqrtFixedRaw(value.GetRaw(), FractionBits));
+	}
+
+	/*
+	*	@angle: 2^32 is a full turn, so angles wrap around like the integers they are. Sin<Fixed16>(AngleFromDegrees(30)).
+	*/
+	template <class FixedType>
+	FixedType Sin(uint32 angle)
+	{
+		typedef typename FixedType::RawType Raw;
+		uint32 const Fraction = FixedType::Fraction;
+		sint64 sine = SineQ30(angle);
+		if (Fraction >= 30)
+		{
+			return FixedType::FromRaw(Raw(sine * (sint64(1) << (Fraction >= 30 ? Fraction - 30 : 0))));
+		}
+		// Rounded half up like the other operations.
+		return FixedType::FromRaw(Raw((sine + (sint64(1) << (Fraction < 30 ? 29 - Fraction : 0))) >> (Fraction < 30 ? 30 - Fraction : 0)));
+	}
+	template <class FixedType>
+	FixedType Cos(uint32 angle)
+	{
+		return Sin<FixedType>(angle + 0x40000000u);
+	}
+
+	inline uint32 AngleFromDegrees(sint32 degrees)
+	{
+		sint32 wrapped = degrees % 360;
+		return uint32(((uint64(wrapped < 0 ? wrapped + 360 : wrapped) << 32) + 180) / 360);
+	}
+
+	template <class FixedType>
+	struct FixedVector2
+	{
+		FixedType x;
+		FixedType y;
+
+		FixedVector2 operator+(FixedVector2 const& other) const
+		{
+			return { x + other.x, y + other.y };
+		}
+		FixedVector2 operator-(FixedVector2 const& other) const
+		{
+			return { x - other.x, y - other.y };
+		}
+		FixedVector2 operator*(FixedType scale) const
+		{
+			return { x * scale, y * scale };
+		}
+		FixedVector2& operator+=(FixedVector2 const& other)
+		{
+			return *this = *this + other;
+		}
+		FixedVector2& operator-=(FixedVector2 const& other)
+		{
+			return *this = *this - other;
+		}
+		bool operator==(FixedVector2 const& other) const
+		{
+			return x == other.x && y == other.y;
+		}
+		bool operator!=(FixedVector2 const& other) const
+		{
+			return !(*this == other);
+		}
+
+		FixedType Dot(FixedVector2 const& other) const
+		{
+			return x * other.x + y * other.y;
+		}
+		FixedType LengthSquared() const
+		{
+			return Dot(*this);
+		}
+		FixedType Length() const
+		{
+			return Sqrt(LengthSquared());
+		}
+		/*
+		*	@angle: counter clockwise, binary angle as for Sin.
+		*/
+		FixedVector2 Rotated(uint32 angle) const
+		{
+			FixedType sine = Sin<FixedType>(angle), cosine = Cos<FixedType>(angle);
+			return { x * cosine - y * sine, x * sine + y * cosine };
+		}
+	};
+
+	typedef FixedVector2<Fixed16> FixedVector16;
+	typedef FixedVector2<Fixed32> FixedVector32;
+
+	/*
+	*	Whole arrays, the results are bit for bit those of the scalar operators. result may be the same array as an input,
+	*	but not overlap one partially. AddBatch uses SSE2, 4 values per instruction. The multiplications are plain loops:
+	*	SSE2 only multiplies unsigned 32 bit lanes, correcting the signs, saturating and interleaving the even and odd lanes
+	*	again took as long as the scalar 64 bit multiply, and the compiler does not vectorize the loop either.
+	*/
+	void AddBatch(Fixed16 const* a, Fixed16 const* b, Fixed16* result, size_t count);
+	void MultiplyBatch(Fixed16 const* a, Fixed16 const* b, Fixed16* result, size_t count);
+
+	/*
+	*	result = a * b + c, rounded after the multiplication like the scalar expression. position + velocity * step.
+	*/
+	void MultiplyAddBatch(Fixed16 const* a, Fixed16 const* b, Fixed16 const* c, Fixed16* result, size_t count);
+}
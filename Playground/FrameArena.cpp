@@ -0,0 +1,93 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+using namespace X;
+
+FrameArena::FrameArena(size_t capacity) :
+	_current(&_buffers[0]),
+	_capacity(capacity)
+{
+	for (Buffer& buffer : _buffers)
+	{
+		buffer.memory = static_cast<uint8*>(::operator new(capacity));
+		buffer.used = 0;
+		buffer.overflowCount = 0;
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	for (Buffer& buffer : _buffers)
+	{
+		Release(buffer);
+		::operator delete(buffer.memory);
+	}
+}
+
+void FrameArena::Release(Buffer& buffer)
+{
+	for (void* block : buffer.overflow)
+	{
+		free(block);
+	}
+	buffer.overflow.clear();
+	buffer.overflowCount = 0;
+	buffer.used = 0;
+}
+
+void FrameArena::BeginFrame()
+{
+	// The bump offset keeps counting past the capacity, so it is what the frame would have needed.
+	_lastFrameHighWater = _current->used.load(memory_order_relaxed);
+	_lastFrameOverflows = _current->overflowCount;
+	_peakHighWater = max(_peakHighWater, _lastFrameHighWater);
+	++_frame;
+
+	_current = &_buffers[_frame % 2];
+	Release(*_current);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	Buffer& buffer = *_current;
+	// Reserving size + alignment - 1 keeps the bump a single atomic add.
+	size_t reserved = size + alignment - 1;
+	size_t offset = buffer.used.fetch_add(reserved, memory_order_relaxed);
+	if (offset + reserved <= _capacity)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(buffer.memory + offset);
+		return reinterpret_cast<void*>((address + alignment - 1) & ~uintptr_t(alignment - 1));
+	}
+	return AllocateOverflow(buffer, size, alignment);
+}
+
+void* FrameArena::AllocateOverflow(Buffer& buffer, size_t size, size_t alignment)
+{
+	void* block = malloc(size + alignment - 1);
+	if (!block)
+	{
+		throw bad_alloc();
+	}
+	{
+		lock_guard<mutex> lock(_overflowMutex);
+		buffer.overflow.push_back(block);
+		++buffer.overflowCount;
+	}
+	uintptr_t address = reinterpret_cast<uintptr_t>(block);
+	return reinterpret_cast<void*>((address + alignment - 1) & ~uintptr_t(alignment - 1));
+}
+
+FrameArena::Statistics FrameArena::GetStatistics() const
+{
+	Statistics statistics;
+	statistics.capacity = _capacity;
+	statistics.used = min(_current->used.load(memory_order_relaxed), _capacity);
+	statistics.lastFrameHighWater = _lastFrameHighWater;
+	statistics.peakHighWater = _peakHighWater;
+	statistics.lastFrameOverflows = _lastFrameOverflows;
+	statistics.frame = _frame;
+	return statistics;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "BasicType.h"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Linear allocator for data that dies with the frame. Two buffers are used in turn, so what was allocated in a frame
+	*	stays valid through the next one, e.g. for the render thread drawing it.
+	*
+	*	Allocate is lock free and can be called from any thread. A frame that runs out of arena memory falls back to the
+	*	heap, those blocks are freed together with the buffer they overflowed.
+	*/
+	class FrameArena
+	{
+	public:
+		struct Statistics
+		{
+			size_t capacity;			// per buffer
+			size_t used;				// so far in the current frame
+			size_t lastFrameHighWater;	// bytes asked for in the previous frame, overflow included
+			size_t peakHighWater;		// over all frames
+			uint32 lastFrameOverflows;	// allocations the previous frame sent to the heap
+			uint64 frame;
+		};
+
+		explicit FrameArena(size_t capacity);
+		~FrameArena();
+		FrameArena(FrameArena const&) = delete;
+		FrameArena& operator=(FrameArena const&) = delete;
+
+		/*
+		*	Starts a new frame, invalidates what was allocated two frames ago. Nothing may allocate concurrently.
+		*/
+		void BeginFrame();
+
+		/*
+		*	@alignment: power of two.
+		*	@return: never nullptr, throws std::bad_alloc if the heap fallback fails.
+		*/
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+		template <class T>
+		T* AllocateArray(size_t count)
+		{
+			return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		Statistics GetStatistics() const;
+
+	private:
+		struct Buffer
+		{
+			uint8* memory;
+			std::atomic<size_t> used;
+			std::vector<void*> overflow;
+			uint32 overflowCount;
+		};
+
+		void* AllocateOverflow(Buffer& buffer, size_t size, size_t alignment);
+		void Release(Buffer& buffer);
+
+		Buffer _buffers[2];
+		Buffer* _current;
+		size_t _capacity;
+		size_t _lastFrameHighWater = 0;
+		size_t _peakHighWater = 0;
+		uint32 _lastFrameOverflows = 0;
+		uint64 _frame = 0;
+		std::mutex _overflowMutex;
+	};
+
+	/*
+	*	Standard allocator on a FrameArena for transient containers, deallocate does nothing.
+	*/
+	template <class T>
+	class FrameAllocator
+	{
+	public:
+		typedef T value_type;
+
+		FrameAllocator(FrameArena& arena) noexcept : _arena(&arena) {}
+		template <class U>
+		FrameAllocator(FrameAllocator<U> const& other) noexcept : _arena(other._arena) {}
+
+		T* allocate(size_t count)
+		{
+			return _arena->AllocateArray<T>(count);
+		}
+		void deallocate(T*, size_t) noexcept
+		{
+		}
+
+		template <class U>
+		bool operator==(FrameAllocator<U> const& other) const noexcept
+		{
+			return _arena == other._arena;
+		}
+		template <class U>
+		bool operator!=(FrameAllocator<U> const& other) const noexcept
+		{
+			return _arena != other._arena;
+		}
+
+	private:
+		template <class U> friend class FrameAllocator;
+		FrameArena* _arena;
+	};
+
+	template <class T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
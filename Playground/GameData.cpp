@@ -0,0 +1,76 @@
+#include "GameData.h"
+#include <cstring>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	bool IsInside(uint64 offset, uint64 size, size_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+GameDataFile::GameDataFile(Ptr<MappedFile> mapped, vector<uint8> buffer) :
+	_mapped(move(mapped)),
+	_buffer(move(buffer))
+{
+	_data = _mapped ? _mapped->GetData() : _buffer.data();
+	_size = _mapped ? _mapped->GetSize() : _buffer.size();
+	_header = reinterpret_cast<GameDataTableHeader const*>(_data);
+}
+
+Ptr<GameDataFile> GameDataFile::Open(string const& path, uint32 rowSize, uint32 layoutHash)
+{
+	Ptr<MappedFile> mapped = MappedFile::Open(path);
+	if (!mapped)
+	{
+		return nullptr;
+	}
+	Ptr<GameDataFile> file = CreatePtr<GameDataFile>(mapped, vector<uint8>());
+	return file->Check(rowSize, layoutHash) ? file : nullptr;
+}
+
+Ptr<GameDataFile> GameDataFile::Create(vector<uint8> buffer, uint32 rowSize, uint32 layoutHash)
+{
+	Ptr<GameDataFile> file = CreatePtr<GameDataFile>(nullptr, move(buffer));
+	return file->Check(rowSize, layoutHash) ? file : nullptr;
+}
+
+bool GameDataFile::Check(uint32 rowSize, uint32 layoutHash) const
+{
+	if (_size < sizeof(GameDataTableHeader))
+	{
+		return false;
+	}
+	GameDataTableHeader const& header = *_header;
+	return header.magic == GameDataMagic && header.version == GameDataVersion && header.headerSize == sizeof(GameDataTableHeader) &&
+		header.fileSize == _size && header.layoutHash == layoutHash && header.rowSize == rowSize && rowSize >= sizeof(GameDataString) &&
+		header.displacementsOffset % 4 == 0 && IsInside(header.displacementsOffset, uint64(header.bucketCount) * sizeof(uint32), _size) &&
+		header.rowsOffset % 4 == 0 && IsInside(header.rowsOffset, uint64(header.rowCount) * rowSize, _size) &&
+		IsInside(header.stringsOffset, header.stringsSize, _size) && (header.stringsSize == 0 || _data[_size - 1] == 0) &&
+		(header.rowCount == 0 || header.bucketCount > 0);
+}
+
+uint32 GameDataFile::Find(char const* id, size_t length) const
+{
+	GameDataTableHeader const& header = *_header;
+	if (header.rowCount == 0)
+	{
+		return ~0u;
+	}
+	uint32 const* displacements = reinterpret_cast<uint32 const*>(_data + header.displacementsOffset);
+	uint32 bucket = uint32(GameDataHash(id, length, 0) % header.bucketCount);
+	uint32 index = uint32(GameDataHash(id, length, displacements[bucket]) % header.rowCount);
+
+	// Any string hashes to some row, compare with the id stored in it.
+	GameDataString stored;
+	memcpy(&stored, _data + header.rowsOffset + size_t(index) * header.rowSize, sizeof(stored));
+	if (stored.offset >= header.stringsSize)
+	{
+		return ~0u;
+	}
+	char const* storedID = GetString(stored);
+	return strncmp(storedID, id, length) == 0 && storedID[length] == 0 ? index : ~0u;
+}
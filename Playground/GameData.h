@@ -0,0 +1,158 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Compiled designer table, written by DataCompiler. Little-endian, offsets from the start of the file:
+	*
+	*	header | displacements | rows | strings
+	*
+	*	Rows are dense arrays of 4 byte fields in the order of the generated row struct.
+	*	Row i is the slot the minimal perfect hash gives for its id, so the generated id constants are row indices
+	*	and a string lookup is two hashes plus one compare.
+	*/
+	uint32 const GameDataMagic = 0x54444753;	// "SGDT"
+	uint16 const GameDataVersion = 1;
+
+	struct GameDataTableHeader
+	{
+		uint32 magic;
+		uint16 version;
+		uint16 headerSize;
+		uint32 fileSize;
+		uint32 layoutHash;		// of the columns and the ids, must match the generated header
+		uint32 rowCount;
+		uint32 rowSize;
+		uint32 bucketCount;
+		uint32 displacementsOffset;
+		uint32 rowsOffset;
+		uint32 stringsOffset;
+		uint32 stringsSize;
+		uint32 reserved;
+	};
+
+	static_assert(sizeof(GameDataTableHeader) == 48, "GameDataTableHeader is part of the file format");
+
+	/*
+	*	A string column, offset into the strings section of its table.
+	*/
+	struct GameDataString
+	{
+		uint32 offset;
+	};
+
+	/*
+	*	Hash shared by DataCompiler and the runtime. FNV-1a with a seeded start and a final mix.
+	*/
+	inline uint64 GameDataHash(char const* text, size_t length, uint64 seed)
+	{
+		uint64 hash = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+		for (size_t i = 0; i < length; ++i)
+		{
+			hash = (hash ^ uint8(text[i])) * 1099511628211ull;
+		}
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	/*
+	*	The untyped table, use GameDataTable<Row> in game code.
+	*/
+	class GameDataFile : public ReferenceCountBase<true>
+	{
+	public:
+		/*
+		*	@return: nullptr if the file is missing or does not match the generated header.
+		*/
+		static Ptr<GameDataFile> Open(std::string const& path, uint32 rowSize, uint32 layoutHash);
+		static Ptr<GameDataFile> Create(std::vector<uint8> file, uint32 rowSize, uint32 layoutHash);
+
+		uint32 GetRowCount() const
+		{
+			return _header->rowCount;
+		}
+		void const* GetRows() const
+		{
+			return _data + _header->rowsOffset;
+		}
+		char const* GetString(GameDataString string) const
+		{
+			return reinterpret_cast<char const*>(_data + _header->stringsOffset + string.offset);
+		}
+
+		/*
+		*	@id: the id column is always the first field of a row.
+		*	@return: row index, ~0u if there is no row with that id.
+		*/
+		uint32 Find(char const* id, size_t length) const;
+		uint32 Find(std::string const& id) const
+		{
+			return Find(id.c_str(), id.size());
+		}
+
+		GameDataFile(Ptr<MappedFile> mapped, std::vector<uint8> buffer);
+
+	private:
+		bool Check(uint32 rowSize, uint32 layoutHash) const;
+
+		Ptr<MappedFile> _mapped;
+		std::vector<uint8> _buffer;
+		uint8 const* _data;
+		size_t _size;
+		GameDataTableHeader const* _header;
+	};
+
+	/*
+	*	Typed view of a compiled table, Row is one of the structs generated into GameDataTables.h.
+	*	Indexing with a generated id constant is a single load.
+	*/
+	template <class Row>
+	class GameDataTable
+	{
+	public:
+		bool Open(std::string const& path)
+		{
+			return Attach(GameDataFile::Open(path, sizeof(Row), Row::LayoutHash));
+		}
+		bool Attach(Ptr<GameDataFile> file)
+		{
+			_file = file;
+			_rows = _file ? static_cast<Row const*>(_file->GetRows()) : nullptr;
+			_count = _file ? _file->GetRowCount() : 0;
+			return _rows != nullptr;
+		}
+
+		uint32 GetCount() const
+		{
+			return _count;
+		}
+		Row const& operator[](uint32 index) const
+		{
+			return _rows[index];
+		}
+		/*
+		*	@return: nullptr if there is no row with that id.
+		*/
+		Row const* Find(std::string const& id) const
+		{
+			uint32 index = _file->Find(id);
+			return index == ~0u ? nullptr : &_rows[index];
+		}
+		char const* GetString(GameDataString string) const
+		{
+			return _file->GetString(string);
+		}
+
+	private:
+		Ptr<GameDataFile> _file;
+		Row const* _rows = nullptr;
+		uint32 _count = 0;
+	};
+}
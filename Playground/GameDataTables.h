@@ -0,0 +1,129 @@
+// Generated by DataCompiler from the tables in Data/Tables, do not edit.
+#pragma once
+#include "GameData.h"
+
+namespace X
+{
+	struct ClassesRow
+	{
+		static constexpr uint32 LayoutHash = 0x3D186117;
+
+		GameDataString id;
+		GameDataString name;
+		uint32 move;
+		uint32 hp_growth;
+		uint32 attack_growth;
+		uint32 defense_growth;
+		uint32 flying;
+	};
+
+	struct WeaponsRow
+	{
+		static constexpr uint32 LayoutHash = 0xC69B99EF;
+
+		GameDataString id;
+		GameDataString name;
+		sint32 might;
+		sint32 hit;
+		float32 crit;
+		uint32 min_range;
+		uint32 max_range;
+		uint32 uses;
+	};
+
+	struct SkillsRow
+	{
+		static constexpr uint32 LayoutHash = 0x1E5CAC71;
+
+		GameDataString id;
+		GameDataString name;
+		GameDataString description;
+		float32 trigger_chance;
+	};
+
+	struct UnitsRow
+	{
+		static constexpr uint32 LayoutHash = 0x23524FDB;
+
+		GameDataString id;
+		GameDataString name;
+		uint32 unit_class;		// ClassesRow index, ~0u if empty
+		uint32 weapon;		// WeaponsRow index, ~0u if empty
+		uint32 skill;		// SkillsRow index, ~0u if empty
+		uint32 team;
+		uint32 level;
+		sint32 hp;
+		sint32 attack;
+		sint32 defense;
+	};
+
+	struct StringsRow
+	{
+		static constexpr uint32 LayoutHash = 0x2D37C709;
+
+		GameDataString id;
+		GameDataString en;
+		GameDataString zh_cn;
+	};
+
+	namespace GameDataID
+	{
+		namespace Classes
+		{
+			constexpr uint32 Count = 5;
+			constexpr uint32 Mage = 0;
+			constexpr uint32 Archer = 1;
+			constexpr uint32 Knight = 2;
+			constexpr uint32 PegasusKnight = 3;
+			constexpr uint32 Cleric = 4;
+		}
+
+		namespace Weapons
+		{
+			constexpr uint32 Count = 6;
+			constexpr uint32 KillerBow = 0;
+			constexpr uint32 IronSword = 1;
+			constexpr uint32 SteelLance = 2;
+			constexpr uint32 HealStaff = 3;
+			constexpr uint32 FireTome = 4;
+			constexpr uint32 IronBow = 5;
+		}
+
+		namespace Skills
+		{
+			constexpr uint32 Count = 4;
+			constexpr uint32 Vantage = 0;
+			constexpr uint32 Miracle = 1;
+			constexpr uint32 Canto = 2;
+			constexpr uint32 Pierce = 3;
+		}
+
+		namespace Units
+		{
+			constexpr uint32 Count = 9;
+			constexpr uint32 Clair = 0;
+			constexpr uint32 Brigand = 1;
+			constexpr uint32 DarkMage = 2;
+			constexpr uint32 Alm = 3;
+			constexpr uint32 Celica = 4;
+			constexpr uint32 Silque = 5;
+			constexpr uint32 Gray = 6;
+			constexpr uint32 Tobin = 7;
+			constexpr uint32 BanditArcher = 8;
+		}
+
+		namespace Strings
+		{
+			constexpr uint32 Count = 9;
+			constexpr uint32 MenuStart = 0;
+			constexpr uint32 UnitAttacks = 1;
+			constexpr uint32 FrameTime = 2;
+			constexpr uint32 MenuContinue = 3;
+			constexpr uint32 WindowTitle = 4;
+			constexpr uint32 UnitHp = 5;
+			constexpr uint32 MenuOptions = 6;
+			constexpr uint32 TurnBanner = 7;
+			constexpr uint32 MenuQuit = 8;
+		}
+	}
+}
@@ -0,0 +1,296 @@
+#include "GlyphCache.h"
+#include <algorithm>
+// stb_truetype includes these itself, they must come before the namespace below.
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// Own copy of stb_truetype from the imgui tree, kept static and namespaced the same way imgui_draw.cpp does it.
+namespace GlyphCacheStb
+{
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+}
+
+using namespace std;
+using namespace X;
+
+struct GlyphCache::FontInfo
+{
+	GlyphCacheStb::stbtt_fontinfo info;
+};
+
+namespace
+{
+	// @return: 0 at the end of the string, invalid sequences decode as U+FFFD.
+	uint32 NextCodepoint(char const*& text)
+	{
+		uint8 const* bytes = reinterpret_cast<uint8 const*>(text);
+		uint8 lead = bytes[0];
+		if (lead == 0)
+		{
+			return 0;
+		}
+		uint32 length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+		if (length == 0)
+		{
+			++text;
+			return 0xFFFD;
+		}
+		uint32 codepoint = length == 1 ? lead : lead & (0xFF >> (length + 1));
+		for (uint32 i = 1; i < length; ++i)
+		{
+			if ((bytes[i] & 0xC0) != 0x80)
+			{
+				text += i;
+				return 0xFFFD;
+			}
+			codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+		}
+		text += length;
+		return codepoint;
+	}
+}
+
+GlyphCache::GlyphCache(vector<uint8> font, float32 pixelHeight, uint32 pageSize) :
+	_font(move(font)),
+	_fontInfo(new FontInfo()),
+	_pixelHeight(pixelHeight),
+	_pageSize(pageSize),
+	_mostRecent(NoCell),
+	_leastRecent(NoCell),
+	_frame(0),
+	_statistics()
+{
+	int offset = GlyphCacheStb::stbtt_GetFontOffsetForIndex(_font.data(), 0);
+	if (offset < 0 || !GlyphCacheStb::stbtt_InitFont(&_fontInfo->info, _font.data(), offset))
+	{
+		throw exception("GlyphCache: invalid font file.");
+	}
+
+	_scale = GlyphCacheStb::stbtt_ScaleForPixelHeight(&_fontInfo->info, pixelHeight);
+	int ascent, descent, lineGap;
+	GlyphCacheStb::stbtt_GetFontVMetrics(&_fontInfo->info, &ascent, &descent, &lineGap);
+	_ascent = ascent * _scale;
+	_lineHeight = (ascent - descent + lineGap) * _scale;
+
+	// One texel of padding on each side keeps linear filtering from bleeding into the neighbor cells.
+	_cellSize = uint32(ceil(pixelHeight)) + 2;
+	_cellsPerRow = _pageSize / _cellSize;
+	uint32 cellCount = _cellsPerRow * _cellsPerRow;
+
+	_page.resize(size_t(_pageSize) * _pageSize);
+	_cellCodepoint.resize(cellCount);
+	_cellLastUsedFrame.resize(cellCount);
+	_previous.resize(cellCount, NoCell);
+	_next.resize(cellCount, NoCell);
+	_cellGlyph.resize(cellCount);
+	for (uint32 cell = cellCount; cell-- > 0;)
+	{
+		_freeCells.push_back(cell);
+	}
+	_statistics.cellCount = cellCount;
+}
+
+GlyphCache::~GlyphCache()
+{
+}
+
+void GlyphCache::BeginFrame()
+{
+	++_frame;
+}
+
+GlyphCache::Glyph const* GlyphCache::Acquire(uint32 codepoint)
+{
+	auto found = _codepointToCell.find(codepoint);
+	if (found != _codepointToCell.end())
+	{
+		Touch(found->second);
+		return &_cellGlyph[found->second];
+	}
+	auto blank = _blankGlyphs.find(codepoint);
+	if (blank != _blankGlyphs.end())
+	{
+		return &blank->second;
+	}
+	if (_missing.count(codepoint))
+	{
+		return nullptr;
+	}
+
+	GlyphCacheStb::stbtt_fontinfo const* info = &_fontInfo->info;
+	int glyphIndex = GlyphCacheStb::stbtt_FindGlyphIndex(info, int(codepoint));
+	if (glyphIndex == 0)
+	{
+		_missing.insert(codepoint);
+		return nullptr;
+	}
+
+	int advance, leftSideBearing;
+	GlyphCacheStb::stbtt_GetGlyphHMetrics(info, glyphIndex, &advance, &leftSideBearing);
+	int x0, y0, x1, y1;
+	GlyphCacheStb::stbtt_GetGlyphBitmapBox(info, glyphIndex, _scale, _scale, &x0, &y0, &x1, &y1);
+
+	Glyph glyph;
+	glyph.advance = advance * _scale;
+	glyph.offsetX = float32(x0);
+	glyph.offsetY = float32(y0);
+	// Glyphs larger than a cell (rare, the cell is one pixel height wide) are clipped.
+	uint32 width = min(uint32(max(x1 - x0, 0)), _cellSize - 2);
+	uint32 height = min(uint32(max(y1 - y0, 0)), _cellSize - 2);
+	glyph.width = float32(width);
+	glyph.height = float32(height);
+
+	if (width == 0 || height == 0)
+	{
+		glyph.u0 = glyph.v0 = glyph.u1 = glyph.v1 = 0;
+		return &_blankGlyphs.emplace(codepoint, glyph).first->second;
+	}
+
+	uint32 cell = AllocateCell();
+	if (cell == NoCell)
+	{
+		++_statistics.rejected;
+		return nullptr;
+	}
+
+	uint32 cellX = (cell % _cellsPerRow) * _cellSize;
+	uint32 cellY = (cell / _cellsPerRow) * _cellSize;
+	for (uint32 row = 0; row < _cellSize; ++row)
+	{
+		memset(&_page[size_t(cellY + row) * _pageSize + cellX], 0, _cellSize);
+	}
+	GlyphCacheStb::stbtt_MakeGlyphBitmap(info, &_page[size_t(cellY + 1) * _pageSize + cellX + 1], int(width), int(height), int(_pageSize), _scale, _scale, glyphIndex);
+
+	float32 texel = 1.0f / _pageSize;
+	glyph.u0 = (cellX + 1) * texel;
+	glyph.v0 = (cellY + 1) * texel;
+	glyph.u1 = (cellX + 1 + width) * texel;
+	glyph.v1 = (cellY + 1 + height) * texel;
+
+	_cellGlyph[cell] = glyph;
+	_cellCodepoint[cell] = codepoint;
+	_codepointToCell.emplace(codepoint, cell);
+	LinkFront(cell);
+	_cellLastUsedFrame[cell] = _frame;
+	_dirtyCells.push_back(cell);
+	++_statistics.rasterized;
+	return &_cellGlyph[cell];
+}
+
+float32 GlyphCache::AppendText(char const* utf8, float32 x, float32 baseline, uint32 color, vector<GlyphVertex>& vertices)
+{
+	while (uint32 codepoint = NextCodepoint(utf8))
+	{
+		Glyph const* glyph = Acquire(codepoint);
+		if (glyph == nullptr)
+		{
+			continue;
+		}
+		if (glyph->width > 0)
+		{
+			float32 left = x + glyph->offsetX;
+			float32 top = baseline + glyph->offsetY;
+			float32 right = left + glyph->width;
+			float32 bottom = top + glyph->height;
+			vertices.push_back({ left, top, glyph->u0, glyph->v0, color });
+			vertices.push_back({ right, top, glyph->u1, glyph->v0, color });
+			vertices.push_back({ right, bottom, glyph->u1, glyph->v1, color });
+			vertices.push_back({ left, bottom, glyph->u0, glyph->v1, color });
+		}
+		x += glyph->advance;
+	}
+	return x;
+}
+
+void GlyphCache::Flush(GlyphAtlasUploader& uploader)
+{
+	sort(_dirtyCells.begin(), _dirtyCells.end());
+	_dirtyCells.erase(unique(_dirtyCells.begin(), _dirtyCells.end()), _dirtyCells.end());
+	for (uint32 cell : _dirtyCells)
+	{
+		uint32 cellX = (cell % _cellsPerRow) * _cellSize;
+		uint32 cellY = (cell / _cellsPerRow) * _cellSize;
+		uploader.UpdateRegion(cellX, cellY, _cellSize, _cellSize, &_page[size_t(cellY) * _pageSize + cellX], _pageSize);
+		_statistics.uploadedBytes += _cellSize * _cellSize;
+	}
+	_dirtyCells.clear();
+}
+
+GlyphCache::Statistics GlyphCache::GetStatistics() const
+{
+	Statistics statistics = _statistics;
+	statistics.residentGlyphs = uint32(_codepointToCell.size());
+	return statistics;
+}
+
+uint32 GlyphCache::AllocateCell()
+{
+	if (!_freeCells.empty())
+	{
+		uint32 cell = _freeCells.back();
+		_freeCells.pop_back();
+		return cell;
+	}
+
+	uint32 cell = _leastRecent;
+	if (cell == NoCell || _cellLastUsedFrame[cell] == _frame)
+	{
+		return NoCell;
+	}
+	_codepointToCell.erase(_cellCodepoint[cell]);
+	Unlink(cell);
+	++_statistics.evicted;
+	return cell;
+}
+
+void GlyphCache::Touch(uint32 cell)
+{
+	_cellLastUsedFrame[cell] = _frame;
+	if (cell != _mostRecent)
+	{
+		Unlink(cell);
+		LinkFront(cell);
+	}
+}
+
+void GlyphCache::Unlink(uint32 cell)
+{
+	uint32 previous = _previous[cell];
+	uint32 next = _next[cell];
+	if (previous != NoCell)
+	{
+		_next[previous] = next;
+	}
+	else
+	{
+		_mostRecent = next;
+	}
+	if (next != NoCell)
+	{
+		_previous[next] = previous;
+	}
+	else
+	{
+		_leastRecent = previous;
+	}
+	_previous[cell] = _next[cell] = NoCell;
+}
+
+void GlyphCache::LinkFront(uint32 cell)
+{
+	_previous[cell] = NoCell;
+	_next[cell] = _mostRecent;
+	if (_mostRecent != NoCell)
+	{
+		_previous[_mostRecent] = cell;
+	}
+	_mostRecent = cell;
+	if (_leastRecent == NoCell)
+	{
+		_leastRecent = cell;
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "BasicType.h"
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Receives the parts of the atlas page that changed. Coordinates are in texels, alpha has one byte per texel.
+	*/
+	class GlyphAtlasUploader
+	{
+	public:
+		virtual ~GlyphAtlasUploader() = default;
+		virtual void UpdateRegion(uint32 x, uint32 y, uint32 width, uint32 height, uint8 const* alpha, uint32 pitch) = 0;
+	};
+
+	/*
+	*	Same layout as ImDrawVert.
+	*/
+	struct GlyphVertex
+	{
+		float32 x, y;
+		float32 u, v;
+		uint32 color;
+	};
+
+	/*
+	*	Rasterizes glyphs the first time they are used into one 8 bit alpha atlas page.
+	*	The page is split into equal cells, when all cells are taken the least recently used glyph is evicted.
+	*	Only glyphs that are actually drawn are rasterized, so large glyph ranges like CJK cost nothing until used.
+	*	Changed cells are uploaded one sub-rectangle each in Flush.
+	*/
+	class GlyphCache
+	{
+	public:
+		struct Glyph
+		{
+			float32 u0, v0, u1, v1;
+			float32 offsetX, offsetY;	// from the pen position on the baseline to the top left of the quad
+			float32 width, height;
+			float32 advance;
+		};
+
+		struct Statistics
+		{
+			uint32 residentGlyphs;
+			uint32 cellCount;
+			uint64 rasterized;
+			uint64 evicted;
+			uint64 rejected;		// misses while every cell was in use by the current frame
+			uint64 uploadedBytes;
+		};
+
+		/*
+		*	@font: a TrueType file, kept alive by the cache.
+		*	@pageSize: width and height of the atlas page in texels.
+		*/
+		GlyphCache(std::vector<uint8> font, float32 pixelHeight, uint32 pageSize);
+		~GlyphCache();
+
+		/*
+		*	Glyphs acquired since the last BeginFrame are never evicted, quads built this frame stay valid.
+		*/
+		void BeginFrame();
+
+		/*
+		*	@return: nullptr if the font has no such glyph or the atlas is full with glyphs of this frame.
+		*/
+		Glyph const* Acquire(uint32 codepoint);
+
+		/*
+		*	Appends 4 vertices per visible glyph of the UTF-8 text, pen starts at (x, baseline).
+		*	Quads use the same corner order as ParticleSystem, so ParticleSystem::BuildQuadIndices fits them.
+		*	@return: pen position after the text.
+		*/
+		float32 AppendText(char const* utf8, float32 x, float32 baseline, uint32 color, std::vector<GlyphVertex>& vertices);
+
+		void Flush(GlyphAtlasUploader& uploader);
+
+		uint32 GetPageSize() const
+		{
+			return _pageSize;
+		}
+		float32 GetLineHeight() const
+		{
+			return _lineHeight;
+		}
+		Statistics GetStatistics() const;
+
+	private:
+		struct FontInfo;
+
+		uint32 AllocateCell();
+		void Touch(uint32 cell);
+		void Unlink(uint32 cell);
+		void LinkFront(uint32 cell);
+
+		enum : uint32
+		{
+			NoCell = ~0u
+		};
+
+		std::vector<uint8> _font;
+		std::unique_ptr<FontInfo> _fontInfo;
+		float32 _pixelHeight;
+		float32 _scale;
+		float32 _ascent;
+		float32 _lineHeight;
+		uint32 _pageSize;
+		uint32 _cellSize;
+		uint32 _cellsPerRow;
+
+		// CPU copy of the page, uploads read from it.
+		std::vector<uint8> _page;
+
+		// Per cell, the LRU list runs from _mostRecent to _leastRecent.
+		std::vector<uint32> _cellCodepoint;
+		std::vector<uint32> _cellLastUsedFrame;
+		std::vector<uint32> _previous;
+		std::vector<uint32> _next;
+		std::vector<Glyph> _cellGlyph;
+		uint32 _mostRecent;
+		uint32 _leastRecent;
+		std::vector<uint32> _freeCells;
+
+		std::unordered_map<uint32, uint32> _codepointToCell;
+		// Glyphs without pixels (spaces) need no cell.
+		std::unordered_map<uint32, Glyph> _blankGlyphs;
+		// Codepoints the font has no glyph for, remembered so they are not looked up again.
+		std::unordered_set<uint32> _missing;
+		std::vector<uint32> _dirtyCells;
+
+		uint32 _frame;
+		Statistics _statistics;
+	};
+}
@@ -0,0 +1,16 @@
+
+struct PS_INPUT
+{
+    float4 pos : SV_POSITION;
+    float4 col : COLOR0;
+    float2 uv : TEXCOORD0;
+};
+sampler sampler0;
+Texture2D texture0;
+
+// The glyph atlas only has coverage in the red channel.
+float4 main(PS_INPUT input) : SV_Target
+{
+    float coverage = texture0.Sample(sampler0, input.uv).r;
+    return float4(input.col.rgb, input.col.a * coverage);
+}
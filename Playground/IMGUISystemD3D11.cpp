@@ -23,7 +23,11 @@
 #include "IMGUIVertexShader.hlsl.Release.pcsh"
 #include "IMGUIPixelShader.hlsl.Release.pcsh"
 #endif
+#include "CommandBuffer.h"
+#include "D3D11CommandBackend.h"
 #include "D3DHelper.h"
+#include "StateObjectCache.h"
+#include "VectorMath.h"
 
 using namespace X;
 
@@ -83,23 +87,17 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 	HWND                     g_hWnd = 0;
 	ID3D11Device*            g_pd3dDevice = NULL;
 	ID3D11DeviceContext*     g_pd3dDeviceContext = NULL;
-	ID3D11Buffer*            g_pVB = NULL;
-	ID3D11Buffer*            g_pIB = NULL;
 	ID3D11VertexShader*      g_pVertexShader = NULL;
 	ID3D11InputLayout*       g_pInputLayout = NULL;
-	ID3D11Buffer*            g_pVertexConstantBuffer = NULL;
 	ID3D11PixelShader*       g_pPixelShader = NULL;
 	ID3D11SamplerState*      g_pFontSampler = NULL;
 	ID3D11ShaderResourceView*g_pFontTextureView = NULL;
 	ID3D11RasterizerState*   g_pRasterizerState = NULL;
 	ID3D11BlendState*        g_pBlendState = NULL;
 	ID3D11DepthStencilState* g_pDepthStencilState = NULL;
-	int                      g_VertexBufferSize = 5000, g_IndexBufferSize = 10000;
-
-	struct VERTEX_CONSTANT_BUFFER
-	{
-		float        mvp[4][4];
-	};
+	Ptr<StateObjectCache>    g_pStateObjectCache;
+	CommandBuffer            g_Commands;
+	Ptr<CommandBackend>      g_pCommandBackend;
 
 
 	virtual void ImGui_ImplDX11_Render() override
@@ -109,81 +107,59 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 		ImGui_ImplDX11_RenderDrawLists(drawData);
 	}
 
-	// This is the main rendering function that you have to implement and provide to ImGui (via setting up 'RenderDrawListsFn' in the ImGuiIO structure)
-	// If text or lines are blurry when integrating ImGui in your engine:
-	// - in your Render function, try translating your projection matrix by (0.5f,0.5f) or (0.375f,0.375f)
-	void ImGui_ImplDX11_RenderDrawLists(ImDrawData* draw_data)
+	static void CallDrawCallback(void const* list, void const* command)
 	{
-		ID3D11DeviceContext* ctx = g_pd3dDeviceContext;
+		const ImDrawCmd* pcmd = static_cast<const ImDrawCmd*>(command);
+		pcmd->UserCallback(static_cast<const ImDrawList*>(list), pcmd);
+	}
 
-		// Create and grow vertex/index buffers if needed
-		if (!g_pVB || g_VertexBufferSize < draw_data->TotalVtxCount)
-		{
-			if (g_pVB) { g_pVB->Release(); g_pVB = NULL; }
-			g_VertexBufferSize = draw_data->TotalVtxCount + 5000;
-			D3D11_BUFFER_DESC desc;
-			memset(&desc, 0, sizeof(D3D11_BUFFER_DESC));
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.ByteWidth = g_VertexBufferSize * sizeof(ImDrawVert);
-			desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			desc.MiscFlags = 0;
-			if (g_pd3dDevice->CreateBuffer(&desc, NULL, &g_pVB) < 0)
-				return;
-		}
-		if (!g_pIB || g_IndexBufferSize < draw_data->TotalIdxCount)
-		{
-			if (g_pIB) { g_pIB->Release(); g_pIB = NULL; }
-			g_IndexBufferSize = draw_data->TotalIdxCount + 10000;
-			D3D11_BUFFER_DESC desc;
-			memset(&desc, 0, sizeof(D3D11_BUFFER_DESC));
-			desc.Usage = D3D11_USAGE_DYNAMIC;
-			desc.ByteWidth = g_IndexBufferSize * sizeof(ImDrawIdx);
-			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-			if (g_pd3dDevice->CreateBuffer(&desc, NULL, &g_pIB) < 0)
-				return;
-		}
+	// Turns the draw data into backend neutral commands, does not touch the device.
+	static void RecordDrawLists(ImDrawData* draw_data, CommandBuffer& commands)
+	{
+		ImGuiIO& io = ImGui::GetIO();
+		commands.SetViewport(0.0f, 0.0f, io.DisplaySize.x, io.DisplaySize.y);
+
+		// Orthographic projection of the display, in pixels with y down.
+		Mat4 projection = Mat4::OrthographicOffCenter(0.0f, io.DisplaySize.x, io.DisplaySize.y, 0.0f, -1.0f, 1.0f);
+		commands.SetProjection(projection.m);
 
-		// Copy and convert all vertices into a single contiguous buffer
-		D3D11_MAPPED_SUBRESOURCE vtx_resource, idx_resource;
-		if (ctx->Map(g_pVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &vtx_resource) != S_OK)
-			return;
-		if (ctx->Map(g_pIB, 0, D3D11_MAP_WRITE_DISCARD, 0, &idx_resource) != S_OK)
-			return;
-		ImDrawVert* vtx_dst = (ImDrawVert*)vtx_resource.pData;
-		ImDrawIdx* idx_dst = (ImDrawIdx*)idx_resource.pData;
 		for (int n = 0; n < draw_data->CmdListsCount; n++)
 		{
 			const ImDrawList* cmd_list = draw_data->CmdLists[n];
-			memcpy(vtx_dst, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-			memcpy(idx_dst, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-			vtx_dst += cmd_list->VtxBuffer.Size;
-			idx_dst += cmd_list->IdxBuffer.Size;
-		}
-		ctx->Unmap(g_pVB, 0);
-		ctx->Unmap(g_pIB, 0);
-
-		// Setup orthographic projection matrix into our constant buffer
-		{
-			D3D11_MAPPED_SUBRESOURCE mapped_resource;
-			if (ctx->Map(g_pVertexConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped_resource) != S_OK)
-				return;
-			VERTEX_CONSTANT_BUFFER* constant_buffer = (VERTEX_CONSTANT_BUFFER*)mapped_resource.pData;
-			float L = 0.0f;
-			float R = ImGui::GetIO().DisplaySize.x;
-			float B = ImGui::GetIO().DisplaySize.y;
-			float T = 0.0f;
-			float mvp[4][4] =
+			commands.SetVertices(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size, sizeof(ImDrawVert));
+			const ImDrawIdx* idx = cmd_list->IdxBuffer.Data;
+			for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
 			{
-				{ 2.0f / (R - L),   0.0f,           0.0f,       0.0f },
-				{ 0.0f,         2.0f / (T - B),     0.0f,       0.0f },
-				{ 0.0f,         0.0f,           0.5f,       0.0f },
-				{ (R + L) / (L - R),  (T + B) / (B - T),    0.5f,       1.0f },
-			};
-			memcpy(&constant_buffer->mvp, mvp, sizeof(mvp));
-			ctx->Unmap(g_pVertexConstantBuffer, 0);
+				const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+				if (pcmd->UserCallback)
+				{
+					commands.Callback(&CallDrawCallback, cmd_list, pcmd);
+				}
+				else
+				{
+					commands.SetTexture(pcmd->TextureId);
+					commands.SetScissor((sint32)pcmd->ClipRect.x, (sint32)pcmd->ClipRect.y, (sint32)pcmd->ClipRect.z, (sint32)pcmd->ClipRect.w);
+					commands.DrawIndexed(idx, pcmd->ElemCount, 0);
+				}
+				idx += pcmd->ElemCount;
+			}
 		}
+	}
+
+	// This is the main rendering function that you have to implement and provide to ImGui (via setting up 'RenderDrawListsFn' in the ImGuiIO structure)
+	// If text or lines are blurry when integrating ImGui in your engine:
+	// - in your Render function, try translating your projection matrix by (0.5f,0.5f) or (0.375f,0.375f)
+	void ImGui_ImplDX11_RenderDrawLists(ImDrawData* draw_data)
+	{
+		ID3D11DeviceContext* ctx = g_pd3dDeviceContext;
+		if (!g_pCommandBackend)
+			return;
+
+		// Record the draw lists, the backend uploads the vertices and indices and issues the draws.
+		// All of them go into one buffer on this thread. Execute takes several buffers, so the lists could be recorded
+		// on the job system, but only the CommandBuffer/Record benchmarks do that so far.
+		g_Commands.Reset();
+		RecordDrawLists(draw_data, g_Commands);
 
 		// Backup DX state that will be modified to restore it afterwards (unfortunately this is very ugly looking and verbose. Close your eyes!)
 		struct BACKUP_DX11_STATE
@@ -227,25 +203,10 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 		ctx->IAGetVertexBuffers(0, 1, &old.VertexBuffer, &old.VertexBufferStride, &old.VertexBufferOffset);
 		ctx->IAGetInputLayout(&old.InputLayout);
 
-		// Setup viewport
-		D3D11_VIEWPORT vp;
-		memset(&vp, 0, sizeof(D3D11_VIEWPORT));
-		vp.Width = ImGui::GetIO().DisplaySize.x;
-		vp.Height = ImGui::GetIO().DisplaySize.y;
-		vp.MinDepth = 0.0f;
-		vp.MaxDepth = 1.0f;
-		vp.TopLeftX = vp.TopLeftY = 0.0f;
-		ctx->RSSetViewports(1, &vp);
-
-		// Bind shader and vertex buffers
-		unsigned int stride = sizeof(ImDrawVert);
-		unsigned int offset = 0;
+		// Bind the pipeline, viewport, buffers and textures come from the commands
 		ctx->IASetInputLayout(g_pInputLayout);
-		ctx->IASetVertexBuffers(0, 1, &g_pVB, &stride, &offset);
-		ctx->IASetIndexBuffer(g_pIB, sizeof(ImDrawIdx) == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
 		ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		ctx->VSSetShader(g_pVertexShader, NULL, 0);
-		ctx->VSSetConstantBuffers(0, 1, &g_pVertexConstantBuffer);
 		ctx->PSSetShader(g_pPixelShader, NULL, 0);
 		ctx->PSSetSamplers(0, 1, &g_pFontSampler);
 
@@ -255,30 +216,8 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 		ctx->OMSetDepthStencilState(g_pDepthStencilState, 0);
 		ctx->RSSetState(g_pRasterizerState);
 
-		// Render command lists
-		int vtx_offset = 0;
-		int idx_offset = 0;
-		for (int n = 0; n < draw_data->CmdListsCount; n++)
-		{
-			const ImDrawList* cmd_list = draw_data->CmdLists[n];
-			for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
-			{
-				const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
-				if (pcmd->UserCallback)
-				{
-					pcmd->UserCallback(cmd_list, pcmd);
-				}
-				else
-				{
-					const D3D11_RECT r = { (LONG)pcmd->ClipRect.x, (LONG)pcmd->ClipRect.y, (LONG)pcmd->ClipRect.z, (LONG)pcmd->ClipRect.w };
-					ctx->PSSetShaderResources(0, 1, (ID3D11ShaderResourceView**)&pcmd->TextureId);
-					ctx->RSSetScissorRects(1, &r);
-					ctx->DrawIndexed(pcmd->ElemCount, idx_offset, vtx_offset);
-				}
-				idx_offset += pcmd->ElemCount;
-			}
-			vtx_offset += cmd_list->VtxBuffer.Size;
-		}
+		CommandBuffer const* buffers[] = { &g_Commands };
+		g_pCommandBackend->Execute(buffers, 1);
 
 		// Restore modified DX state
 		ctx->RSSetScissorRects(old.ScissorRectsCount, old.ScissorRects);
@@ -354,7 +293,7 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 			desc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 			desc.MinLOD = 0.f;
 			desc.MaxLOD = 0.f;
-			g_pd3dDevice->CreateSamplerState(&desc, &g_pFontSampler);
+			g_pFontSampler = g_pStateObjectCache->GetSamplerState(desc).Detach();
 		}
 	}
 
@@ -386,19 +325,11 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 			};
 			if (g_pd3dDevice->CreateInputLayout(local_layout, 3, CompiledShaderCode_IMGUIVertexShader_main, ArraySize(CompiledShaderCode_IMGUIVertexShader_main), &g_pInputLayout) != S_OK)
 				return false;
-
-			// Create the constant buffer
-			{
-				D3D11_BUFFER_DESC desc;
-				desc.ByteWidth = sizeof(VERTEX_CONSTANT_BUFFER);
-				desc.Usage = D3D11_USAGE_DYNAMIC;
-				desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-				desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-				desc.MiscFlags = 0;
-				g_pd3dDevice->CreateBuffer(&desc, NULL, &g_pVertexConstantBuffer);
-			}
 		}
 
+		// Vertex, index and constant buffers belong to the command backend
+		g_pCommandBackend = CreatePtr<D3D11CommandBackend>(g_pd3dDevice, g_pd3dDeviceContext);
+
 		// Create the pixel shader
 		{
 			if (g_pd3dDevice->CreatePixelShader(CompiledShaderCode_IMGUIPixelShader_main, ArraySize(CompiledShaderCode_IMGUIPixelShader_main), NULL, &g_pPixelShader) != S_OK)
@@ -420,7 +351,7 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 			desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
 			desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
 			desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-			g_pd3dDevice->CreateBlendState(&desc, &g_pBlendState);
+			g_pBlendState = g_pStateObjectCache->GetBlendState(desc).Detach();
 		}
 
 		// Create the rasterizer state
@@ -431,7 +362,7 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 			desc.CullMode = D3D11_CULL_NONE;
 			desc.ScissorEnable = true;
 			desc.DepthClipEnable = true;
-			g_pd3dDevice->CreateRasterizerState(&desc, &g_pRasterizerState);
+			g_pRasterizerState = g_pStateObjectCache->GetRasterizerState(desc).Detach();
 		}
 
 		// Create depth-stencil State
@@ -445,7 +376,7 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 			desc.FrontFace.StencilFailOp = desc.FrontFace.StencilDepthFailOp = desc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_KEEP;
 			desc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
 			desc.BackFace = desc.FrontFace;
-			g_pd3dDevice->CreateDepthStencilState(&desc, &g_pDepthStencilState);
+			g_pDepthStencilState = g_pStateObjectCache->GetDepthStencilState(desc).Detach();
 		}
 
 		ImGui_ImplDX11_CreateFontsTexture();
@@ -460,23 +391,22 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 
 		if (g_pFontSampler) { g_pFontSampler->Release(); g_pFontSampler = NULL; }
 		if (g_pFontTextureView) { g_pFontTextureView->Release(); g_pFontTextureView = NULL; ImGui::GetIO().Fonts->TexID = NULL; } // We copied g_pFontTextureView to io.Fonts->TexID so let's clear that as well.
-		if (g_pIB) { g_pIB->Release(); g_pIB = NULL; }
-		if (g_pVB) { g_pVB->Release(); g_pVB = NULL; }
+		g_pCommandBackend = nullptr;
 
 		if (g_pBlendState) { g_pBlendState->Release(); g_pBlendState = NULL; }
 		if (g_pDepthStencilState) { g_pDepthStencilState->Release(); g_pDepthStencilState = NULL; }
 		if (g_pRasterizerState) { g_pRasterizerState->Release(); g_pRasterizerState = NULL; }
 		if (g_pPixelShader) { g_pPixelShader->Release(); g_pPixelShader = NULL; }
-		if (g_pVertexConstantBuffer) { g_pVertexConstantBuffer->Release(); g_pVertexConstantBuffer = NULL; }
 		if (g_pInputLayout) { g_pInputLayout->Release(); g_pInputLayout = NULL; }
 		if (g_pVertexShader) { g_pVertexShader->Release(); g_pVertexShader = NULL; }
 	}
 
-	virtual bool    ImGui_ImplDX11_Init(void* hwnd, ID3D11Device* device, ID3D11DeviceContext* device_context) override
+	virtual bool    ImGui_ImplDX11_Init(void* hwnd, ID3D11Device* device, ID3D11DeviceContext* device_context, Ptr<StateObjectCache> state_cache) override
 	{
 		g_hWnd = (HWND)hwnd;
 		g_pd3dDevice = device;
 		g_pd3dDeviceContext = device_context;
+		g_pStateObjectCache = state_cache;
 
 		if (!QueryPerformanceFrequency((LARGE_INTEGER *)&g_TicksPerSecond))
 			return false;
@@ -516,6 +446,7 @@ struct IMGUISystemD3D11Impl : public IMGUISystemD3D11
 		ImGui::Shutdown();
 		g_pd3dDevice = NULL;
 		g_pd3dDeviceContext = NULL;
+		g_pStateObjectCache = nullptr;
 		g_hWnd = (HWND)0;
 	}
 
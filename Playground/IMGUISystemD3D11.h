@@ -14,12 +14,15 @@ struct ImDrawData;
 
 namespace X
 {
+	class StateObjectCache;
+
 	class IMGUISystemD3D11 : public ReferenceCountBase<true>
 	{
 	public:
 		virtual ~IMGUISystemD3D11() = default;
 
-		virtual bool ImGui_ImplDX11_Init(void* hwnd, ID3D11Device* device, ID3D11DeviceContext* device_context) = 0;
+		// Blend, rasterizer, depth-stencil and sampler states are taken from state_cache, so recreating the device objects does not create them again.
+		virtual bool ImGui_ImplDX11_Init(void* hwnd, ID3D11Device* device, ID3D11DeviceContext* device_context, Ptr<StateObjectCache> state_cache) = 0;
 		virtual void ImGui_ImplDX11_Shutdown() = 0;
 		virtual void ImGui_ImplDX11_NewFrame() = 0;
 		virtual void ImGui_ImplDX11_Render() = 0;
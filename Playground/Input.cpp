@@ -0,0 +1,347 @@
+#include "Input.h"
+#include <array>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+// The virtual key codes are fixed by Windows, spelled out so tools and benchmarks translate recorded keys elsewhere.
+#define VK_LBUTTON              0x01
+#define VK_RBUTTON              0x02
+#define VK_CANCEL               0x03
+#define VK_MBUTTON              0x04
+#define VK_XBUTTON1             0x05
+#define VK_XBUTTON2             0x06
+#define VK_BACK                 0x08
+#define VK_TAB                  0x09
+#define VK_CLEAR                0x0C
+#define VK_RETURN               0x0D
+#define VK_SHIFT                0x10
+#define VK_CONTROL              0x11
+#define VK_MENU                 0x12
+#define VK_PAUSE                0x13
+#define VK_CAPITAL              0x14
+#define VK_KANA                 0x15
+#define VK_HANGEUL              0x15
+#define VK_HANGUL               0x15
+#define VK_JUNJA                0x17
+#define VK_FINAL                0x18
+#define VK_HANJA                0x19
+#define VK_KANJI                0x19
+#define VK_ESCAPE               0x1B
+#define VK_CONVERT              0x1C
+#define VK_NONCONVERT           0x1D
+#define VK_ACCEPT               0x1E
+#define VK_MODECHANGE           0x1F
+#define VK_SPACE                0x20
+#define VK_PRIOR                0x21
+#define VK_NEXT                 0x22
+#define VK_END                  0x23
+#define VK_HOME                 0x24
+#define VK_LEFT                 0x25
+#define VK_UP                   0x26
+#define VK_RIGHT                0x27
+#define VK_DOWN                 0x28
+#define VK_SELECT               0x29
+#define VK_PRINT                0x2A
+#define VK_EXECUTE              0x2B
+#define VK_SNAPSHOT             0x2C
+#define VK_INSERT               0x2D
+#define VK_DELETE               0x2E
+#define VK_HELP                 0x2F
+#define VK_LWIN                 0x5B
+#define VK_RWIN                 0x5C
+#define VK_APPS                 0x5D
+#define VK_SLEEP                0x5F
+#define VK_NUMPAD0              0x60
+#define VK_NUMPAD1              0x61
+#define VK_NUMPAD2              0x62
+#define VK_NUMPAD3              0x63
+#define VK_NUMPAD4              0x64
+#define VK_NUMPAD5              0x65
+#define VK_NUMPAD6              0x66
+#define VK_NUMPAD7              0x67
+#define VK_NUMPAD8              0x68
+#define VK_NUMPAD9              0x69
+#define VK_MULTIPLY             0x6A
+#define VK_ADD                  0x6B
+#define VK_SEPARATOR            0x6C
+#define VK_SUBTRACT             0x6D
+#define VK_DECIMAL              0x6E
+#define VK_DIVIDE               0x6F
+#define VK_F1                   0x70
+#define VK_F2                   0x71
+#define VK_F3                   0x72
+#define VK_F4                   0x73
+#define VK_F5                   0x74
+#define VK_F6                   0x75
+#define VK_F7                   0x76
+#define VK_F8                   0x77
+#define VK_F9                   0x78
+#define VK_F10                  0x79
+#define VK_F11                  0x7A
+#define VK_F12                  0x7B
+#define VK_F13                  0x7C
+#define VK_F14                  0x7D
+#define VK_F15                  0x7E
+#define VK_F16                  0x7F
+#define VK_F17                  0x80
+#define VK_F18                  0x81
+#define VK_F19                  0x82
+#define VK_F20                  0x83
+#define VK_F21                  0x84
+#define VK_F22                  0x85
+#define VK_F23                  0x86
+#define VK_F24                  0x87
+#define VK_NUMLOCK              0x90
+#define VK_SCROLL               0x91
+#define VK_OEM_NEC_EQUAL        0x92
+#define VK_LSHIFT               0xA0
+#define VK_RSHIFT               0xA1
+#define VK_LCONTROL             0xA2
+#define VK_RCONTROL             0xA3
+#define VK_LMENU                0xA4
+#define VK_RMENU                0xA5
+#define VK_BROWSER_BACK         0xA6
+#define VK_BROWSER_FORWARD      0xA7
+#define VK_BROWSER_REFRESH      0xA8
+#define VK_BROWSER_STOP         0xA9
+#define VK_BROWSER_SEARCH       0xAA
+#define VK_BROWSER_FAVORITES    0xAB
+#define VK_BROWSER_HOME         0xAC
+#define VK_VOLUME_MUTE          0xAD
+#define VK_VOLUME_DOWN          0xAE
+#define VK_VOLUME_UP            0xAF
+#define VK_MEDIA_NEXT_TRACK     0xB0
+#define VK_MEDIA_PREV_TRACK     0xB1
+#define VK_MEDIA_STOP           0xB2
+#define VK_MEDIA_PLAY_PAUSE     0xB3
+#define VK_LAUNCH_MAIL          0xB4
+#define VK_LAUNCH_MEDIA_SELECT  0xB5
+#define VK_LAUNCH_APP1          0xB6
+#define VK_LAUNCH_APP2          0xB7
+#define VK_OEM_1                0xBA
+#define VK_OEM_PLUS             0xBB
+#define VK_OEM_COMMA            0xBC
+#define VK_OEM_MINUS            0xBD
+#define VK_OEM_PERIOD           0xBE
+#define VK_OEM_2                0xBF
+#define VK_OEM_3                0xC0
+#define VK_OEM_4                0xDB
+#define VK_OEM_5                0xDC
+#define VK_OEM_6                0xDD
+#define VK_OEM_7                0xDE
+#define VK_OEM_8                0xDF
+#endif
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const WindowsVKCount = 256;
+}
+
+InputSemantic X::InputSemanticFromWindowsVK(uint32 winKey)
+{
+	// Filled once, a lookup per key after that.
+	static array<InputSemantic, WindowsVKCount> const mapping = []
+	{
+		array<InputSemantic, WindowsVKCount> mapping;
+		mapping.fill(InputSemantic::InputSemanticInvalid);
+
+		mapping[0] = InputSemantic::NullSemantic;
+
+		mapping[VK_LBUTTON] = InputSemantic::M_Button0;
+		mapping[VK_RBUTTON] = InputSemantic::M_Button1;
+		mapping[VK_CANCEL] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_MBUTTON] = InputSemantic::M_Button2;
+		mapping[VK_XBUTTON1] = InputSemantic::M_Button3;
+		mapping[VK_XBUTTON2] = InputSemantic::M_Button4;
+
+		mapping[VK_BACK] = InputSemantic::K_BackSpace;
+		mapping[VK_TAB] = InputSemantic::K_Tab;
+		mapping[VK_CLEAR] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_RETURN] = InputSemantic::K_Enter;
+
+		mapping[VK_SHIFT] = InputSemantic::Temp_Shift;
+		mapping[VK_CONTROL] = InputSemantic::Temp_Ctrl;
+		mapping[VK_MENU] = InputSemantic::Temp_Alt;
+		mapping[VK_PAUSE] = InputSemantic::K_Pause;
+		mapping[VK_CAPITAL] = InputSemantic::K_CapsLock;
+
+		mapping[VK_KANA] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_HANGEUL] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_HANGUL] = InputSemantic::InputSemanticInvalid;
+
+		mapping[VK_JUNJA] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_FINAL] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_HANJA] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_KANJI] = InputSemantic::InputSemanticInvalid;
+
+		mapping[VK_ESCAPE] = InputSemantic::K_Escape;
+		mapping[VK_CONVERT] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_NONCONVERT] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_ACCEPT] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_MODECHANGE] = InputSemantic::InputSemanticInvalid;
+
+		mapping[VK_SPACE] = InputSemantic::K_Space;
+		mapping[VK_PRIOR] = InputSemantic::K_PageUp;
+		mapping[VK_NEXT] = InputSemantic::K_PageDown;
+		mapping[VK_END] = InputSemantic::K_End;
+		mapping[VK_HOME] = InputSemantic::K_Home;
+		mapping[VK_LEFT] = InputSemantic::K_LeftArrow;
+		mapping[VK_UP] = InputSemantic::K_UpArrow;
+		mapping[VK_RIGHT] = InputSemantic::K_RightArrow;
+		mapping[VK_DOWN] = InputSemantic::K_DownArrow;
+		mapping[VK_SELECT] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_PRINT] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_EXECUTE] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_SNAPSHOT] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_INSERT] = InputSemantic::K_Insert;
+		mapping[VK_DELETE] = InputSemantic::K_Delete;
+		mapping[VK_HELP] = InputSemantic::InputSemanticInvalid;
+
+		mapping['0'] = InputSemantic::K_0;
+		mapping['1'] = InputSemantic::K_1;
+		mapping['2'] = InputSemantic::K_2;
+		mapping['3'] = InputSemantic::K_3;
+		mapping['4'] = InputSemantic::K_4;
+		mapping['5'] = InputSemantic::K_5;
+		mapping['6'] = InputSemantic::K_6;
+		mapping['7'] = InputSemantic::K_7;
+		mapping['8'] = InputSemantic::K_8;
+		mapping['9'] = InputSemantic::K_9;
+
+		mapping['A'] = InputSemantic::K_A;
+		mapping['B'] = InputSemantic::K_B;
+		mapping['C'] = InputSemantic::K_C;
+		mapping['D'] = InputSemantic::K_D;
+		mapping['E'] = InputSemantic::K_E;
+		mapping['F'] = InputSemantic::K_F;
+		mapping['G'] = InputSemantic::K_G;
+
+		mapping['H'] = InputSemantic::K_H;
+		mapping['I'] = InputSemantic::K_I;
+		mapping['J'] = InputSemantic::K_J;
+		mapping['K'] = InputSemantic::K_K;
+		mapping['L'] = InputSemantic::K_L;
+		mapping['M'] = InputSemantic::K_M;
+		mapping['N'] = InputSemantic::K_N;
+
+		mapping['O'] = InputSemantic::K_O;
+		mapping['P'] = InputSemantic::K_P;
+		mapping['Q'] = InputSemantic::K_Q;
+		mapping['R'] = InputSemantic::K_R;
+		mapping['S'] = InputSemantic::K_S;
+		mapping['T'] = InputSemantic::K_T;
+
+		mapping['U'] = InputSemantic::K_U;
+		mapping['V'] = InputSemantic::K_V;
+		mapping['W'] = InputSemantic::K_W;
+		mapping['X'] = InputSemantic::K_X;
+		mapping['Y'] = InputSemantic::K_Y;
+		mapping['Z'] = InputSemantic::K_Z;
+
+		mapping[VK_LWIN] = InputSemantic::K_LeftWin;
+		mapping[VK_RWIN] = InputSemantic::K_RightWin;
+		mapping[VK_APPS] = InputSemantic::K_Apps;
+
+		mapping[VK_SLEEP] = InputSemantic::K_Sleep;
+
+		mapping[VK_NUMPAD0] = InputSemantic::K_NumPad0;
+		mapping[VK_NUMPAD1] = InputSemantic::K_NumPad1;
+		mapping[VK_NUMPAD2] = InputSemantic::K_NumPad2;
+		mapping[VK_NUMPAD3] = InputSemantic::K_NumPad3;
+		mapping[VK_NUMPAD4] = InputSemantic::K_NumPad4;
+		mapping[VK_NUMPAD5] = InputSemantic::K_NumPad5;
+		mapping[VK_NUMPAD6] = InputSemantic::K_NumPad6;
+		mapping[VK_NUMPAD7] = InputSemantic::K_NumPad7;
+		mapping[VK_NUMPAD8] = InputSemantic::K_NumPad8;
+		mapping[VK_NUMPAD9] = InputSemantic::K_NumPad9;
+
+		mapping[VK_MULTIPLY] = InputSemantic::K_NumPadAsterisk;
+		mapping[VK_ADD] = InputSemantic::K_NumPadPlus;
+		mapping[VK_SEPARATOR] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_SUBTRACT] = InputSemantic::K_NumPadMinus;
+		mapping[VK_DECIMAL] = InputSemantic::K_NumPadPeriod;
+		mapping[VK_DIVIDE] = InputSemantic::K_NumPadSlash;
+
+		mapping[VK_F1] = InputSemantic::K_F1;
+		mapping[VK_F2] = InputSemantic::K_F2;
+		mapping[VK_F3] = InputSemantic::K_F3;
+		mapping[VK_F4] = InputSemantic::K_F4;
+		mapping[VK_F5] = InputSemantic::K_F5;
+		mapping[VK_F6] = InputSemantic::K_F6;
+		mapping[VK_F7] = InputSemantic::K_F7;
+		mapping[VK_F8] = InputSemantic::K_F8;
+		mapping[VK_F9] = InputSemantic::K_F9;
+		mapping[VK_F10] = InputSemantic::K_F10;
+		mapping[VK_F11] = InputSemantic::K_F11;
+		mapping[VK_F12] = InputSemantic::K_F12;
+		mapping[VK_F13] = InputSemantic::K_F13;
+		mapping[VK_F14] = InputSemantic::K_F14;
+		mapping[VK_F15] = InputSemantic::K_F15;
+		mapping[VK_F16] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F17] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F18] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F19] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F20] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F21] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F22] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F23] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_F24] = InputSemantic::InputSemanticInvalid;
+
+		mapping[VK_NUMLOCK] = InputSemantic::K_NumLock;
+		mapping[VK_SCROLL] = InputSemantic::K_ScrollLock;
+
+		mapping[VK_OEM_NEC_EQUAL] = InputSemantic::K_NumPadEquals;
+
+
+		mapping[VK_LSHIFT] = InputSemantic::K_LeftShift;
+		mapping[VK_RSHIFT] = InputSemantic::K_RightShift;
+		mapping[VK_LCONTROL] = InputSemantic::K_LeftCtrl;
+		mapping[VK_RCONTROL] = InputSemantic::K_RightCtrl;
+		mapping[VK_LMENU] = InputSemantic::K_LeftAlt;
+		mapping[VK_RMENU] = InputSemantic::K_RightAlt;
+
+		mapping[VK_BROWSER_BACK] = InputSemantic::K_WebBack;
+		mapping[VK_BROWSER_FORWARD] = InputSemantic::K_WebForward;
+		mapping[VK_BROWSER_REFRESH] = InputSemantic::K_WebRefresh;
+		mapping[VK_BROWSER_STOP] = InputSemantic::K_WebStop;
+		mapping[VK_BROWSER_SEARCH] = InputSemantic::K_WebSearch;
+		mapping[VK_BROWSER_FAVORITES] = InputSemantic::K_WebFavorites;
+		mapping[VK_BROWSER_HOME] = InputSemantic::K_WebHome;
+
+		mapping[VK_VOLUME_MUTE] = InputSemantic::K_Mute;
+		mapping[VK_VOLUME_DOWN] = InputSemantic::K_VolumeUp;
+		mapping[VK_VOLUME_UP] = InputSemantic::K_VolumeDown;
+		mapping[VK_MEDIA_NEXT_TRACK] = InputSemantic::K_NextTrack;
+		mapping[VK_MEDIA_PREV_TRACK] = InputSemantic::K_PrevTrack;
+		mapping[VK_MEDIA_STOP] = InputSemantic::K_MediaStop;
+		mapping[VK_MEDIA_PLAY_PAUSE] = InputSemantic::K_PlayPause;
+		mapping[VK_LAUNCH_MAIL] = InputSemantic::K_Mail;
+		mapping[VK_LAUNCH_MEDIA_SELECT] = InputSemantic::K_MediaSelect;
+		mapping[VK_LAUNCH_APP1] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_LAUNCH_APP2] = InputSemantic::InputSemanticInvalid;
+
+		mapping[VK_OEM_1] = InputSemantic::K_Semicolon;
+		mapping[VK_OEM_PLUS] = InputSemantic::InputSemanticInvalid;
+		mapping[VK_OEM_COMMA] = InputSemantic::K_Comma;
+		mapping[VK_OEM_MINUS] = InputSemantic::K_Minus;
+		mapping[VK_OEM_PERIOD] = InputSemantic::K_Period;
+		mapping[VK_OEM_2] = InputSemantic::K_Slash;
+		mapping[VK_OEM_3] = InputSemantic::K_Tilde;
+
+		mapping[VK_OEM_4] = InputSemantic::K_LeftBracket;
+		mapping[VK_OEM_5] = InputSemantic::K_BackSlash;
+		mapping[VK_OEM_6] = InputSemantic::K_RightBracket;
+		mapping[VK_OEM_7] = InputSemantic::K_Quote;
+		mapping[VK_OEM_8] = InputSemantic::InputSemanticInvalid;
+
+		return mapping;
+	} ();
+
+	return winKey < WindowsVKCount ? mapping[winKey] : InputSemantic::InputSemanticInvalid;
+}
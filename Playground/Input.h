@@ -1,5 +1,6 @@
 #pragma once
 #include "BasicType.h"
+#include "ReferenceCount.h"
 
 namespace X
 {
@@ -179,8 +180,7 @@ namespace X
 	class InputHandler : public ReferenceCountBase<true>
 	{
 	public:
-		virtual ~InputHandler() = 0
-		{}
+		virtual ~InputHandler() = 0;
 
 		virtual void OnKeyDown(InputSemantic key) = 0;
 
@@ -194,4 +194,15 @@ namespace X
 
 		virtual void OnMouseMove(InputSemantic key, uint32 x, uint32 y) = 0;
 	};
+
+	inline InputHandler::~InputHandler()
+	{
+	}
+
+	/*
+	*	VK_SHIFT, VK_CONTROL and VK_MENU come back as Temp_Shift, Temp_Ctrl and Temp_Alt, the window tells the sides
+	*	apart from the message first.
+	*	@return: InputSemanticInvalid for keys without a semantic.
+	*/
+	InputSemantic InputSemanticFromWindowsVK(uint32 winKey);
 }
@@ -0,0 +1,244 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "WorkStealingDeque.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	struct Job
+	{
+		function<void()> work;
+		JobCounter* counter;
+	};
+}
+
+/*
+*	Every worker owns a deque, jobs started on a worker go to its own deque and are taken newest first, which keeps
+*	nested work hot in the cache. Idle workers steal the oldest jobs of the others. Jobs started on other threads, the
+*	main thread mostly, go through a shared queue.
+*/
+struct JobSystemImpl : public JobSystem
+{
+	JobSystemImpl(uint32 workerCount) :
+		deques_(workerCount)
+	{
+		for (uint32 i = 0; i < workerCount; ++i)
+		{
+			workers_.emplace_back([this, i] { WorkerLoop(i); });
+		}
+	}
+
+	~JobSystemImpl()
+	{
+		{
+			lock_guard<mutex> lock(sleepMutex_);
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		for (auto& worker : workers_)
+		{
+			worker.join();
+		}
+	}
+
+	virtual void Run(function<void()> work, JobCounter* counter) override
+	{
+		if (counter)
+		{
+			counter->Add(1);
+		}
+		Job* job = new Job{ move(work), counter };
+		uint32 worker = GetCurrentWorker();
+		if (worker != NotAWorker)
+		{
+			deques_[worker].Push(job);
+		}
+		else
+		{
+			lock_guard<mutex> lock(sharedMutex_);
+			shared_.push_back(job);
+		}
+		queued_.fetch_add(1, memory_order_seq_cst);
+		if (sleeping_.load(memory_order_seq_cst) > 0)
+		{
+			lock_guard<mutex> lock(sleepMutex_);
+			wake_.notify_one();
+		}
+	}
+
+	virtual void Wait(JobCounter& counter) override
+	{
+		// The waiting thread helps instead of blocking, this is also what keeps nested waits on workers from deadlocking.
+		uint32 worker = GetCurrentWorker();
+		uint32 victim = worker == NotAWorker ? 0 : worker;
+		while (!counter.IsDone())
+		{
+			Job* job = FindJob(worker, victim);
+			if (job)
+			{
+				Execute(job);
+			}
+			else
+			{
+				this_thread::yield();
+			}
+		}
+	}
+
+	virtual uint32 GetWorkerCount() const override
+	{
+		return uint32(workers_.size());
+	}
+
+	enum : uint32 { NotAWorker = ~0u };
+
+	uint32 GetCurrentWorker() const
+	{
+		return currentSystem == this ? currentWorker : NotAWorker;
+	}
+
+	Job* FindJob(uint32 worker, uint32& victim)
+	{
+		Job* job = worker != NotAWorker ? deques_[worker].Take() : nullptr;
+		if (!job)
+		{
+			lock_guard<mutex> lock(sharedMutex_);
+			if (!shared_.empty())
+			{
+				job = shared_.front();
+				shared_.pop_front();
+			}
+		}
+		// Round robin over the other workers, starting after the last one that had something.
+		for (uint32 i = 0; !job && i < deques_.size(); ++i)
+		{
+			victim = (victim + 1) % uint32(deques_.size());
+			if (victim != worker)
+			{
+				job = deques_[victim].Steal();
+			}
+		}
+		if (job)
+		{
+			queued_.fetch_sub(1, memory_order_relaxed);
+		}
+		return job;
+	}
+
+	void Execute(Job* job)
+	{
+		{
+			SRPG_PROFILE_ZONE("Job");
+			job->work();
+		}
+		if (job->counter)
+		{
+			job->counter->Done();
+		}
+		delete job;
+	}
+
+	void WorkerLoop(uint32 worker)
+	{
+		currentSystem = this;
+		currentWorker = worker;
+		SRPG_PROFILE_THREAD(("Worker " + to_string(worker)).c_str());
+		uint32 victim = worker;
+		uint32 idleSpins = 0;
+		while (true)
+		{
+			Job* job = FindJob(worker, victim);
+			if (job)
+			{
+				Execute(job);
+				idleSpins = 0;
+				continue;
+			}
+			// A steal can fail on contention while jobs are left, spin a little before sleeping.
+			if (++idleSpins < 64)
+			{
+				this_thread::yield();
+				continue;
+			}
+			idleSpins = 0;
+
+			unique_lock<mutex> lock(sleepMutex_);
+			sleeping_.fetch_add(1, memory_order_seq_cst);
+			wake_.wait(lock, [this] { return stopping_ || queued_.load(memory_order_seq_cst) > 0; });
+			sleeping_.fetch_sub(1, memory_order_relaxed);
+			// Jobs queued before the destructor still run.
+			if (stopping_ && queued_.load(memory_order_seq_cst) == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	static thread_local JobSystemImpl* currentSystem;
+	static thread_local uint32 currentWorker;
+
+	vector<WorkStealingDeque<Job>> deques_;
+	vector<thread> workers_;
+
+	mutex sharedMutex_;
+	deque<Job*> shared_;
+
+	// Jobs pushed and not yet picked up by anyone, workers sleep while it is 0.
+	atomic<sint64> queued_{ 0 };
+	atomic<uint32> sleeping_{ 0 };
+	mutex sleepMutex_;
+	condition_variable wake_;
+	bool stopping_ = false;
+};
+
+thread_local JobSystemImpl* JobSystemImpl::currentSystem = nullptr;
+thread_local uint32 JobSystemImpl::currentWorker = JobSystemImpl::NotAWorker;
+
+
+Ptr<JobSystem> JobSystem::Create(uint32 workerCount)
+{
+	if (workerCount == 0)
+	{
+		uint32 hardwareThreads = thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	return CreatePtr<JobSystemImpl>(workerCount);
+}
+
+void JobSystem::ParallelFor(uint32 count, uint32 grainSize, function<void(uint32 begin, uint32 end)> const& body)
+{
+	if (grainSize == 0)
+	{
+		// A few ranges per thread, so threads that finish early can steal from the slow ones.
+		grainSize = count / ((GetWorkerCount() + 1) * 4);
+	}
+	grainSize = max(grainSize, 1u);
+	if (count <= grainSize)
+	{
+		if (count > 0)
+		{
+			body(0, count);
+		}
+		return;
+	}
+
+	JobCounter counter;
+	// The calling thread takes the first range itself instead of waiting idle.
+	uint32 end = grainSize;
+	for (uint32 begin = grainSize; begin < count; begin = end)
+	{
+		// Not begin + grainSize, which wraps for counts near the end of the range.
+		end = count - begin > grainSize ? begin + grainSize : count;
+		Run([&body, begin, end] { body(begin, end); }, &counter);
+	}
+	body(0, grainSize);
+	Wait(counter);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include <atomic>
+#include <functional>
+
+namespace X
+{
+	/*
+	*	Counts the unfinished jobs that were started with it. Pass it to JobSystem::Wait to block until they are all done.
+	*/
+	class JobCounter
+	{
+	public:
+		JobCounter() = default;
+		JobCounter(JobCounter const&) = delete;
+		JobCounter& operator=(JobCounter const&) = delete;
+
+		bool IsDone() const
+		{
+			return _pending.load(std::memory_order_acquire) == 0;
+		}
+
+		void Add(uint32 count)
+		{
+			_pending.fetch_add(count, std::memory_order_relaxed);
+		}
+		void Done()
+		{
+			_pending.fetch_sub(1, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<uint32> _pending{ 0 };
+	};
+
+	class JobSystem : public ReferenceCountBase<true>
+	{
+	public:
+		/*
+		*	@workerCount: number of worker threads, 0 means one less than the hardware threads so the calling thread keeps a core.
+		*/
+		static Ptr<JobSystem> Create(uint32 workerCount = 0);
+
+		virtual ~JobSystem() = default;
+
+		/*
+		*	@counter: may be nullptr for fire and forget jobs.
+		*/
+		virtual void Run(std::function<void()> job, JobCounter* counter) = 0;
+
+		/*
+		*	Executes pending jobs on the calling thread until counter is done, so waiting inside a job does not deadlock.
+		*/
+		virtual void Wait(JobCounter& counter) = 0;
+
+		virtual uint32 GetWorkerCount() const = 0;
+
+		/*
+		*	Splits [0, count) into ranges of grainSize and runs body on them in parallel, returns when all ranges are done.
+		*	@grainSize: 0 picks a size that gives every thread a few ranges to balance with.
+		*/
+		void ParallelFor(uint32 count, uint32 grainSize, std::function<void(uint32 begin, uint32 end)> const& body);
+	};
+}
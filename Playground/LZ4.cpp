@@ -0,0 +1,233 @@
+#include "LZ4.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const MinMatch = 4;
+	// The last 5 bytes are always literals and the last match starts at least 12 bytes before the end.
+	size_t const LastLiterals = 5;
+	size_t const MatchFindLimit = 12;
+	uint32 const MaxDistance = 65535;
+	uint32 const HashBits = 12;
+
+	uint32 Read32(uint8 const* p)
+	{
+		uint32 value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32 Hash(uint32 sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Writes the 255-continued part of a literal or match length.
+	bool WriteLength(size_t length, uint8*& out, uint8* end)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			if (out == end)
+			{
+				return false;
+			}
+			*out++ = 255;
+		}
+		if (out == end)
+		{
+			return false;
+		}
+		*out++ = uint8(length);
+		return true;
+	}
+
+	bool WriteSequence(uint8 const* literals, size_t literalLength, uint32 offset, size_t matchLength, uint8*& out, uint8* end)
+	{
+		if (out == end)
+		{
+			return false;
+		}
+		uint8* token = out++;
+		*token = uint8(min<size_t>(literalLength, 15) << 4);
+		if (literalLength >= 15 && !WriteLength(literalLength - 15, out, end))
+		{
+			return false;
+		}
+		if (size_t(end - out) < literalLength)
+		{
+			return false;
+		}
+		if (literalLength > 0)
+		{
+			memcpy(out, literals, literalLength);
+			out += literalLength;
+		}
+		if (offset == 0)
+		{
+			// Last sequence, literals only.
+			return true;
+		}
+
+		if (end - out < 2)
+		{
+			return false;
+		}
+		*out++ = uint8(offset);
+		*out++ = uint8(offset >> 8);
+		matchLength -= MinMatch;
+		*token |= uint8(min<size_t>(matchLength, 15));
+		return matchLength < 15 || WriteLength(matchLength - 15, out, end);
+	}
+
+	bool ReadLength(uint8 const*& in, uint8 const* end, size_t& length)
+	{
+		uint8 byte;
+		do
+		{
+			if (in == end)
+			{
+				return false;
+			}
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+}
+
+size_t X::LZ4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t X::LZ4Compress(uint8 const* source, size_t size, uint8* destination, size_t capacity)
+{
+	uint8* out = destination;
+	uint8* end = destination + capacity;
+	size_t anchor = 0;
+
+	if (size > MatchFindLimit)
+	{
+		// Positions are stored as uint32, blocks are far below 4 GB.
+		uint32 table[1 << HashBits] = {};
+		size_t matchLimit = size - LastLiterals;
+		size_t position = 0;
+		while (position + MatchFindLimit <= size)
+		{
+			uint32 sequence = Read32(source + position);
+			uint32 hash = Hash(sequence);
+			size_t candidate = table[hash];
+			table[hash] = uint32(position);
+			if (candidate >= position || position - candidate > MaxDistance || Read32(source + candidate) != sequence)
+			{
+				// Skip faster through data that does not compress.
+				position += 1 + ((position - anchor) >> 6);
+				continue;
+			}
+
+			while (position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1])
+			{
+				--position;
+				--candidate;
+			}
+			size_t length = MinMatch;
+			while (position + length < matchLimit && source[position + length] == source[candidate + length])
+			{
+				++length;
+			}
+			if (!WriteSequence(source + anchor, position - anchor, uint32(position - candidate), length, out, end))
+			{
+				return 0;
+			}
+			position += length;
+			anchor = position;
+			if (position + MatchFindLimit <= size)
+			{
+				table[Hash(Read32(source + position - 2))] = uint32(position - 2);
+			}
+		}
+	}
+
+	if (!WriteSequence(source + anchor, size - anchor, 0, 0, out, end))
+	{
+		return 0;
+	}
+	return size_t(out - destination);
+}
+
+bool X::LZ4Decompress(uint8 const* source, size_t size, uint8* destination, size_t destinationSize)
+{
+	uint8 const* in = source;
+	uint8 const* inEnd = source + size;
+	uint8* out = destination;
+	uint8* outEnd = destination + destinationSize;
+
+	for (;;)
+	{
+		if (in == inEnd)
+		{
+			return false;
+		}
+		uint8 token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, inEnd, literalLength))
+		{
+			return false;
+		}
+		if (literalLength > size_t(inEnd - in) || literalLength > size_t(outEnd - out))
+		{
+			return false;
+		}
+		if (literalLength > 0)
+		{
+			memcpy(out, in, literalLength);
+			in += literalLength;
+			out += literalLength;
+		}
+		if (in == inEnd)
+		{
+			return out == outEnd;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > size_t(out - destination))
+		{
+			return false;
+		}
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += MinMatch;
+		if (matchLength > size_t(outEnd - out))
+		{
+			return false;
+		}
+
+		uint8 const* match = out - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			// Overlapping match repeats the last offset bytes.
+			for (size_t i = 0; i < matchLength; ++i)
+			{
+				*out++ = match[i];
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "BasicType.h"
+#include <cstddef>
+
+namespace X
+{
+	/*
+	*	LZ4 block format (no frame header), compatible with LZ4_compress_default / LZ4_decompress_safe.
+	*/
+
+	/*
+	*	@return: the worst case compressed size of size bytes.
+	*/
+	size_t LZ4CompressBound(size_t size);
+
+	/*
+	*	@return: compressed size, 0 if it does not fit into capacity.
+	*/
+	size_t LZ4Compress(uint8 const* source, size_t size, uint8* destination, size_t capacity);
+
+	/*
+	*	Never reads or writes outside of the given buffers, also for corrupt input.
+	*	@return: false unless the input is a valid block of exactly destinationSize bytes.
+	*/
+	bool LZ4Decompress(uint8 const* source, size_t size, uint8* destination, size_t destinationSize);
+}
@@ -0,0 +1,205 @@
+#include "Localization.h"
+#include "GameDataTables.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	/*
+	*	Shortens text[0, length) so it does not end inside a UTF-8 sequence, for text whose bytes after the cut are gone.
+	*/
+	size_t CutAtCharacter(char const* text, size_t length)
+	{
+		size_t lead = length;
+		while (lead > 0 && length - lead < 4)
+		{
+			--lead;
+			uint8 byte = uint8(text[lead]);
+			if ((byte & 0xC0) != 0x80)
+			{
+				size_t sequence = byte < 0x80 ? 1 : byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+				return lead + sequence > length ? lead : length;
+			}
+		}
+		return length;
+	}
+}
+
+TextScratch::TextScratch(uint32 capacity) :
+	_buffer(capacity > 0 ? capacity : 1)
+{
+}
+
+void TextScratch::Begin()
+{
+	_start = _used;
+	_truncated = false;
+}
+
+void TextScratch::Write(char const* text, size_t length)
+{
+	// One byte is always left for the terminator.
+	size_t space = _buffer.size() - 1 - _used;
+	if (length > space)
+	{
+		// Do not cut a UTF-8 sequence in half.
+		length = space;
+		while (length > 0 && (uint8(text[length]) & 0xC0) == 0x80)
+		{
+			--length;
+		}
+		_truncated = true;
+	}
+	memcpy(&_buffer[_used], text, length);
+	_used += uint32(length);
+}
+
+char const* TextScratch::End()
+{
+	if (_truncated)
+	{
+		++_overflowCount;
+	}
+	_buffer[_used] = 0;
+	char const* text = &_buffer[_start];
+	_used = _used + 1 < _buffer.size() ? _used + 1 : _used;
+	return text;
+}
+
+char const* TextScratch::Append(char const* text, size_t length)
+{
+	Begin();
+	Write(text, length);
+	return End();
+}
+
+char const* TextScratch::Print(char const* format, ...)
+{
+	Begin();
+	size_t space = _buffer.size() - _used;
+	va_list args;
+	va_start(args, format);
+	sint32 length = vsnprintf(&_buffer[_used], space, format, args);
+	va_end(args);
+	if (length < 0)
+	{
+		length = 0;
+	}
+	else if (size_t(length) >= space)
+	{
+		// The bytes after the cut are overwritten by the terminator, so look back for the last lead byte instead.
+		length = sint32(CutAtCharacter(&_buffer[_used], space - 1));
+		_truncated = true;
+	}
+	_used += uint32(length);
+	return End();
+}
+
+Ptr<Localization> Localization::Open(string const& path)
+{
+	Ptr<GameDataFile> file = GameDataFile::Open(path, sizeof(StringsRow), StringsRow::LayoutHash);
+	if (!file)
+	{
+		return nullptr;
+	}
+	return CreatePtr<Localization>(file);
+}
+
+Localization::Localization(Ptr<GameDataFile> file) :
+	_file(move(file)),
+	_current(nullptr),
+	_language(0)
+{
+	uint32 rowCount = _file->GetRowCount();
+	uint32 columnCount = sizeof(StringsRow) / sizeof(GameDataString);
+	GameDataString const* rows = static_cast<GameDataString const*>(_file->GetRows());
+
+	_languages.resize(columnCount - 1);
+	for (uint32 language = 0; language < _languages.size(); ++language)
+	{
+		vector<Text>& texts = _languages[language];
+		texts.resize(rowCount);
+		for (uint32 row = 0; row < rowCount; ++row)
+		{
+			char const* text = _file->GetString(rows[row * columnCount + 1 + language]);
+			// Untranslated strings fall back to the first language.
+			if (language > 0 && text[0] == 0)
+			{
+				texts[row] = _languages[0][row];
+				continue;
+			}
+			texts[row].text = text;
+			texts[row].length = uint32(strlen(texts[row].text));
+		}
+	}
+	SetLanguage(0);
+}
+
+void Localization::SetLanguage(uint32 language)
+{
+	if (language < _languages.size())
+	{
+		_language = language;
+		_current = _languages[language].data();
+	}
+}
+
+char const* Localization::Format(TextScratch& scratch, uint32 id, initializer_list<FormatArg> args) const
+{
+	Text const& format = _current[id];
+	char const* position = format.text;
+	char const* end = format.text + format.length;
+
+	scratch.Begin();
+	while (position != end)
+	{
+		char const* brace = static_cast<char const*>(memchr(position, '{', end - position));
+		if (!brace)
+		{
+			scratch.Write(position, end - position);
+			break;
+		}
+		scratch.Write(position, brace - position);
+		position = brace + 1;
+
+		if (position != end && *position == '{')
+		{
+			scratch.Write("{", 1);
+			++position;
+			continue;
+		}
+		if (end - position < 2 || position[0] < '0' || position[0] > '9' || position[1] != '}' || uint32(position[0] - '0') >= args.size())
+		{
+			// Not a placeholder, or a translation that uses more arguments than the code passes. Keep the text as it is.
+			scratch.Write(brace, 1);
+			continue;
+		}
+
+		FormatArg const& arg = args.begin()[position[0] - '0'];
+		position += 2;
+		char number[32];
+		sint32 length = 0;
+		switch (arg.type)
+		{
+		case FormatArg::Type::Int:
+			length = snprintf(number, sizeof(number), "%d", arg.i);
+			break;
+		case FormatArg::Type::UInt:
+			length = snprintf(number, sizeof(number), "%u", arg.u);
+			break;
+		case FormatArg::Type::Float:
+			length = snprintf(number, sizeof(number), "%.*f", sint32(arg.decimals), arg.f);
+			break;
+		case FormatArg::Type::Text:
+			scratch.Write(arg.text, strlen(arg.text));
+			continue;
+		}
+		scratch.Write(number, length > 0 ? min(size_t(length), sizeof(number) - 1) : 0);
+	}
+	return scratch.End();
+}
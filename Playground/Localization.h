@@ -0,0 +1,146 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "GameData.h"
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Per frame buffer for UI text. Reset it at the start of the frame, everything formatted into it stays valid until then.
+	*	The memory is allocated once, a frame that needs more gets truncated text and bumps the overflow count.
+	*/
+	class TextScratch
+	{
+	public:
+		explicit TextScratch(uint32 capacity = 64 * 1024);
+
+		void Reset()
+		{
+			_used = 0;
+		}
+
+		/*
+		*	Copies text and returns the NUL terminated copy.
+		*/
+		char const* Append(char const* text, size_t length);
+
+		/*
+		*	printf into the buffer.
+		*/
+		char const* Print(char const* format, ...);
+
+		uint32 GetUsed() const
+		{
+			return _used;
+		}
+		uint32 GetCapacity() const
+		{
+			return uint32(_buffer.size());
+		}
+		uint32 GetOverflowCount() const
+		{
+			return _overflowCount;
+		}
+
+	private:
+		friend class Localization;
+
+		// Building a string in place: Begin, any number of Write, End returns it.
+		void Begin();
+		void Write(char const* text, size_t length);
+		char const* End();
+
+		std::vector<char> _buffer;
+		uint32 _used = 0;
+		uint32 _start = 0;
+		bool _truncated = false;
+		uint32 _overflowCount = 0;
+	};
+
+	/*
+	*	An argument for Localization::Format, fills {0} to {9} in the localized text.
+	*/
+	struct FormatArg
+	{
+		enum class Type
+		{
+			Int,
+			UInt,
+			Float,
+			Text,
+		};
+
+		FormatArg(sint32 value) : type(Type::Int), i(value) {}
+		FormatArg(uint32 value) : type(Type::UInt), u(value) {}
+		FormatArg(float32 value, uint32 decimals = 1) : type(Type::Float), decimals(decimals), f(value) {}
+		FormatArg(char const* value) : type(Type::Text), text(value) {}
+
+		Type type;
+		uint32 decimals = 0;
+		union
+		{
+			sint32 i;
+			uint32 u;
+			float32 f;
+			char const* text;
+		};
+	};
+
+	/*
+	*	All UI strings of the game in UTF-8, compiled by DataCompiler from Data/Tables/strings.csv. Every column after the id
+	*	is a language in column order, strings are looked up with the GameDataID::Strings constants.
+	*
+	*	The texts of every language are resolved when the table is opened, so Get is an indexed load and SetLanguage only
+	*	swaps the pointer to the resolved texts.
+	*/
+	class Localization : public ReferenceCountBase<true>
+	{
+	public:
+		/*
+		*	@return: nullptr if the file is missing or does not match GameDataTables.h.
+		*/
+		static Ptr<Localization> Open(std::string const& path);
+
+		Localization(Ptr<GameDataFile> file);
+
+		uint32 GetLanguageCount() const
+		{
+			return uint32(_languages.size());
+		}
+		uint32 GetLanguage() const
+		{
+			return _language;
+		}
+		void SetLanguage(uint32 language);
+
+		char const* Get(uint32 id) const
+		{
+			return _current[id].text;
+		}
+		uint32 GetLength(uint32 id) const
+		{
+			return _current[id].length;
+		}
+
+		/*
+		*	Replaces {n} with the n-th argument, {{ gives a single {. Nothing is allocated.
+		*	@return: the formatted text in scratch.
+		*/
+		char const* Format(TextScratch& scratch, uint32 id, std::initializer_list<FormatArg> args) const;
+
+	private:
+		struct Text
+		{
+			char const* text;
+			uint32 length;
+		};
+
+		Ptr<GameDataFile> _file;
+		std::vector<std::vector<Text>> _languages;
+		Text const* _current;
+		uint32 _language;
+	};
+}
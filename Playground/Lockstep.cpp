@@ -0,0 +1,300 @@
+#include "Lockstep.h"
+#include "Varint.h"
+#include <algorithm>
+
+using namespace std;
+using namespace X;
+
+class SimulatedNetwork::Endpoint : public LockstepTransport
+{
+public:
+	Endpoint(SimulatedNetwork& network, uint32 index) :
+		_network(network),
+		_index(index)
+	{
+	}
+
+	void Send(vector<uint8> bytes) override
+	{
+		_network.Send(_index, move(bytes));
+	}
+
+	void Receive(vector<vector<uint8>>& packets) override
+	{
+		vector<vector<uint8>>& delivered = _network._delivered[_index];
+		move(delivered.begin(), delivered.end(), back_inserter(packets));
+		delivered.clear();
+	}
+
+private:
+	SimulatedNetwork& _network;
+	uint32 _index;
+};
+
+SimulatedNetwork::SimulatedNetwork(Settings const& settings) :
+	_settings(settings),
+	_random(settings.seed ? settings.seed : 0x9E3779B97F4A7C15ull)
+{
+	_endpoints[0].reset(new Endpoint(*this, 0));
+	_endpoints[1].reset(new Endpoint(*this, 1));
+}
+
+SimulatedNetwork::~SimulatedNetwork() = default;
+
+LockstepTransport& SimulatedNetwork::GetEndpoint(uint32 index)
+{
+	return *_endpoints[index & 1];
+}
+
+float64 SimulatedNetwork::NextRandom()
+{
+	_random ^= _random >> 12;
+	_random ^= _random << 25;
+	_random ^= _random >> 27;
+	return float64((_random * 2685821657736338717ull) >> 11) / float64(1ull << 53);
+}
+
+void SimulatedNetwork::Send(uint32 from, vector<uint8> bytes)
+{
+	_bytesSent[from] += bytes.size();
+	++_packetsSent[from];
+	if (NextRandom() < _settings.lossRate)
+	{
+		return;
+	}
+	_inFlight.push_back({ _nowMs + _settings.latencyMs + NextRandom() * _settings.jitterMs, from ^ 1, move(bytes) });
+}
+
+void SimulatedNetwork::Advance(float64 milliseconds)
+{
+	_nowMs += milliseconds;
+	// Delivered in the order they arrive, which jitter may make a different one than they were sent in.
+	stable_sort(_inFlight.begin(), _inFlight.end(), [](Packet const& a, Packet const& b) { return a.deliverMs < b.deliverMs; });
+	auto arrived = find_if(_inFlight.begin(), _inFlight.end(), [this](Packet const& packet) { return packet.deliverMs > _nowMs; });
+	for (auto packet = _inFlight.begin(); packet != arrived; ++packet)
+	{
+		_delivered[packet->to].push_back(move(packet->bytes));
+	}
+	_inFlight.erase(_inFlight.begin(), arrived);
+}
+
+uint64 SimulatedNetwork::GetBytesSent(uint32 endpoint) const
+{
+	return _bytesSent[endpoint & 1];
+}
+
+uint32 SimulatedNetwork::GetPacketsSent(uint32 endpoint) const
+{
+	return _packetsSent[endpoint & 1];
+}
+
+
+LockstepSession::LockstepSession(BattleSimulation& simulation, LockstepTransport& transport, uint8 player, uint32 inputDelay) :
+	_simulation(simulation),
+	_transport(transport),
+	_player(player),
+	_inputDelay(inputDelay),
+	// Both sides start with inputDelay ticks without commands, nothing to exchange for them.
+	_localFirst(inputDelay),
+	_localEnd(inputDelay),
+	_remoteAcknowledged(inputDelay),
+	_remoteEnd(inputDelay)
+{
+	_remote.resize(inputDelay);
+	_checksums[0] = _simulation.GetChecksum();
+}
+
+void LockstepSession::Queue(BattleCommand const& command)
+{
+	_queued.push_back(command);
+}
+
+uint32 LockstepSession::Update(uint32 maxTicks)
+{
+	// What was queued since the last update goes into the first tick not sent yet.
+	while (_localEnd <= _tick + _inputDelay)
+	{
+		_local.push_back(move(_queued));
+		_queued.clear();
+		++_localEnd;
+	}
+	SendInputs();
+
+	vector<vector<uint8>> packets;
+	_transport.Receive(packets);
+	for (vector<uint8> const& packet : packets)
+	{
+		ReadPacket(packet);
+	}
+
+	uint32 ran = 0;
+	while (ran < maxTicks && !IsDesynced() && _tick < _localEnd && _tick < _remoteEnd)
+	{
+		RunTick();
+		++ran;
+	}
+	if (ran == 0 && maxTicks > 0 && !IsDesynced())
+	{
+		++_statistics.stalls;
+	}
+
+	// Our commands are kept until both ran and the other side has them.
+	while (_localFirst < min(_tick, _remoteAcknowledged))
+	{
+		_local.pop_front();
+		++_localFirst;
+	}
+	return ran;
+}
+
+void LockstepSession::SendInputs()
+{
+	vector<uint8> bytes;
+	uint32 checksumTick = _tick - _tick % ChecksumInterval;
+	bool sendChecksum = checksumTick != _lastSentChecksumTick;
+	AppendVarint(bytes, (uint64(_remoteEnd) << 1) | (sendChecksum ? 1 : 0));
+	if (sendChecksum)
+	{
+		// Sent once, a lost one only skips a comparison.
+		AppendVarint(bytes, checksumTick);
+		AppendVarint(bytes, _checksums[checksumTick / ChecksumInterval % ChecksumHistory]);
+		_lastSentChecksumTick = checksumTick;
+	}
+
+	uint32 first = max(_localFirst, _remoteAcknowledged);
+	uint32 count = min<uint32>(_localEnd - first, uint32(MaxTicksPerPacket));
+	AppendVarint(bytes, first);
+	AppendVarint(bytes, count);
+	for (uint32 tick = first; tick < first + count; ++tick)
+	{
+		vector<BattleCommand> const& commands = _local[tick - _localFirst];
+		AppendVarint(bytes, commands.size());
+		for (BattleCommand const& command : commands)
+		{
+			AppendBattleCommand(bytes, command);
+		}
+	}
+
+	_statistics.bytesSent += bytes.size();
+	++_statistics.packetsSent;
+	_transport.Send(move(bytes));
+}
+
+void LockstepSession::ReadPacket(vector<uint8> const& bytes)
+{
+	uint8 const* position = bytes.data();
+	uint8 const* end = position + bytes.size();
+	uint64 header, checksumTick = 0, checksum = 0, first, count;
+	if (!ReadVarint(position, end, header))
+	{
+		return;
+	}
+	bool hasChecksum = (header & 1) != 0;
+	if (hasChecksum && (!ReadVarint(position, end, checksumTick) || !ReadVarint(position, end, checksum)))
+	{
+		return;
+	}
+	if (!ReadVarint(position, end, first) || !ReadVarint(position, end, count) || count > MaxTicksPerPacket)
+	{
+		return;
+	}
+
+	// Decoded completely before anything is kept, a damaged packet is dropped as a whole.
+	vector<vector<BattleCommand>> ticks;
+	ticks.resize(size_t(count));
+	for (vector<BattleCommand>& commands : ticks)
+	{
+		uint64 commandCount;
+		if (!ReadVarint(position, end, commandCount) || commandCount > uint64(end - position))
+		{
+			return;
+		}
+		commands.resize(size_t(commandCount));
+		for (BattleCommand& command : commands)
+		{
+			if (!ReadBattleCommand(position, end, command))
+			{
+				return;
+			}
+		}
+	}
+	if (position != end)
+	{
+		return;
+	}
+
+	_remoteAcknowledged = max(_remoteAcknowledged, uint32(min<uint64>(header >> 1, _localEnd)));
+	if (hasChecksum)
+	{
+		CompareChecksum(uint32(checksumTick), uint32(checksum));
+	}
+	// Packets repeat what was not acknowledged, so they overlap; only the part past what we have is new.
+	for (uint64 tick = max<uint64>(first, _remoteEnd); tick < first + count && first <= _remoteEnd; ++tick)
+	{
+		_remote.push_back(move(ticks[size_t(tick - first)]));
+		++_remoteEnd;
+	}
+}
+
+void LockstepSession::RunTick()
+{
+	// Player 0 first on both sides, so the order does not depend on who sent first.
+	static vector<BattleCommand> const none;
+	vector<BattleCommand> const& local = _tick < _localFirst ? none : _local[_tick - _localFirst];
+	vector<BattleCommand> const& remote = _remote.front();
+	for (uint8 player = 0; player < 2; ++player)
+	{
+		for (BattleCommand const& command : player == _player ? local : remote)
+		{
+			if (_simulation.GetCurrentTeam() == player)
+			{
+				_simulation.Apply(command);
+			}
+		}
+	}
+	_simulation.Tick();
+	_remote.pop_front();
+	++_tick;
+	++_statistics.ticks;
+
+	if (_tick % ChecksumInterval == 0)
+	{
+		_checksums[_tick / ChecksumInterval % ChecksumHistory] = _simulation.GetChecksum();
+		auto due = partition(_remoteChecksums.begin(), _remoteChecksums.end(), [this](pair<uint32, uint32> const& reported)
+		{
+			return reported.first > _tick;
+		});
+		vector<pair<uint32, uint32>> compare(due, _remoteChecksums.end());
+		_remoteChecksums.erase(due, _remoteChecksums.end());
+		for (auto const& reported : compare)
+		{
+			CompareChecksum(reported.first, reported.second);
+		}
+	}
+}
+
+void LockstepSession::CompareChecksum(uint32 tick, uint32 checksum)
+{
+	if (tick % ChecksumInterval != 0 || IsDesynced())
+	{
+		return;
+	}
+	if (tick > _tick)
+	{
+		// The other side is ahead by at most the input delay, a few of these at a time.
+		if (_remoteChecksums.size() < ChecksumHistory)
+		{
+			_remoteChecksums.push_back({ tick, checksum });
+		}
+		return;
+	}
+	if (_tick - tick >= ChecksumInterval * ChecksumHistory)
+	{
+		return;
+	}
+	++_statistics.checksumsCompared;
+	if (_checksums[tick / ChecksumInterval % ChecksumHistory] != checksum)
+	{
+		_desyncTick = tick;
+	}
+}
@@ -0,0 +1,156 @@
+#pragma once
+#include "BasicType.h"
+#include "BattleSimulation.h"
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Unreliable and unordered, like UDP: packets may be lost, duplicated in time or arrive out of order.
+	*/
+	class LockstepTransport
+	{
+	public:
+		virtual ~LockstepTransport() = default;
+		virtual void Send(std::vector<uint8> bytes) = 0;
+		virtual void Receive(std::vector<std::vector<uint8>>& packets) = 0;
+	};
+
+	/*
+	*	Two endpoints in one process with latency, jitter and loss, on a clock advanced by the caller, so a match over a
+	*	bad connection runs the same every time.
+	*/
+	class SimulatedNetwork
+	{
+	public:
+		struct Settings
+		{
+			float64 latencyMs;		// one way
+			float64 jitterMs;		// added uniformly at random, reorders packets
+			float64 lossRate;		// 0 to 1
+			uint64 seed;
+		};
+
+		explicit SimulatedNetwork(Settings const& settings);
+		~SimulatedNetwork();
+
+		LockstepTransport& GetEndpoint(uint32 index);
+		void Advance(float64 milliseconds);
+
+		uint64 GetBytesSent(uint32 endpoint) const;
+		uint32 GetPacketsSent(uint32 endpoint) const;
+
+	private:
+		class Endpoint;
+		struct Packet
+		{
+			float64 deliverMs;
+			uint32 to;
+			std::vector<uint8> bytes;
+		};
+
+		void Send(uint32 from, std::vector<uint8> bytes);
+		float64 NextRandom();
+
+		Settings _settings;
+		float64 _nowMs = 0;
+		uint64 _random;
+		std::unique_ptr<Endpoint> _endpoints[2];
+		std::vector<Packet> _inFlight;
+		std::vector<std::vector<uint8>> _delivered[2];
+		uint64 _bytesSent[2] = {};
+		uint32 _packetsSent[2] = {};
+	};
+
+	/*
+	*	One side of a two player battle in lockstep. Only commands go over the network: both sides run the same
+	*	simulation and a tick runs once the commands of both players for it are known.
+	*
+	*	Commands queued now take effect inputDelay ticks later, if the other side's commands arrive within that time the
+	*	simulation never waits for them. Every packet repeats the commands the other side has not acknowledged yet, so a
+	*	lost packet costs a few bytes in the next one instead of a resend round trip, and an idle tick costs one byte.
+	*	Every ChecksumInterval ticks both sides exchange a checksum of the simulation, a mismatch stops the session.
+	*/
+	class LockstepSession
+	{
+	public:
+		static uint32 const ChecksumInterval = 8;
+
+		struct Statistics
+		{
+			uint32 ticks;
+			uint32 stalls;				// updates that could not run a tick because the other side's commands were missing
+			uint32 checksumsCompared;
+			uint64 bytesSent;
+			uint32 packetsSent;
+		};
+
+		/*
+		*	@player: 0 or 1, also the team the player commands.
+		*/
+		LockstepSession(BattleSimulation& simulation, LockstepTransport& transport, uint8 player, uint32 inputDelay);
+
+		/*
+		*	Commands for units of other teams or outside the player's turn are dropped when their tick runs, on both sides.
+		*/
+		void Queue(BattleCommand const& command);
+
+		/*
+		*	Sends, receives and runs up to maxTicks ticks, as far as the commands of both players are known.
+		*	Call it once per simulation step, more than one tick catches up after a stall.
+		*	@return: the ticks that ran.
+		*/
+		uint32 Update(uint32 maxTicks = 1);
+
+		bool IsDesynced() const
+		{
+			return _desyncTick != ~0u;
+		}
+		/*
+		*	@return: the first compared tick count whose checksums differed, ~0u if none did.
+		*/
+		uint32 GetDesyncTick() const
+		{
+			return _desyncTick;
+		}
+		uint32 GetTick() const
+		{
+			return _tick;
+		}
+		Statistics const& GetStatistics() const
+		{
+			return _statistics;
+		}
+
+	private:
+		static uint32 const ChecksumHistory = 32;
+		static uint32 const MaxTicksPerPacket = 64;
+
+		void SendInputs();
+		void ReadPacket(std::vector<uint8> const& bytes);
+		void RunTick();
+		void CompareChecksum(uint32 tick, uint32 checksum);
+
+		BattleSimulation& _simulation;
+		LockstepTransport& _transport;
+		uint8 _player;
+		uint32 _inputDelay;
+		uint32 _tick = 0;							// ticks run since the session started
+
+		std::vector<BattleCommand> _queued;
+		std::deque<std::vector<BattleCommand>> _local;	// for ticks [_localFirst, _localEnd)
+		uint32 _localFirst;
+		uint32 _localEnd;
+		uint32 _remoteAcknowledged;					// the other side has our commands up to here
+		std::deque<std::vector<BattleCommand>> _remote;	// for ticks [_tick, _remoteEnd)
+		uint32 _remoteEnd;
+
+		uint32 _checksums[ChecksumHistory];			// ours after tick counts that are multiples of ChecksumInterval
+		std::vector<std::pair<uint32, uint32>> _remoteChecksums;	// received ahead of our own simulation
+		uint32 _lastSentChecksumTick = ~0u;
+		uint32 _desyncTick = ~0u;
+		Statistics _statistics = {};
+	};
+}
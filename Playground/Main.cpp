@@ -1,21 +1,127 @@
 #include "ComPtr.h"
 #include "Window.h"
 #include "DeviceAndContext.h"
+#include "BattleInput.h"
+#include "D3D11TextureDevice.h"
+#include "FrameArena.h"
 #include "IMGUISystemD3D11.h"
+#include "GameDataTables.h"
+#include "JobSystem.h"
+#include "Localization.h"
+#include "MemoryTracker.h"
+#include "PakFile.h"
+#include "ProfilerWindow.h"
+#include "Replay.h"
+#include "StageGraph.h"
+#include "StartupGraph.h"
+#include "TextureStreamer.h"
 #include "Utility.h"
 
 #include "imgui.h"
 
+#include <fstream>
 #include <iostream>
 
+namespace
+{
+	/*
+	*	ImGui keeps its buffers across frames, so it cannot use the frame arena. It gets a heap of its own instead, out of
+	*	the way of the debug CRT heap tracking every allocation, and is charged to the UI tag.
+	*/
+	HANDLE imguiHeap = ::HeapCreate(0, 0, 0);
+
+	void* ImGuiAllocate(size_t size)
+	{
+		void* memory = ::HeapAlloc(imguiHeap, 0, size);
+		if (memory)
+		{
+			X::MemoryTracker::RecordAllocation(X::MemoryTag::UI, size);
+		}
+		return memory;
+	}
+
+	void ImGuiFree(void* memory)
+	{
+		if (memory)
+		{
+			X::MemoryTracker::RecordFree(X::MemoryTag::UI, ::HeapSize(imguiHeap, 0, memory));
+			::HeapFree(imguiHeap, 0, memory);
+		}
+	}
+
+	/*
+	*	The compiled unit tables, the skirmish is fought by the units they list.
+	*/
+	struct Roster
+	{
+		X::GameDataTable<X::UnitsRow> units;
+		X::GameDataTable<X::ClassesRow> classes;
+		X::GameDataTable<X::WeaponsRow> weapons;
+		X::GameDataTable<X::SkillsRow> skills;
+	};
+
+	/*
+	*	@return: "-" for the ~0u of an empty reference, or when the table did not load.
+	*/
+	template <class Row>
+	char const* GetRowName(X::GameDataTable<Row> const& table, X::uint32 index)
+	{
+		return index < table.GetCount() ? table.GetString(table[index].name) : "-";
+	}
+
+	/*
+	*	A field of plains, forests and a river with both teams at the far edges. The map units are the rows of the units
+	*	table in order, four a side without it.
+	*/
+	X::Ptr<X::BattleMap> MakeSkirmishMap(Roster const& roster)
+	{
+		X::uint32 teamSizes[2] = {};
+		std::string units;
+		auto addUnit = [&](X::uint32 team, std::string const& name)
+		{
+			team = team == 0 ? 0 : 1;
+			units += "unit " + std::string(team == 0 ? "1 " : "10 ") + std::to_string(1 + teamSizes[team]++) + " " +
+				std::to_string(team) + (team == 0 ? " e " : " w ") + name + "\n";
+		};
+		for (X::uint32 index = 0; index < roster.units.GetCount(); ++index)
+		{
+			addUnit(roster.units[index].team, roster.units.GetString(roster.units[index].name));
+		}
+		if (roster.units.GetCount() == 0)
+		{
+			for (X::uint32 index = 0; index < 4; ++index)
+			{
+				addUnit(0, "Blue " + std::to_string(index + 1));
+				addUnit(1, "Red " + std::to_string(index + 1));
+			}
+		}
+
+		X::uint32 largestTeam = teamSizes[0] > teamSizes[1] ? teamSizes[0] : teamSizes[1];
+		X::uint32 height = largestTeam + 2 > 10 ? largestTeam + 2 : 10;
+		std::string text = "size 12 " + std::to_string(height) + "\ntiles\n";
+		for (X::uint32 y = 0; y < height; ++y)
+		{
+			for (X::uint32 x = 0; x < 12; ++x)
+			{
+				text += x == 6 && y % 4 != 3 ? '~' : (x * 5 + y * 3) % 7 == 0 ? 'f' : '.';
+			}
+			text += '\n';
+		}
+		std::vector<X::uint8> file;
+		X::ConvertBattleMapText(text + units, file);
+		return X::BattleMap::Create(std::move(file));
+	}
+}
+
 struct GUI
 {
 	bool show_test_window = true;
 	bool show_another_window = false;
 	ImVec4 clear_col = ImColor(114, 144, 154);
 	float f = 0.0f;
+	X::ProfilerWindow profiler;
 
-	void RenderGUI()
+	void RenderGUI(X::FrameArena const& frameArena, X::StageGraph const& stages, X::TextureStreamer const& textures, X::TextureStreamer::TextureHandle portrait)
 	{
 		ImGui::Text("Hello, world!");
 		ImGui::SliderFloat("float", &f, 0.0f, 1.0f);
@@ -23,6 +129,158 @@ struct GUI
 		if (ImGui::Button("Test Window")) show_test_window ^= 1;
 		if (ImGui::Button("Another Window")) show_another_window ^= 1;
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+		X::FrameArena::Statistics arena = frameArena.GetStatistics();
+		ImGui::Text("Frame arena high-water %.1f / %.1f KB, %u overflows", arena.lastFrameHighWater / 1024.0f, arena.capacity / 1024.0f, arena.lastFrameOverflows);
+		RenderMemoryPanel();
+		RenderStagePanel(stages);
+		RenderTexturePanel(textures, portrait);
+		profiler.Render();
+	}
+
+	void RenderBattlePanel(X::BattleSimulation const& battle, X::BattleInputController& input, Roster const& roster)
+	{
+		using namespace X;
+
+		float32 const TileSize = 24.0f;
+		static ImU32 const terrainColors[] =
+		{
+			ImColor(0, 0, 0), ImColor(120, 170, 80), ImColor(40, 110, 50),
+			ImColor(130, 110, 90), ImColor(50, 90, 170), ImColor(90, 90, 90),
+		};
+		static_assert(sizeof(terrainColors) / sizeof(terrainColors[0]) == uint32(Terrain::Count), "A color for every terrain.");
+
+		BattleMap const& map = battle.GetMap();
+		ImGui::Begin("Battle");
+		if (battle.GetWinner() != 0xFF)
+		{
+			ImGui::Text("Team %u won", battle.GetWinner());
+		}
+		else
+		{
+			ImGui::Text("Team %u to move, tick %u", battle.GetCurrentTeam(), battle.GetTick());
+		}
+		ImGui::Text("Arrows and Enter or the mouse select, move and attack, Escape cancels, W waits, E ends the turn.");
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		// The controller picks the tiles itself from the window's mouse positions, it has to know where they are drawn.
+		input.SetView(uint32(origin.x > 0.0f ? origin.x : 0.0f), uint32(origin.y > 0.0f ? origin.y : 0.0f), uint32(TileSize),
+			uint32(ImGui::GetIO().DisplaySize.y));
+		auto tileMin = [&](uint32 x, uint32 y)
+		{
+			return ImVec2(origin.x + x * TileSize, origin.y + y * TileSize);
+		};
+		auto tileMax = [&](uint32 x, uint32 y)
+		{
+			return ImVec2(origin.x + (x + 1) * TileSize - 1.0f, origin.y + (y + 1) * TileSize - 1.0f);
+		};
+		for (uint32 y = 0; y < map.GetHeight(); ++y)
+		{
+			for (uint32 x = 0; x < map.GetWidth(); ++x)
+			{
+				drawList->AddRectFilled(tileMin(x, y), tileMax(x, y), terrainColors[uint32(map.GetTile(x, y).terrain)]);
+			}
+		}
+		std::vector<BattleUnit> const& units = battle.GetUnits();
+		for (uint16 index = 0; index < units.size(); ++index)
+		{
+			BattleUnit const& unit = units[index];
+			if (unit.health <= 0)
+			{
+				continue;
+			}
+			// Units that are done for the turn are drawn darker.
+			uint8 shade = unit.moved && unit.acted ? 120 : 230;
+			ImVec2 unitMin(tileMin(unit.x, unit.y).x + 4.0f, tileMin(unit.x, unit.y).y + 4.0f);
+			ImVec2 unitMax(tileMax(unit.x, unit.y).x - 4.0f, tileMax(unit.x, unit.y).y - 4.0f);
+			drawList->AddRectFilled(unitMin, unitMax, unit.team == 0 ? ImColor(40, 60, shade) : ImColor(shade, 40, 40));
+			if (index == input.GetSelectedUnit())
+			{
+				drawList->AddRect(tileMin(unit.x, unit.y), tileMax(unit.x, unit.y), ImColor(255, 220, 0));
+			}
+			if (ImGui::IsMouseHoveringRect(unitMin, unitMax))
+			{
+				if (index < roster.units.GetCount())
+				{
+					UnitsRow const& row = roster.units[index];
+					ImGui::SetTooltip("%s, level %u %s\n%d HP\nWeapon: %s\nSkill: %s", map.GetUnitName(index), row.level,
+						GetRowName(roster.classes, row.unit_class), unit.health, GetRowName(roster.weapons, row.weapon),
+						GetRowName(roster.skills, row.skill));
+				}
+				else
+				{
+					ImGui::SetTooltip("%s\n%d HP", map.GetUnitName(index), unit.health);
+				}
+			}
+		}
+		drawList->AddRect(tileMin(input.GetCursorX(), input.GetCursorY()), tileMax(input.GetCursorX(), input.GetCursorY()), ImColor(255, 255, 255));
+		// Takes the clicks, so they do not drag the window.
+		ImGui::InvisibleButton("Map", ImVec2(map.GetWidth() * TileSize, map.GetHeight() * TileSize));
+		ImGui::End();
+	}
+
+	void RenderTexturePanel(X::TextureStreamer const& textures, X::TextureStreamer::TextureHandle portrait)
+	{
+		X::TextureStreamer::Statistics statistics = textures.GetStatistics();
+		ImGui::Begin("Textures");
+		ImGui::Text("%u loading, %u waiting, %u uploading, %u resident, %u failed", statistics.loading, statistics.waitingForUpload,
+			statistics.uploading, statistics.resident, statistics.failed);
+		ImGui::Text("Uploaded %.1f KB last frame", statistics.uploadedBytesLastFrame / 1024.0);
+		// The checker placeholder until the portrait is resident.
+		ImGui::Image(textures.GetTexture(portrait), ImVec2(128, 128));
+		ImGui::End();
+	}
+
+	void RenderStagePanel(X::StageGraph const& stages)
+	{
+		X::StageGraph::FrameTiming timing = stages.GetLastFrameTiming();
+		ImGui::Begin("Stages");
+		ImGui::Text("Frame %llu: %.2f ms", (unsigned long long)timing.frame, timing.durationMs);
+		ImGui::Columns(4);
+		ImGui::Text("Stage"); ImGui::NextColumn();
+		ImGui::Text("Start ms"); ImGui::NextColumn();
+		ImGui::Text("ms"); ImGui::NextColumn();
+		ImGui::Text("Average ms"); ImGui::NextColumn();
+		ImGui::Separator();
+		for (X::StageGraph::StageTiming const& stage : timing.stages)
+		{
+			ImGui::Text("%s%s", stage.name.c_str(), stage.mainThread ? "" : " (worker)"); ImGui::NextColumn();
+			ImGui::Text("%.2f", stage.startMs); ImGui::NextColumn();
+			ImGui::Text("%.2f", stage.durationMs); ImGui::NextColumn();
+			ImGui::Text("%.2f", stage.averageMs); ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::End();
+	}
+
+	void RenderMemoryPanel()
+	{
+		using namespace X;
+
+		ImGui::Begin("Memory");
+		ImGui::Columns(5);
+		ImGui::Text("Tag"); ImGui::NextColumn();
+		ImGui::Text("KB"); ImGui::NextColumn();
+		ImGui::Text("Peak KB"); ImGui::NextColumn();
+		ImGui::Text("Allocs/frame"); ImGui::NextColumn();
+		ImGui::Text("KB/frame"); ImGui::NextColumn();
+		ImGui::Separator();
+		for (uint32 tag = 0; tag < uint32(MemoryTag::Count); ++tag)
+		{
+			MemoryTagStatistics statistics = MemoryTracker::GetStatistics(MemoryTag(tag));
+			ImGui::Text("%s", GetMemoryTagName(MemoryTag(tag))); ImGui::NextColumn();
+			ImGui::Text("%.1f", statistics.bytes / 1024.0); ImGui::NextColumn();
+			ImGui::Text("%.1f", statistics.peakBytes / 1024.0); ImGui::NextColumn();
+			ImGui::Text("%llu", (unsigned long long)statistics.lastFrameAllocations); ImGui::NextColumn();
+			ImGui::Text("%.1f", statistics.lastFrameBytes / 1024.0); ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		if (ImGui::Button("Write snapshot"))
+		{
+			std::ofstream file("memory_" + std::to_string(MemoryTracker::GetFrame()) + ".txt");
+			MemoryTracker::WriteSnapshot(file);
+		}
+		ImGui::End();
 	}
 };
 
@@ -31,48 +289,174 @@ int main()
 	using namespace X;
 	using namespace std;
 
+	SRPG_PROFILE_THREAD("Main");
 	auto gui = make_unique<GUI>();
 
-	Ptr<Window> window = Window::Create(L"hello", { 1280,800 });
-	Ptr<DeviceAndContext> deviceAndContext = CreatePtr<DeviceAndContext>(window);
-	Ptr<IMGUISystemD3D11> imgui = IMGUISystemD3D11::Create();
-
-	imgui->ImGui_ImplDX11_Init(window->GetHWND(), deviceAndContext->GetD3DDevice(), deviceAndContext->GetD3DDeviceContext());
+	ImGui::GetIO().MemAllocFn = &ImGuiAllocate;
+	ImGui::GetIO().MemFreeFn = &ImGuiFree;
+	FrameArena frameArena(4 * 1024 * 1024);
 
+	Ptr<JobSystem> jobs = JobSystem::Create();
+	Ptr<Window> window;
+	Ptr<DeviceAndContext> deviceAndContext;
+	Ptr<IMGUISystemD3D11> imgui = IMGUISystemD3D11::Create();
+	Ptr<PakFile> pak;
+	Ptr<TextureStreamer> textures;
+	TextureStreamer::TextureHandle portrait = 0;
+	Ptr<Localization> localization;
+	Roster roster;
 
-	function<void(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)> imguiInputCallback = [imgui](HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) 
+	// The window and everything owning it stay on the main thread, files and the font atlas load meanwhile.
+	StartupGraph startup;
+	auto windowTask = startup.Add("Window", StartupGraph::Thread::Main, [&]
 	{
-		auto wndProc = static_cast<LRESULT(*)(HWND, UINT msg, WPARAM wParam, LPARAM lParam)>(imgui->GetWndProcHandler());
-		wndProc(hWnd, message, wParam, lParam);
-	};
-	window->SetRawWindowsMessageHook(&imguiInputCallback);
-
-	window->SetResizeHandler([deviceAndContext, imgui](uint32 width, uint32 height)
+		window = Window::Create(L"hello", { 1280,800 });
+	});
+	auto deviceTask = startup.Add("Device", StartupGraph::Thread::Main, [&]
 	{
-		deviceAndContext->UpdateWindowSize();
-		imgui->ImGui_ImplDX11_InvalidateDeviceObjects();
-		imgui->ImGui_ImplDX11_CreateDeviceObjects();
+		MemoryTagScope tag(MemoryTag::Render);
+		deviceAndContext = CreatePtr<DeviceAndContext>(window);
+	}, { windowTask });
+	auto fontTask = startup.Add("Font atlas", StartupGraph::Thread::Worker, []
+	{
+		MemoryTagScope tag(MemoryTag::UI);
+		unsigned char* pixels;
+		int width, height;
+		ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	});
+	auto pakTask = startup.Add("Pak", StartupGraph::Thread::Worker, [&]
+	{
+		MemoryTagScope tag(MemoryTag::Assets);
+		pak = PakFile::Open("Data.pak");
 	});
+	auto tableTask = startup.Add("Tables", StartupGraph::Thread::Worker, [&]
+	{
+		MemoryTagScope tag(MemoryTag::Assets);
+		localization = Localization::Open("strings.tbl");
+		roster.units.Open("units.tbl");
+		roster.classes.Open("classes.tbl");
+		roster.weapons.Open("weapons.tbl");
+		roster.skills.Open("skills.tbl");
+	});
+	startup.Add("Textures", StartupGraph::Thread::Main, [&]
+	{
+		MemoryTagScope tag(MemoryTag::Assets);
+		// From the pak when there is one, loose files otherwise.
+		TextureStreamer::Loader loader;
+		if (pak)
+		{
+			Ptr<PakFile> source = pak;
+			loader = [source](string const& path, TextureData& texture)
+			{
+				vector<uint8> file;
+				return source->Read(path, file) && DecodeTGA(file.data(), file.size(), texture);
+			};
+		}
+		textures = CreatePtr<TextureStreamer>(CreatePtr<D3D11TextureDevice>(deviceAndContext->GetD3DDevice()), jobs, 4 * 1024 * 1024, loader);
+		portrait = textures->Request("Textures/Portrait.tga");
+	}, { deviceTask, pakTask });
+	startup.Add("Title", StartupGraph::Thread::Main, [&]
+	{
+		if (localization)
+		{
+			window->SetTitleText(localization->Get(GameDataID::Strings::WindowTitle));
+		}
+	}, { windowTask, tableTask });
+	startup.Add("ImGui", StartupGraph::Thread::Main, [&]
+	{
+		imgui->ImGui_ImplDX11_Init(window->GetHWND(), deviceAndContext->GetD3DDevice(), deviceAndContext->GetD3DDeviceContext(), deviceAndContext->GetStateObjectCache());
+		// Up front instead of in the first NewFrame, which would hitch.
+		imgui->ImGui_ImplDX11_CreateDeviceObjects();
+	}, { deviceTask, fontTask });
+	startup.Run(*jobs);
 
-	window->SetMessageIdle([deviceAndContext, imgui, &gui]
+	auto imguiWndProc = static_cast<LRESULT(*)(HWND, UINT msg, WPARAM wParam, LPARAM lParam)>(imgui->GetWndProcHandler());
+	window->GetEvents().Subscribe<WindowMessageEvent>([imguiWndProc](WindowMessageEvent const& event)
 	{
-		imgui->ImGui_ImplDX11_NewFrame();
+		imguiWndProc(static_cast<HWND>(event.window), event.message, WPARAM(event.wParam), LPARAM(event.lParam));
+	});
 
-		gui->RenderGUI();
+	// A skirmish played through the battle input, every command the simulation accepts goes into the replay saved at exit.
+	uint64 const battleSeed = 1;
+	BattleSimulation battle(MakeSkirmishMap(roster), battleSeed);
+	ReplayRecorder replay("Skirmish", battle, battleSeed);
+	Ptr<BattleInputController> battleInput = CreatePtr<BattleInputController>(battle, BattleInputController::CommandSink([&replay, &battle](BattleCommand const& command)
+	{
+		replay.Apply(battle, command);
+	}));
+	window->SetInputHandler(battleInput);
 
+	// Frame stages in the order they use the ImGui frame and the back buffer. Two frames in flight let the GUI of the
+	// next frame start before this one is presented, the frame arena is double-buffered for that.
+	StageGraph stages(*jobs, 2);
+	auto guiFrame = stages.DeclareResource("ImGui frame");
+	auto backBuffer = stages.DeclareResource("Back buffer");
+	stages.Add("Input", StageGraph::Thread::Main, [&](uint64)
+	{
+		SRPG_PROFILE_FRAME();
+		MemoryTracker::BeginFrame();
+		frameArena.BeginFrame();
+		textures->Update();
+		replay.Tick(battle);
+		MemoryTagScope tag(MemoryTag::UI);
+		imgui->ImGui_ImplDX11_NewFrame();
+	}, {}, { guiFrame });
+	stages.Add("GUI", StageGraph::Thread::Main, [&](uint64)
+	{
+		MemoryTagScope tag(MemoryTag::UI);
+		gui->RenderGUI(frameArena, stages, *textures, portrait);
+		gui->RenderBattlePanel(battle, *battleInput, roster);
+	}, {}, { guiFrame });
+	stages.Add("Submit", StageGraph::Thread::Main, [&](uint64)
+	{
+		MemoryTagScope tag(MemoryTag::Render);
 		deviceAndContext->GetD3DDeviceContext()->ClearRenderTargetView(deviceAndContext->GetBackBufferRenderTargetView(), (float*)&gui->clear_col);
 		ID3D11RenderTargetView* rtvs[] = { deviceAndContext->GetBackBufferRenderTargetView() };
 		deviceAndContext->GetD3DDeviceContext()->OMSetRenderTargets(ArraySize(rtvs), rtvs, nullptr);
 
+		auto section = deviceAndContext->StartEventSection(L"IMGUI");
+		imgui->ImGui_ImplDX11_Render();
+	}, { guiFrame }, { backBuffer });
+	stages.Add("Present", StageGraph::Thread::Main, [&](uint64 frame)
+	{
+		MemoryTagScope tag(MemoryTag::Render);
+		deviceAndContext->Present();
+		if (frame == 0)
 		{
-			auto section = deviceAndContext->StartEventSection(L"IMGUI");
-			imgui->ImGui_ImplDX11_Render();
+			startup.Mark("First frame");
+			cout << startup.FormatTimeline();
+			OutputDebugStringA(startup.FormatTimeline().c_str());
 		}
-		deviceAndContext->Present();
+	}, {}, { backBuffer });
 
-		cout << "hello" << endl;
+	// Only noted here, a drag delivers several resizes and the back buffer is rebuilt once, before the next frame.
+	bool resized = false;
+	window->GetEvents().Subscribe<WindowResizeEvent>([&resized](WindowResizeEvent const&)
+	{
+		resized = true;
+	});
+	auto resize = [&deviceAndContext, &imgui, &stages]
+	{
+		// The frames in flight still draw to the old back buffer.
+		stages.Flush();
+		deviceAndContext->UpdateWindowSize();
+		// Pipeline states come back from the cache, only the buffers, shaders and font texture are really rebuilt.
+		imgui->ImGui_ImplDX11_InvalidateDeviceObjects();
+		imgui->ImGui_ImplDX11_CreateDeviceObjects();
+	};
+
+	window->GetEvents().Subscribe<WindowIdleEvent>([&stages, &resized, &resize](WindowIdleEvent const&)
+	{
+		if (resized)
+		{
+			resized = false;
+			resize();
+		}
+		stages.RunFrame();
 	});
 	window->StartHandlingMessages();
+	stages.Flush();
+	replay.Save("Skirmish.replay", battle);
 
 	imgui->ImGui_ImplDX11_Shutdown();
 
@@ -91,6 +475,15 @@ struct DML
 	}
 	~DML()
 	{
+		// What is still allocated per tag, statics destroyed after this one show up as well.
+		for (X::uint32 tag = 0; tag < X::uint32(X::MemoryTag::Count); ++tag)
+		{
+			X::MemoryTagStatistics statistics = X::MemoryTracker::GetStatistics(X::MemoryTag(tag));
+			char line[128];
+			snprintf(line, sizeof(line), "%s: %lld bytes in %lld allocations still alive at exit.\n", X::GetMemoryTagName(X::MemoryTag(tag)),
+				(long long)statistics.bytes, (long long)statistics.liveAllocations);
+			OutputDebugStringA(line);
+		}
 		if (_CrtDumpMemoryLeaks())
 		{
 			OutputDebugString(L"memory leaks.");
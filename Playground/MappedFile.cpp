@@ -0,0 +1,120 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace X;
+
+#ifdef _WIN32
+struct MappedFileImpl : public MappedFile
+{
+	HANDLE file_ = INVALID_HANDLE_VALUE;
+	HANDLE mapping_ = NULL;
+	void const* view_ = nullptr;
+	size_t size_ = 0;
+
+	~MappedFileImpl()
+	{
+		if (view_)
+		{
+			UnmapViewOfFile(view_);
+		}
+		if (mapping_)
+		{
+			CloseHandle(mapping_);
+		}
+		if (file_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file_);
+		}
+	}
+
+	bool Open(string const& path)
+	{
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file_ == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+		{
+			return false;
+		}
+		size_ = size_t(size.QuadPart);
+		mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping_)
+		{
+			return false;
+		}
+		view_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+		return view_ != nullptr;
+	}
+
+	virtual uint8 const* GetData() const override
+	{
+		return static_cast<uint8 const*>(view_);
+	}
+	virtual size_t GetSize() const override
+	{
+		return size_;
+	}
+};
+#else
+struct MappedFileImpl : public MappedFile
+{
+	void* view_ = MAP_FAILED;
+	size_t size_ = 0;
+
+	~MappedFileImpl()
+	{
+		if (view_ != MAP_FAILED)
+		{
+			munmap(view_, size_);
+		}
+	}
+
+	bool Open(string const& path)
+	{
+		int file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		struct stat status;
+		if (fstat(file, &status) == 0 && status.st_size > 0)
+		{
+			size_ = size_t(status.st_size);
+			view_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+		}
+		// The mapping keeps its own reference to the file.
+		close(file);
+		return view_ != MAP_FAILED;
+	}
+
+	virtual uint8 const* GetData() const override
+	{
+		return static_cast<uint8 const*>(view_);
+	}
+	virtual size_t GetSize() const override
+	{
+		return size_;
+	}
+};
+#endif
+
+Ptr<MappedFile> MappedFile::Open(string const& path)
+{
+	Ptr<MappedFileImpl> file = CreatePtr<MappedFileImpl>();
+	if (!file->Open(path))
+	{
+		return nullptr;
+	}
+	return file;
+}
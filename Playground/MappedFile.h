@@ -0,0 +1,23 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include <string>
+
+namespace X
+{
+	/*
+	*	A whole file mapped read-only into the address space.
+	*	Mapping costs the same for any file size, pages are read on first access.
+	*/
+	class MappedFile : public ReferenceCountBase<true>
+	{
+	public:
+		/*
+		*	@return: nullptr if the file does not exist, is empty or can not be mapped.
+		*/
+		static Ptr<MappedFile> Open(std::string const& path);
+
+		virtual uint8 const* GetData() const = 0;
+		virtual size_t GetSize() const = 0;
+	};
+}
@@ -0,0 +1,452 @@
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <dbghelp.h>
+#include <intrin.h>
+#define SRPG_RETURN_ADDRESS() _ReturnAddress()
+#else
+#include <execinfo.h>
+#define SRPG_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const TagCount = uint32(MemoryTag::Count);
+	uint32 const MaxStackFrames = 16;
+	uint32 const StackTableSize = 1024;
+
+	char const* const TagNames[TagCount] = { "Untagged", "Render", "Simulation", "AI", "UI", "Assets" };
+
+	// In front of every tracked block, 16 bytes keep the block as aligned as malloc made it.
+	struct BlockHeader
+	{
+		uint64 size;
+		uint32 tag;
+		uint32 magic;
+	};
+
+	static_assert(sizeof(BlockHeader) == 16, "BlockHeader must keep the malloc alignment");
+
+	uint32 const BlockMagic = 0x4D454D54;	// "MEMT"
+
+	struct TagCounters
+	{
+		atomic<sint64> bytes;
+		atomic<sint64> peakBytes;
+		atomic<sint64> liveAllocations;
+		atomic<uint64> totalAllocations;
+		atomic<uint64> totalBytes;
+		// Totals when the current frame began, only touched by BeginFrame.
+		uint64 frameStartAllocations;
+		uint64 frameStartBytes;
+		uint64 lastFrameAllocations;
+		uint64 lastFrameBytes;
+	};
+
+	struct StackSample
+	{
+		uint64 hash;
+		uint64 samples;
+		void* frames[MaxStackFrames];
+		uint32 frameCount;
+		MemoryTag tag;
+	};
+
+	// Everything here is constant initialized, operator new may run before any dynamic initializer.
+	TagCounters counters[TagCount];
+	StackSample stackTable[StackTableSize];
+	uint32 stackTableUsed = 0;
+	uint64 droppedSamples = 0;
+	atomic_flag stackTableLock = ATOMIC_FLAG_INIT;
+	atomic<uint64> sampleInterval{ 512 * 1024 };
+	atomic<uint64> frame{ 0 };
+
+	thread_local MemoryTag currentTag = MemoryTag::Untagged;
+	thread_local uint64 bytesSinceSample = 0;
+	thread_local bool insideTracker = false;
+
+	uint32 const MaxTrackerFrames = 8;
+
+	/*
+	*	@caller: return address of the operator new that was called, the stack starts at the frame it returns to.
+	*	How many frames the tracker itself takes depends on the platform and on what the compiler inlined or turned into
+	*	tail calls, so they are found by address instead of skipping a fixed count.
+	*/
+	uint32 CaptureStack(void** frames, void* caller)
+	{
+		void* all[MaxStackFrames + MaxTrackerFrames];
+#ifdef _WIN32
+		uint32 count = ::CaptureStackBackTrace(0, MaxStackFrames + MaxTrackerFrames, all, nullptr);
+#else
+		sint32 captured = backtrace(all, MaxStackFrames + MaxTrackerFrames);
+		uint32 count = captured > 0 ? uint32(captured) : 0;
+#endif
+		uint32 first = 0;
+		while (first < min(count, MaxTrackerFrames) && all[first] != caller)
+		{
+			++first;
+		}
+		// Not found when the unwinder could not walk through the allocator, keep everything then.
+		first = first < min(count, MaxTrackerFrames) ? first : 0;
+		count = min(count - first, MaxStackFrames);
+		memcpy(frames, all + first, count * sizeof(void*));
+		return count;
+	}
+
+	void RecordSample(MemoryTag tag, uint64 samples, void* caller)
+	{
+		StackSample sample;
+		sample.tag = tag;
+		sample.samples = samples;
+		sample.frameCount = CaptureStack(sample.frames, caller);
+		sample.hash = 14695981039346656037ull ^ uint64(tag);
+		for (uint32 i = 0; i < sample.frameCount; ++i)
+		{
+			sample.hash = (sample.hash ^ uint64(uintptr_t(sample.frames[i]))) * 1099511628211ull;
+		}
+
+		while (stackTableLock.test_and_set(memory_order_acquire))
+		{
+		}
+		uint32 slot = uint32(sample.hash % StackTableSize);
+		for (uint32 probe = 0; probe < StackTableSize; ++probe, slot = (slot + 1) % StackTableSize)
+		{
+			StackSample& entry = stackTable[slot];
+			if (entry.samples == 0)
+			{
+				if (stackTableUsed * 4 >= StackTableSize * 3)
+				{
+					break;
+				}
+				entry = sample;
+				++stackTableUsed;
+				samples = 0;
+				break;
+			}
+			if (entry.hash == sample.hash && entry.tag == tag)
+			{
+				entry.samples += samples;
+				samples = 0;
+				break;
+			}
+		}
+		droppedSamples += samples;
+		stackTableLock.clear(memory_order_release);
+	}
+
+	void Count(MemoryTag tag, size_t size)
+	{
+		TagCounters& tagCounters = counters[uint32(tag) < TagCount ? uint32(tag) : 0];
+		sint64 bytes = tagCounters.bytes.fetch_add(size, memory_order_relaxed) + sint64(size);
+		sint64 peak = tagCounters.peakBytes.load(memory_order_relaxed);
+		while (bytes > peak && !tagCounters.peakBytes.compare_exchange_weak(peak, bytes, memory_order_relaxed))
+		{
+		}
+		tagCounters.liveAllocations.fetch_add(1, memory_order_relaxed);
+		tagCounters.totalAllocations.fetch_add(1, memory_order_relaxed);
+		tagCounters.totalBytes.fetch_add(size, memory_order_relaxed);
+	}
+
+	void Uncount(MemoryTag tag, size_t size)
+	{
+		TagCounters& tagCounters = counters[uint32(tag) < TagCount ? uint32(tag) : 0];
+		tagCounters.bytes.fetch_sub(size, memory_order_relaxed);
+		tagCounters.liveAllocations.fetch_sub(1, memory_order_relaxed);
+	}
+
+	void* TrackedAllocate(size_t size, void* caller)
+	{
+		BlockHeader* header = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+		if (!header)
+		{
+			return nullptr;
+		}
+		MemoryTag tag = currentTag;
+		header->size = size;
+		header->tag = uint32(tag);
+		header->magic = BlockMagic;
+		Count(tag, size);
+
+		uint64 interval = sampleInterval.load(memory_order_relaxed);
+		bytesSinceSample += size;
+		if (interval > 0 && bytesSinceSample >= interval && !insideTracker)
+		{
+			uint64 samples = bytesSinceSample / interval;
+			bytesSinceSample %= interval;
+			// Capturing the stack may allocate the first time, e.g. when the unwinder is loaded.
+			insideTracker = true;
+			RecordSample(tag, samples, caller);
+			insideTracker = false;
+		}
+		return header + 1;
+	}
+
+	void TrackedFree(void* memory)
+	{
+		if (!memory)
+		{
+			return;
+		}
+		BlockHeader* header = static_cast<BlockHeader*>(memory) - 1;
+		Uncount(MemoryTag(header->tag), size_t(header->size));
+		header->magic = 0;
+		free(header);
+	}
+
+	void* AllocateOrThrow(size_t size, void* caller)
+	{
+		for (;;)
+		{
+			void* memory = TrackedAllocate(size, caller);
+			if (memory)
+			{
+				return memory;
+			}
+			new_handler handler = get_new_handler();
+			if (!handler)
+			{
+				throw bad_alloc();
+			}
+			handler();
+		}
+	}
+
+	string DescribeFrame(void* address)
+	{
+		char text[512];
+#ifdef _WIN32
+		// Symbol names instead of addresses, addresses move between runs and would break diffing.
+		static bool initialized = false;
+		HANDLE process = ::GetCurrentProcess();
+		if (!initialized)
+		{
+			::SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+			::SymInitialize(process, nullptr, TRUE);
+			initialized = true;
+		}
+		uint8 buffer[sizeof(SYMBOL_INFO) + 256];
+		SYMBOL_INFO* symbol = reinterpret_cast<SYMBOL_INFO*>(buffer);
+		symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+		symbol->MaxNameLen = 256;
+		DWORD64 displacement = 0;
+		if (::SymFromAddr(process, DWORD64(address), &displacement, symbol))
+		{
+			snprintf(text, sizeof(text), "%s+0x%llx", symbol->Name, (unsigned long long)displacement);
+			return text;
+		}
+		snprintf(text, sizeof(text), "%p", address);
+		return text;
+#else
+		char** symbols = backtrace_symbols(&address, 1);
+		if (!symbols)
+		{
+			snprintf(text, sizeof(text), "%p", address);
+			return text;
+		}
+		// "binary(symbol+offset) [address]", the address part differs between runs.
+		string symbol = symbols[0];
+		free(symbols);
+		size_t bracket = symbol.find(" [");
+		return bracket == string::npos ? symbol : symbol.substr(0, bracket);
+#endif
+	}
+}
+
+#ifndef SRPG_NO_MEMORY_TRACKING
+
+void* operator new(size_t size)
+{
+	return AllocateOrThrow(size, SRPG_RETURN_ADDRESS());
+}
+
+void* operator new[](size_t size)
+{
+	return AllocateOrThrow(size, SRPG_RETURN_ADDRESS());
+}
+
+void* operator new(size_t size, nothrow_t const&) noexcept
+{
+	return TrackedAllocate(size, SRPG_RETURN_ADDRESS());
+}
+
+void* operator new[](size_t size, nothrow_t const&) noexcept
+{
+	return TrackedAllocate(size, SRPG_RETURN_ADDRESS());
+}
+
+void operator delete(void* memory) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete(void* memory, nothrow_t const&) noexcept
+{
+	TrackedFree(memory);
+}
+
+void operator delete[](void* memory, nothrow_t const&) noexcept
+{
+	TrackedFree(memory);
+}
+
+#endif
+
+char const* X::GetMemoryTagName(MemoryTag tag)
+{
+	return uint32(tag) < TagCount ? TagNames[uint32(tag)] : "Invalid";
+}
+
+MemoryTagScope::MemoryTagScope(MemoryTag tag) :
+	_previous(currentTag)
+{
+	currentTag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope()
+{
+	currentTag = _previous;
+}
+
+bool MemoryTracker::IsEnabled()
+{
+#ifdef SRPG_NO_MEMORY_TRACKING
+	return false;
+#else
+	return true;
+#endif
+}
+
+void MemoryTracker::BeginFrame()
+{
+	for (TagCounters& tagCounters : counters)
+	{
+		uint64 allocations = tagCounters.totalAllocations.load(memory_order_relaxed);
+		uint64 bytes = tagCounters.totalBytes.load(memory_order_relaxed);
+		tagCounters.lastFrameAllocations = allocations - tagCounters.frameStartAllocations;
+		tagCounters.lastFrameBytes = bytes - tagCounters.frameStartBytes;
+		tagCounters.frameStartAllocations = allocations;
+		tagCounters.frameStartBytes = bytes;
+	}
+	frame.fetch_add(1, memory_order_relaxed);
+}
+
+MemoryTagStatistics MemoryTracker::GetStatistics(MemoryTag tag)
+{
+	TagCounters const& tagCounters = counters[uint32(tag) < TagCount ? uint32(tag) : 0];
+	MemoryTagStatistics statistics;
+	statistics.bytes = tagCounters.bytes.load(memory_order_relaxed);
+	statistics.peakBytes = tagCounters.peakBytes.load(memory_order_relaxed);
+	statistics.liveAllocations = tagCounters.liveAllocations.load(memory_order_relaxed);
+	statistics.totalAllocations = tagCounters.totalAllocations.load(memory_order_relaxed);
+	statistics.lastFrameAllocations = tagCounters.lastFrameAllocations;
+	statistics.lastFrameBytes = tagCounters.lastFrameBytes;
+	return statistics;
+}
+
+uint64 MemoryTracker::GetFrame()
+{
+	return frame.load(memory_order_relaxed);
+}
+
+void MemoryTracker::RecordAllocation(MemoryTag tag, size_t bytes)
+{
+	Count(tag, bytes);
+}
+
+void MemoryTracker::RecordFree(MemoryTag tag, size_t bytes)
+{
+	Uncount(tag, bytes);
+}
+
+void MemoryTracker::SetSampleInterval(uint64 bytes)
+{
+	sampleInterval.store(bytes, memory_order_relaxed);
+}
+
+void MemoryTracker::WriteSnapshot(ostream& stream)
+{
+	// Copied out first, symbolizing allocates and must not happen under the lock.
+	vector<StackSample> samples;
+	samples.reserve(StackTableSize);
+	uint64 dropped;
+	while (stackTableLock.test_and_set(memory_order_acquire))
+	{
+	}
+	for (StackSample const& sample : stackTable)
+	{
+		if (sample.samples > 0)
+		{
+			samples.push_back(sample);
+		}
+	}
+	dropped = droppedSamples;
+	stackTableLock.clear(memory_order_release);
+
+	uint64 interval = sampleInterval.load(memory_order_relaxed);
+	char line[256];
+	snprintf(line, sizeof(line), "# memory snapshot, frame %llu, sample interval %llu bytes\n",
+		(unsigned long long)GetFrame(), (unsigned long long)interval);
+	stream << line;
+	stream << "# tag bytes peak live total_allocations\n";
+	for (uint32 tag = 0; tag < TagCount; ++tag)
+	{
+		MemoryTagStatistics statistics = GetStatistics(MemoryTag(tag));
+		snprintf(line, sizeof(line), "tag %s %lld %lld %lld %llu\n", TagNames[tag], (long long)statistics.bytes,
+			(long long)statistics.peakBytes, (long long)statistics.liveAllocations, (unsigned long long)statistics.totalAllocations);
+		stream << line;
+	}
+
+	struct Stack
+	{
+		MemoryTag tag;
+		uint64 samples;
+		string frames;
+	};
+	vector<Stack> stacks;
+	for (StackSample const& sample : samples)
+	{
+		Stack stack = { sample.tag, sample.samples, string() };
+		for (uint32 i = 0; i < sample.frameCount; ++i)
+		{
+			stack.frames += "  " + DescribeFrame(sample.frames[i]) + "\n";
+		}
+		stacks.push_back(move(stack));
+	}
+	sort(stacks.begin(), stacks.end(), [](Stack const& a, Stack const& b)
+	{
+		return a.tag != b.tag ? a.tag < b.tag : a.samples != b.samples ? a.samples > b.samples : a.frames < b.frames;
+	});
+	snprintf(line, sizeof(line), "# sampled stacks, bytes are samples * interval, %llu samples dropped\n", (unsigned long long)dropped);
+	stream << line;
+	for (Stack const& stack : stacks)
+	{
+		snprintf(line, sizeof(line), "stack %s %llu\n", GetMemoryTagName(stack.tag), (unsigned long long)(stack.samples * interval));
+		stream << line << stack.frames;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "BasicType.h"
+#include <cstddef>
+#include <ostream>
+
+namespace X
+{
+	/*
+	*	Subsystem an allocation is charged to. Set with MemoryTagScope, allocations outside any scope are Untagged.
+	*/
+	enum class MemoryTag : uint8
+	{
+		Untagged,
+		Render,
+		Simulation,
+		AI,
+		UI,
+		Assets,
+		Count,
+	};
+
+	char const* GetMemoryTagName(MemoryTag tag);
+
+	/*
+	*	Charges everything the current thread allocates to tag until the scope ends. Scopes nest.
+	*/
+	class MemoryTagScope
+	{
+	public:
+		explicit MemoryTagScope(MemoryTag tag);
+		~MemoryTagScope();
+		MemoryTagScope(MemoryTagScope const&) = delete;
+		MemoryTagScope& operator=(MemoryTagScope const&) = delete;
+
+	private:
+		MemoryTag _previous;
+	};
+
+	struct MemoryTagStatistics
+	{
+		sint64 bytes;
+		sint64 peakBytes;
+		sint64 liveAllocations;
+		uint64 totalAllocations;
+		uint64 lastFrameAllocations;
+		uint64 lastFrameBytes;			// allocated in the previous frame, not what is still alive
+	};
+
+	/*
+	*	Tracks every operator new and delete of the program, so it sees the STL and our own objects alike. Each block
+	*	carries a small header with its size and tag. ImGui allocates from a private heap and reports its blocks through
+	*	RecordAllocation and RecordFree, without stacks.
+	*
+	*	One allocation in about every sample interval bytes has its call stack recorded. A stack sampled once stands for
+	*	sample interval bytes, the usual statistical heap profile.
+	*
+	*	Define SRPG_NO_MEMORY_TRACKING to leave the global heap alone, the statistics then stay zero.
+	*/
+	class MemoryTracker
+	{
+	public:
+		static bool IsEnabled();
+
+		/*
+		*	Call once per frame, closes the per frame allocation counts.
+		*/
+		static void BeginFrame();
+
+		static MemoryTagStatistics GetStatistics(MemoryTag tag);
+		static uint64 GetFrame();
+
+		/*
+		*	For memory that does not come from operator new, e.g. a private heap.
+		*/
+		static void RecordAllocation(MemoryTag tag, size_t bytes);
+		static void RecordFree(MemoryTag tag, size_t bytes);
+
+		/*
+		*	@bytes: 0 stops sampling.
+		*/
+		static void SetSampleInterval(uint64 bytes);
+
+		/*
+		*	Text report of the tags and the sampled stacks, sorted so two snapshots can be diffed.
+		*/
+		static void WriteSnapshot(std::ostream& stream);
+	};
+}
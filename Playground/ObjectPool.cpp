@@ -0,0 +1,123 @@
+#include "ObjectPool.h"
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+using namespace X;
+
+template <bool ThreadSafe>
+SizeClassPool<ThreadSafe>& SizeClassPool<ThreadSafe>::Instance()
+{
+	if (ThreadSafe)
+	{
+		static SizeClassPool* shared = new SizeClassPool();
+		return *shared;
+	}
+	// Without the lock every thread needs free lists of its own.
+	static thread_local SizeClassPool* own = new SizeClassPool();
+	return *own;
+}
+
+template <bool ThreadSafe>
+void SizeClassPool<ThreadSafe>::Lock() const
+{
+	if (ThreadSafe)
+	{
+		while (_lock.test_and_set(memory_order_acquire))
+		{
+		}
+	}
+}
+
+template <bool ThreadSafe>
+void SizeClassPool<ThreadSafe>::Unlock() const
+{
+	if (ThreadSafe)
+	{
+		_lock.clear(memory_order_release);
+	}
+}
+
+template <bool ThreadSafe>
+void* SizeClassPool<ThreadSafe>::Allocate(size_t size)
+{
+	if (size == 0 || size > MaxSize)
+	{
+		return ::operator new(size);
+	}
+	size_t index = (size - 1) / Granularity;
+
+	Lock();
+	SizeClass& sizeClass = _classes[index];
+	void* memory;
+	if (sizeClass.free)
+	{
+		memory = sizeClass.free;
+		sizeClass.free = sizeClass.free->next;
+	}
+	else
+	{
+		size_t blockSize = (index + 1) * Granularity;
+		if (sizeClass.bump == sizeClass.bumpEnd)
+		{
+			// Blocks are handed out from the new chunk one by one instead of threading it onto the free list up front.
+			uint8* chunk = static_cast<uint8*>(malloc(ChunkSize));
+			if (!chunk)
+			{
+				Unlock();
+				throw bad_alloc();
+			}
+			_chunks.push_back(chunk);
+			sizeClass.bump = chunk;
+			sizeClass.bumpEnd = chunk + ChunkSize / blockSize * blockSize;
+		}
+		memory = sizeClass.bump;
+		sizeClass.bump += blockSize;
+	}
+	++sizeClass.live;
+	Unlock();
+	return memory;
+}
+
+template <bool ThreadSafe>
+void SizeClassPool<ThreadSafe>::Free(void* memory, size_t size)
+{
+	if (!memory)
+	{
+		return;
+	}
+	if (size == 0 || size > MaxSize)
+	{
+		::operator delete(memory);
+		return;
+	}
+	size_t index = (size - 1) / Granularity;
+
+	Lock();
+	SizeClass& sizeClass = _classes[index];
+	FreeBlock* block = static_cast<FreeBlock*>(memory);
+	block->next = sizeClass.free;
+	sizeClass.free = block;
+	--sizeClass.live;
+	Unlock();
+}
+
+template <bool ThreadSafe>
+typename SizeClassPool<ThreadSafe>::Statistics SizeClassPool<ThreadSafe>::GetStatistics() const
+{
+	Statistics statistics;
+	Lock();
+	statistics.chunks = uint32(_chunks.size());
+	for (size_t i = 0; i < ClassCount; ++i)
+	{
+		statistics.liveBlocks[i] = _classes[i].live;
+	}
+	Unlock();
+	return statistics;
+}
+
+namespace X
+{
+	template class SizeClassPool<true>;
+	template class SizeClassPool<false>;
+}
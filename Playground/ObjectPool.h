@@ -0,0 +1,90 @@
+#pragma once
+#include "BasicType.h"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Free lists of fixed size blocks in 16 byte steps up to 256 bytes, carved from 64 KB chunks that are never returned.
+	*	Larger sizes go to the global heap.
+	*
+	*	ThreadSafe = false drops the lock and gives every thread a pool of its own. Only use it for objects that are created
+	*	and released on one thread, the same rule as ReferenceCountBase<false>. The pool of a thread that ends is kept with
+	*	its chunks, like the shared one.
+	*/
+	template <bool ThreadSafe>
+	class SizeClassPool
+	{
+	public:
+		enum : size_t
+		{
+			Granularity = 16,
+			MaxSize = 256,
+			ClassCount = MaxSize / Granularity,
+			ChunkSize = 64 * 1024,
+		};
+
+		struct Statistics
+		{
+			uint32 chunks;
+			uint32 liveBlocks[ClassCount];
+		};
+
+		/*
+		*	Never destroyed, pooled objects may outlive any static. For ThreadSafe = false the one of the calling thread.
+		*/
+		static SizeClassPool& Instance();
+
+		void* Allocate(size_t size);
+		void Free(void* memory, size_t size);
+
+		Statistics GetStatistics() const;
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		struct SizeClass
+		{
+			FreeBlock* free = nullptr;
+			uint8* bump = nullptr;
+			uint8* bumpEnd = nullptr;
+			uint32 live = 0;
+		};
+
+		void Lock() const;
+		void Unlock() const;
+
+		SizeClass _classes[ClassCount];
+		std::vector<void*> _chunks;
+		mutable std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+	};
+
+	/*
+	*	Derive a ReferenceCountBase object from it as well to have CreatePtr take its memory from the pool:
+	*
+	*	class Unit : public ReferenceCountBase<false>, public PoolAllocated<false>
+	*
+	*	Use the same ThreadSafe for both. Delete relies on the virtual destructor of ReferenceCountBase for the size.
+	*/
+	template <bool ThreadSafe>
+	class PoolAllocated
+	{
+	public:
+		static void* operator new(size_t size)
+		{
+			return SizeClassPool<ThreadSafe>::Instance().Allocate(size);
+		}
+		static void operator delete(void* memory, size_t size)
+		{
+			SizeClassPool<ThreadSafe>::Instance().Free(memory, size);
+		}
+	};
+
+	extern template class SizeClassPool<true>;
+	extern template class SizeClassPool<false>;
+}
@@ -0,0 +1,308 @@
+#include "PakFile.h"
+#include "LZ4.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint64 AlignUp(uint64 value)
+	{
+		return (value + PakAlignment - 1) & ~uint64(PakAlignment - 1);
+	}
+
+	bool IsInside(uint64 offset, uint64 size, uint64 fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+
+	template <class T>
+	void Append(vector<uint8>& file, T const& value)
+	{
+		uint8 const* bytes = reinterpret_cast<uint8 const*>(&value);
+		file.insert(file.end(), bytes, bytes + sizeof(T));
+	}
+}
+
+string X::NormalizePakPath(string const& path)
+{
+	string normalized = path;
+	for (char& c : normalized)
+	{
+		if (c == '\\')
+		{
+			c = '/';
+		}
+		else if (c >= 'A' && c <= 'Z')
+		{
+			c = char(c - 'A' + 'a');
+		}
+	}
+	return normalized;
+}
+
+uint64 X::HashPakPath(string const& normalizedPath)
+{
+	// FNV-1a
+	uint64 hash = 14695981039346656037ull;
+	for (char c : normalizedPath)
+	{
+		hash = (hash ^ uint8(c)) * 1099511628211ull;
+	}
+	return hash;
+}
+
+PakFile::PakFile(Ptr<MappedFile> mapped) :
+	_mapped(move(mapped))
+{
+	_data = _mapped->GetData();
+	_header = reinterpret_cast<PakHeader const*>(_data);
+	_entries = reinterpret_cast<PakEntry const*>(_data + _header->entriesOffset);
+	_blocks = reinterpret_cast<PakBlock const*>(_data + _header->blocksOffset);
+	_names = reinterpret_cast<char const*>(_data + _header->namesOffset);
+}
+
+Ptr<PakFile> PakFile::Open(string const& path)
+{
+	Ptr<MappedFile> mapped = MappedFile::Open(path);
+	if (!mapped || mapped->GetSize() < sizeof(PakHeader))
+	{
+		return nullptr;
+	}
+	Ptr<PakFile> pak = CreatePtr<PakFile>(mapped);
+	if (!pak->CheckTables())
+	{
+		return nullptr;
+	}
+	return pak;
+}
+
+bool PakFile::CheckTables() const
+{
+	PakHeader const& header = *_header;
+	uint64 size = _mapped->GetSize();
+	return header.magic == PakMagic && header.version == PakVersion && header.headerSize == sizeof(PakHeader) && header.fileSize == size &&
+		header.entriesOffset % 8 == 0 && IsInside(header.entriesOffset, uint64(header.entryCount) * sizeof(PakEntry), size) &&
+		header.blocksOffset % 8 == 0 && IsInside(header.blocksOffset, uint64(header.blockCount) * sizeof(PakBlock), size) &&
+		IsInside(header.namesOffset, header.namesSize, size) && (header.namesSize == 0 || _names[header.namesSize - 1] == 0);
+}
+
+PakEntry const* PakFile::Find(string const& path) const
+{
+	string normalized = NormalizePakPath(path);
+	uint64 hash = HashPakPath(normalized);
+	PakEntry const* end = _entries + _header->entryCount;
+	PakEntry const* entry = lower_bound(_entries, end, hash, [](PakEntry const& entry, uint64 hash)
+	{
+		return entry.hash < hash;
+	});
+	// The hash alone could match a path that is not in the pak.
+	if (entry == end || entry->hash != hash || entry->nameOffset >= _header->namesSize || normalized != _names + entry->nameOffset)
+	{
+		return nullptr;
+	}
+	return entry;
+}
+
+bool PakFile::ReadEntry(PakEntry const& entry, vector<uint8>& data) const
+{
+	uint64 fileSize = _header->fileSize;
+	if (entry.flags & PakEntryFlag_Stored)
+	{
+		if (!IsInside(entry.offset, entry.size, fileSize))
+		{
+			return false;
+		}
+		data.assign(_data + entry.offset, _data + entry.offset + entry.size);
+		return true;
+	}
+
+	if (!IsInside(entry.firstBlock, entry.blockCount, _header->blockCount))
+	{
+		return false;
+	}
+	data.resize(size_t(entry.size));
+	uint64 written = 0;
+	for (uint32 index = 0; index < entry.blockCount; ++index)
+	{
+		PakBlock const& block = _blocks[entry.firstBlock + index];
+		if (!IsInside(block.offset, block.compressedSize, fileSize) || !IsInside(written, block.size, entry.size))
+		{
+			return false;
+		}
+		if (block.compressedSize == block.size)
+		{
+			memcpy(data.data() + written, _data + block.offset, block.size);
+		}
+		else if (!LZ4Decompress(_data + block.offset, block.compressedSize, data.data() + written, block.size))
+		{
+			return false;
+		}
+		written += block.size;
+	}
+	return written == entry.size;
+}
+
+bool PakFile::Contains(string const& path) const
+{
+	return Find(path) != nullptr;
+}
+
+bool PakFile::Read(string const& path, vector<uint8>& data) const
+{
+	PakEntry const* entry = Find(path);
+	return entry && ReadEntry(*entry, data);
+}
+
+void PakFile::ReadAsync(JobSystem& jobs, string const& path, ReadCallback callback, JobCounter* counter) const
+{
+	jobs.Run([this, path, callback]
+	{
+		vector<uint8> data;
+		bool succeeded = Read(path, data);
+		callback(succeeded, move(data));
+	}, counter);
+}
+
+uint8 const* PakFile::GetStoredData(string const& path, size_t& size) const
+{
+	PakEntry const* entry = Find(path);
+	if (!entry || !(entry->flags & PakEntryFlag_Stored) || !IsInside(entry->offset, entry->size, _header->fileSize))
+	{
+		return nullptr;
+	}
+	size = size_t(entry->size);
+	return _data + entry->offset;
+}
+
+char const* PakFile::GetEntryName(uint32 index) const
+{
+	return _names + _entries[index].nameOffset;
+}
+
+PakWriter::PakWriter(uint32 blockSize) :
+	_blockSize(blockSize)
+{
+}
+
+void PakWriter::Add(string const& path, vector<uint8> data, bool compress)
+{
+	_sources.push_back({ NormalizePakPath(path), move(data), compress });
+}
+
+string PakWriter::Build(vector<uint8>& file) const
+{
+	vector<uint32> order(_sources.size());
+	vector<uint64> hashes(_sources.size());
+	for (uint32 index = 0; index < _sources.size(); ++index)
+	{
+		order[index] = index;
+		hashes[index] = HashPakPath(_sources[index].path);
+	}
+	sort(order.begin(), order.end(), [&](uint32 a, uint32 b)
+	{
+		return hashes[a] < hashes[b];
+	});
+	for (size_t index = 1; index < order.size(); ++index)
+	{
+		if (hashes[order[index - 1]] == hashes[order[index]])
+		{
+			Source const& a = _sources[order[index - 1]];
+			Source const& b = _sources[order[index]];
+			return a.path == b.path ? "duplicate path " + a.path : "hash collision between " + a.path + " and " + b.path;
+		}
+	}
+
+	PakHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PakMagic;
+	header.version = PakVersion;
+	header.headerSize = sizeof(PakHeader);
+	header.blockSize = _blockSize;
+	header.entryCount = uint32(_sources.size());
+
+	file.assign(size_t(AlignUp(sizeof(PakHeader))), 0);
+	vector<PakEntry> entries;
+	vector<PakBlock> blocks;
+	string names;
+	vector<uint8> compressed(LZ4CompressBound(_blockSize));
+	for (uint32 index : order)
+	{
+		Source const& source = _sources[index];
+		PakEntry entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.hash = hashes[index];
+		entry.size = source.data.size();
+		entry.nameOffset = uint32(names.size());
+		names.append(source.path.c_str(), source.path.size() + 1);
+
+		if (!source.compress)
+		{
+			entry.flags = PakEntryFlag_Stored;
+			file.resize(size_t(AlignUp(file.size())), 0);
+			entry.offset = file.size();
+			file.insert(file.end(), source.data.begin(), source.data.end());
+		}
+		else
+		{
+			entry.firstBlock = uint32(blocks.size());
+			for (size_t offset = 0; offset < source.data.size(); offset += _blockSize)
+			{
+				PakBlock block;
+				block.offset = file.size();
+				block.size = uint32(min<size_t>(_blockSize, source.data.size() - offset));
+				uint8 const* raw = source.data.data() + offset;
+				// Keep the block raw unless compression saves something.
+				size_t compressedSize = LZ4Compress(raw, block.size, compressed.data(), block.size - 1);
+				if (compressedSize == 0)
+				{
+					block.compressedSize = block.size;
+					file.insert(file.end(), raw, raw + block.size);
+				}
+				else
+				{
+					block.compressedSize = uint32(compressedSize);
+					file.insert(file.end(), compressed.begin(), compressed.begin() + compressedSize);
+				}
+				blocks.push_back(block);
+			}
+			entry.blockCount = uint32(blocks.size()) - entry.firstBlock;
+		}
+		entries.push_back(entry);
+	}
+
+	file.resize(size_t(AlignUp(file.size())), 0);
+	header.blocksOffset = file.size();
+	header.blockCount = uint32(blocks.size());
+	for (PakBlock const& block : blocks)
+	{
+		Append(file, block);
+	}
+	header.entriesOffset = file.size();
+	for (PakEntry const& entry : entries)
+	{
+		Append(file, entry);
+	}
+	header.namesOffset = file.size();
+	header.namesSize = uint32(names.size());
+	file.insert(file.end(), names.begin(), names.end());
+	header.fileSize = file.size();
+	memcpy(file.data(), &header, sizeof(header));
+	return string();
+}
+
+string PakWriter::Save(string const& path) const
+{
+	vector<uint8> file;
+	string error = Build(file);
+	if (!error.empty())
+	{
+		return error;
+	}
+	ofstream output(path, ios::binary);
+	output.write(reinterpret_cast<char const*>(file.data()), file.size());
+	return output ? string() : "can not write " + path;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Pak layout, little-endian, offsets from the start of the file:
+	*
+	*	header | entry data | block table | entry table | names
+	*
+	*	Compressed entries are split into blocks of up to blockSize bytes that are LZ4 compressed on their own,
+	*	blocks that do not get smaller are kept raw. Stored entries are one uncompressed range aligned to
+	*	PakAlignment, so they can be used in place from the mapping.
+	*	Entries are sorted by the hash of their normalized path.
+	*/
+	uint32 const PakMagic = 0x4B415053;	// "SPAK"
+	uint16 const PakVersion = 1;
+	uint32 const PakAlignment = 64;
+
+	enum PakEntryFlags : uint32
+	{
+		PakEntryFlag_Stored = 1 << 0,
+	};
+
+	struct PakHeader
+	{
+		uint32 magic;
+		uint16 version;
+		uint16 headerSize;
+		uint64 fileSize;
+		uint32 blockSize;
+		uint32 entryCount;
+		uint32 blockCount;
+		uint32 namesSize;
+		uint64 entriesOffset;
+		uint64 blocksOffset;
+		uint64 namesOffset;
+	};
+
+	struct PakEntry
+	{
+		uint64 hash;
+		uint64 offset;		// stored entries only
+		uint64 size;		// uncompressed
+		uint32 firstBlock;
+		uint32 blockCount;
+		uint32 nameOffset;	// null terminated, relative to the names section
+		uint32 flags;
+	};
+
+	struct PakBlock
+	{
+		uint64 offset;
+		uint32 compressedSize;	// equal to size for raw blocks
+		uint32 size;
+	};
+
+	static_assert(sizeof(PakHeader) == 56, "PakHeader is part of the file format");
+	static_assert(sizeof(PakEntry) == 40, "PakEntry is part of the file format");
+	static_assert(sizeof(PakBlock) == 16, "PakBlock is part of the file format");
+
+	/*
+	*	Paths are looked up case-insensitively with either slash, the pak keeps the normalized form.
+	*/
+	std::string NormalizePakPath(std::string const& path);
+	uint64 HashPakPath(std::string const& normalizedPath);
+
+	/*
+	*	Reads entries of a mapped pak. All methods are const and may be called from any thread.
+	*/
+	class PakFile : public ReferenceCountBase<true>
+	{
+	public:
+		typedef std::function<void(bool succeeded, std::vector<uint8> data)> ReadCallback;
+
+		/*
+		*	@return: nullptr if the file can not be mapped or its header and tables do not fit into it.
+		*/
+		static Ptr<PakFile> Open(std::string const& path);
+
+		bool Contains(std::string const& path) const;
+
+		/*
+		*	@return: false if there is no such entry or it is corrupt.
+		*/
+		bool Read(std::string const& path, std::vector<uint8>& data) const;
+
+		/*
+		*	Reads and decompresses on the job system, callback is called on the worker thread.
+		*	The pak has to stay alive until the job is done.
+		*	@counter: may be nullptr.
+		*/
+		void ReadAsync(JobSystem& jobs, std::string const& path, ReadCallback callback, JobCounter* counter) const;
+
+		/*
+		*	Zero copy access to stored entries.
+		*	@return: nullptr if there is no such entry or it is compressed.
+		*/
+		uint8 const* GetStoredData(std::string const& path, size_t& size) const;
+
+		uint32 GetEntryCount() const
+		{
+			return _header->entryCount;
+		}
+		char const* GetEntryName(uint32 index) const;
+
+		explicit PakFile(Ptr<MappedFile> mapped);
+
+	private:
+		bool CheckTables() const;
+		PakEntry const* Find(std::string const& path) const;
+		bool ReadEntry(PakEntry const& entry, std::vector<uint8>& data) const;
+
+		Ptr<MappedFile> _mapped;
+		uint8 const* _data;
+		PakHeader const* _header;
+		PakEntry const* _entries;
+		PakBlock const* _blocks;
+		char const* _names;
+	};
+
+	/*
+	*	Collects files and writes them as one pak.
+	*/
+	class PakWriter
+	{
+	public:
+		explicit PakWriter(uint32 blockSize = 64 * 1024);
+
+		/*
+		*	@compress: false stores the entry uncompressed so it can be used in place through GetStoredData.
+		*/
+		void Add(std::string const& path, std::vector<uint8> data, bool compress = true);
+
+		/*
+		*	@return: empty on success, otherwise the reason, e.g. two paths with the same hash.
+		*/
+		std::string Build(std::vector<uint8>& file) const;
+		std::string Save(std::string const& path) const;
+
+	private:
+		struct Source
+		{
+			std::string path;
+			std::vector<uint8> data;
+			bool compress;
+		};
+
+		uint32 _blockSize;
+		std::vector<Source> _sources;
+	};
+}
@@ -0,0 +1,251 @@
+#include "ParticleSystem.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <emmintrin.h>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	// Multiple of 4 so that every range handed to the SSE kernel starts on a full lane group.
+	uint32 const UpdateGrainSize = 4096;
+	uint32 const WriteGrainSize = 2048;
+	// Positions transformed at once on the stack before they are expanded to quads.
+	uint32 const WriteChunkSize = 256;
+
+	uint32 LerpColor(uint32 from, uint32 to, float32 t)
+	{
+		uint32 result = 0;
+		for (uint32 shift = 0; shift < 32; shift += 8)
+		{
+			float32 a = float32((from >> shift) & 0xFF);
+			float32 b = float32((to >> shift) & 0xFF);
+			result |= uint32(a + (b - a) * t + 0.5f) << shift;
+		}
+		return result;
+	}
+}
+
+ParticleSystem::ParticleSystem(uint32 budget) :
+	_budget(budget),
+	_aliveCount(0),
+	_throttledCount(0),
+	_randomState(0x2545F491)
+{
+}
+
+ParticleSystem::EmitterTypeID ParticleSystem::RegisterEmitterType(ParticleEmitterDesc const& desc)
+{
+	Pool pool;
+	pool.desc = desc;
+	pool.count = 0;
+	pool.emitCarry = 0;
+
+	// Round up so the kernel can always load whole lane groups, the extra slots are never alive.
+	uint32 paddedCapacity = (desc.capacity + 3) & ~3u;
+	pool.x.resize(paddedCapacity);
+	pool.y.resize(paddedCapacity);
+	pool.velocityX.resize(paddedCapacity);
+	pool.velocityY.resize(paddedCapacity);
+	pool.age.resize(paddedCapacity);
+	pool.lifetime.resize(paddedCapacity, 1.0f);
+
+	_pools.push_back(move(pool));
+	return EmitterTypeID(_pools.size() - 1);
+}
+
+void ParticleSystem::SetBudget(uint32 budget)
+{
+	_budget = budget;
+}
+
+uint32 ParticleSystem::Emit(EmitterTypeID type, float32 x, float32 y, uint32 count)
+{
+	Pool& pool = _pools[type];
+	ParticleEmitterDesc const& desc = pool.desc;
+
+	float32 wanted = float32(count);
+	if (desc.priority > 0 && _budget > 0)
+	{
+		float32 pressure = float32(_aliveCount) / float32(_budget);
+		if (pressure > 0.5f)
+		{
+			float32 scale = max(0.0f, (1.0f - pressure) * 2.0f);
+			wanted *= powf(scale, float32(desc.priority));
+		}
+	}
+	// Keep the fractional part so that a steady trickle of single particles degrades smoothly instead of stopping.
+	wanted += pool.emitCarry;
+	uint32 spawn = uint32(wanted);
+	pool.emitCarry = wanted - float32(spawn);
+
+	uint32 budgetLeft = _budget > _aliveCount ? _budget - _aliveCount : 0;
+	spawn = min(spawn, min(budgetLeft, desc.capacity - pool.count));
+	_throttledCount += count > spawn ? count - spawn : 0;
+
+	for (uint32 i = 0; i < spawn; ++i)
+	{
+		uint32 index = pool.count + i;
+		float32 angle = NextRandom(desc.minAngle, desc.maxAngle);
+		float32 speed = NextRandom(desc.minSpeed, desc.maxSpeed);
+		pool.x[index] = x;
+		pool.y[index] = y;
+		pool.velocityX[index] = cosf(angle) * speed;
+		pool.velocityY[index] = sinf(angle) * speed;
+		pool.age[index] = 0;
+		pool.lifetime[index] = NextRandom(desc.minLifetime, desc.maxLifetime);
+	}
+	pool.count += spawn;
+	_aliveCount += spawn;
+	return spawn;
+}
+
+void ParticleSystem::Update(float32 deltaTime, JobSystem* jobs)
+{
+	for (auto& pool : _pools)
+	{
+		if (jobs)
+		{
+			jobs->ParallelFor(pool.count, UpdateGrainSize, [this, &pool, deltaTime](uint32 begin, uint32 end)
+			{
+				UpdatePool(pool, begin, end, deltaTime);
+			});
+		}
+		else
+		{
+			UpdatePool(pool, 0, pool.count, deltaTime);
+		}
+	}
+
+	_aliveCount = 0;
+	for (auto& pool : _pools)
+	{
+		CompactPool(pool);
+		_aliveCount += pool.count;
+	}
+}
+
+void ParticleSystem::UpdatePool(Pool& pool, uint32 begin, uint32 end, float32 deltaTime)
+{
+	ParticleEmitterDesc const& desc = pool.desc;
+	float32 damping = max(0.0f, 1.0f - desc.drag * deltaTime);
+
+	__m128 const dt = _mm_set1_ps(deltaTime);
+	__m128 const damp = _mm_set1_ps(damping);
+	__m128 const gravityX = _mm_set1_ps(desc.gravityX * deltaTime);
+	__m128 const gravityY = _mm_set1_ps(desc.gravityY * deltaTime);
+
+	// Lanes past count belong to dead slots inside the padded capacity, integrating them is harmless.
+	end = (end + 3) & ~3u;
+	for (uint32 i = begin; i < end; i += 4)
+	{
+		__m128 vx = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&pool.velocityX[i]), damp), gravityX);
+		__m128 vy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&pool.velocityY[i]), damp), gravityY);
+		_mm_storeu_ps(&pool.velocityX[i], vx);
+		_mm_storeu_ps(&pool.velocityY[i], vy);
+		_mm_storeu_ps(&pool.x[i], _mm_add_ps(_mm_loadu_ps(&pool.x[i]), _mm_mul_ps(vx, dt)));
+		_mm_storeu_ps(&pool.y[i], _mm_add_ps(_mm_loadu_ps(&pool.y[i]), _mm_mul_ps(vy, dt)));
+		_mm_storeu_ps(&pool.age[i], _mm_add_ps(_mm_loadu_ps(&pool.age[i]), dt));
+	}
+}
+
+// Swap-remove: a dead particle is overwritten by the last alive one, order is not preserved.
+void ParticleSystem::CompactPool(Pool& pool)
+{
+	uint32 count = pool.count;
+	uint32 i = 0;
+	while (i < count)
+	{
+		if (pool.age[i] >= pool.lifetime[i])
+		{
+			--count;
+			pool.x[i] = pool.x[count];
+			pool.y[i] = pool.y[count];
+			pool.velocityX[i] = pool.velocityX[count];
+			pool.velocityY[i] = pool.velocityY[count];
+			pool.age[i] = pool.age[count];
+			pool.lifetime[i] = pool.lifetime[count];
+		}
+		else
+		{
+			++i;
+		}
+	}
+	pool.count = count;
+}
+
+void ParticleSystem::WriteVertices(ParticleVertex* dst, Transform2D const& view, JobSystem* jobs) const
+{
+	for (auto const& pool : _pools)
+	{
+		if (jobs)
+		{
+			jobs->ParallelFor(pool.count, WriteGrainSize, [this, &pool, &view, dst](uint32 begin, uint32 end)
+			{
+				WritePool(pool, view, dst, begin, end);
+			});
+		}
+		else
+		{
+			WritePool(pool, view, dst, 0, pool.count);
+		}
+		dst += pool.count * 4;
+	}
+}
+
+void ParticleSystem::WritePool(Pool const& pool, Transform2D const& view, ParticleVertex* dst, uint32 begin, uint32 end) const
+{
+	ParticleEmitterDesc const& desc = pool.desc;
+	// The area scale of the view, a rotation does not turn the quads.
+	float32 sizeScale = sqrtf(fabsf(view.a * view.d - view.b * view.c)) * 0.5f;
+	float32 viewX[WriteChunkSize], viewY[WriteChunkSize];
+	for (uint32 chunk = begin; chunk < end; chunk += WriteChunkSize)
+	{
+		uint32 chunkEnd = min(end, chunk + WriteChunkSize);
+		TransformPoints(view, &pool.x[chunk], &pool.y[chunk], viewX, viewY, chunkEnd - chunk);
+		for (uint32 i = chunk; i < chunkEnd; ++i)
+		{
+			float32 t = pool.age[i] / pool.lifetime[i];
+			float32 halfSize = (desc.startSize + (desc.endSize - desc.startSize) * t) * sizeScale;
+			uint32 color = LerpColor(desc.startColor, desc.endColor, t);
+			float32 left = viewX[i - chunk] - halfSize;
+			float32 right = viewX[i - chunk] + halfSize;
+			float32 top = viewY[i - chunk] - halfSize;
+			float32 bottom = viewY[i - chunk] + halfSize;
+
+			ParticleVertex* quad = dst + i * 4;
+			quad[0] = { left, top, desc.u0, desc.v0, color };
+			quad[1] = { right, top, desc.u1, desc.v0, color };
+			quad[2] = { right, bottom, desc.u1, desc.v1, color };
+			quad[3] = { left, bottom, desc.u0, desc.v1, color };
+		}
+	}
+}
+
+void ParticleSystem::BuildQuadIndices(uint16* dst, uint32 quadCount)
+{
+	assert(quadCount * 4 <= 0x10000);
+	for (uint32 i = 0; i < quadCount; ++i)
+	{
+		uint16 base = uint16(i * 4);
+		dst[0] = base;
+		dst[1] = uint16(base + 1);
+		dst[2] = uint16(base + 2);
+		dst[3] = base;
+		dst[4] = uint16(base + 2);
+		dst[5] = uint16(base + 3);
+		dst += 6;
+	}
+}
+
+// xorshift32, the same sequence on every platform.
+float32 ParticleSystem::NextRandom(float32 min, float32 max)
+{
+	_randomState ^= _randomState << 13;
+	_randomState ^= _randomState >> 17;
+	_randomState ^= _randomState << 5;
+	return min + (max - min) * float32(_randomState >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "BasicType.h"
+#include "VectorMath.h"
+#include <vector>
+
+namespace X
+{
+	class JobSystem;
+
+	/*
+	*	Same layout as ImDrawVert, so particles can be drawn with the IMGUI input layout and shaders.
+	*/
+	struct ParticleVertex
+	{
+		float32 x, y;
+		float32 u, v;
+		uint32 color;
+	};
+
+	struct ParticleEmitterDesc
+	{
+		uint32 capacity;				// most particles of this type alive at once
+		uint32 priority;				// 0 is never throttled, higher values are throttled earlier when the budget runs low
+		float32 minLifetime, maxLifetime;
+		float32 minSpeed, maxSpeed;
+		float32 minAngle, maxAngle;		// radians, direction of the initial velocity
+		float32 gravityX, gravityY;
+		float32 drag;					// fraction of the velocity lost per second
+		float32 startSize, endSize;
+		uint32 startColor, endColor;	// packed like ImGui colors
+		float32 u0, v0, u1, v1;			// sprite rectangle in the texture
+	};
+
+	/*
+	*	Particles of each emitter type live in their own structure of arrays pool.
+	*	Update integrates the pools with SSE on the job system and swap-removes dead particles,
+	*	WriteVertices then expands the survivors to quads straight into mapped vertex memory.
+	*/
+	class ParticleSystem
+	{
+	public:
+		typedef uint32 EmitterTypeID;
+
+		/*
+		*	@budget: most particles alive at once over all emitter types.
+		*/
+		explicit ParticleSystem(uint32 budget);
+
+		EmitterTypeID RegisterEmitterType(ParticleEmitterDesc const& desc);
+
+		/*
+		*	Above half of the budget, emission of types with priority > 0 is scaled down until it reaches zero at the full budget.
+		*	Types with priority 0 keep emitting until the budget is exhausted.
+		*/
+		void SetBudget(uint32 budget);
+		uint32 GetBudget() const
+		{
+			return _budget;
+		}
+
+		/*
+		*	@return: number of particles actually spawned.
+		*/
+		uint32 Emit(EmitterTypeID type, float32 x, float32 y, uint32 count);
+
+		/*
+		*	@jobs: may be nullptr to update on the calling thread.
+		*/
+		void Update(float32 deltaTime, JobSystem* jobs);
+
+		uint32 GetAliveCount() const
+		{
+			return _aliveCount;
+		}
+		uint32 GetVertexCount() const
+		{
+			return _aliveCount * 4;
+		}
+		uint32 GetIndexCount() const
+		{
+			return _aliveCount * 6;
+		}
+		/*
+		*	Requested particles that were not spawned because of the budget.
+		*/
+		uint64 GetThrottledCount() const
+		{
+			return _throttledCount;
+		}
+
+		/*
+		*	Writes GetVertexCount() vertices, 4 per particle in the order top left, top right, bottom right, bottom left.
+		*	dst is usually memory mapped from a DynamicVertexRing, see BuildQuadIndices for the matching index buffer.
+		*	@view: from the particle positions to the vertex positions, usually the camera. The quads stay upright and
+		*	are only scaled by it.
+		*/
+		void WriteVertices(ParticleVertex* dst, Transform2D const& view, JobSystem* jobs) const;
+
+		/*
+		*	16 bit indices cover 16384 quads, draw larger vertex ranges in batches with a base vertex.
+		*/
+		static void BuildQuadIndices(uint16* dst, uint32 quadCount);
+
+	private:
+		struct Pool
+		{
+			ParticleEmitterDesc desc;
+			uint32 count;
+			float32 emitCarry;
+
+			std::vector<float32> x;
+			std::vector<float32> y;
+			std::vector<float32> velocityX;
+			std::vector<float32> velocityY;
+			std::vector<float32> age;
+			std::vector<float32> lifetime;
+		};
+
+		void UpdatePool(Pool& pool, uint32 begin, uint32 end, float32 deltaTime);
+		void CompactPool(Pool& pool);
+		void WritePool(Pool const& pool, Transform2D const& view, ParticleVertex* dst, uint32 begin, uint32 end) const;
+		float32 NextRandom(float32 min, float32 max);
+
+		std::vector<Pool> _pools;
+		uint32 _budget;
+		uint32 _aliveCount;
+		uint64 _throttledCount;
+		uint32 _randomState;
+	};
+}
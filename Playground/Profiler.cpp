@@ -0,0 +1,364 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const RingSize = 16384;
+	uint32 const FrameRingSize = 256;
+
+	// Fields are relaxed atomics so a reader copying a slot the owner is rewriting is well defined, it is dropped afterwards.
+	struct Slot
+	{
+		atomic<uintptr_t> name;
+		atomic<uint64> startTicks;
+		atomic<uint64> endTicks;
+		atomic<uint32> depth;
+	};
+
+	/*
+	*	Written by one thread only. begun is raised before a slot is rewritten and written after, a reader that copied
+	*	slots between two loads of them knows which of them may be torn.
+	*/
+	struct ThreadRing
+	{
+		Slot slots[RingSize];
+		atomic<uint64> begun{ 0 };
+		atomic<uint64> written{ 0 };
+		atomic<uint64> firstValid{ 0 };
+		atomic<bool> owned{ true };
+		uint32 thread = 0;
+		string name;				// under the registry mutex
+	};
+
+	struct Registry
+	{
+		mutex lock;
+		vector<unique_ptr<ThreadRing>> rings;
+		unordered_set<string> names;
+		unordered_map<wstring, char const*> wideNames;
+		uint32 nextThread = 0;
+
+		atomic<uint64> frames[FrameRingSize];
+		atomic<uint64> frameCount{ 0 };
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	ThreadRing* AcquireRing()
+	{
+		Registry& registry = GetRegistry();
+		lock_guard<mutex> lock(registry.lock);
+		// The ring of a thread that ended is taken over under a new thread number, the zones it still holds are dropped.
+		ThreadRing* ring = nullptr;
+		for (auto& candidate : registry.rings)
+		{
+			if (!candidate->owned.load(memory_order_acquire))
+			{
+				ring = candidate.get();
+				ring->owned.store(true, memory_order_relaxed);
+				ring->firstValid.store(ring->written.load(memory_order_relaxed), memory_order_relaxed);
+				break;
+			}
+		}
+		if (!ring)
+		{
+			registry.rings.push_back(make_unique<ThreadRing>());
+			ring = registry.rings.back().get();
+		}
+		ring->thread = registry.nextThread++;
+		ring->name = "Thread " + to_string(ring->thread);
+		return ring;
+	}
+
+	// Plain thread locals for the zones, only the rarely touched release guard has a destructor.
+	thread_local ThreadRing* threadRing = nullptr;
+	thread_local uint32 threadDepth = 0;
+
+	struct ThreadRingRelease
+	{
+		~ThreadRingRelease()
+		{
+			threadRing->owned.store(false, memory_order_release);
+		}
+	};
+
+	ThreadRing* GetThreadRing()
+	{
+		if (!threadRing)
+		{
+			threadRing = AcquireRing();
+			static thread_local ThreadRingRelease release;
+			(void)release;
+		}
+		return threadRing;
+	}
+
+	struct Calibration
+	{
+		chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+		uint64 ticks = Profiler::GetTicks();
+	} const calibration;
+
+	void WriteJsonString(ostream& stream, char const* text)
+	{
+		stream << '"';
+		for (char const* c = text; *c; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				stream << '\\' << *c;
+			}
+			else if (uint8(*c) < 0x20)
+			{
+				char escaped[8];
+				snprintf(escaped, sizeof(escaped), "\\u%04x", uint32(uint8(*c)));
+				stream << escaped;
+			}
+			else
+			{
+				stream << *c;
+			}
+		}
+		stream << '"';
+	}
+}
+
+uint32& Profiler::GetDepth()
+{
+	return threadDepth;
+}
+
+float64 Profiler::TicksToMilliseconds(sint64 ticks)
+{
+	static atomic<float64> calibrated{ 0 };
+	float64 millisecondsPerTick = calibrated.load(memory_order_relaxed);
+	if (millisecondsPerTick != 0)
+	{
+		return ticks * millisecondsPerTick;
+	}
+	float64 elapsedMs = chrono::duration<float64, milli>(chrono::steady_clock::now() - calibration.clock).count();
+	uint64 elapsedTicks = GetTicks() - calibration.ticks;
+	float64 ratio = elapsedTicks > 0 ? elapsedMs / elapsedTicks : 0;
+	if (elapsedMs > 1000)
+	{
+		calibrated.store(ratio, memory_order_relaxed);
+	}
+	return ticks * ratio;
+}
+
+void Profiler::EndZone(char const* name, uint64 startTicks)
+{
+	uint64 endTicks = GetTicks();
+	uint32 depth = --threadDepth;
+	ThreadRing* ring = GetThreadRing();
+
+	uint64 index = ring->written.load(memory_order_relaxed);
+	ring->begun.store(index + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	Slot& slot = ring->slots[index % RingSize];
+	slot.name.store(reinterpret_cast<uintptr_t>(name), memory_order_relaxed);
+	slot.startTicks.store(startTicks, memory_order_relaxed);
+	slot.endTicks.store(endTicks, memory_order_relaxed);
+	slot.depth.store(depth, memory_order_relaxed);
+	ring->written.store(index + 1, memory_order_release);
+}
+
+void Profiler::SetThreadName(char const* name)
+{
+	ThreadRing* ring = GetThreadRing();
+	lock_guard<mutex> lock(GetRegistry().lock);
+	ring->name = name;
+}
+
+char const* Profiler::InternName(string const& name)
+{
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> lock(registry.lock);
+	// Set elements never move, so the pointer stays valid while more names are added.
+	return registry.names.insert(name).first->c_str();
+}
+
+char const* Profiler::InternName(wchar_t const* name)
+{
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> lock(registry.lock);
+	auto found = registry.wideNames.find(name);
+	if (found != registry.wideNames.end())
+	{
+		return found->second;
+	}
+
+	// UTF-16 on Windows, UTF-32 elsewhere, to UTF-8.
+	string utf8;
+	for (wchar_t const* c = name; *c; ++c)
+	{
+		uint32 codePoint = uint32(*c);
+		if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint < 0xDC00 && c[1] >= 0xDC00 && c[1] < 0xE000)
+		{
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (uint32(c[1]) - 0xDC00);
+			++c;
+		}
+		if (codePoint < 0x80)
+		{
+			utf8 += char(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			utf8 += char(0xC0 | (codePoint >> 6));
+			utf8 += char(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			utf8 += char(0xE0 | (codePoint >> 12));
+			utf8 += char(0x80 | ((codePoint >> 6) & 0x3F));
+			utf8 += char(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			utf8 += char(0xF0 | (codePoint >> 18));
+			utf8 += char(0x80 | ((codePoint >> 12) & 0x3F));
+			utf8 += char(0x80 | ((codePoint >> 6) & 0x3F));
+			utf8 += char(0x80 | (codePoint & 0x3F));
+		}
+	}
+	char const* interned = registry.names.insert(utf8).first->c_str();
+	registry.wideNames.emplace(name, interned);
+	return interned;
+}
+
+void Profiler::MarkFrame()
+{
+	Registry& registry = GetRegistry();
+	uint64 index = registry.frameCount.load(memory_order_relaxed);
+	registry.frames[index % FrameRingSize].store(GetTicks(), memory_order_relaxed);
+	registry.frameCount.store(index + 1, memory_order_release);
+}
+
+vector<uint64> Profiler::GetFrames(uint32 count)
+{
+	Registry& registry = GetRegistry();
+	uint64 frameCount = registry.frameCount.load(memory_order_acquire);
+	uint64 first = frameCount - min<uint64>(frameCount, min(count, FrameRingSize - 1));
+	vector<uint64> frames;
+	for (uint64 i = first; i < frameCount; ++i)
+	{
+		frames.push_back(registry.frames[i % FrameRingSize].load(memory_order_relaxed));
+	}
+	return frames;
+}
+
+vector<ProfileZoneRecord> Profiler::Capture(uint64 sinceTicks)
+{
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> lock(registry.lock);
+	vector<ProfileZoneRecord> zones;
+	for (auto& ring : registry.rings)
+	{
+		size_t ringStart = zones.size();
+		uint64 written = ring->written.load(memory_order_acquire);
+		uint64 first = max(ring->firstValid.load(memory_order_relaxed), written > RingSize ? written - RingSize : 0);
+		for (uint64 index = first; index < written; ++index)
+		{
+			Slot const& slot = ring->slots[index % RingSize];
+			ProfileZoneRecord zone;
+			zone.name = reinterpret_cast<char const*>(slot.name.load(memory_order_relaxed));
+			zone.startTicks = slot.startTicks.load(memory_order_relaxed);
+			zone.endTicks = slot.endTicks.load(memory_order_relaxed);
+			zone.depth = slot.depth.load(memory_order_relaxed);
+			zone.thread = ring->thread;
+			zones.push_back(zone);
+		}
+
+		// Whatever the owner started rewriting meanwhile may be torn.
+		atomic_thread_fence(memory_order_acquire);
+		uint64 begun = ring->begun.load(memory_order_relaxed);
+		uint64 firstIntact = begun > RingSize ? begun - RingSize : 0;
+		size_t keep = ringStart;
+		for (size_t i = ringStart; i < zones.size(); ++i)
+		{
+			if (first + (i - ringStart) >= firstIntact && zones[i].endTicks >= sinceTicks)
+			{
+				zones[keep++] = zones[i];
+			}
+		}
+		zones.resize(keep);
+	}
+	return zones;
+}
+
+vector<ProfileThread> Profiler::GetThreads()
+{
+	Registry& registry = GetRegistry();
+	lock_guard<mutex> lock(registry.lock);
+	vector<ProfileThread> threads;
+	for (auto& ring : registry.rings)
+	{
+		threads.push_back({ ring->thread, ring->name });
+	}
+	return threads;
+}
+
+void Profiler::WriteChromeTrace(ostream& stream)
+{
+	vector<ProfileZoneRecord> zones = Capture(0);
+	vector<uint64> frames = GetFrames(FrameRingSize);
+	uint64 origin = ~0ull;
+	for (ProfileZoneRecord const& zone : zones)
+	{
+		origin = min(origin, zone.startTicks);
+	}
+	for (uint64 frame : frames)
+	{
+		origin = min(origin, frame);
+	}
+
+	char number[64];
+	auto microseconds = [&](uint64 ticks)
+	{
+		snprintf(number, sizeof(number), "%.3f", TicksToMilliseconds(sint64(ticks - origin)) * 1000.0);
+		return number;
+	};
+
+	stream << "{\"traceEvents\":[\n";
+	bool first = true;
+	auto separate = [&]
+	{
+		stream << (first ? "" : ",\n");
+		first = false;
+	};
+	for (ProfileThread const& thread : GetThreads())
+	{
+		separate();
+		stream << "{\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.thread << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+		WriteJsonString(stream, thread.name.c_str());
+		stream << "}}";
+	}
+	for (ProfileZoneRecord const& zone : zones)
+	{
+		separate();
+		stream << "{\"ph\":\"X\",\"pid\":0,\"tid\":" << zone.thread << ",\"name\":";
+		WriteJsonString(stream, zone.name);
+		stream << ",\"ts\":" << microseconds(zone.startTicks);
+		snprintf(number, sizeof(number), "%.3f", TicksToMilliseconds(sint64(zone.endTicks - zone.startTicks)) * 1000.0);
+		stream << ",\"dur\":" << number << "}";
+	}
+	for (uint64 frame : frames)
+	{
+		separate();
+		stream << "{\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"name\":\"Frame\",\"ts\":" << microseconds(frame) << "}";
+	}
+	stream << "\n]}\n";
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "BasicType.h"
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+*	SRPG_PROFILE_ZONE("name") times the enclosing scope, SRPG_PROFILE_FRAME() marks the start of a frame and
+*	SRPG_PROFILE_THREAD("name") names the calling thread in the timeline. Zone names must outlive the profiler, string
+*	literals or Profiler::InternName.
+*
+*	Define SRPG_NO_PROFILER to compile all of them to nothing.
+*/
+#ifndef SRPG_NO_PROFILER
+#define SRPG_PROFILE_CONCATENATE_(a, b) a##b
+#define SRPG_PROFILE_CONCATENATE(a, b) SRPG_PROFILE_CONCATENATE_(a, b)
+#define SRPG_PROFILE_ZONE(name) ::X::ProfileZone SRPG_PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#define SRPG_PROFILE_FRAME() ::X::Profiler::MarkFrame()
+#define SRPG_PROFILE_THREAD(name) ::X::Profiler::SetThreadName(name)
+#else
+#define SRPG_PROFILE_ZONE(name) ((void)0)
+#define SRPG_PROFILE_FRAME() ((void)0)
+#define SRPG_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace X
+{
+	struct ProfileZoneRecord
+	{
+		char const* name;
+		uint64 startTicks;
+		uint64 endTicks;
+		uint32 depth;			// 0 for zones not nested in another zone of their thread
+		uint32 thread;
+	};
+
+	struct ProfileThread
+	{
+		uint32 thread;
+		std::string name;
+	};
+
+	/*
+	*	Zones are written when they end to a ring buffer of the thread they ran on, with plain stores and without locks.
+	*	Readers copy the rings and drop what the owner overwrote while they were copying, so the newest 16384 zones of
+	*	every thread are kept.
+	*/
+	class Profiler
+	{
+	public:
+		/*
+		*	The time stamp counter where there is one, reading the system clock would be most of the cost of a zone.
+		*/
+		static uint64 GetTicks()
+		{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return uint64(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+		}
+
+		/*
+		*	Measured against the system clock since the program started, exact enough after the first second.
+		*/
+		static float64 TicksToMilliseconds(sint64 ticks);
+
+		static void SetThreadName(char const* name);
+
+		/*
+		*	@return: a copy of name that stays valid until the program ends, the same pointer for equal names.
+		*/
+		static char const* InternName(std::string const& name);
+		static char const* InternName(wchar_t const* name);
+
+		static void MarkFrame();
+
+		/*
+		*	Start ticks of the last frames, oldest first.
+		*/
+		static std::vector<uint64> GetFrames(uint32 count);
+
+		/*
+		*	Zones of all threads that ended at or after sinceTicks, ordered by thread and end time.
+		*/
+		static std::vector<ProfileZoneRecord> Capture(uint64 sinceTicks);
+		static std::vector<ProfileThread> GetThreads();
+
+		/*
+		*	Everything captured, as JSON for chrome://tracing and Perfetto.
+		*/
+		static void WriteChromeTrace(std::ostream& stream);
+
+		static void EndZone(char const* name, uint64 startTicks);
+		static uint32& GetDepth();
+	};
+
+	class ProfileZone
+	{
+	public:
+#ifndef SRPG_NO_PROFILER
+		explicit ProfileZone(char const* name) :
+			_name(name),
+			_startTicks(Profiler::GetTicks())
+		{
+			++Profiler::GetDepth();
+		}
+		ProfileZone(ProfileZone&& other) :
+			_name(other._name),
+			_startTicks(other._startTicks)
+		{
+			other._name = nullptr;
+		}
+		~ProfileZone()
+		{
+			if (_name)
+			{
+				Profiler::EndZone(_name, _startTicks);
+			}
+		}
+#else
+		explicit ProfileZone(char const*)
+		{
+		}
+		ProfileZone(ProfileZone&&)
+		{
+		}
+#endif
+		ProfileZone(ProfileZone const&) = delete;
+		ProfileZone& operator=(ProfileZone const&) = delete;
+		ProfileZone& operator=(ProfileZone&&) = delete;
+
+#ifndef SRPG_NO_PROFILER
+	private:
+		char const* _name;
+		uint64 _startTicks;
+#endif
+	};
+}
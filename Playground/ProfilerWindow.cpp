@@ -0,0 +1,111 @@
+#include "ProfilerWindow.h"
+#include "imgui.h"
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	float32 const RowHeight = 18.0f;
+	float32 const LaneGap = 6.0f;
+	float32 const LabelWidth = 90.0f;
+
+	// The same name keeps its colour from frame to frame, names are interned so the pointer will do.
+	ImU32 GetZoneColor(char const* name)
+	{
+		uint64 hash = uint64(reinterpret_cast<uintptr_t>(name)) * 0x9E3779B97F4A7C15ull;
+		return ImColor::HSV(float32(hash >> 40) / float32(1 << 24), 0.5f, 0.75f);
+	}
+}
+
+void ProfilerWindow::Refresh()
+{
+	_frameTicks = Profiler::GetFrames(uint32(_frames) + 1);
+	_endTicks = Profiler::GetTicks();
+	_beginTicks = _frameTicks.empty() ? _endTicks : _frameTicks.front();
+	_zones = Profiler::Capture(_beginTicks);
+	_threads = Profiler::GetThreads();
+}
+
+void ProfilerWindow::Render()
+{
+	if (!_paused)
+	{
+		Refresh();
+	}
+
+	ImGui::Begin("Profiler");
+	ImGui::Checkbox("Pause", &_paused);
+	ImGui::SameLine();
+	ImGui::PushItemWidth(120.0f);
+	ImGui::SliderInt("Frames", &_frames, 1, 30);
+	ImGui::PopItemWidth();
+	ImGui::SameLine();
+	if (ImGui::Button("Export trace"))
+	{
+		ofstream file("trace_" + to_string(_endTicks) + ".json");
+		Profiler::WriteChromeTrace(file);
+	}
+	ImGui::Text("%.2f ms shown", Profiler::TicksToMilliseconds(sint64(_endTicks - _beginTicks)));
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float32 width = max(ImGui::GetContentRegionAvailWidth() - LabelWidth, 1.0f);
+	float32 left = origin.x + LabelWidth;
+	float32 pixelsPerTick = _endTicks > _beginTicks ? width / float32(_endTicks - _beginTicks) : 0.0f;
+	auto toX = [&](uint64 ticks)
+	{
+		return left + float32(sint64(ticks - _beginTicks)) * pixelsPerTick;
+	};
+
+	float32 top = origin.y;
+	for (ProfileThread const& thread : _threads)
+	{
+		uint32 depth = 0;
+		bool any = false;
+		for (ProfileZoneRecord const& zone : _zones)
+		{
+			if (zone.thread == thread.thread)
+			{
+				depth = max(depth, zone.depth);
+				any = true;
+			}
+		}
+		if (!any)
+		{
+			continue;
+		}
+
+		drawList->AddText(ImVec2(origin.x, top + 2.0f), ImColor(220, 220, 220), thread.name.c_str());
+		for (ProfileZoneRecord const& zone : _zones)
+		{
+			if (zone.thread != thread.thread)
+			{
+				continue;
+			}
+			ImVec2 zoneMin(max(toX(zone.startTicks), left), top + zone.depth * RowHeight);
+			ImVec2 zoneMax(max(toX(zone.endTicks), zoneMin.x + 1.0f), zoneMin.y + RowHeight - 1.0f);
+			drawList->AddRectFilled(zoneMin, zoneMax, GetZoneColor(zone.name));
+			ImVec2 textSize = ImGui::CalcTextSize(zone.name);
+			if (zoneMax.x - zoneMin.x > textSize.x + 4.0f)
+			{
+				drawList->AddText(ImVec2(zoneMin.x + 2.0f, zoneMin.y + 1.0f), ImColor(0, 0, 0), zone.name);
+			}
+			if (ImGui::IsMouseHoveringRect(zoneMin, zoneMax))
+			{
+				ImGui::SetTooltip("%s\n%.3f ms", zone.name, Profiler::TicksToMilliseconds(sint64(zone.endTicks - zone.startTicks)));
+			}
+		}
+		top += (depth + 1) * RowHeight + LaneGap;
+	}
+
+	for (uint64 frame : _frameTicks)
+	{
+		drawList->AddLine(ImVec2(toX(frame), origin.y), ImVec2(toX(frame), top), ImColor(255, 255, 255, 128));
+	}
+	ImGui::Dummy(ImVec2(LabelWidth + width, top - origin.y));
+	ImGui::End();
+}
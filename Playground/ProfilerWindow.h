@@ -0,0 +1,27 @@
+#pragma once
+#include "BasicType.h"
+#include "Profiler.h"
+#include <vector>
+
+namespace X
+{
+	/*
+	*	ImGui timeline of the last frames: a lane per thread, zones stacked by nesting depth, frame starts as lines.
+	*/
+	class ProfilerWindow
+	{
+	public:
+		void Render();
+
+	private:
+		void Refresh();
+
+		bool _paused = false;
+		int _frames = 3;
+		uint64 _beginTicks = 0;
+		uint64 _endTicks = 0;
+		std::vector<uint64> _frameTicks;
+		std::vector<ProfileZoneRecord> _zones;
+		std::vector<ProfileThread> _threads;
+	};
+}
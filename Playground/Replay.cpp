@@ -0,0 +1,202 @@
+#include "Replay.h"
+#include "Varint.h"
+#include <fstream>
+#include <iterator>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const ReplayMagic = 0x4C505253;	// "SRPL"
+	uint32 const ReplayVersion = 1;
+
+	// Stored in the low 2 bits of each event's tick delta.
+	enum EventKind : uint32
+	{
+		Event_Command,
+		Event_Checksum,
+		Event_End,
+	};
+
+	void AppendUInt32(vector<uint8>& bytes, uint32 value)
+	{
+		for (uint32 shift = 0; shift < 32; shift += 8)
+		{
+			bytes.push_back(uint8(value >> shift));
+		}
+	}
+
+	bool ReadUInt32(uint8 const*& position, uint8 const* end, uint32& value)
+	{
+		if (end - position < 4)
+		{
+			return false;
+		}
+		value = position[0] | (position[1] << 8) | (position[2] << 16) | (uint32(position[3]) << 24);
+		position += 4;
+		return true;
+	}
+}
+
+ReplayRecorder::ReplayRecorder(string mapPath, BattleSimulation const& simulation, uint64 seed, uint32 checksumInterval) :
+	_checksumInterval(checksumInterval ? checksumInterval : 1),
+	_lastTick(simulation.GetTick()),
+	_finished(false)
+{
+	AppendUInt32(_data, ReplayMagic);
+	AppendVarint(_data, ReplayVersion);
+	AppendVarint(_data, seed);
+	AppendVarint(_data, _checksumInterval);
+	AppendVarint(_data, mapPath.size());
+	_data.insert(_data.end(), mapPath.begin(), mapPath.end());
+	// The first checksum catches a replay played on a different map.
+	AppendChecksum(simulation);
+}
+
+void ReplayRecorder::AppendEvent(uint32 tick, uint32 kind)
+{
+	AppendVarint(_data, (uint64(tick - _lastTick) << 2) | kind);
+	_lastTick = tick;
+}
+
+void ReplayRecorder::AppendChecksum(BattleSimulation const& simulation)
+{
+	AppendEvent(simulation.GetTick(), Event_Checksum);
+	AppendUInt32(_data, simulation.GetChecksum());
+}
+
+bool ReplayRecorder::Apply(BattleSimulation& simulation, BattleCommand const& command)
+{
+	if (_finished || !simulation.Apply(command))
+	{
+		return false;
+	}
+	AppendEvent(simulation.GetTick(), Event_Command);
+	AppendBattleCommand(_data, command);
+	return true;
+}
+
+void ReplayRecorder::Tick(BattleSimulation& simulation)
+{
+	simulation.Tick();
+	if (!_finished && simulation.GetTick() % _checksumInterval == 0)
+	{
+		AppendChecksum(simulation);
+	}
+}
+
+vector<uint8> const& ReplayRecorder::Finish(BattleSimulation const& simulation)
+{
+	if (!_finished)
+	{
+		AppendEvent(simulation.GetTick(), Event_End);
+		AppendUInt32(_data, simulation.GetChecksum());
+		_finished = true;
+	}
+	return _data;
+}
+
+bool ReplayRecorder::Save(string const& path, BattleSimulation const& simulation)
+{
+	vector<uint8> const& data = Finish(simulation);
+	ofstream file(path, ios::binary);
+	file.write(reinterpret_cast<char const*>(data.data()), data.size());
+	return bool(file);
+}
+
+bool ReplayPlayer::Load(vector<uint8> data)
+{
+	uint8 const* position = data.data();
+	uint8 const* end = position + data.size();
+	uint32 magic;
+	uint64 version, seed, checksumInterval, pathLength;
+	if (!ReadUInt32(position, end, magic) || magic != ReplayMagic || !ReadVarint(position, end, version) || version != ReplayVersion ||
+		!ReadVarint(position, end, seed) || !ReadVarint(position, end, checksumInterval) || !ReadVarint(position, end, pathLength) ||
+		pathLength > uint64(end - position))
+	{
+		return false;
+	}
+	_mapPath.assign(reinterpret_cast<char const*>(position), size_t(pathLength));
+	position += pathLength;
+	_seed = seed;
+	_checksumInterval = uint32(checksumInterval);
+	_streamOffset = size_t(position - data.data());
+	_data = move(data);
+	return true;
+}
+
+bool ReplayPlayer::LoadFile(string const& path)
+{
+	ifstream file(path, ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	return Load(vector<uint8>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>()));
+}
+
+ReplayPlayer::Result ReplayPlayer::Play(BattleSimulation& simulation) const
+{
+	Result result = {};
+	result.desyncTick = ~0u;
+	uint8 const* position = _data.data() + _streamOffset;
+	uint8 const* end = _data.data() + _data.size();
+	uint32 tick = simulation.GetTick();
+
+	for (;;)
+	{
+		uint64 header;
+		if (!ReadVarint(position, end, header))
+		{
+			// Truncated replay, e.g. the game crashed before Finish. What was played so far is still valid.
+			break;
+		}
+		tick += uint32(header >> 2);
+		while (simulation.GetTick() < tick)
+		{
+			simulation.Tick();
+			++result.ticks;
+		}
+
+		uint32 kind = uint32(header & 3);
+		if (kind == Event_Command)
+		{
+			BattleCommand command;
+			if (!ReadBattleCommand(position, end, command))
+			{
+				break;
+			}
+			++result.commands;
+			if (!simulation.Apply(command))
+			{
+				result.desyncTick = tick;
+				return result;
+			}
+		}
+		else if (kind == Event_Checksum || kind == Event_End)
+		{
+			uint32 checksum;
+			if (!ReadUInt32(position, end, checksum))
+			{
+				break;
+			}
+			if (checksum != simulation.GetChecksum())
+			{
+				result.desyncTick = tick;
+				return result;
+			}
+			++result.checksumsVerified;
+			if (kind == Event_End)
+			{
+				result.completed = true;
+				return result;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+	return result;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "BasicType.h"
+#include "BattleSimulation.h"
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	A replay is the map path, the seed and the commands with the tick they were applied at, plus a checksum of the
+	*	simulation every checksumInterval ticks. Ticks are stored as varint deltas, so a turn of commands takes a few bytes.
+	*
+	*	Drives the simulation while recording: commands go through Apply and steps through Tick.
+	*/
+	class ReplayRecorder
+	{
+	public:
+		ReplayRecorder(std::string mapPath, BattleSimulation const& simulation, uint64 seed, uint32 checksumInterval = 60);
+
+		/*
+		*	Only commands the simulation accepts are recorded.
+		*/
+		bool Apply(BattleSimulation& simulation, BattleCommand const& command);
+		void Tick(BattleSimulation& simulation);
+
+		/*
+		*	Ends the stream with the final checksum, the recorder takes no more commands afterwards.
+		*/
+		std::vector<uint8> const& Finish(BattleSimulation const& simulation);
+		bool Save(std::string const& path, BattleSimulation const& simulation);
+
+	private:
+		void AppendEvent(uint32 tick, uint32 kind);
+		void AppendChecksum(BattleSimulation const& simulation);
+
+		std::vector<uint8> _data;
+		uint32 _checksumInterval;
+		uint32 _lastTick;
+		bool _finished;
+	};
+
+	class ReplayPlayer
+	{
+	public:
+		struct Result
+		{
+			bool completed;			// reached the end without a desync
+			uint32 ticks;
+			uint32 commands;
+			uint32 checksumsVerified;
+			uint32 desyncTick;		// first tick whose checksum or command did not match, ~0u if none
+		};
+
+		/*
+		*	@return: false if data is not a replay of a supported version.
+		*/
+		bool Load(std::vector<uint8> data);
+		bool LoadFile(std::string const& path);
+
+		std::string const& GetMapPath() const
+		{
+			return _mapPath;
+		}
+		uint64 GetSeed() const
+		{
+			return _seed;
+		}
+
+		/*
+		*	Runs the whole replay as fast as possible on a simulation created from the map and the seed of the replay.
+		*/
+		Result Play(BattleSimulation& simulation) const;
+
+	private:
+		std::vector<uint8> _data;
+		size_t _streamOffset;
+		std::string _mapPath;
+		uint64 _seed;
+		uint32 _checksumInterval;
+	};
+}
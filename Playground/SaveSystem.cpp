@@ -0,0 +1,450 @@
+#include "SaveSystem.h"
+#include "LZ4.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const SaveMagic = 0x56415353;	// "SSAV"
+	uint16 const SaveVersion = 1;
+
+	enum class SaveFileKind : uint16
+	{
+		Base,
+		Delta,
+	};
+
+	struct SaveFileHeader
+	{
+		uint32 magic;
+		uint16 version;
+		SaveFileKind kind;
+		uint64 generation;		// of the base, a delta only applies to the base with the same generation
+		uint32 sectionCount;
+		uint32 pageCount;
+		uint64 payloadSize;
+		uint64 payloadHash;
+	};
+
+	uint64 HashBytes(uint8 const* bytes, size_t size)
+	{
+		// FNV-1a
+		uint64 hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	void AppendUInt32(vector<uint8>& bytes, uint32 value)
+	{
+		uint8 const* begin = reinterpret_cast<uint8 const*>(&value);
+		bytes.insert(bytes.end(), begin, begin + sizeof(value));
+	}
+
+	struct Reader
+	{
+		uint8 const* position;
+		uint8 const* end;
+
+		bool ReadUInt32(uint32& value)
+		{
+			return ReadBytes(&value, sizeof(value));
+		}
+		bool ReadBytes(void* destination, size_t size)
+		{
+			if (size_t(end - position) < size)
+			{
+				return false;
+			}
+			memcpy(destination, position, size);
+			position += size;
+			return true;
+		}
+	};
+
+	uint32 PageBytes(SaveState::Section const& section, uint32 page)
+	{
+		uint32 records = min(section.recordsPerPage, section.recordCount - page * section.recordsPerPage);
+		return records * section.recordSize;
+	}
+
+	bool ReplaceFile(string const& temporaryPath, string const& path)
+	{
+#ifdef _WIN32
+		return MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+		return rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+	}
+
+	bool WriteAtomically(string const& path, vector<uint8> const& bytes)
+	{
+		string temporaryPath = path + ".tmp";
+		{
+			ofstream file(temporaryPath, ios::binary | ios::trunc);
+			file.write(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+			file.flush();
+			if (!file)
+			{
+				return false;
+			}
+		}
+		return ReplaceFile(temporaryPath, path);
+	}
+
+	/*
+	*	Reads a base or delta file into state.
+	*	@return: false if the file is missing, corrupt or does not match kind and generation.
+	*/
+	bool ApplyFile(string const& path, SaveFileKind kind, uint64& generation, SaveState& state)
+	{
+		ifstream file(path, ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		vector<uint8> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+		SaveFileHeader header;
+		if (bytes.size() < sizeof(header))
+		{
+			return false;
+		}
+		memcpy(&header, bytes.data(), sizeof(header));
+		uint8 const* payload = bytes.data() + sizeof(header);
+		if (header.magic != SaveMagic || header.version != SaveVersion || header.kind != kind || header.payloadSize != bytes.size() - sizeof(header) ||
+			header.payloadHash != HashBytes(payload, size_t(header.payloadSize)))
+		{
+			return false;
+		}
+		if (kind == SaveFileKind::Delta && header.generation != generation)
+		{
+			return false;
+		}
+		generation = header.generation;
+
+		Reader reader = { payload, payload + header.payloadSize };
+		vector<SaveState::SectionID> sections;
+		for (uint32 index = 0; index < header.sectionCount; ++index)
+		{
+			uint32 nameLength, recordSize, recordCount;
+			if (!reader.ReadUInt32(nameLength) || nameLength > size_t(reader.end - reader.position))
+			{
+				return false;
+			}
+			string name(reinterpret_cast<char const*>(reader.position), nameLength);
+			reader.position += nameLength;
+			if (!reader.ReadUInt32(recordSize) || !reader.ReadUInt32(recordCount) || recordSize == 0)
+			{
+				return false;
+			}
+			SaveState::SectionID section = state.FindSection(name);
+			if (section == ~0u)
+			{
+				section = state.AddSection(name, recordSize, recordCount);
+			}
+			state.Resize(section, recordCount);
+			sections.push_back(section);
+		}
+
+		SaveState::Snapshot layout = state.TakeSnapshot();
+		vector<uint8> raw;
+		for (uint32 index = 0; index < header.pageCount; ++index)
+		{
+			uint32 sectionIndex, page, storedSize;
+			if (!reader.ReadUInt32(sectionIndex) || !reader.ReadUInt32(page) || !reader.ReadUInt32(storedSize) || sectionIndex >= sections.size())
+			{
+				return false;
+			}
+			SaveState::Section const& section = layout.sections[sections[sectionIndex]];
+			if (page >= section.pages.size() || storedSize > size_t(reader.end - reader.position))
+			{
+				return false;
+			}
+			uint32 size = PageBytes(section, page);
+			raw.resize(size);
+			if (storedSize == size)
+			{
+				memcpy(raw.data(), reader.position, size);
+			}
+			else if (!LZ4Decompress(reader.position, storedSize, raw.data(), size))
+			{
+				return false;
+			}
+			reader.position += storedSize;
+			// Records of a page are contiguous, the first one gives the whole page.
+			memcpy(state.Modify(sections[sectionIndex], page * section.recordsPerPage), raw.data(), size);
+		}
+		return true;
+	}
+}
+
+SaveState::SectionID SaveState::AddSection(string const& name, uint32 recordSize, uint32 recordCount)
+{
+	SectionID existing = FindSection(name);
+	if (existing != ~0u)
+	{
+		return existing;
+	}
+	Section section;
+	section.name = name;
+	section.recordSize = recordSize;
+	section.recordsPerPage = max(1u, PageSize / recordSize);
+	section.recordCount = 0;
+	_sections.push_back(move(section));
+	Resize(SectionID(_sections.size() - 1), recordCount);
+	return SectionID(_sections.size() - 1);
+}
+
+void SaveState::Resize(SectionID id, uint32 recordCount)
+{
+	Section& section = _sections[id];
+	uint32 pageCount = (recordCount + section.recordsPerPage - 1) / section.recordsPerPage;
+	if (recordCount < section.recordCount && recordCount % section.recordsPerPage != 0)
+	{
+		// Clear the records that are cut off, so growing again starts from zero.
+		uint32 last = min(section.recordCount, pageCount * section.recordsPerPage);
+		uint8* begin = static_cast<uint8*>(Modify(id, recordCount));
+		memset(begin, 0, size_t(last - recordCount) * section.recordSize);
+	}
+	section.pages.resize(pageCount);
+	for (auto& page : section.pages)
+	{
+		if (!page)
+		{
+			page = make_shared<Page>();
+			page->bytes.resize(size_t(section.recordsPerPage) * section.recordSize);
+		}
+	}
+	section.recordCount = recordCount;
+}
+
+SaveState::SectionID SaveState::FindSection(string const& name) const
+{
+	for (SectionID id = 0; id < _sections.size(); ++id)
+	{
+		if (_sections[id].name == name)
+		{
+			return id;
+		}
+	}
+	return ~0u;
+}
+
+void const* SaveState::Get(SectionID id, uint32 index) const
+{
+	Section const& section = _sections[id];
+	return &section.pages[index / section.recordsPerPage]->bytes[(index % section.recordsPerPage) * section.recordSize];
+}
+
+void* SaveState::Modify(SectionID id, uint32 index)
+{
+	Section& section = _sections[id];
+	shared_ptr<Page>& page = section.pages[index / section.recordsPerPage];
+	if (page.use_count() > 1)
+	{
+		page = make_shared<Page>(*page);
+	}
+	else
+	{
+		// The last snapshot reading this page may have just released it on another thread.
+		atomic_thread_fence(memory_order_acquire);
+	}
+	return &page->bytes[(index % section.recordsPerPage) * section.recordSize];
+}
+
+SaveState::Snapshot SaveState::TakeSnapshot() const
+{
+	Snapshot snapshot;
+	snapshot.sections = _sections;
+	return snapshot;
+}
+
+SaveSystem::SaveSystem(Ptr<JobSystem> jobs, string path) :
+	_jobs(move(jobs)),
+	_path(move(path)),
+	_baseGeneration(0),
+	_statistics()
+{
+}
+
+SaveSystem::~SaveSystem()
+{
+	Wait();
+}
+
+bool SaveSystem::Save(SaveState const& state)
+{
+	if (IsSaving())
+	{
+		return false;
+	}
+
+	auto start = chrono::steady_clock::now();
+	auto snapshot = make_shared<SaveState::Snapshot>(state.TakeSnapshot());
+	chrono::duration<float64, milli> pause = chrono::steady_clock::now() - start;
+	{
+		lock_guard<mutex> lock(_statisticsMutex);
+		_statistics.lastPauseMilliseconds = pause.count();
+	}
+
+	_jobs->Run([this, snapshot]
+	{
+		Write(*snapshot);
+	}, &_counter);
+	return true;
+}
+
+void SaveSystem::Wait()
+{
+	_jobs->Wait(_counter);
+}
+
+SaveSystem::Statistics SaveSystem::GetStatistics() const
+{
+	lock_guard<mutex> lock(_statisticsMutex);
+	return _statistics;
+}
+
+void SaveSystem::Write(SaveState::Snapshot const& snapshot)
+{
+	auto start = chrono::steady_clock::now();
+
+	// Pages that still are the very same object as in the base did not change, the others are compared by value.
+	struct ChangedPage
+	{
+		uint32 section;
+		uint32 page;
+	};
+	vector<ChangedPage> changed;
+	uint32 totalPages = 0;
+	uint64 changedBytes = 0, totalBytes = 0;
+	for (uint32 sectionIndex = 0; sectionIndex < snapshot.sections.size(); ++sectionIndex)
+	{
+		SaveState::Section const& section = snapshot.sections[sectionIndex];
+		SaveState::Section const* base = sectionIndex < _base.sections.size() ? &_base.sections[sectionIndex] : nullptr;
+		for (uint32 page = 0; page < section.pages.size(); ++page)
+		{
+			uint32 size = PageBytes(section, page);
+			++totalPages;
+			totalBytes += size;
+			bool same = base && page < base->pages.size() && PageBytes(*base, page) == size &&
+				(section.pages[page] == base->pages[page] || memcmp(section.pages[page]->bytes.data(), base->pages[page]->bytes.data(), size) == 0);
+			if (!same)
+			{
+				changed.push_back({ sectionIndex, page });
+				changedBytes += size;
+			}
+		}
+	}
+
+	bool writeBase = _baseGeneration == 0 || changedBytes * 2 > totalBytes;
+	if (writeBase)
+	{
+		changed.clear();
+		for (uint32 sectionIndex = 0; sectionIndex < snapshot.sections.size(); ++sectionIndex)
+		{
+			for (uint32 page = 0; page < snapshot.sections[sectionIndex].pages.size(); ++page)
+			{
+				changed.push_back({ sectionIndex, page });
+			}
+		}
+	}
+
+	vector<uint8> payload;
+	for (SaveState::Section const& section : snapshot.sections)
+	{
+		AppendUInt32(payload, uint32(section.name.size()));
+		payload.insert(payload.end(), section.name.begin(), section.name.end());
+		AppendUInt32(payload, section.recordSize);
+		AppendUInt32(payload, section.recordCount);
+	}
+	vector<uint8> compressed(LZ4CompressBound(SaveState::PageSize));
+	for (ChangedPage const& page : changed)
+	{
+		SaveState::Section const& section = snapshot.sections[page.section];
+		uint32 size = PageBytes(section, page.page);
+		uint8 const* raw = section.pages[page.page]->bytes.data();
+		compressed.resize(max<size_t>(compressed.size(), LZ4CompressBound(size)));
+		size_t compressedSize = LZ4Compress(raw, size, compressed.data(), size > 0 ? size - 1 : 0);
+		AppendUInt32(payload, page.section);
+		AppendUInt32(payload, page.page);
+		if (compressedSize == 0)
+		{
+			AppendUInt32(payload, size);
+			payload.insert(payload.end(), raw, raw + size);
+		}
+		else
+		{
+			AppendUInt32(payload, uint32(compressedSize));
+			payload.insert(payload.end(), compressed.begin(), compressed.begin() + compressedSize);
+		}
+	}
+
+	uint64 generation = _baseGeneration;
+	if (writeBase)
+	{
+		// Unique across runs, so a delta left over from an earlier base never applies to this one.
+		generation = max<uint64>(_baseGeneration + 1, uint64(chrono::system_clock::now().time_since_epoch().count()));
+	}
+	SaveFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SaveMagic;
+	header.version = SaveVersion;
+	header.kind = writeBase ? SaveFileKind::Base : SaveFileKind::Delta;
+	header.generation = generation;
+	header.sectionCount = uint32(snapshot.sections.size());
+	header.pageCount = uint32(changed.size());
+	header.payloadSize = payload.size();
+	header.payloadHash = HashBytes(payload.data(), payload.size());
+
+	vector<uint8> file(sizeof(header));
+	memcpy(file.data(), &header, sizeof(header));
+	file.insert(file.end(), payload.begin(), payload.end());
+
+	string deltaPath = _path + ".delta";
+	bool succeeded = WriteAtomically(writeBase ? _path : deltaPath, file);
+	if (succeeded && writeBase)
+	{
+		// The old delta no longer matches the generation, removing it only saves the space.
+		remove(deltaPath.c_str());
+		_base = snapshot;
+		_baseGeneration = generation;
+	}
+
+	chrono::duration<float64, milli> elapsed = chrono::steady_clock::now() - start;
+	lock_guard<mutex> lock(_statisticsMutex);
+	_statistics.lastWriteMilliseconds = elapsed.count();
+	_statistics.lastChangedPages = uint32(changed.size());
+	_statistics.lastTotalPages = totalPages;
+	_statistics.lastWrittenBytes = file.size();
+	_statistics.lastWasBase = writeBase;
+	++_statistics.saves;
+	if (!succeeded)
+	{
+		++_statistics.failures;
+	}
+}
+
+bool SaveSystem::Load(string const& path, SaveState& state)
+{
+	uint64 generation = 0;
+	if (!ApplyFile(path, SaveFileKind::Base, generation, state))
+	{
+		return false;
+	}
+	// A missing or stale delta just means the base is the latest save.
+	ApplyFile(path + ".delta", SaveFileKind::Delta, generation, state);
+	return true;
+}
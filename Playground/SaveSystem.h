@@ -0,0 +1,149 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Saved game state as named sections of fixed size records, e.g. one section for units and one for map tiles.
+	*	Records are grouped into pages that are shared with snapshots and copied on the first write after a snapshot,
+	*	so taking a snapshot only copies page pointers.
+	*
+	*	Only the thread that owns the state may modify it and take snapshots.
+	*/
+	class SaveState
+	{
+	public:
+		typedef uint32 SectionID;
+
+		static uint32 const PageSize = 4096;
+
+		struct Page
+		{
+			std::vector<uint8> bytes;
+		};
+
+		struct Section
+		{
+			std::string name;
+			uint32 recordSize;
+			uint32 recordsPerPage;
+			uint32 recordCount;
+			std::vector<std::shared_ptr<Page>> pages;
+		};
+
+		/*
+		*	Immutable view of the state at the time it was taken, safe to read from any thread.
+		*/
+		struct Snapshot
+		{
+			std::vector<Section> sections;
+		};
+
+		/*
+		*	@return: the existing section if the name is already used, records are zero initialized.
+		*/
+		SectionID AddSection(std::string const& name, uint32 recordSize, uint32 recordCount);
+		void Resize(SectionID section, uint32 recordCount);
+		/*
+		*	@return: ~0u if there is no section with that name.
+		*/
+		SectionID FindSection(std::string const& name) const;
+
+		uint32 GetRecordCount(SectionID section) const
+		{
+			return _sections[section].recordCount;
+		}
+
+		void const* Get(SectionID section, uint32 index) const;
+		/*
+		*	Copies the page first if a snapshot still shares it. Do not keep the pointer across TakeSnapshot.
+		*/
+		void* Modify(SectionID section, uint32 index);
+
+		template <class T>
+		T const& Get(SectionID section, uint32 index) const
+		{
+			return *static_cast<T const*>(Get(section, index));
+		}
+		template <class T>
+		T& Modify(SectionID section, uint32 index)
+		{
+			return *static_cast<T*>(Modify(section, index));
+		}
+
+		Snapshot TakeSnapshot() const;
+
+	private:
+		std::vector<Section> _sections;
+	};
+
+	/*
+	*	Writes a SaveState in the background. A save slot is a base file with every page plus a delta file with the
+	*	pages changed since the base, so most saves only serialize what changed. When the delta grows past half of
+	*	the base, the next save writes a new base instead. Both files are written to a temporary file and renamed
+	*	over the old one, a save that is interrupted leaves the previous one intact.
+	*/
+	class SaveSystem : public ReferenceCountBase<true>
+	{
+	public:
+		struct Statistics
+		{
+			float64 lastPauseMilliseconds;		// snapshot on the calling thread
+			float64 lastWriteMilliseconds;		// background serialization and file writes
+			uint32 lastChangedPages;
+			uint32 lastTotalPages;
+			uint64 lastWrittenBytes;
+			bool lastWasBase;
+			uint32 saves;
+			uint32 failures;
+		};
+
+		/*
+		*	@path: the base file, the delta file is path + ".delta".
+		*/
+		SaveSystem(Ptr<JobSystem> jobs, std::string path);
+		~SaveSystem();
+
+		/*
+		*	Takes a snapshot of state and returns, serialization and writing happen on the job system.
+		*	Call at a safe point where state is consistent, e.g. at turn start.
+		*	@return: false if the previous save is still being written, the save is skipped.
+		*/
+		bool Save(SaveState const& state);
+
+		bool IsSaving() const
+		{
+			return !_counter.IsDone();
+		}
+		void Wait();
+
+		Statistics GetStatistics() const;
+
+		/*
+		*	Loads base and delta into state, sections are added by name when missing.
+		*	@return: false if there is no valid base file.
+		*/
+		static bool Load(std::string const& path, SaveState& state);
+
+	private:
+		void Write(SaveState::Snapshot const& snapshot);
+
+		Ptr<JobSystem> _jobs;
+		std::string _path;
+		JobCounter _counter;
+
+		// Only used by the save job.
+		SaveState::Snapshot _base;
+		uint64 _baseGeneration;
+
+		mutable std::mutex _statisticsMutex;
+		Statistics _statistics;
+	};
+}
@@ -0,0 +1,48 @@
+#include "ServerTransport.h"
+#include <iterator>
+
+using namespace std;
+using namespace X;
+
+uint32 LoopbackTransport::Connect()
+{
+	lock_guard<mutex> lock(_clientMutex);
+	_toClients.emplace_back();
+	return uint32(_toClients.size() - 1);
+}
+
+void LoopbackTransport::ClientSend(uint32 connection, vector<uint8> bytes)
+{
+	lock_guard<mutex> lock(_serverMutex);
+	_toServer.push_back({ connection, move(bytes), chrono::steady_clock::now() });
+	_serverArrived.notify_one();
+}
+
+void LoopbackTransport::ClientReceive(uint32 connection, vector<vector<uint8>>& messages)
+{
+	lock_guard<mutex> lock(_clientMutex);
+	if (connection >= _toClients.size())
+	{
+		return;
+	}
+	deque<vector<uint8>>& inbox = _toClients[connection];
+	move(inbox.begin(), inbox.end(), back_inserter(messages));
+	inbox.clear();
+}
+
+void LoopbackTransport::Receive(vector<ServerPacket>& packets, chrono::steady_clock::time_point deadline)
+{
+	unique_lock<mutex> lock(_serverMutex);
+	_serverArrived.wait_until(lock, deadline, [this] { return !_toServer.empty(); });
+	move(_toServer.begin(), _toServer.end(), back_inserter(packets));
+	_toServer.clear();
+}
+
+void LoopbackTransport::Send(uint32 connection, vector<uint8> bytes)
+{
+	lock_guard<mutex> lock(_clientMutex);
+	if (connection < _toClients.size())
+	{
+		_toClients[connection].push_back(move(bytes));
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace X
+{
+	struct ServerPacket
+	{
+		uint32 connection;
+		std::vector<uint8> bytes;
+		std::chrono::steady_clock::time_point received;		// when the transport got it, latencies are measured from here
+	};
+
+	/*
+	*	How the server talks to clients, one packet is one message. Connections are numbered by the transport.
+	*/
+	class ServerTransport : public ReferenceCountBase<true>
+	{
+	public:
+		virtual ~ServerTransport() = default;
+
+		/*
+		*	Appends the packets that arrived, waits until there is at least one or the deadline passed.
+		*/
+		virtual void Receive(std::vector<ServerPacket>& packets, std::chrono::steady_clock::time_point deadline) = 0;
+
+		/*
+		*	Can be called from any thread.
+		*/
+		virtual void Send(uint32 connection, std::vector<uint8> bytes) = 0;
+	};
+
+	/*
+	*	Clients in the same process, for tests and load runs without a network in between.
+	*/
+	class LoopbackTransport : public ServerTransport
+	{
+	public:
+		uint32 Connect();
+
+		void ClientSend(uint32 connection, std::vector<uint8> bytes);
+
+		/*
+		*	Appends what the server sent to the connection without waiting.
+		*/
+		void ClientReceive(uint32 connection, std::vector<std::vector<uint8>>& messages);
+
+		void Receive(std::vector<ServerPacket>& packets, std::chrono::steady_clock::time_point deadline) override;
+		void Send(uint32 connection, std::vector<uint8> bytes) override;
+
+	private:
+		std::mutex _serverMutex;
+		std::condition_variable _serverArrived;
+		std::vector<ServerPacket> _toServer;
+
+		std::mutex _clientMutex;
+		std::vector<std::deque<std::vector<uint8>>> _toClients;
+	};
+}
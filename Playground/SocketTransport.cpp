@@ -0,0 +1,493 @@
+#include "SocketTransport.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+#ifdef _WIN32
+	typedef SOCKET SocketHandle;
+	SocketHandle const InvalidSocket = INVALID_SOCKET;
+
+	void StartSockets()
+	{
+		// Never cleaned up, sockets may be closed by static destructors.
+		static bool started = []
+		{
+			WSADATA data;
+			return ::WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		(void)started;
+	}
+
+	void CloseSocket(SocketHandle socket)
+	{
+		::closesocket(socket);
+	}
+
+	void SetNonBlocking(SocketHandle socket)
+	{
+		u_long enable = 1;
+		::ioctlsocket(socket, FIONBIO, &enable);
+	}
+
+	bool WouldBlock()
+	{
+		return ::WSAGetLastError() == WSAEWOULDBLOCK;
+	}
+
+	sint32 PollSockets(pollfd* sockets, size_t count, sint32 timeoutMs)
+	{
+		return ::WSAPoll(sockets, ULONG(count), timeoutMs);
+	}
+
+	sint32 const SendFlags = 0;
+#else
+	typedef int SocketHandle;
+	SocketHandle const InvalidSocket = -1;
+
+	void StartSockets()
+	{
+	}
+
+	void CloseSocket(SocketHandle socket)
+	{
+		::close(socket);
+	}
+
+	void SetNonBlocking(SocketHandle socket)
+	{
+		::fcntl(socket, F_SETFL, ::fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+	}
+
+	bool WouldBlock()
+	{
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	}
+
+	sint32 PollSockets(pollfd* sockets, size_t count, sint32 timeoutMs)
+	{
+		return ::poll(sockets, nfds_t(count), timeoutMs);
+	}
+
+	// A client that went away must not kill the server with SIGPIPE.
+#ifdef MSG_NOSIGNAL
+	sint32 const SendFlags = MSG_NOSIGNAL;
+#else
+	sint32 const SendFlags = 0;
+#endif
+#endif
+
+	sockaddr_in LoopbackAddress(uint16 port)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		return address;
+	}
+
+	void Configure(SocketHandle socket)
+	{
+		// Commands are small and answered right away, Nagle would hold them back.
+		int enable = 1;
+		::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char const*>(&enable), sizeof(enable));
+#ifdef SO_NOSIGPIPE
+		::setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, reinterpret_cast<char const*>(&enable), sizeof(enable));
+#endif
+		SetNonBlocking(socket);
+	}
+
+	/*
+	*	One end of a connection with what was read but not taken and what was sent but did not fit the socket.
+	*/
+	struct Stream
+	{
+		SocketHandle socket;
+		vector<uint8> incoming;
+		size_t incomingTaken;
+		vector<uint8> outgoing;
+	};
+
+	Stream OpenStream(SocketHandle socket)
+	{
+		Configure(socket);
+		return { socket, {}, 0, {} };
+	}
+
+	void CloseStream(Stream& stream)
+	{
+		if (stream.socket != InvalidSocket)
+		{
+			CloseSocket(stream.socket);
+			stream.socket = InvalidSocket;
+		}
+		stream.incoming = vector<uint8>();
+		stream.incomingTaken = 0;
+		stream.outgoing = vector<uint8>();
+	}
+
+	void AppendMessage(vector<uint8>& outgoing, vector<uint8> const& bytes)
+	{
+		uint32 size = uint32(bytes.size());
+		uint8 const length[] = { uint8(size), uint8(size >> 8), uint8(size >> 16), uint8(size >> 24) };
+		outgoing.insert(outgoing.end(), length, length + 4);
+		outgoing.insert(outgoing.end(), bytes.begin(), bytes.end());
+	}
+
+	/*
+	*	@return: false if the connection failed.
+	*/
+	bool WritePending(Stream& stream)
+	{
+		size_t sent = 0;
+		while (sent < stream.outgoing.size())
+		{
+			int chunk = int(min<size_t>(stream.outgoing.size() - sent, 1 << 20));
+			int written = ::send(stream.socket, reinterpret_cast<char const*>(stream.outgoing.data() + sent), chunk, SendFlags);
+			if (written <= 0)
+			{
+				if (written < 0 && WouldBlock())
+				{
+					break;
+				}
+				return false;
+			}
+			sent += size_t(written);
+		}
+		stream.outgoing.erase(stream.outgoing.begin(), stream.outgoing.begin() + sent);
+		return true;
+	}
+
+	/*
+	*	@return: false if the peer closed the connection or it failed.
+	*/
+	bool ReadAvailable(Stream& stream)
+	{
+		for (;;)
+		{
+			uint8 buffer[16 * 1024];
+			int read = ::recv(stream.socket, reinterpret_cast<char*>(buffer), sizeof(buffer), 0);
+			if (read <= 0)
+			{
+				return read < 0 && WouldBlock();
+			}
+			stream.incoming.insert(stream.incoming.end(), buffer, buffer + read);
+		}
+	}
+
+	/*
+	*	@return: false if the stream holds a message larger than MaxMessageSize.
+	*/
+	template <class Function>
+	bool TakeMessages(Stream& stream, Function onMessage)
+	{
+		uint8 const* bytes = stream.incoming.data();
+		size_t available = stream.incoming.size();
+		size_t& taken = stream.incomingTaken;
+		while (available - taken >= 4)
+		{
+			uint8 const* length = bytes + taken;
+			uint32 size = length[0] | (length[1] << 8) | (length[2] << 16) | (uint32(length[3]) << 24);
+			if (size > SocketTransport::MaxMessageSize)
+			{
+				return false;
+			}
+			if (available - taken - 4 < size)
+			{
+				break;
+			}
+			onMessage(vector<uint8>(length + 4, length + 4 + size));
+			taken += 4 + size;
+		}
+		// Moved down once per read instead of once per message.
+		stream.incoming.erase(stream.incoming.begin(), stream.incoming.begin() + taken);
+		taken = 0;
+		return true;
+	}
+
+	sint32 MillisecondsUntil(chrono::steady_clock::time_point deadline)
+	{
+		chrono::steady_clock::duration left = deadline - chrono::steady_clock::now();
+		if (left <= chrono::steady_clock::duration::zero())
+		{
+			return 0;
+		}
+		// Rounded up, polling until just before the deadline would spin through the last millisecond.
+		return sint32(min<sint64>(chrono::duration_cast<chrono::milliseconds>(left).count() + 1, 1000 * 1000));
+	}
+}
+
+struct SocketTransportImpl : public SocketTransport
+{
+	SocketHandle listen_ = InvalidSocket;
+	uint16 port_ = 0;
+
+	// Send comes from the match jobs, everything the streams hold is shared with them.
+	mutex mutex_;
+	vector<Stream> connections_;
+	deque<uint32> accepted_;
+	vector<ServerPacket> received_;
+	vector<pollfd> polled_;
+	vector<uint32> polledConnections_;
+
+	~SocketTransportImpl()
+	{
+		for (Stream& connection : connections_)
+		{
+			CloseStream(connection);
+		}
+		if (listen_ != InvalidSocket)
+		{
+			CloseSocket(listen_);
+		}
+	}
+
+	bool Listen(uint16 port)
+	{
+		StartSockets();
+		listen_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (listen_ == InvalidSocket)
+		{
+			return false;
+		}
+		int enable = 1;
+		::setsockopt(listen_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<char const*>(&enable), sizeof(enable));
+		sockaddr_in address = LoopbackAddress(port);
+		if (::bind(listen_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listen_, SOMAXCONN) != 0)
+		{
+			return false;
+		}
+		socklen_t size = sizeof(address);
+		if (::getsockname(listen_, reinterpret_cast<sockaddr*>(&address), &size) != 0)
+		{
+			return false;
+		}
+		port_ = ntohs(address.sin_port);
+		SetNonBlocking(listen_);
+		return true;
+	}
+
+	/*
+	*	Waits until any socket is ready or the deadline passed, then accepts, reads and writes what it can.
+	*/
+	void Step(chrono::steady_clock::time_point deadline)
+	{
+		{
+			lock_guard<mutex> lock(mutex_);
+			polled_.clear();
+			polledConnections_.clear();
+			polled_.push_back({ listen_, POLLIN, 0 });
+			for (uint32 index = 0; index < connections_.size(); ++index)
+			{
+				Stream const& connection = connections_[index];
+				if (connection.socket != InvalidSocket)
+				{
+					polled_.push_back({ connection.socket, short(POLLIN | (connection.outgoing.empty() ? 0 : POLLOUT)), 0 });
+					polledConnections_.push_back(index);
+				}
+			}
+		}
+		if (PollSockets(polled_.data(), polled_.size(), MillisecondsUntil(deadline)) <= 0)
+		{
+			return;
+		}
+
+		lock_guard<mutex> lock(mutex_);
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		for (size_t index = 1; index < polled_.size(); ++index)
+		{
+			if (polled_[index].revents == 0)
+			{
+				continue;
+			}
+			uint32 id = polledConnections_[index - 1];
+			Stream& connection = connections_[id];
+			// Closed by a Send that failed while this thread was polling.
+			if (connection.socket == InvalidSocket)
+			{
+				continue;
+			}
+			bool open = ReadAvailable(connection);
+			// What arrived before the close is still delivered.
+			bool valid = TakeMessages(connection, [this, id, now](vector<uint8> bytes)
+			{
+				received_.push_back({ id, move(bytes), now });
+			});
+			if (!open || !valid || !WritePending(connection))
+			{
+				CloseStream(connection);
+			}
+		}
+		if (polled_[0].revents != 0)
+		{
+			for (SocketHandle client = ::accept(listen_, nullptr, nullptr); client != InvalidSocket; client = ::accept(listen_, nullptr, nullptr))
+			{
+				connections_.push_back(OpenStream(client));
+				accepted_.push_back(uint32(connections_.size() - 1));
+			}
+		}
+	}
+
+	virtual uint16 GetPort() const override
+	{
+		return port_;
+	}
+
+	virtual bool Accept(uint32& connection, chrono::steady_clock::time_point deadline) override
+	{
+		for (;;)
+		{
+			{
+				lock_guard<mutex> lock(mutex_);
+				if (!accepted_.empty())
+				{
+					connection = accepted_.front();
+					accepted_.pop_front();
+					return true;
+				}
+			}
+			if (chrono::steady_clock::now() >= deadline)
+			{
+				return false;
+			}
+			Step(deadline);
+		}
+	}
+
+	virtual void Receive(vector<ServerPacket>& packets, chrono::steady_clock::time_point deadline) override
+	{
+		for (;;)
+		{
+			{
+				lock_guard<mutex> lock(mutex_);
+				if (!received_.empty() || chrono::steady_clock::now() >= deadline)
+				{
+					move(received_.begin(), received_.end(), back_inserter(packets));
+					received_.clear();
+					return;
+				}
+			}
+			Step(deadline);
+		}
+	}
+
+	virtual void Send(uint32 connection, vector<uint8> bytes) override
+	{
+		lock_guard<mutex> lock(mutex_);
+		if (connection >= connections_.size() || connections_[connection].socket == InvalidSocket)
+		{
+			return;
+		}
+		Stream& stream = connections_[connection];
+		AppendMessage(stream.outgoing, bytes);
+		if (!WritePending(stream))
+		{
+			CloseStream(stream);
+		}
+	}
+};
+
+Ptr<SocketTransport> SocketTransport::Listen(uint16 port)
+{
+	Ptr<SocketTransportImpl> transport = CreatePtr<SocketTransportImpl>();
+	if (!transport->Listen(port))
+	{
+		return nullptr;
+	}
+	return transport;
+}
+
+struct SocketClientImpl : public SocketClient
+{
+	Stream stream_ = { InvalidSocket, {}, 0, {} };
+
+	~SocketClientImpl()
+	{
+		CloseStream(stream_);
+	}
+
+	bool Connect(uint16 port)
+	{
+		StartSockets();
+		SocketHandle socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (socket == InvalidSocket)
+		{
+			return false;
+		}
+		sockaddr_in address = LoopbackAddress(port);
+		if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			CloseSocket(socket);
+			return false;
+		}
+		stream_ = OpenStream(socket);
+		return true;
+	}
+
+	virtual bool Send(vector<uint8> const& bytes) override
+	{
+		if (stream_.socket == InvalidSocket)
+		{
+			return false;
+		}
+		AppendMessage(stream_.outgoing, bytes);
+		while (!stream_.outgoing.empty())
+		{
+			pollfd writable = { stream_.socket, POLLOUT, 0 };
+			if (!WritePending(stream_) || (!stream_.outgoing.empty() && PollSockets(&writable, 1, -1) < 0))
+			{
+				CloseStream(stream_);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	virtual bool Receive(vector<vector<uint8>>& messages) override
+	{
+		if (stream_.socket == InvalidSocket)
+		{
+			return false;
+		}
+		bool open = ReadAvailable(stream_);
+		// What arrived before the close is still delivered.
+		if (!TakeMessages(stream_, [&messages](vector<uint8> bytes) { messages.push_back(move(bytes)); }) || !open)
+		{
+			CloseStream(stream_);
+			return false;
+		}
+		return true;
+	}
+};
+
+Ptr<SocketClient> SocketClient::Connect(uint16 port)
+{
+	Ptr<SocketClientImpl> client = CreatePtr<SocketClientImpl>();
+	if (!client->Connect(port))
+	{
+		return nullptr;
+	}
+	return client;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "ServerTransport.h"
+#include <chrono>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Clients over TCP on 127.0.0.1. Every message goes as a 4 byte little endian length and its bytes, messages larger
+	*	than MaxMessageSize close the connection.
+	*
+	*	Receive does all the socket work: it accepts clients, reads and writes. Send writes right away what fits the
+	*	socket buffer, the rest goes out in the next Receive. Connections are numbered in the order they were accepted,
+	*	a closed one keeps its number and Send to it does nothing.
+	*/
+	class SocketTransport : public ServerTransport
+	{
+	public:
+		static uint32 const MaxMessageSize = 64 * 1024;
+
+		/*
+		*	@port: 0 picks a free one, see GetPort.
+		*	@return: nullptr if the port can not be listened on.
+		*/
+		static Ptr<SocketTransport> Listen(uint16 port);
+
+		virtual uint16 GetPort() const = 0;
+
+		/*
+		*	Waits for the next client that was not returned yet, messages it sends meanwhile wait for Receive.
+		*	@return: false if none connected before the deadline.
+		*/
+		virtual bool Accept(uint32& connection, std::chrono::steady_clock::time_point deadline) = 0;
+	};
+
+	/*
+	*	The other end of a SocketTransport connection, for bots and tests.
+	*/
+	class SocketClient : public ReferenceCountBase<true>
+	{
+	public:
+		/*
+		*	@return: nullptr if nothing listens on the port.
+		*/
+		static Ptr<SocketClient> Connect(uint16 port);
+
+		/*
+		*	Waits until the message is in the socket buffer.
+		*	@return: false once the connection is closed.
+		*/
+		virtual bool Send(std::vector<uint8> const& bytes) = 0;
+
+		/*
+		*	Appends the messages that arrived without waiting.
+		*	@return: false once the connection is closed.
+		*/
+		virtual bool Receive(std::vector<std::vector<uint8>>& messages) = 0;
+	};
+}
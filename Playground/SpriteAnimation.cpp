@@ -0,0 +1,368 @@
+#include "SpriteAnimation.h"
+#include <cassert>
+#include <cfloat>
+#include <utility>
+#include <emmintrin.h>
+
+using namespace std;
+using namespace X;
+
+AnimationClip::AnimationClip(vector<Frame> frames, float32 framesPerSecond, bool looping) :
+	_frames(move(frames)),
+	_framesPerSecond(framesPerSecond),
+	_looping(looping)
+{
+	assert(!_frames.empty());
+	assert(_framesPerSecond > 0);
+}
+
+
+SpriteAnimationSystem::SpriteAnimationSystem() :
+	_awakeCount(0),
+	_visibleLeft(-FLT_MAX),
+	_visibleTop(-FLT_MAX),
+	_visibleRight(FLT_MAX),
+	_visibleBottom(FLT_MAX)
+{
+}
+
+SpriteAnimationSystem::ClipID SpriteAnimationSystem::RegisterClip(Ptr<AnimationClip> clip)
+{
+	ClipRange range;
+	range.firstKey = uint32(_keySprites.size());
+	range.keyCount = uint32(clip->GetFrames().size());
+	range.framesPerSecond = clip->GetFramesPerSecond();
+	range.looping = clip->IsLooping();
+	for (auto const& frame : clip->GetFrames())
+	{
+		_keySprites.push_back(frame.spriteIndex);
+		_keyOffsetX.push_back(frame.offsetX);
+		_keyOffsetY.push_back(frame.offsetY);
+	}
+	_clipRanges.push_back(range);
+	_clips.push_back(move(clip));
+	return ClipID(_clips.size() - 1);
+}
+
+SpriteAnimationSystem::InstanceID SpriteAnimationSystem::CreateInstance(ClipID clip, float32 x, float32 y)
+{
+	InstanceID instance;
+	if (!_freeInstances.empty())
+	{
+		instance = _freeInstances.back();
+		_freeInstances.pop_back();
+	}
+	else
+	{
+		instance = InstanceID(_instanceToSlot.size());
+		_instanceToSlot.push_back(0);
+	}
+
+	// New instances start asleep at the end, Play decides whether they wake up.
+	uint32 slot = uint32(_slotToInstance.size());
+	_instanceToSlot[instance] = slot;
+	_slotToInstance.push_back(instance);
+	_phase.push_back(0);
+	_rate.push_back(0);
+	_speed.push_back(1);
+	_frameCount.push_back(1);
+	_loopMask.push_back(0);
+	_firstKey.push_back(0);
+	_clip.push_back(clip);
+	_x.push_back(x);
+	_y.push_back(y);
+	_finished.push_back(0);
+	_frameIndex.push_back(0);
+	_fraction.push_back(0);
+	_spriteIndex.push_back(0);
+	_offsetX.push_back(0);
+	_offsetY.push_back(0);
+
+	Play(instance, clip, true);
+	return instance;
+}
+
+void SpriteAnimationSystem::DestroyInstance(InstanceID instance)
+{
+	RemoveSlot(_instanceToSlot[instance]);
+	_freeInstances.push_back(instance);
+}
+
+void SpriteAnimationSystem::Play(InstanceID instance, ClipID clip, bool restart)
+{
+	uint32 slot = _instanceToSlot[instance];
+	ClipRange const& range = _clipRanges[clip];
+	if (restart || _clip[slot] != clip)
+	{
+		_phase[slot] = 0;
+	}
+	_clip[slot] = clip;
+	_rate[slot] = range.framesPerSecond * _speed[slot];
+	_frameCount[slot] = float32(range.keyCount);
+	_loopMask[slot] = range.looping ? ~0u : 0u;
+	_firstKey[slot] = range.firstKey;
+	_finished[slot] = 0;
+
+	SampleSlot(slot, 0);
+	ResolveFrames(slot, slot + 1);
+	if (slot >= _awakeCount && !ShouldSleep(slot))
+	{
+		WakeUp(slot);
+	}
+}
+
+void SpriteAnimationSystem::SetSpeed(InstanceID instance, float32 speed)
+{
+	assert(speed >= 0);
+	uint32 slot = _instanceToSlot[instance];
+	_speed[slot] = speed;
+	_rate[slot] = _clipRanges[_clip[slot]].framesPerSecond * speed;
+}
+
+void SpriteAnimationSystem::SetPosition(InstanceID instance, float32 x, float32 y)
+{
+	uint32 slot = _instanceToSlot[instance];
+	_x[slot] = x;
+	_y[slot] = y;
+	// Awake instances that left the region are put to sleep by the next Update.
+	if (slot >= _awakeCount && !ShouldSleep(slot))
+	{
+		WakeUp(slot);
+	}
+}
+
+void SpriteAnimationSystem::SetVisibleRegion(float32 left, float32 top, float32 right, float32 bottom, float32 margin)
+{
+	_visibleLeft = left - margin;
+	_visibleTop = top - margin;
+	_visibleRight = right + margin;
+	_visibleBottom = bottom + margin;
+
+	// Only a region change can wake instances that did not move, so the sleeping ones are scanned here instead of every frame.
+	for (uint32 slot = _awakeCount; slot < uint32(_slotToInstance.size()); ++slot)
+	{
+		if (!ShouldSleep(slot))
+		{
+			WakeUp(slot);
+		}
+	}
+}
+
+void SpriteAnimationSystem::Update(float32 deltaTime)
+{
+	SampleRange(0, _awakeCount, deltaTime);
+	ResolveFrames(0, _awakeCount);
+
+	// Walk downwards so that the slot swapped in by PutToSleep has already been visited.
+	for (uint32 slot = _awakeCount; slot-- > 0;)
+	{
+		if (ShouldSleep(slot))
+		{
+			PutToSleep(slot);
+		}
+	}
+}
+
+uint32 SpriteAnimationSystem::GetSpriteIndex(InstanceID instance) const
+{
+	return _spriteIndex[_instanceToSlot[instance]];
+}
+
+float32 SpriteAnimationSystem::GetOffsetX(InstanceID instance) const
+{
+	return _offsetX[_instanceToSlot[instance]];
+}
+
+float32 SpriteAnimationSystem::GetOffsetY(InstanceID instance) const
+{
+	return _offsetY[_instanceToSlot[instance]];
+}
+
+bool SpriteAnimationSystem::IsFinished(InstanceID instance) const
+{
+	return _finished[_instanceToSlot[instance]] != 0;
+}
+
+bool SpriteAnimationSystem::IsSleeping(InstanceID instance) const
+{
+	return _instanceToSlot[instance] >= _awakeCount;
+}
+
+// Advances the phase of 4 instances per iteration and splits it into frame index and tween fraction.
+// Looping clips wrap around, the others clamp on their last frame and get flagged as finished.
+void SpriteAnimationSystem::SampleRange(uint32 begin, uint32 end, float32 deltaTime)
+{
+	__m128 const dt = _mm_set1_ps(deltaTime);
+	__m128 const one = _mm_set1_ps(1.0f);
+
+	uint32 slot = begin;
+	for (; slot + 4 <= end; slot += 4)
+	{
+		__m128 phase = _mm_loadu_ps(&_phase[slot]);
+		__m128 rate = _mm_loadu_ps(&_rate[slot]);
+		__m128 count = _mm_loadu_ps(&_frameCount[slot]);
+		__m128 loop = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<__m128i const*>(&_loopMask[slot])));
+
+		phase = _mm_add_ps(phase, _mm_mul_ps(rate, dt));
+
+		// Phase is never negative, so truncation is floor.
+		__m128 wraps = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(phase, count)));
+		__m128 wrapped = _mm_sub_ps(phase, _mm_mul_ps(wraps, count));
+		__m128 last = _mm_sub_ps(count, one);
+		__m128 clamped = _mm_min_ps(phase, last);
+		__m128 finished = _mm_andnot_ps(loop, _mm_cmpge_ps(phase, last));
+
+		phase = _mm_or_ps(_mm_and_ps(loop, wrapped), _mm_andnot_ps(loop, clamped));
+		_mm_storeu_ps(&_phase[slot], phase);
+
+		__m128i index = _mm_cvttps_epi32(phase);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&_frameIndex[slot]), index);
+		_mm_storeu_ps(&_fraction[slot], _mm_sub_ps(phase, _mm_cvtepi32_ps(index)));
+
+		int finishedBits = _mm_movemask_ps(finished);
+		_finished[slot + 0] |= uint8(finishedBits & 1);
+		_finished[slot + 1] |= uint8((finishedBits >> 1) & 1);
+		_finished[slot + 2] |= uint8((finishedBits >> 2) & 1);
+		_finished[slot + 3] |= uint8((finishedBits >> 3) & 1);
+	}
+	for (; slot < end; ++slot)
+	{
+		SampleSlot(slot, deltaTime);
+	}
+}
+
+void SpriteAnimationSystem::SampleSlot(uint32 slot, float32 deltaTime)
+{
+	float32 phase = _phase[slot] + _rate[slot] * deltaTime;
+	float32 count = _frameCount[slot];
+	if (_loopMask[slot])
+	{
+		phase -= float32(uint32(phase / count)) * count;
+	}
+	else if (phase >= count - 1)
+	{
+		phase = count - 1;
+		_finished[slot] = 1;
+	}
+	_phase[slot] = phase;
+	_frameIndex[slot] = uint32(phase);
+	_fraction[slot] = phase - float32(_frameIndex[slot]);
+}
+
+// Gathers the two keys around each sampled frame and tweens the offsets between them, 4 instances at a time.
+void SpriteAnimationSystem::ResolveFrames(uint32 begin, uint32 end)
+{
+	alignas(16) float32 fromX[4], fromY[4], toX[4], toY[4], fraction[4];
+
+	for (uint32 slot = begin; slot < end; slot += 4)
+	{
+		uint32 lanes = end - slot < 4 ? end - slot : 4;
+		for (uint32 lane = 0; lane < 4; ++lane)
+		{
+			if (lane >= lanes)
+			{
+				fromX[lane] = fromY[lane] = toX[lane] = toY[lane] = fraction[lane] = 0;
+				continue;
+			}
+			uint32 s = slot + lane;
+			uint32 keyCount = uint32(_frameCount[s]);
+			uint32 frame = _frameIndex[s] < keyCount ? _frameIndex[s] : keyCount - 1; // rounding can land exactly on keyCount
+			uint32 from = _firstKey[s] + frame;
+			uint32 to = frame + 1 < keyCount ? from + 1 : (_loopMask[s] ? _firstKey[s] : from);
+
+			_spriteIndex[s] = _keySprites[from];
+			fromX[lane] = _keyOffsetX[from];
+			fromY[lane] = _keyOffsetY[from];
+			toX[lane] = _keyOffsetX[to];
+			toY[lane] = _keyOffsetY[to];
+			fraction[lane] = _fraction[s];
+		}
+
+		__m128 t = _mm_load_ps(fraction);
+		__m128 ax = _mm_load_ps(fromX);
+		__m128 ay = _mm_load_ps(fromY);
+		__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(toX), ax), t));
+		__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(toY), ay), t));
+		_mm_store_ps(toX, x);
+		_mm_store_ps(toY, y);
+		for (uint32 lane = 0; lane < lanes; ++lane)
+		{
+			_offsetX[slot + lane] = toX[lane];
+			_offsetY[slot + lane] = toY[lane];
+		}
+	}
+}
+
+bool SpriteAnimationSystem::ShouldSleep(uint32 slot) const
+{
+	return _finished[slot] != 0
+		|| _x[slot] < _visibleLeft || _x[slot] > _visibleRight
+		|| _y[slot] < _visibleTop || _y[slot] > _visibleBottom;
+}
+
+void SpriteAnimationSystem::PutToSleep(uint32 slot)
+{
+	assert(slot < _awakeCount);
+	--_awakeCount;
+	SwapSlots(slot, _awakeCount);
+}
+
+void SpriteAnimationSystem::WakeUp(uint32 slot)
+{
+	assert(slot >= _awakeCount);
+	SwapSlots(slot, _awakeCount);
+	++_awakeCount;
+}
+
+void SpriteAnimationSystem::SwapSlots(uint32 a, uint32 b)
+{
+	if (a == b)
+	{
+		return;
+	}
+	swap(_phase[a], _phase[b]);
+	swap(_rate[a], _rate[b]);
+	swap(_speed[a], _speed[b]);
+	swap(_frameCount[a], _frameCount[b]);
+	swap(_loopMask[a], _loopMask[b]);
+	swap(_firstKey[a], _firstKey[b]);
+	swap(_clip[a], _clip[b]);
+	swap(_x[a], _x[b]);
+	swap(_y[a], _y[b]);
+	swap(_finished[a], _finished[b]);
+	swap(_frameIndex[a], _frameIndex[b]);
+	swap(_fraction[a], _fraction[b]);
+	swap(_spriteIndex[a], _spriteIndex[b]);
+	swap(_offsetX[a], _offsetX[b]);
+	swap(_offsetY[a], _offsetY[b]);
+	swap(_slotToInstance[a], _slotToInstance[b]);
+	_instanceToSlot[_slotToInstance[a]] = a;
+	_instanceToSlot[_slotToInstance[b]] = b;
+}
+
+void SpriteAnimationSystem::RemoveSlot(uint32 slot)
+{
+	if (slot < _awakeCount)
+	{
+		PutToSleep(slot);
+		slot = _awakeCount;
+	}
+	SwapSlots(slot, uint32(_slotToInstance.size() - 1));
+
+	_phase.pop_back();
+	_rate.pop_back();
+	_speed.pop_back();
+	_frameCount.pop_back();
+	_loopMask.pop_back();
+	_firstKey.pop_back();
+	_clip.pop_back();
+	_x.pop_back();
+	_y.pop_back();
+	_finished.pop_back();
+	_frameIndex.pop_back();
+	_fraction.pop_back();
+	_spriteIndex.pop_back();
+	_offsetX.pop_back();
+	_offsetY.pop_back();
+	_slotToInstance.pop_back();
+}
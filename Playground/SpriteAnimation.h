@@ -0,0 +1,145 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Immutable animation data, shared by every instance that plays it.
+	*	Frames are evenly spaced in time, offsets are tweened linearly from one frame to the next.
+	*/
+	class AnimationClip : public ReferenceCountBase<true>
+	{
+	public:
+		struct Frame
+		{
+			uint32 spriteIndex;
+			float32 offsetX;
+			float32 offsetY;
+		};
+
+		AnimationClip(std::vector<Frame> frames, float32 framesPerSecond, bool looping);
+
+		std::vector<Frame> const& GetFrames() const
+		{
+			return _frames;
+		}
+		float32 GetFramesPerSecond() const
+		{
+			return _framesPerSecond;
+		}
+		bool IsLooping() const
+		{
+			return _looping;
+		}
+
+	private:
+		std::vector<Frame> const _frames;
+		float32 const _framesPerSecond;
+		bool const _looping;
+	};
+
+	/*
+	*	Plays clips for many sprites at once. Playback state is kept in packed arrays and sampled 4 instances at a time.
+	*	Awake instances are packed at the front of the arrays, finished or off-screen instances are moved behind them and skipped by Update.
+	*	Sleeping instances keep the last sampled frame, so finished clips still render their last frame.
+	*/
+	class SpriteAnimationSystem
+	{
+	public:
+		typedef uint32 ClipID;
+		typedef uint32 InstanceID;
+		static InstanceID const InvalidInstance = ~0u;
+
+		SpriteAnimationSystem();
+
+		ClipID RegisterClip(Ptr<AnimationClip> clip);
+
+		InstanceID CreateInstance(ClipID clip, float32 x, float32 y);
+		void DestroyInstance(InstanceID instance);
+
+		/*
+		*	@restart: if false and the instance is already playing the clip, keep the current phase.
+		*/
+		void Play(InstanceID instance, ClipID clip, bool restart = true);
+		void SetSpeed(InstanceID instance, float32 speed);
+		void SetPosition(InstanceID instance, float32 x, float32 y);
+
+		/*
+		*	Instances whose position is outside of this region (expanded by margin) go to sleep until they come back.
+		*/
+		void SetVisibleRegion(float32 left, float32 top, float32 right, float32 bottom, float32 margin);
+
+		void Update(float32 deltaTime);
+
+		uint32 GetSpriteIndex(InstanceID instance) const;
+		float32 GetOffsetX(InstanceID instance) const;
+		float32 GetOffsetY(InstanceID instance) const;
+		bool IsFinished(InstanceID instance) const;
+		bool IsSleeping(InstanceID instance) const;
+
+		uint32 GetInstanceCount() const
+		{
+			return uint32(_slotToInstance.size());
+		}
+		uint32 GetAwakeCount() const
+		{
+			return _awakeCount;
+		}
+
+	private:
+		void SampleRange(uint32 begin, uint32 end, float32 deltaTime);
+		void SampleSlot(uint32 slot, float32 deltaTime);
+		void ResolveFrames(uint32 begin, uint32 end);
+		bool ShouldSleep(uint32 slot) const;
+		void PutToSleep(uint32 slot);
+		void WakeUp(uint32 slot);
+		void SwapSlots(uint32 a, uint32 b);
+		void RemoveSlot(uint32 slot);
+
+		// Frames of all registered clips, concatenated.
+		std::vector<uint32> _keySprites;
+		std::vector<float32> _keyOffsetX;
+		std::vector<float32> _keyOffsetY;
+
+		struct ClipRange
+		{
+			uint32 firstKey;
+			uint32 keyCount;
+			float32 framesPerSecond;
+			bool looping;
+		};
+		std::vector<Ptr<AnimationClip>> _clips;
+		std::vector<ClipRange> _clipRanges;
+
+		// Per instance playback state, indexed by slot. Slots [0, _awakeCount) are awake.
+		std::vector<float32> _phase;		// in frames
+		std::vector<float32> _rate;			// frames per second * speed
+		std::vector<float32> _speed;
+		std::vector<float32> _frameCount;
+		std::vector<uint32> _loopMask;		// ~0u when looping
+		std::vector<uint32> _firstKey;
+		std::vector<ClipID> _clip;
+		std::vector<float32> _x;
+		std::vector<float32> _y;
+		std::vector<uint8> _finished;
+
+		// Sampled results, indexed by slot.
+		std::vector<uint32> _frameIndex;
+		std::vector<float32> _fraction;
+		std::vector<uint32> _spriteIndex;
+		std::vector<float32> _offsetX;
+		std::vector<float32> _offsetY;
+
+		std::vector<InstanceID> _slotToInstance;
+		std::vector<uint32> _instanceToSlot;
+		std::vector<InstanceID> _freeInstances;
+		uint32 _awakeCount;
+
+		float32 _visibleLeft;
+		float32 _visibleTop;
+		float32 _visibleRight;
+		float32 _visibleBottom;
+	};
+}
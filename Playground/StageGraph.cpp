@@ -0,0 +1,384 @@
+#include "StageGraph.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	StageGraph::StageID const NoStage = ~0u;
+
+	float64 MillisecondsSince(chrono::steady_clock::time_point origin)
+	{
+		return chrono::duration<float64, milli>(chrono::steady_clock::now() - origin).count();
+	}
+}
+
+StageGraph::StageGraph(JobSystem& jobs, uint32 framesInFlight) :
+	_jobs(jobs)
+{
+	if (framesInFlight == 0)
+	{
+		throw invalid_argument("StageGraph: at least one frame has to be in flight.");
+	}
+	_frames.resize(framesInFlight);
+	for (Frame& frame : _frames)
+	{
+		frame.frame = ~0ull;
+		frame.remaining = 0;
+	}
+}
+
+StageGraph::~StageGraph()
+{
+	try
+	{
+		Flush();
+	}
+	catch (...)
+	{
+		// Already reported by RunFrame if anyone was still calling it.
+	}
+}
+
+StageGraph::ResourceID StageGraph::DeclareResource(string name, uint32 copies)
+{
+	if (copies == 0)
+	{
+		throw invalid_argument("StageGraph: resource " + name + " needs at least one copy.");
+	}
+	_resources.push_back({ move(name), copies, NoStage, {} });
+	return ResourceID(_resources.size() - 1);
+}
+
+void StageGraph::AddDependency(StageID stage, StageID dependency)
+{
+	vector<StageID>& dependencies = _stages[stage].dependencies;
+	if (dependency != NoStage && dependency != stage && find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+	{
+		dependencies.push_back(dependency);
+	}
+}
+
+StageGraph::StageID StageGraph::Add(string name, Thread thread, function<void(uint64 frame)> work, initializer_list<ResourceID> reads,
+	initializer_list<ResourceID> writes)
+{
+	if (_compiled)
+	{
+		throw logic_error("StageGraph: " + name + " added after the first frame.");
+	}
+	for (ResourceID resource : reads)
+	{
+		if (resource >= _resources.size())
+		{
+			throw invalid_argument("StageGraph: " + name + " reads an undeclared resource.");
+		}
+	}
+	for (ResourceID resource : writes)
+	{
+		if (resource >= _resources.size())
+		{
+			throw invalid_argument("StageGraph: " + name + " writes an undeclared resource.");
+		}
+	}
+
+	StageID id = StageID(_stages.size());
+#ifndef SRPG_NO_PROFILER
+	char const* profileName = Profiler::InternName(name);
+#else
+	char const* profileName = nullptr;
+#endif
+	_stages.push_back({ move(name), thread, move(work), profileName, reads, writes, {}, {}, 0 });
+
+	// Within a frame: after the last writer of everything touched, and writers after the readers of the previous value.
+	for (ResourceID resource : reads)
+	{
+		AddDependency(id, _resources[resource].lastWriter);
+	}
+	for (ResourceID resource : writes)
+	{
+		AddDependency(id, _resources[resource].lastWriter);
+		for (StageID reader : _resources[resource].readersSinceWrite)
+		{
+			AddDependency(id, reader);
+		}
+	}
+	for (ResourceID resource : reads)
+	{
+		_resources[resource].readersSinceWrite.push_back(id);
+	}
+	for (ResourceID resource : writes)
+	{
+		_resources[resource].lastWriter = id;
+		_resources[resource].readersSinceWrite.clear();
+	}
+	return id;
+}
+
+void StageGraph::Compile()
+{
+	// Between frames every pair of stages conflicting on a resource is ordered, the stage of the later frame waits for
+	// the frame that last used the same copy. Further back than the frames in flight is always finished.
+	uint32 framesInFlight = uint32(_frames.size());
+	for (StageID id = 0; id < _stages.size(); ++id)
+	{
+		Stage& stage = _stages[id];
+		auto addPrevious = [&](StageID other, uint32 distance)
+		{
+			if (distance >= framesInFlight)
+			{
+				return;
+			}
+			for (PreviousFrameDependency const& dependency : stage.previousFrameDependencies)
+			{
+				if (dependency.stage == other && dependency.distance == distance)
+				{
+					return;
+				}
+			}
+			stage.previousFrameDependencies.push_back({ other, distance });
+		};
+
+		// A stage never runs for two frames at once.
+		addPrevious(id, 1);
+		for (StageID otherID = 0; otherID < _stages.size(); ++otherID)
+		{
+			Stage const& other = _stages[otherID];
+			for (ResourceID resource : stage.writes)
+			{
+				bool touched = find(other.reads.begin(), other.reads.end(), resource) != other.reads.end() ||
+					find(other.writes.begin(), other.writes.end(), resource) != other.writes.end();
+				if (touched)
+				{
+					addPrevious(otherID, _resources[resource].copies);
+				}
+			}
+			for (ResourceID resource : stage.reads)
+			{
+				if (find(other.writes.begin(), other.writes.end(), resource) != other.writes.end())
+				{
+					addPrevious(otherID, _resources[resource].copies);
+				}
+			}
+		}
+	}
+	_compiled = true;
+}
+
+void StageGraph::RunFrame()
+{
+	if (!_compiled)
+	{
+		Compile();
+	}
+
+	unique_lock<mutex> lock(_mutex);
+	uint64 frameNumber = _nextFrame;
+	uint32 framesInFlight = uint32(_frames.size());
+	if (frameNumber >= framesInFlight)
+	{
+		RunMainThreadUntilDone(lock, frameNumber - framesInFlight);
+	}
+	++_nextFrame;
+
+	Frame& frame = _frames[frameNumber % framesInFlight];
+	frame.frame = frameNumber;
+	frame.remaining = uint32(_stages.size());
+	frame.origin = chrono::steady_clock::now();
+	frame.instances.assign(_stages.size(), { 0, {}, false, false, 0, 0 });
+
+	vector<StageRef> ready;
+	for (StageID id = 0; id < _stages.size(); ++id)
+	{
+		Stage const& stage = _stages[id];
+		Instance& instance = frame.instances[id];
+		for (StageID dependency : stage.dependencies)
+		{
+			frame.instances[dependency].dependents.push_back({ frameNumber, id });
+			++instance.pendingDependencies;
+		}
+		for (PreviousFrameDependency const& dependency : stage.previousFrameDependencies)
+		{
+			if (dependency.distance > frameNumber)
+			{
+				continue;
+			}
+			Instance& previous = _frames[(frameNumber - dependency.distance) % framesInFlight].instances[dependency.stage];
+			if (!previous.done)
+			{
+				previous.dependents.push_back({ frameNumber, id });
+				++instance.pendingDependencies;
+			}
+		}
+		if (instance.pendingDependencies == 0)
+		{
+			ready.push_back({ frameNumber, id });
+		}
+	}
+	lock.unlock();
+	for (StageRef ref : ready)
+	{
+		Schedule(ref);
+	}
+	lock.lock();
+
+	if (frameNumber + 1 >= framesInFlight)
+	{
+		RunMainThreadUntilDone(lock, frameNumber + 1 - framesInFlight);
+	}
+	if (_exception)
+	{
+		exception_ptr exception = _exception;
+		_exception = nullptr;
+		rethrow_exception(exception);
+	}
+}
+
+void StageGraph::Flush()
+{
+	unique_lock<mutex> lock(_mutex);
+	if (_nextFrame > 0)
+	{
+		RunMainThreadUntilDone(lock, _nextFrame - 1);
+	}
+	if (_exception)
+	{
+		exception_ptr exception = _exception;
+		_exception = nullptr;
+		rethrow_exception(exception);
+	}
+}
+
+void StageGraph::RunMainThreadUntilDone(unique_lock<mutex>& lock, uint64 frameNumber)
+{
+	// Frames finish in order, every stage waits for itself in the frame before.
+	Frame const& frame = _frames[frameNumber % _frames.size()];
+	auto isDone = [&] { return frame.frame != frameNumber || frame.remaining == 0; };
+	for (;;)
+	{
+		_changed.wait(lock, [&] { return !_mainQueue.empty() || isDone(); });
+		if (_mainQueue.empty())
+		{
+			break;
+		}
+		StageRef ref = _mainQueue.front();
+		_mainQueue.erase(_mainQueue.begin());
+		lock.unlock();
+		Execute(ref);
+		lock.lock();
+	}
+}
+
+void StageGraph::Schedule(StageRef ref)
+{
+	if (_stages[ref.stage].thread == Thread::Main)
+	{
+		lock_guard<mutex> lock(_mutex);
+		_mainQueue.push_back(ref);
+		_changed.notify_all();
+	}
+	else
+	{
+		_jobs.Run([this, ref] { Execute(ref); }, nullptr);
+	}
+}
+
+void StageGraph::Execute(StageRef ref)
+{
+	// The frame cannot be reused before this stage is done, so it is safe to use outside the lock.
+	Frame& frame = _frames[ref.frame % _frames.size()];
+	Instance& instance = frame.instances[ref.stage];
+	instance.startMs = MillisecondsSince(frame.origin);
+	if (!instance.failed)
+	{
+		try
+		{
+			SRPG_PROFILE_ZONE(_stages[ref.stage].profileName);
+			_stages[ref.stage].work(ref.frame);
+		}
+		catch (...)
+		{
+			lock_guard<mutex> lock(_mutex);
+			if (!_exception)
+			{
+				_exception = current_exception();
+			}
+			instance.failed = true;
+		}
+	}
+	instance.endMs = MillisecondsSince(frame.origin);
+
+	vector<StageRef> ready;
+	{
+		lock_guard<mutex> lock(_mutex);
+		for (StageRef dependent : instance.dependents)
+		{
+			Instance& other = _frames[dependent.frame % _frames.size()].instances[dependent.stage];
+			if (dependent.frame == ref.frame)
+			{
+				other.failed = other.failed || instance.failed;
+			}
+			if (--other.pendingDependencies == 0)
+			{
+				ready.push_back(dependent);
+			}
+		}
+		instance.done = true;
+		if (--frame.remaining == 0)
+		{
+			FinishFrame(frame);
+		}
+		// Notified under the lock, Flush may return and the graph be gone as soon as the lock is released.
+		_changed.notify_all();
+	}
+	for (StageRef dependent : ready)
+	{
+		Schedule(dependent);
+	}
+}
+
+void StageGraph::FinishFrame(Frame& frame)
+{
+	_lastFrameTiming.frame = frame.frame;
+	_lastFrameTiming.durationMs = 0;
+	_lastFrameTiming.stages.clear();
+	for (StageID id = 0; id < _stages.size(); ++id)
+	{
+		Stage& stage = _stages[id];
+		Instance const& instance = frame.instances[id];
+		float64 durationMs = instance.endMs - instance.startMs;
+		stage.averageMs = frame.frame == 0 ? durationMs : stage.averageMs * 0.95 + durationMs * 0.05;
+		_lastFrameTiming.durationMs = max(_lastFrameTiming.durationMs, instance.endMs);
+		_lastFrameTiming.stages.push_back({ stage.name, instance.startMs, durationMs, stage.averageMs, stage.thread == Thread::Main, instance.failed });
+	}
+}
+
+uint64 StageGraph::GetFrame() const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _nextFrame;
+}
+
+StageGraph::FrameTiming StageGraph::GetLastFrameTiming() const
+{
+	lock_guard<mutex> lock(_mutex);
+	return _lastFrameTiming;
+}
+
+string StageGraph::FormatLastFrameTiming() const
+{
+	FrameTiming timing = GetLastFrameTiming();
+	char line[256];
+	snprintf(line, sizeof(line), "Frame %llu: %.2f ms\n", (unsigned long long)timing.frame, timing.durationMs);
+	string text = line;
+	for (StageTiming const& stage : timing.stages)
+	{
+		snprintf(line, sizeof(line), "%9.2f %9.2f %9.2f  %-6s %s%s\n", stage.startMs, stage.durationMs, stage.averageMs,
+			stage.mainThread ? "main" : "worker", stage.name.c_str(), stage.skipped ? " (skipped)" : "");
+		text += line;
+	}
+	return text;
+}
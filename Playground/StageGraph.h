@@ -0,0 +1,170 @@
+#pragma once
+#include "BasicType.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	A frame as a graph of stages that declare the resources they read and write. The order follows from the
+	*	declarations: a stage runs after the stages added before it that write what it reads, or touch what it writes.
+	*	Stages without such a conflict run concurrently, worker stages on the job system, main thread stages (input,
+	*	submit, present) on the thread calling RunFrame.
+	*
+	*	Up to framesInFlight frames run at once. A stage of the next frame starts as soon as the same stage of this
+	*	frame is done and no stage of this frame still uses the resources it conflicts on, so input and simulation of
+	*	the next frame can overlap submit and present of this one. Resources declared with more than one copy are
+	*	cycled per frame, stages pick theirs with the frame number, and only conflict with the frame using the same copy.
+	*/
+	class StageGraph
+	{
+	public:
+		typedef uint32 StageID;
+		typedef uint32 ResourceID;
+
+		enum class Thread
+		{
+			Main,
+			Worker,
+		};
+
+		struct StageTiming
+		{
+			std::string name;
+			float64 startMs;		// relative to the start of the frame
+			float64 durationMs;
+			float64 averageMs;
+			bool mainThread;
+			bool skipped;			// a stage it depends on in the same frame threw
+		};
+
+		struct FrameTiming
+		{
+			uint64 frame;
+			float64 durationMs;
+			std::vector<StageTiming> stages;
+		};
+
+		/*
+		*	@framesInFlight: 1 runs the frames one after another.
+		*/
+		StageGraph(JobSystem& jobs, uint32 framesInFlight = 2);
+
+		/*
+		*	Waits for the frames still in flight.
+		*/
+		~StageGraph();
+
+		StageGraph(StageGraph const&) = delete;
+		StageGraph& operator=(StageGraph const&) = delete;
+
+		/*
+		*	@copies: frames using the resource at once, copy frame % copies belongs to a frame.
+		*/
+		ResourceID DeclareResource(std::string name, uint32 copies = 1);
+
+		/*
+		*	Stages can only be added before the first frame.
+		*/
+		StageID Add(std::string name, Thread thread, std::function<void(uint64 frame)> work, std::initializer_list<ResourceID> reads,
+			std::initializer_list<ResourceID> writes);
+
+		/*
+		*	Starts the next frame and runs main thread stages until only framesInFlight - 1 frames are left unfinished.
+		*	If a stage threw, the stages depending on it in its frame are skipped and the exception is rethrown here.
+		*/
+		void RunFrame();
+
+		/*
+		*	Runs main thread stages until every started frame is done.
+		*/
+		void Flush();
+
+		uint64 GetFrame() const;
+
+		/*
+		*	The last finished frame.
+		*/
+		FrameTiming GetLastFrameTiming() const;
+		std::string FormatLastFrameTiming() const;
+
+	private:
+		struct Resource
+		{
+			std::string name;
+			uint32 copies;
+			StageID lastWriter;
+			std::vector<StageID> readersSinceWrite;
+		};
+
+		struct PreviousFrameDependency
+		{
+			StageID stage;
+			uint32 distance;
+		};
+
+		struct Stage
+		{
+			std::string name;
+			Thread thread;
+			std::function<void(uint64 frame)> work;
+			char const* profileName;
+			std::vector<ResourceID> reads;
+			std::vector<ResourceID> writes;
+			std::vector<StageID> dependencies;
+			std::vector<PreviousFrameDependency> previousFrameDependencies;
+			float64 averageMs;
+		};
+
+		struct StageRef
+		{
+			uint64 frame;
+			StageID stage;
+		};
+
+		struct Instance
+		{
+			uint32 pendingDependencies;
+			std::vector<StageRef> dependents;
+			bool done;
+			bool failed;
+			float64 startMs;
+			float64 endMs;
+		};
+
+		struct Frame
+		{
+			uint64 frame;
+			uint32 remaining;
+			std::chrono::steady_clock::time_point origin;
+			std::vector<Instance> instances;
+		};
+
+		void Compile();
+		void AddDependency(StageID stage, StageID dependency);
+		void Schedule(StageRef ref);
+		void Execute(StageRef ref);
+		void FinishFrame(Frame& frame);
+		void RunMainThreadUntilDone(std::unique_lock<std::mutex>& lock, uint64 frame);
+
+		JobSystem& _jobs;
+		std::vector<Resource> _resources;
+		std::vector<Stage> _stages;
+		bool _compiled = false;
+
+		mutable std::mutex _mutex;
+		std::condition_variable _changed;
+		std::vector<Frame> _frames;
+		uint64 _nextFrame = 0;
+		std::vector<StageRef> _mainQueue;
+		std::exception_ptr _exception;
+		FrameTiming _lastFrameTiming = {};
+	};
+}
@@ -0,0 +1,157 @@
+#include "StartupGraph.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace std;
+using namespace X;
+
+StartupGraph::TaskID StartupGraph::Add(string name, Thread thread, function<void()> work, initializer_list<TaskID> dependencies)
+{
+	TaskID id = TaskID(_tasks.size());
+	for (TaskID dependency : dependencies)
+	{
+		// Only tasks added earlier can be depended on, which keeps the graph free of cycles.
+		if (dependency >= id)
+		{
+			throw invalid_argument("StartupGraph: " + name + " depends on a task that was not added before it.");
+		}
+		_tasks[dependency].dependents.push_back(id);
+	}
+	_tasks.push_back({ move(name), thread, move(work), {}, uint32(dependencies.size()), false, false, 0, 0 });
+	return id;
+}
+
+float64 StartupGraph::Now() const
+{
+	return chrono::duration<float64, milli>(chrono::steady_clock::now() - _origin).count();
+}
+
+void StartupGraph::Run(JobSystem& jobs)
+{
+	_origin = chrono::steady_clock::now();
+	_finishedCount = 0;
+	_exception = nullptr;
+	// Roots are collected first, once a task runs it starts counting down the dependencies of others.
+	vector<TaskID> roots;
+	for (TaskID id = 0; id < _tasks.size(); ++id)
+	{
+		if (_tasks[id].pendingDependencies == 0)
+		{
+			roots.push_back(id);
+		}
+	}
+	for (TaskID id : roots)
+	{
+		Schedule(jobs, id);
+	}
+
+	unique_lock<mutex> lock(_mutex);
+	for (;;)
+	{
+		_changed.wait(lock, [this] { return !_mainQueue.empty() || _finishedCount == _tasks.size(); });
+		if (_mainQueue.empty())
+		{
+			break;
+		}
+		TaskID id = _mainQueue.front();
+		_mainQueue.erase(_mainQueue.begin());
+		lock.unlock();
+		Execute(jobs, id);
+		lock.lock();
+	}
+
+	if (_exception)
+	{
+		rethrow_exception(_exception);
+	}
+}
+
+void StartupGraph::Schedule(JobSystem& jobs, TaskID id)
+{
+	if (_tasks[id].thread == Thread::Main)
+	{
+		// Notified under the lock, Run may return and the graph be gone as soon as the lock is released.
+		lock_guard<mutex> lock(_mutex);
+		_mainQueue.push_back(id);
+		_changed.notify_all();
+	}
+	else
+	{
+		jobs.Run([this, &jobs, id] { Execute(jobs, id); }, nullptr);
+	}
+}
+
+void StartupGraph::Execute(JobSystem& jobs, TaskID id)
+{
+	Task& task = _tasks[id];
+	task.startMs = Now();
+	task.skipped = task.failed;
+	if (!task.skipped)
+	{
+		try
+		{
+			task.work();
+		}
+		catch (...)
+		{
+			lock_guard<mutex> lock(_mutex);
+			if (!_exception)
+			{
+				_exception = current_exception();
+			}
+			task.failed = true;
+		}
+	}
+	task.endMs = Now();
+
+	vector<TaskID> ready;
+	{
+		lock_guard<mutex> lock(_mutex);
+		for (TaskID dependent : task.dependents)
+		{
+			_tasks[dependent].failed = _tasks[dependent].failed || task.failed;
+			if (--_tasks[dependent].pendingDependencies == 0)
+			{
+				ready.push_back(dependent);
+			}
+		}
+		++_finishedCount;
+		_changed.notify_all();
+	}
+	for (TaskID dependent : ready)
+	{
+		Schedule(jobs, dependent);
+	}
+}
+
+void StartupGraph::Mark(string name)
+{
+	float64 now = Now();
+	_marks.push_back({ move(name), now, now, true, false });
+}
+
+vector<StartupGraph::Timing> StartupGraph::GetTimeline() const
+{
+	vector<Timing> timeline;
+	for (Task const& task : _tasks)
+	{
+		timeline.push_back({ task.name, task.startMs, task.endMs, task.thread == Thread::Main, task.skipped });
+	}
+	stable_sort(timeline.begin(), timeline.end(), [](Timing const& a, Timing const& b) { return a.startMs < b.startMs; });
+	timeline.insert(timeline.end(), _marks.begin(), _marks.end());
+	return timeline;
+}
+
+string StartupGraph::FormatTimeline() const
+{
+	string text = "Startup timeline (ms):\n";
+	for (Timing const& timing : GetTimeline())
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "%9.2f %9.2f %9.2f  %-6s %s%s\n", timing.startMs, timing.endMs, timing.endMs - timing.startMs,
+			timing.mainThread ? "main" : "worker", timing.name.c_str(), timing.skipped ? " (skipped)" : "");
+		text += line;
+	}
+	return text;
+}
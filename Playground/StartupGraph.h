@@ -0,0 +1,91 @@
+#pragma once
+#include "BasicType.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Startup as a dependency graph. A task starts as soon as the tasks it depends on are done, worker tasks run on the
+	*	job system and main thread tasks (the window, anything that owns it) on the thread calling Run.
+	*
+	*	Every task is timed relative to the start of Run, Mark adds later milestones such as the first presented frame.
+	*/
+	class StartupGraph
+	{
+	public:
+		typedef uint32 TaskID;
+
+		enum class Thread
+		{
+			Main,
+			Worker,
+		};
+
+		struct Timing
+		{
+			std::string name;
+			float64 startMs;
+			float64 endMs;
+			bool mainThread;
+			bool skipped;		// a task it depends on threw
+		};
+
+		/*
+		*	@dependencies: tasks added before this one.
+		*/
+		TaskID Add(std::string name, Thread thread, std::function<void()> work, std::initializer_list<TaskID> dependencies = {});
+
+		/*
+		*	Runs the graph once and returns when every task is done. If a task throws, the tasks depending on it are skipped and the first exception
+		*	is rethrown here once the others have finished.
+		*/
+		void Run(JobSystem& jobs);
+
+		/*
+		*	Adds a zero length entry at the current time to the timeline.
+		*/
+		void Mark(std::string name);
+
+		/*
+		*	Tasks in the order they started.
+		*/
+		std::vector<Timing> GetTimeline() const;
+		std::string FormatTimeline() const;
+
+	private:
+		struct Task
+		{
+			std::string name;
+			Thread thread;
+			std::function<void()> work;
+			std::vector<TaskID> dependents;
+			uint32 pendingDependencies;
+			bool failed;
+			bool skipped;
+			float64 startMs;
+			float64 endMs;
+		};
+
+		void Schedule(JobSystem& jobs, TaskID id);
+		void Execute(JobSystem& jobs, TaskID id);
+		float64 Now() const;
+
+		std::vector<Task> _tasks;
+		std::vector<Timing> _marks;
+		std::chrono::steady_clock::time_point _origin;
+
+		std::mutex _mutex;
+		std::condition_variable _changed;
+		std::vector<TaskID> _mainQueue;
+		uint32 _finishedCount = 0;
+		std::exception_ptr _exception;
+	};
+}
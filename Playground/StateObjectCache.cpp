@@ -0,0 +1,132 @@
+#include "StateObjectCache.h"
+#include "D3DHelper.h"
+
+using namespace std;
+using namespace X;
+
+StateObjectCache::StateObjectCache(ID3D11Device* device) :
+	_device(device),
+	_requests(0)
+{
+}
+
+template <class Desc, class State, class Create>
+ComPtr<State> StateObjectCache::FindOrCreate(Table<Desc, State>& table, Key<Desc> const& key, Create const& create)
+{
+	lock_guard<mutex> lock(_mutex);
+	++_requests;
+	auto found = table.find(key);
+	if (found != table.end())
+	{
+		return found->second;
+	}
+
+	ComPtr<State> state;
+	ThrowIfFailed(create(key.desc, &state));
+	table.emplace(key, state);
+	return state;
+}
+
+ComPtr<ID3D11BlendState> StateObjectCache::GetBlendState(D3D11_BLEND_DESC const& desc)
+{
+	// Every render target has padding after the UINT8 write mask, copy member by member so it stays zero.
+	Key<D3D11_BLEND_DESC> key;
+	memset(&key, 0, sizeof(key));
+	key.desc.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+	key.desc.IndependentBlendEnable = desc.IndependentBlendEnable;
+	for (uint32 i = 0; i < 8; ++i)
+	{
+		D3D11_RENDER_TARGET_BLEND_DESC const& target = desc.RenderTarget[i];
+		D3D11_RENDER_TARGET_BLEND_DESC& keyTarget = key.desc.RenderTarget[i];
+		keyTarget.BlendEnable = target.BlendEnable;
+		keyTarget.SrcBlend = target.SrcBlend;
+		keyTarget.DestBlend = target.DestBlend;
+		keyTarget.BlendOp = target.BlendOp;
+		keyTarget.SrcBlendAlpha = target.SrcBlendAlpha;
+		keyTarget.DestBlendAlpha = target.DestBlendAlpha;
+		keyTarget.BlendOpAlpha = target.BlendOpAlpha;
+		keyTarget.RenderTargetWriteMask = target.RenderTargetWriteMask;
+	}
+
+	return FindOrCreate(_blendStates, key, [this](D3D11_BLEND_DESC const& keyDesc, ID3D11BlendState** state)
+	{
+		return _device->CreateBlendState(&keyDesc, state);
+	});
+}
+
+ComPtr<ID3D11RasterizerState> StateObjectCache::GetRasterizerState(D3D11_RASTERIZER_DESC const& desc)
+{
+	Key<D3D11_RASTERIZER_DESC> key;
+	memset(&key, 0, sizeof(key));
+	key.desc.FillMode = desc.FillMode;
+	key.desc.CullMode = desc.CullMode;
+	key.desc.FrontCounterClockwise = desc.FrontCounterClockwise;
+	key.desc.DepthBias = desc.DepthBias;
+	key.desc.DepthBiasClamp = desc.DepthBiasClamp;
+	key.desc.SlopeScaledDepthBias = desc.SlopeScaledDepthBias;
+	key.desc.DepthClipEnable = desc.DepthClipEnable;
+	key.desc.ScissorEnable = desc.ScissorEnable;
+	key.desc.MultisampleEnable = desc.MultisampleEnable;
+	key.desc.AntialiasedLineEnable = desc.AntialiasedLineEnable;
+
+	return FindOrCreate(_rasterizerStates, key, [this](D3D11_RASTERIZER_DESC const& keyDesc, ID3D11RasterizerState** state)
+	{
+		return _device->CreateRasterizerState(&keyDesc, state);
+	});
+}
+
+ComPtr<ID3D11DepthStencilState> StateObjectCache::GetDepthStencilState(D3D11_DEPTH_STENCIL_DESC const& desc)
+{
+	// D3D11_DEPTH_STENCIL_DESC has padding after the two UINT8 stencil masks, copy member by member so it stays zero.
+	Key<D3D11_DEPTH_STENCIL_DESC> key;
+	memset(&key, 0, sizeof(key));
+	key.desc.DepthEnable = desc.DepthEnable;
+	key.desc.DepthWriteMask = desc.DepthWriteMask;
+	key.desc.DepthFunc = desc.DepthFunc;
+	key.desc.StencilEnable = desc.StencilEnable;
+	key.desc.StencilReadMask = desc.StencilReadMask;
+	key.desc.StencilWriteMask = desc.StencilWriteMask;
+	key.desc.FrontFace = desc.FrontFace;
+	key.desc.BackFace = desc.BackFace;
+
+	return FindOrCreate(_depthStencilStates, key, [this](D3D11_DEPTH_STENCIL_DESC const& keyDesc, ID3D11DepthStencilState** state)
+	{
+		return _device->CreateDepthStencilState(&keyDesc, state);
+	});
+}
+
+ComPtr<ID3D11SamplerState> StateObjectCache::GetSamplerState(D3D11_SAMPLER_DESC const& desc)
+{
+	Key<D3D11_SAMPLER_DESC> key;
+	memset(&key, 0, sizeof(key));
+	key.desc.Filter = desc.Filter;
+	key.desc.AddressU = desc.AddressU;
+	key.desc.AddressV = desc.AddressV;
+	key.desc.AddressW = desc.AddressW;
+	key.desc.MipLODBias = desc.MipLODBias;
+	key.desc.MaxAnisotropy = desc.MaxAnisotropy;
+	key.desc.ComparisonFunc = desc.ComparisonFunc;
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		key.desc.BorderColor[i] = desc.BorderColor[i];
+	}
+	key.desc.MinLOD = desc.MinLOD;
+	key.desc.MaxLOD = desc.MaxLOD;
+
+	return FindOrCreate(_samplerStates, key, [this](D3D11_SAMPLER_DESC const& keyDesc, ID3D11SamplerState** state)
+	{
+		return _device->CreateSamplerState(&keyDesc, state);
+	});
+}
+
+StateObjectCache::Statistics StateObjectCache::GetStatistics() const
+{
+	lock_guard<mutex> lock(_mutex);
+	Statistics statistics;
+	statistics.blendStates = uint32(_blendStates.size());
+	statistics.rasterizerStates = uint32(_rasterizerStates.size());
+	statistics.depthStencilStates = uint32(_depthStencilStates.size());
+	statistics.samplerStates = uint32(_samplerStates.size());
+	statistics.requests = _requests;
+	return statistics;
+}
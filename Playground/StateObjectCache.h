@@ -0,0 +1,87 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "ComPtr.h"
+#include <d3d11.h>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace X
+{
+	/*
+	*	Creates each distinct blend, rasterizer, depth-stencil and sampler state only once per device.
+	*	Descriptors are hashed by value, equal descriptors return the same state object.
+	*	Safe to use from several threads.
+	*/
+	class StateObjectCache : public ReferenceCountBase<true>
+	{
+	public:
+		struct Statistics
+		{
+			uint32 blendStates;
+			uint32 rasterizerStates;
+			uint32 depthStencilStates;
+			uint32 samplerStates;
+			uint64 requests;	// all Get calls, including the ones that created a state
+		};
+
+		explicit StateObjectCache(ID3D11Device* device);
+
+		ComPtr<ID3D11BlendState> GetBlendState(D3D11_BLEND_DESC const& desc);
+		ComPtr<ID3D11RasterizerState> GetRasterizerState(D3D11_RASTERIZER_DESC const& desc);
+		ComPtr<ID3D11DepthStencilState> GetDepthStencilState(D3D11_DEPTH_STENCIL_DESC const& desc);
+		ComPtr<ID3D11SamplerState> GetSamplerState(D3D11_SAMPLER_DESC const& desc);
+
+		/*
+		*	Created counts are the number of distinct states, they never go down while the cache lives.
+		*/
+		Statistics GetStatistics() const;
+
+	private:
+		/*
+		*	Descriptors are compared and hashed as bytes. Keys are zeroed and then filled member by member, a copy of the whole
+		*	descriptor would bring along whatever the caller left in its padding.
+		*/
+		template <class Desc>
+		struct Key
+		{
+			Desc desc;
+
+			bool operator==(Key const& other) const
+			{
+				return memcmp(&desc, &other.desc, sizeof(Desc)) == 0;
+			}
+		};
+
+		template <class Desc>
+		struct KeyHash
+		{
+			size_t operator()(Key<Desc> const& key) const
+			{
+				// FNV-1a
+				uint8 const* bytes = reinterpret_cast<uint8 const*>(&key.desc);
+				uint64 hash = 14695981039346656037ull;
+				for (size_t i = 0; i < sizeof(Desc); ++i)
+				{
+					hash = (hash ^ bytes[i]) * 1099511628211ull;
+				}
+				return size_t(hash);
+			}
+		};
+
+		template <class Desc, class State>
+		using Table = std::unordered_map<Key<Desc>, ComPtr<State>, KeyHash<Desc>>;
+
+		template <class Desc, class State, class Create>
+		ComPtr<State> FindOrCreate(Table<Desc, State>& table, Key<Desc> const& key, Create const& create);
+
+		ID3D11Device* _device;
+		mutable std::mutex _mutex;
+		Table<D3D11_BLEND_DESC, ID3D11BlendState> _blendStates;
+		Table<D3D11_RASTERIZER_DESC, ID3D11RasterizerState> _rasterizerStates;
+		Table<D3D11_DEPTH_STENCIL_DESC, ID3D11DepthStencilState> _depthStencilStates;
+		Table<D3D11_SAMPLER_DESC, ID3D11SamplerState> _samplerStates;
+		uint64 _requests;
+	};
+}
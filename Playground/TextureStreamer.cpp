@@ -0,0 +1,330 @@
+#include "TextureStreamer.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+using namespace std;
+using namespace X;
+
+bool X::DecodeTGA(uint8 const* file, size_t size, TextureData& texture)
+{
+	size_t const HeaderSize = 18;
+	if (size < HeaderSize)
+	{
+		return false;
+	}
+	uint8 idLength = file[0];
+	uint8 colorMapType = file[1];
+	uint8 imageType = file[2];
+	uint32 width = file[12] | (file[13] << 8);
+	uint32 height = file[14] | (file[15] << 8);
+	uint8 bitsPerPixel = file[16];
+	uint8 descriptor = file[17];
+
+	bool compressed = imageType == 10;
+	if (colorMapType != 0 || (imageType != 2 && !compressed) || (bitsPerPixel != 24 && bitsPerPixel != 32) || width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	uint32 bytesPerPixel = bitsPerPixel / 8;
+	uint32 pixelCount = width * height;
+	uint8 const* read = file + HeaderSize + idLength;
+	uint8 const* end = file + size;
+
+	texture.width = width;
+	texture.height = height;
+	texture.pixels.resize(size_t(pixelCount) * 4);
+	uint8* write = texture.pixels.data();
+
+	// TGA stores BGR(A), the device wants RGBA.
+	auto copyPixel = [bytesPerPixel](uint8 const* bgra, uint8* rgba)
+	{
+		rgba[0] = bgra[2];
+		rgba[1] = bgra[1];
+		rgba[2] = bgra[0];
+		rgba[3] = bytesPerPixel == 4 ? bgra[3] : 0xFF;
+	};
+
+	uint32 pixel = 0;
+	while (pixel < pixelCount)
+	{
+		uint32 run = 1;
+		bool repeat = false;
+		if (compressed)
+		{
+			if (read >= end)
+			{
+				return false;
+			}
+			run = (*read & 0x7F) + 1;
+			repeat = (*read & 0x80) != 0;
+			++read;
+			if (pixel + run > pixelCount)
+			{
+				return false;
+			}
+		}
+		size_t bytesNeeded = repeat ? bytesPerPixel : size_t(run) * bytesPerPixel;
+		if (size_t(end - read) < bytesNeeded)
+		{
+			return false;
+		}
+		for (uint32 i = 0; i < run; ++i)
+		{
+			copyPixel(read, write);
+			write += 4;
+			if (!repeat)
+			{
+				read += bytesPerPixel;
+			}
+		}
+		if (repeat)
+		{
+			read += bytesPerPixel;
+		}
+		pixel += run;
+	}
+
+	// Bit 5 of the descriptor set means the first row is the top one, otherwise rows are stored bottom up.
+	if ((descriptor & 0x20) == 0)
+	{
+		uint32 rowSize = width * 4;
+		vector<uint8> row(rowSize);
+		for (uint32 y = 0; y < height / 2; ++y)
+		{
+			uint8* top = texture.pixels.data() + size_t(y) * rowSize;
+			uint8* bottom = texture.pixels.data() + size_t(height - 1 - y) * rowSize;
+			memcpy(row.data(), top, rowSize);
+			memcpy(top, bottom, rowSize);
+			memcpy(bottom, row.data(), rowSize);
+		}
+	}
+	return true;
+}
+
+TextureStreamer::TextureStreamer(Ptr<TextureDevice> device, Ptr<JobSystem> jobs, uint64 uploadBudgetPerFrame, Loader loader) :
+	_device(move(device)),
+	_jobs(move(jobs)),
+	_loader(loader ? move(loader) : Loader(&TextureStreamer::LoadFile)),
+	_uploadBudget(uploadBudgetPerFrame),
+	_uploadedBytesLastFrame(0),
+	_placeholder(nullptr)
+{
+	// Magenta and gray checker, obvious on screen but small enough to create synchronously.
+	uint32 const PlaceholderSize = 8;
+	vector<uint8> pixels(PlaceholderSize * PlaceholderSize * 4);
+	for (uint32 y = 0; y < PlaceholderSize; ++y)
+	{
+		for (uint32 x = 0; x < PlaceholderSize; ++x)
+		{
+			uint8* p = &pixels[(y * PlaceholderSize + x) * 4];
+			bool odd = ((x / 2) ^ (y / 2)) & 1;
+			p[0] = odd ? 0xFF : 0x80;
+			p[1] = odd ? 0x00 : 0x80;
+			p[2] = odd ? 0xFF : 0x80;
+			p[3] = 0xFF;
+		}
+	}
+	_placeholder = _device->CreateTexture(PlaceholderSize, PlaceholderSize, pixels.data());
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	_jobs->Wait(_inFlight);
+
+	// Creations that finished after the last Update were never published.
+	for (auto const& created : _created)
+	{
+		if (created.texture)
+		{
+			_device->ReleaseTexture(created.texture);
+		}
+	}
+	for (auto const& entry : _entries)
+	{
+		if (entry.state == State::Resident)
+		{
+			_device->ReleaseTexture(entry.texture);
+		}
+	}
+	if (_placeholder)
+	{
+		_device->ReleaseTexture(_placeholder);
+	}
+}
+
+TextureStreamer::TextureHandle TextureStreamer::Request(string const& path)
+{
+	auto found = _handles.find(path);
+	if (found != _handles.end())
+	{
+		return found->second;
+	}
+
+	TextureHandle handle = TextureHandle(_entries.size());
+	_entries.push_back({ path, State::Loading, nullptr });
+	_handles.emplace(path, handle);
+
+	_jobs->Run([this, handle, path]
+	{
+		Decoded decoded;
+		decoded.handle = handle;
+		decoded.succeeded = _loader(path, decoded.data);
+
+		lock_guard<mutex> lock(_mutex);
+		_decoded.push_back(move(decoded));
+	}, &_inFlight);
+
+	return handle;
+}
+
+void TextureStreamer::Cancel(TextureHandle texture)
+{
+	Entry& entry = _entries[texture];
+	switch (entry.state)
+	{
+	case State::WaitingForUpload:
+		for (auto waiting = _waitingForUpload.begin(); waiting != _waitingForUpload.end(); ++waiting)
+		{
+			if (waiting->handle == texture)
+			{
+				_waitingForUpload.erase(waiting);
+				break;
+			}
+		}
+		break;
+	case State::Resident:
+		_device->ReleaseTexture(entry.texture);
+		break;
+	default:
+		// Loading and uploading ones are dropped when their jobs report back in Update.
+		break;
+	}
+	entry.state = State::Cancelled;
+	entry.texture = nullptr;
+
+	auto found = _handles.find(entry.path);
+	if (found != _handles.end() && found->second == texture)
+	{
+		_handles.erase(found);
+	}
+}
+
+void* TextureStreamer::GetTexture(TextureHandle texture) const
+{
+	Entry const& entry = _entries[texture];
+	return entry.state == State::Resident ? entry.texture : _placeholder;
+}
+
+bool TextureStreamer::IsResident(TextureHandle texture) const
+{
+	return _entries[texture].state == State::Resident;
+}
+
+void TextureStreamer::SetUploadBudget(uint64 bytesPerFrame)
+{
+	_uploadBudget = bytesPerFrame;
+}
+
+void TextureStreamer::Update()
+{
+	deque<Decoded> decoded;
+	vector<Created> created;
+	{
+		lock_guard<mutex> lock(_mutex);
+		decoded.swap(_decoded);
+		created.swap(_created);
+	}
+
+	for (auto const& item : created)
+	{
+		Entry& entry = _entries[item.handle];
+		if (entry.state == State::Cancelled)
+		{
+			if (item.texture)
+			{
+				_device->ReleaseTexture(item.texture);
+			}
+			continue;
+		}
+		entry.texture = item.texture;
+		entry.state = item.texture ? State::Resident : State::Failed;
+	}
+
+	for (auto& item : decoded)
+	{
+		Entry& entry = _entries[item.handle];
+		if (entry.state == State::Cancelled)
+		{
+			continue;
+		}
+		if (item.succeeded)
+		{
+			entry.state = State::WaitingForUpload;
+			_waitingForUpload.push_back(move(item));
+		}
+		else
+		{
+			entry.state = State::Failed;
+		}
+	}
+
+	uint64 uploadedBytes = 0;
+	while (!_waitingForUpload.empty())
+	{
+		uint64 size = uint64(_waitingForUpload.front().data.pixels.size());
+		if (uploadedBytes > 0 && uploadedBytes + size > _uploadBudget)
+		{
+			break;
+		}
+		uploadedBytes += size;
+
+		Decoded item = move(_waitingForUpload.front());
+		_waitingForUpload.pop_front();
+		_entries[item.handle].state = State::Uploading;
+
+		// D3D11 resource creation is free-threaded, the initial data upload happens on the worker as well.
+		auto data = make_shared<Decoded>(move(item));
+		_jobs->Run([this, data]
+		{
+			void* texture = _device->CreateTexture(data->data.width, data->data.height, data->data.pixels.data());
+
+			lock_guard<mutex> lock(_mutex);
+			_created.push_back({ data->handle, texture });
+		}, &_inFlight);
+	}
+	_uploadedBytesLastFrame = uploadedBytes;
+}
+
+TextureStreamer::Statistics TextureStreamer::GetStatistics() const
+{
+	Statistics statistics = {};
+	for (auto const& entry : _entries)
+	{
+		switch (entry.state)
+		{
+		case State::Loading: ++statistics.loading; break;
+		case State::WaitingForUpload: ++statistics.waitingForUpload; break;
+		case State::Uploading: ++statistics.uploading; break;
+		case State::Resident: ++statistics.resident; break;
+		case State::Failed: ++statistics.failed; break;
+		case State::Cancelled: ++statistics.cancelled; break;
+		}
+	}
+	statistics.uploadedBytesLastFrame = _uploadedBytesLastFrame;
+	return statistics;
+}
+
+bool TextureStreamer::LoadFile(string const& path, TextureData& texture)
+{
+	ifstream file(path, ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	vector<uint8> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	return DecodeTGA(bytes.data(), bytes.size(), texture);
+}
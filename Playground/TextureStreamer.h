@@ -0,0 +1,153 @@
+#pragma once
+#include "BasicType.h"
+#include "ReferenceCount.h"
+#include "JobSystem.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Decoded texture in system memory, always RGBA8.
+	*/
+	struct TextureData
+	{
+		uint32 width = 0;
+		uint32 height = 0;
+		std::vector<uint8> pixels;
+	};
+
+	/*
+	*	Decodes uncompressed and RLE compressed 24 / 32 bit TGA files.
+	*	@return: false if the format is not supported or the data is truncated.
+	*/
+	bool DecodeTGA(uint8 const* file, size_t size, TextureData& texture);
+
+	/*
+	*	The part of the graphics device the streamer uses, so that the scheduling can run against a fake device.
+	*	CreateTexture and ReleaseTexture are called from worker threads and have to be free-threaded.
+	*/
+	class TextureDevice : public ReferenceCountBase<true>
+	{
+	public:
+		virtual ~TextureDevice() = default;
+
+		/*
+		*	@return: the native texture to bind (an ID3D11ShaderResourceView* for D3D11), nullptr on failure.
+		*/
+		virtual void* CreateTexture(uint32 width, uint32 height, void const* rgbaPixels) = 0;
+		virtual void ReleaseTexture(void* texture) = 0;
+	};
+
+	/*
+	*	Loads textures without blocking the render thread.
+	*	Reading and decoding run on the job system. Decoded textures are admitted for creation in Update while the
+	*	per-frame upload budget lasts, and are created with their initial data on the job system as well.
+	*	Until a texture is resident, GetTexture returns a placeholder.
+	*
+	*	Request, GetTexture and Update must all be called from the same (render) thread.
+	*/
+	class TextureStreamer : public ReferenceCountBase<true>
+	{
+	public:
+		typedef uint32 TextureHandle;
+		typedef std::function<bool(std::string const& path, TextureData& texture)> Loader;
+
+		struct Statistics
+		{
+			uint32 loading;
+			uint32 waitingForUpload;
+			uint32 uploading;
+			uint32 resident;
+			uint32 failed;
+			uint32 cancelled;
+			uint64 uploadedBytesLastFrame;
+		};
+
+		/*
+		*	@loader: nullptr reads the file and decodes it as TGA.
+		*/
+		TextureStreamer(Ptr<TextureDevice> device, Ptr<JobSystem> jobs, uint64 uploadBudgetPerFrame, Loader loader = nullptr);
+		~TextureStreamer();
+
+		/*
+		*	Requesting the same path twice returns the same handle.
+		*/
+		TextureHandle Request(std::string const& path);
+
+		/*
+		*	The texture is not needed any more. Work still pending for it is dropped, a resident texture released. The
+		*	handle returns the placeholder from now on, requesting the path again starts over with a new handle.
+		*/
+		void Cancel(TextureHandle texture);
+
+		void* GetTexture(TextureHandle texture) const;
+		bool IsResident(TextureHandle texture) const;
+
+		/*
+		*	A texture larger than the budget is still admitted, but alone in its frame.
+		*/
+		void SetUploadBudget(uint64 bytesPerFrame);
+
+		void Update();
+
+		Statistics GetStatistics() const;
+
+	private:
+		enum class State
+		{
+			Loading,
+			WaitingForUpload,
+			Uploading,
+			Resident,
+			Failed,
+			Cancelled,
+		};
+
+		struct Entry
+		{
+			std::string path;
+			State state;
+			void* texture;
+		};
+
+		struct Decoded
+		{
+			TextureHandle handle;
+			TextureData data;
+			bool succeeded;
+		};
+
+		struct Created
+		{
+			TextureHandle handle;
+			void* texture;
+		};
+
+		static bool LoadFile(std::string const& path, TextureData& texture);
+
+		Ptr<TextureDevice> _device;
+		Ptr<JobSystem> _jobs;
+		Loader _loader;
+		uint64 _uploadBudget;
+		uint64 _uploadedBytesLastFrame;
+		void* _placeholder;
+
+		std::vector<Entry> _entries;
+		std::unordered_map<std::string, TextureHandle> _handles;
+
+		// Filled by worker threads, drained by Update.
+		std::mutex _mutex;
+		std::deque<Decoded> _decoded;
+		std::vector<Created> _created;
+
+		// Decoded textures that did not fit in the budget of their frame, oldest first.
+		std::deque<Decoded> _waitingForUpload;
+
+		JobCounter _inFlight;
+	};
+}
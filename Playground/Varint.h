@@ -0,0 +1,41 @@
+#pragma once
+#include "BasicType.h"
+#include <vector>
+
+namespace X
+{
+	/*
+	*	LEB128: 7 bits per byte, low bits first, the high bit marks that another byte follows.
+	*/
+	inline void AppendVarint(std::vector<uint8>& bytes, uint64 value)
+	{
+		while (value >= 0x80)
+		{
+			bytes.push_back(uint8(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(uint8(value));
+	}
+
+	/*
+	*	@return: false if the data ends inside the value or it does not fit into 64 bits.
+	*/
+	inline bool ReadVarint(uint8 const*& position, uint8 const* end, uint64& value)
+	{
+		value = 0;
+		for (uint32 shift = 0; shift < 64; shift += 7)
+		{
+			if (position == end)
+			{
+				return false;
+			}
+			uint8 byte = *position++;
+			value |= uint64(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,192 @@
+#include "VectorMath.h"
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace X;
+
+Mat4 Mat4::Identity()
+{
+	return
+	{ {
+		{ 1, 0, 0, 0 },
+		{ 0, 1, 0, 0 },
+		{ 0, 0, 1, 0 },
+		{ 0, 0, 0, 1 },
+	} };
+}
+
+Mat4 Mat4::Translation(Vec3 const& offset)
+{
+	Mat4 matrix = Identity();
+	matrix.m[3][0] = offset.x;
+	matrix.m[3][1] = offset.y;
+	matrix.m[3][2] = offset.z;
+	return matrix;
+}
+
+Mat4 Mat4::Scale(Vec3 const& scale)
+{
+	Mat4 matrix = Identity();
+	matrix.m[0][0] = scale.x;
+	matrix.m[1][1] = scale.y;
+	matrix.m[2][2] = scale.z;
+	return matrix;
+}
+
+Mat4 Mat4::RotationZ(float32 radians)
+{
+	float32 sine = sin(radians), cosine = cos(radians);
+	Mat4 matrix = Identity();
+	matrix.m[0][0] = cosine;
+	matrix.m[0][1] = sine;
+	matrix.m[1][0] = -sine;
+	matrix.m[1][1] = cosine;
+	return matrix;
+}
+
+Mat4 Mat4::OrthographicOffCenter(float32 left, float32 right, float32 bottom, float32 top, float32 zNear, float32 zFar)
+{
+	return
+	{ {
+		{ 2.0f / (right - left), 0, 0, 0 },
+		{ 0, 2.0f / (top - bottom), 0, 0 },
+		{ 0, 0, 1.0f / (zFar - zNear), 0 },
+		{ (right + left) / (left - right), (top + bottom) / (bottom - top), zNear / (zNear - zFar), 1 },
+	} };
+}
+
+Mat4 Mat4::operator*(Mat4 const& other) const
+{
+	// Row i of the product is row i of this combining the rows of other.
+	__m128 rows[4] = { _mm_load_ps(other.m[0]), _mm_load_ps(other.m[1]), _mm_load_ps(other.m[2]), _mm_load_ps(other.m[3]) };
+	Mat4 product;
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		__m128 row = _mm_mul_ps(_mm_set1_ps(m[i][0]), rows[0]);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m[i][1]), rows[1]));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m[i][2]), rows[2]));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(m[i][3]), rows[3]));
+		_mm_store_ps(product.m[i], row);
+	}
+	return product;
+}
+
+Mat4 Mat4::Transposed() const
+{
+	__m128 row0 = _mm_load_ps(m[0]), row1 = _mm_load_ps(m[1]), row2 = _mm_load_ps(m[2]), row3 = _mm_load_ps(m[3]);
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	Mat4 transposed;
+	_mm_store_ps(transposed.m[0], row0);
+	_mm_store_ps(transposed.m[1], row1);
+	_mm_store_ps(transposed.m[2], row2);
+	_mm_store_ps(transposed.m[3], row3);
+	return transposed;
+}
+
+Vec4 Mat4::Transform(Vec4 const& vector) const
+{
+	__m128 result = _mm_mul_ps(_mm_set1_ps(vector.x), _mm_load_ps(m[0]));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(vector.y), _mm_load_ps(m[1])));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(vector.z), _mm_load_ps(m[2])));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(vector.w), _mm_load_ps(m[3])));
+	return Vec4(result);
+}
+
+Vec3 Mat4::TransformPoint(Vec3 const& point) const
+{
+	return Transform(Vec4(point, 1)).GetXYZ();
+}
+
+Vec3 Mat4::TransformVector(Vec3 const& vector) const
+{
+	return Transform(Vec4(vector, 0)).GetXYZ();
+}
+
+void X::TransformPoints(Transform2D const& transform, float32 const* x, float32 const* y, float32* resultX, float32* resultY, size_t count)
+{
+	size_t index = 0;
+#ifdef __AVX__
+	{
+		__m256 a = _mm256_set1_ps(transform.a), b = _mm256_set1_ps(transform.b);
+		__m256 c = _mm256_set1_ps(transform.c), d = _mm256_set1_ps(transform.d);
+		__m256 tx = _mm256_set1_ps(transform.tx), ty = _mm256_set1_ps(transform.ty);
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256 px = _mm256_loadu_ps(x + index), py = _mm256_loadu_ps(y + index);
+			_mm256_storeu_ps(resultX + index, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, px), _mm256_mul_ps(c, py)), tx));
+			_mm256_storeu_ps(resultY + index, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b, px), _mm256_mul_ps(d, py)), ty));
+		}
+	}
+#endif
+	__m128 a = _mm_set1_ps(transform.a), b = _mm_set1_ps(transform.b);
+	__m128 c = _mm_set1_ps(transform.c), d = _mm_set1_ps(transform.d);
+	__m128 tx = _mm_set1_ps(transform.tx), ty = _mm_set1_ps(transform.ty);
+	for (; index + 4 <= count; index += 4)
+	{
+		__m128 px = _mm_loadu_ps(x + index), py = _mm_loadu_ps(y + index);
+		_mm_storeu_ps(resultX + index, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, px), _mm_mul_ps(c, py)), tx));
+		_mm_storeu_ps(resultY + index, _mm_add_ps(_mm_add_ps(_mm_mul_ps(b, px), _mm_mul_ps(d, py)), ty));
+	}
+	for (; index < count; ++index)
+	{
+		float32 px = x[index], py = y[index];
+		resultX[index] = transform.a * px + transform.c * py + transform.tx;
+		resultY[index] = transform.b * px + transform.d * py + transform.ty;
+	}
+}
+
+void X::TransformPoints(Transform2D const& transform, Vec2 const* points, Vec2* result, size_t count)
+{
+	static_assert(sizeof(Vec2) == 2 * sizeof(float32), "Vec2 arrays are loaded as floats.");
+	float32 const* source = &points->x;
+	float32* destination = &result->x;
+
+	// Two points per 128 bits, x0 y0 x1 y1: x' y' = x x * a b + y y * c d + tx ty.
+	size_t index = 0;
+#ifdef __AVX__
+	{
+		__m256 column0 = _mm256_setr_ps(transform.a, transform.b, transform.a, transform.b, transform.a, transform.b, transform.a, transform.b);
+		__m256 column1 = _mm256_setr_ps(transform.c, transform.d, transform.c, transform.d, transform.c, transform.d, transform.c, transform.d);
+		__m256 translation = _mm256_setr_ps(transform.tx, transform.ty, transform.tx, transform.ty, transform.tx, transform.ty, transform.tx,
+			transform.ty);
+		for (; index + 4 <= count; index += 4)
+		{
+			__m256 xy = _mm256_loadu_ps(source + index * 2);
+			__m256 xx = _mm256_permute_ps(xy, _MM_SHUFFLE(2, 2, 0, 0));
+			__m256 yy = _mm256_permute_ps(xy, _MM_SHUFFLE(3, 3, 1, 1));
+			_mm256_storeu_ps(destination + index * 2, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xx, column0), _mm256_mul_ps(yy, column1)), translation));
+		}
+	}
+#endif
+	__m128 column0 = _mm_setr_ps(transform.a, transform.b, transform.a, transform.b);
+	__m128 column1 = _mm_setr_ps(transform.c, transform.d, transform.c, transform.d);
+	__m128 translation = _mm_setr_ps(transform.tx, transform.ty, transform.tx, transform.ty);
+	for (; index + 2 <= count; index += 2)
+	{
+		__m128 xy = _mm_loadu_ps(source + index * 2);
+		__m128 xx = _mm_shuffle_ps(xy, xy, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128 yy = _mm_shuffle_ps(xy, xy, _MM_SHUFFLE(3, 3, 1, 1));
+		_mm_storeu_ps(destination + index * 2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, column0), _mm_mul_ps(yy, column1)), translation));
+	}
+	for (; index < count; ++index)
+	{
+		result[index] = transform.Apply(points[index]);
+	}
+}
+
+void X::TransformPoints(Mat4 const& matrix, Vec3 const* points, Vec4* result, size_t count)
+{
+	// One point per register already uses all four lanes. Transposing 4 points to x x x x, y y y y, z z z z and the
+	// results back measured a third slower, the shuffles of both transposes cost more than the broadcasts they save.
+	__m128 row0 = _mm_load_ps(matrix.m[0]), row1 = _mm_load_ps(matrix.m[1]), row2 = _mm_load_ps(matrix.m[2]), row3 = _mm_load_ps(matrix.m[3]);
+	for (size_t index = 0; index < count; ++index)
+	{
+		Vec3 const& point = points[index];
+		__m128 transformed = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(point.x), row0), row3);
+		transformed = _mm_add_ps(transformed, _mm_mul_ps(_mm_set1_ps(point.y), row1));
+		transformed = _mm_add_ps(transformed, _mm_mul_ps(_mm_set1_ps(point.z), row2));
+		_mm_store_ps(&result[index].x, transformed);
+	}
+}
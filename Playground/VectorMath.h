@@ -0,0 +1,273 @@
+#pragma once
+#include "BasicType.h"
+#include <cmath>
+#include <cstddef>
+#include <emmintrin.h>
+
+namespace X
+{
+	struct Vec2
+	{
+		float32 x;
+		float32 y;
+
+		Vec2() = default;
+		Vec2(float32 x, float32 y) :
+			x(x),
+			y(y)
+		{
+		}
+
+		Vec2 operator+(Vec2 other) const
+		{
+			return { x + other.x, y + other.y };
+		}
+		Vec2 operator-(Vec2 other) const
+		{
+			return { x - other.x, y - other.y };
+		}
+		Vec2 operator*(float32 scale) const
+		{
+			return { x * scale, y * scale };
+		}
+		Vec2 operator*(Vec2 other) const
+		{
+			return { x * other.x, y * other.y };
+		}
+		Vec2& operator+=(Vec2 other)
+		{
+			return *this = *this + other;
+		}
+		Vec2& operator-=(Vec2 other)
+		{
+			return *this = *this - other;
+		}
+
+		float32 Dot(Vec2 other) const
+		{
+			return x * other.x + y * other.y;
+		}
+		float32 Length() const
+		{
+			return std::sqrt(Dot(*this));
+		}
+	};
+
+	struct Vec3
+	{
+		float32 x;
+		float32 y;
+		float32 z;
+
+		Vec3() = default;
+		Vec3(float32 x, float32 y, float32 z) :
+			x(x),
+			y(y),
+			z(z)
+		{
+		}
+		Vec3(Vec2 xy, float32 z) :
+			x(xy.x),
+			y(xy.y),
+			z(z)
+		{
+		}
+
+		Vec3 operator+(Vec3 const& other) const
+		{
+			return { x + other.x, y + other.y, z + other.z };
+		}
+		Vec3 operator-(Vec3 const& other) const
+		{
+			return { x - other.x, y - other.y, z - other.z };
+		}
+		Vec3 operator*(float32 scale) const
+		{
+			return { x * scale, y * scale, z * scale };
+		}
+
+		float32 Dot(Vec3 const& other) const
+		{
+			return x * other.x + y * other.y + z * other.z;
+		}
+		Vec3 Cross(Vec3 const& other) const
+		{
+			return { y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x };
+		}
+		float32 Length() const
+		{
+			return std::sqrt(Dot(*this));
+		}
+	};
+
+	/*
+	*	Aligned so it loads into one SSE register.
+	*/
+	struct alignas(16) Vec4
+	{
+		float32 x;
+		float32 y;
+		float32 z;
+		float32 w;
+
+		Vec4() = default;
+		Vec4(float32 x, float32 y, float32 z, float32 w) :
+			x(x),
+			y(y),
+			z(z),
+			w(w)
+		{
+		}
+		Vec4(Vec3 const& xyz, float32 w) :
+			x(xyz.x),
+			y(xyz.y),
+			z(xyz.z),
+			w(w)
+		{
+		}
+		explicit Vec4(__m128 value)
+		{
+			_mm_store_ps(&x, value);
+		}
+
+		__m128 Load() const
+		{
+			return _mm_load_ps(&x);
+		}
+
+		Vec4 operator+(Vec4 const& other) const
+		{
+			return Vec4(_mm_add_ps(Load(), other.Load()));
+		}
+		Vec4 operator-(Vec4 const& other) const
+		{
+			return Vec4(_mm_sub_ps(Load(), other.Load()));
+		}
+		Vec4 operator*(float32 scale) const
+		{
+			return Vec4(_mm_mul_ps(Load(), _mm_set1_ps(scale)));
+		}
+		Vec4 operator*(Vec4 const& other) const
+		{
+			return Vec4(_mm_mul_ps(Load(), other.Load()));
+		}
+
+		float32 Dot(Vec4 const& other) const
+		{
+			return x * other.x + y * other.y + z * other.z + w * other.w;
+		}
+		Vec3 GetXYZ() const
+		{
+			return { x, y, z };
+		}
+	};
+
+	/*
+	*	Row major with points as row vectors, p * M, so the translation is in the last row and A * B applies A first.
+	*	The layout the shaders get as a float4x4 and multiply with mul(matrix, position).
+	*/
+	struct alignas(16) Mat4
+	{
+		float32 m[4][4];
+
+		static Mat4 Identity();
+		static Mat4 Translation(Vec3 const& offset);
+		static Mat4 Scale(Vec3 const& scale);
+		/*
+		*	@radians: counter clockwise when y points up.
+		*/
+		static Mat4 RotationZ(float32 radians);
+		/*
+		*	Maps [left, right] x [bottom, top] to [-1, 1] and [zNear, zFar] to [0, 1]. For pixel coordinates with y down,
+		*	bottom is the height and top 0.
+		*/
+		static Mat4 OrthographicOffCenter(float32 left, float32 right, float32 bottom, float32 top, float32 zNear, float32 zFar);
+
+		Mat4 operator*(Mat4 const& other) const;
+		Mat4 Transposed() const;
+
+		Vec4 Transform(Vec4 const& vector) const;
+		/*
+		*	w = 1, translated, without the divide by w.
+		*/
+		Vec3 TransformPoint(Vec3 const& point) const;
+		/*
+		*	w = 0, not translated.
+		*/
+		Vec3 TransformVector(Vec3 const& vector) const;
+	};
+
+	/*
+	*	2D affine transform for sprites and particles: x' = a * x + c * y + tx, y' = b * x + d * y + ty. Composes like
+	*	Mat4, A * B applies A first.
+	*/
+	struct Transform2D
+	{
+		float32 a, b;
+		float32 c, d;
+		float32 tx, ty;
+
+		static Transform2D Identity()
+		{
+			return { 1, 0, 0, 1, 0, 0 };
+		}
+		/*
+		*	Scaled first, then rotated, then moved to position.
+		*/
+		static Transform2D Make(Vec2 position, float32 radians, Vec2 scale)
+		{
+			float32 sine = std::sin(radians), cosine = std::cos(radians);
+			return { cosine * scale.x, sine * scale.x, -sine * scale.y, cosine * scale.y, position.x, position.y };
+		}
+
+		Transform2D operator*(Transform2D const& other) const
+		{
+			return
+			{
+				a * other.a + b * other.c, a * other.b + b * other.d,
+				c * other.a + d * other.c, c * other.b + d * other.d,
+				tx * other.a + ty * other.c + other.tx, tx * other.b + ty * other.d + other.ty,
+			};
+		}
+
+		Vec2 Apply(Vec2 point) const
+		{
+			return { a * point.x + c * point.y + tx, b * point.x + d * point.y + ty };
+		}
+
+		/*
+		*	The transform has to be invertible, no zero scale.
+		*/
+		Transform2D Inverse() const
+		{
+			float32 inverseDeterminant = 1.0f / (a * d - b * c);
+			float32 ia = d * inverseDeterminant, ib = -b * inverseDeterminant;
+			float32 ic = -c * inverseDeterminant, id = a * inverseDeterminant;
+			return { ia, ib, ic, id, -(tx * ia + ty * ic), -(tx * ib + ty * id) };
+		}
+
+		Mat4 ToMat4() const
+		{
+			return
+			{ {
+				{ a, b, 0, 0 },
+				{ c, d, 0, 0 },
+				{ 0, 0, 1, 0 },
+				{ tx, ty, 0, 1 },
+			} };
+		}
+	};
+
+	/*
+	*	Batch transforms, input and result may be the same arrays. The Transform2D ones use SSE, or AVX where the build
+	*	enables it (/arch:AVX, -mavx). Mat4 transforms one point per SSE register, which are all four lanes of the result.
+	*
+	*	Only the Vec2 one beats a plain loop of the scalar transform. The compiler vectorizes that loop for structures of
+	*	arrays and Mat4 as well as these do, they are at parity with it and keep the call sites short.
+	*
+	*	Structure of arrays, as the particle pools and sprite instances keep their positions.
+	*/
+	void TransformPoints(Transform2D const& transform, float32 const* x, float32 const* y, float32* resultX, float32* resultY, size_t count);
+	void TransformPoints(Transform2D const& transform, Vec2 const* points, Vec2* result, size_t count);
+	void TransformPoints(Mat4 const& matrix, Vec3 const* points, Vec4* result, size_t count);
+}
@@ -38,10 +38,7 @@ struct WindowImpl : public Window
 
 	LRESULT InstanceWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	{
-		if (messageHook_ != nullptr)
-		{
-			messageHook_(hWnd, message, wParam, lParam);
-		}
+		events_.Publish(WindowMessageEvent{ hWnd, uint32(message), uintptr_t(wParam), intptr_t(lParam) });
 
 		switch (message)
 		{
@@ -320,20 +317,16 @@ struct WindowImpl : public Window
 			}
 		}
 
-		messageIdle_ = nullptr;
-		onResize_ = nullptr;
+		events_.UnsubscribeAll();
 		inputHandler_ = nullptr;
-		messageHook_ = nullptr;
 	}
 
 	void OnResize(uint32 width, uint32 height)
 	{
 		width_ = width;
 		height_ = height;
-		if (onResize_)
-		{
-			onResize_(width, height);
-		}
+		// Inside the window procedure, maybe inside the modal sizing loop, too early to touch the swap chain.
+		events_.Queue(WindowResizeEvent{ width, height });
 	}
 
 	void OnKeyDown(uint32 winKey)
@@ -501,219 +494,15 @@ struct WindowImpl : public Window
 
 	void OnMessageIdle()
 	{
-		if (messageIdle_ != nullptr)
-		{
-			messageIdle_();
-		}
-	}
-
-	InputSemantic InputSemanticFromWindowsVK(uint32 winKey)
-	{
-		static vector<InputSemantic> mapping = []
-		{
-			uint32 const WindowsVKCount = 256;
-			vector<InputSemantic> mapping(WindowsVKCount, InputSemantic::InputSemanticInvalid);
-
-			mapping[0] = InputSemantic::NullSemantic;
-
-			mapping[VK_LBUTTON] = InputSemantic::M_Button0;
-			mapping[VK_RBUTTON] = InputSemantic::M_Button1;
-			mapping[VK_CANCEL] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_MBUTTON] = InputSemantic::M_Button2;
-			mapping[VK_XBUTTON1] = InputSemantic::M_Button3;
-			mapping[VK_XBUTTON2] = InputSemantic::M_Button4;
-
-			mapping[VK_BACK] = InputSemantic::K_BackSpace;
-			mapping[VK_TAB] = InputSemantic::K_Tab;
-			mapping[VK_CLEAR] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_RETURN] = InputSemantic::K_Enter;
-
-			mapping[VK_SHIFT] = InputSemantic::Temp_Shift;
-			mapping[VK_CONTROL] = InputSemantic::Temp_Ctrl;
-			mapping[VK_MENU] = InputSemantic::Temp_Alt;
-			mapping[VK_PAUSE] = InputSemantic::K_Pause;
-			mapping[VK_CAPITAL] = InputSemantic::K_CapsLock;
-
-			mapping[VK_KANA] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_HANGEUL] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_HANGUL] = InputSemantic::InputSemanticInvalid;
-
-			mapping[VK_JUNJA] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_FINAL] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_HANJA] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_KANJI] = InputSemantic::InputSemanticInvalid;
-
-			mapping[VK_ESCAPE] = InputSemantic::K_Escape;
-			mapping[VK_CONVERT] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_NONCONVERT] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_ACCEPT] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_MODECHANGE] = InputSemantic::InputSemanticInvalid;
-
-			mapping[VK_SPACE] = InputSemantic::K_Space;
-			mapping[VK_PRIOR] = InputSemantic::K_PageUp;
-			mapping[VK_NEXT] = InputSemantic::K_PageDown;
-			mapping[VK_END] = InputSemantic::K_End;
-			mapping[VK_HOME] = InputSemantic::K_Home;
-			mapping[VK_LEFT] = InputSemantic::K_LeftArrow;
-			mapping[VK_UP] = InputSemantic::K_UpArrow;
-			mapping[VK_RIGHT] = InputSemantic::K_RightArrow;
-			mapping[VK_DOWN] = InputSemantic::K_DownArrow;
-			mapping[VK_SELECT] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_PRINT] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_EXECUTE] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_SNAPSHOT] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_INSERT] = InputSemantic::K_Insert;
-			mapping[VK_DELETE] = InputSemantic::K_Delete;
-			mapping[VK_HELP] = InputSemantic::InputSemanticInvalid;
-
-			mapping['0'] = InputSemantic::K_0;
-			mapping['1'] = InputSemantic::K_1;
-			mapping['2'] = InputSemantic::K_2;
-			mapping['3'] = InputSemantic::K_3;
-			mapping['4'] = InputSemantic::K_4;
-			mapping['5'] = InputSemantic::K_5;
-			mapping['6'] = InputSemantic::K_6;
-			mapping['7'] = InputSemantic::K_7;
-			mapping['8'] = InputSemantic::K_8;
-			mapping['9'] = InputSemantic::K_9;
-
-			mapping['A'] = InputSemantic::K_A;
-			mapping['B'] = InputSemantic::K_B;
-			mapping['C'] = InputSemantic::K_C;
-			mapping['D'] = InputSemantic::K_D;
-			mapping['E'] = InputSemantic::K_E;
-			mapping['F'] = InputSemantic::K_F;
-			mapping['G'] = InputSemantic::K_G;
-
-			mapping['H'] = InputSemantic::K_H;
-			mapping['I'] = InputSemantic::K_I;
-			mapping['J'] = InputSemantic::K_J;
-			mapping['K'] = InputSemantic::K_K;
-			mapping['L'] = InputSemantic::K_L;
-			mapping['M'] = InputSemantic::K_M;
-			mapping['N'] = InputSemantic::K_N;
-
-			mapping['O'] = InputSemantic::K_O;
-			mapping['P'] = InputSemantic::K_P;
-			mapping['Q'] = InputSemantic::K_Q;
-			mapping['R'] = InputSemantic::K_R;
-			mapping['S'] = InputSemantic::K_S;
-			mapping['T'] = InputSemantic::K_T;
-
-			mapping['U'] = InputSemantic::K_U;
-			mapping['V'] = InputSemantic::K_V;
-			mapping['W'] = InputSemantic::K_W;
-			mapping['X'] = InputSemantic::K_X;
-			mapping['Y'] = InputSemantic::K_Y;
-			mapping['Z'] = InputSemantic::K_Z;
-
-			mapping[VK_LWIN] = InputSemantic::K_LeftWin;
-			mapping[VK_RWIN] = InputSemantic::K_RightWin;
-			mapping[VK_APPS] = InputSemantic::K_Apps;
-
-			mapping[VK_SLEEP] = InputSemantic::K_Sleep;
-
-			mapping[VK_NUMPAD0] = InputSemantic::K_NumPad0;
-			mapping[VK_NUMPAD1] = InputSemantic::K_NumPad1;
-			mapping[VK_NUMPAD2] = InputSemantic::K_NumPad2;
-			mapping[VK_NUMPAD3] = InputSemantic::K_NumPad3;
-			mapping[VK_NUMPAD4] = InputSemantic::K_NumPad4;
-			mapping[VK_NUMPAD5] = InputSemantic::K_NumPad5;
-			mapping[VK_NUMPAD6] = InputSemantic::K_NumPad6;
-			mapping[VK_NUMPAD7] = InputSemantic::K_NumPad7;
-			mapping[VK_NUMPAD8] = InputSemantic::K_NumPad8;
-			mapping[VK_NUMPAD9] = InputSemantic::K_NumPad9;
-
-			mapping[VK_MULTIPLY] = InputSemantic::K_NumPadAsterisk;
-			mapping[VK_ADD] = InputSemantic::K_NumPadPlus;
-			mapping[VK_SEPARATOR] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_SUBTRACT] = InputSemantic::K_NumPadMinus;
-			mapping[VK_DECIMAL] = InputSemantic::K_NumPadPeriod;
-			mapping[VK_DIVIDE] = InputSemantic::K_NumPadSlash;
-
-			mapping[VK_F1] = InputSemantic::K_F1;
-			mapping[VK_F2] = InputSemantic::K_F2;
-			mapping[VK_F3] = InputSemantic::K_F3;
-			mapping[VK_F4] = InputSemantic::K_F4;
-			mapping[VK_F5] = InputSemantic::K_F5;
-			mapping[VK_F6] = InputSemantic::K_F6;
-			mapping[VK_F7] = InputSemantic::K_F7;
-			mapping[VK_F8] = InputSemantic::K_F8;
-			mapping[VK_F9] = InputSemantic::K_F9;
-			mapping[VK_F10] = InputSemantic::K_F10;
-			mapping[VK_F11] = InputSemantic::K_F11;
-			mapping[VK_F12] = InputSemantic::K_F12;
-			mapping[VK_F13] = InputSemantic::K_F13;
-			mapping[VK_F14] = InputSemantic::K_F14;
-			mapping[VK_F15] = InputSemantic::K_F15;
-			mapping[VK_F16] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F17] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F18] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F19] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F20] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F21] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F22] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F23] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_F24] = InputSemantic::InputSemanticInvalid;
-
-			mapping[VK_NUMLOCK] = InputSemantic::K_NumLock;
-			mapping[VK_SCROLL] = InputSemantic::K_ScrollLock;
-
-			mapping[VK_OEM_NEC_EQUAL] = InputSemantic::K_NumPadEquals;
-
-
-			mapping[VK_LSHIFT] = InputSemantic::K_LeftShift;
-			mapping[VK_RSHIFT] = InputSemantic::K_RightShift;
-			mapping[VK_LCONTROL] = InputSemantic::K_LeftCtrl;
-			mapping[VK_RCONTROL] = InputSemantic::K_RightCtrl;
-			mapping[VK_LMENU] = InputSemantic::K_LeftAlt;
-			mapping[VK_RMENU] = InputSemantic::K_RightAlt;
-
-			mapping[VK_BROWSER_BACK] = InputSemantic::K_WebBack;
-			mapping[VK_BROWSER_FORWARD] = InputSemantic::K_WebForward;
-			mapping[VK_BROWSER_REFRESH] = InputSemantic::K_WebRefresh;
-			mapping[VK_BROWSER_STOP] = InputSemantic::K_WebStop;
-			mapping[VK_BROWSER_SEARCH] = InputSemantic::K_WebSearch;
-			mapping[VK_BROWSER_FAVORITES] = InputSemantic::K_WebFavorites;
-			mapping[VK_BROWSER_HOME] = InputSemantic::K_WebHome;
-
-			mapping[VK_VOLUME_MUTE] = InputSemantic::K_Mute;
-			mapping[VK_VOLUME_DOWN] = InputSemantic::K_VolumeUp;
-			mapping[VK_VOLUME_UP] = InputSemantic::K_VolumeDown;
-			mapping[VK_MEDIA_NEXT_TRACK] = InputSemantic::K_NextTrack;
-			mapping[VK_MEDIA_PREV_TRACK] = InputSemantic::K_PrevTrack;
-			mapping[VK_MEDIA_STOP] = InputSemantic::K_MediaStop;
-			mapping[VK_MEDIA_PLAY_PAUSE] = InputSemantic::K_PlayPause;
-			mapping[VK_LAUNCH_MAIL] = InputSemantic::K_Mail;
-			mapping[VK_LAUNCH_MEDIA_SELECT] = InputSemantic::K_MediaSelect;
-			mapping[VK_LAUNCH_APP1] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_LAUNCH_APP2] = InputSemantic::InputSemanticInvalid;
-
-			mapping[VK_OEM_1] = InputSemantic::K_Semicolon;
-			mapping[VK_OEM_PLUS] = InputSemantic::InputSemanticInvalid;
-			mapping[VK_OEM_COMMA] = InputSemantic::K_Comma;
-			mapping[VK_OEM_MINUS] = InputSemantic::K_Minus;
-			mapping[VK_OEM_PERIOD] = InputSemantic::K_Period;
-			mapping[VK_OEM_2] = InputSemantic::K_Slash;
-			mapping[VK_OEM_3] = InputSemantic::K_Tilde;
-
-			mapping[VK_OEM_4] = InputSemantic::K_LeftBracket;
-			mapping[VK_OEM_5] = InputSemantic::K_BackSlash;
-			mapping[VK_OEM_6] = InputSemantic::K_RightBracket;
-			mapping[VK_OEM_7] = InputSemantic::K_Quote;
-			mapping[VK_OEM_8] = InputSemantic::InputSemanticInvalid;
-
-			return mapping;
-		} ();
-
-		return mapping[winKey];
+		events_.Dispatch();
+		events_.Publish(WindowIdleEvent{});
 	}
 
 
 
 
 	HWND hWnd_ = nullptr;
-	std::function<void(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)> messageHook_;
+	WindowEvents events_;
 
 	bool leftShift_ = false;
 	bool rightShift_ = false;
@@ -739,10 +528,6 @@ struct WindowImpl : public Window
 
 	wstring name_;
 
-	function<void()> messageIdle_;
-
-	function<void(uint32 width, uint32 height)> onResize_;
-
 	Ptr<InputHandler> inputHandler_;
 };
 
@@ -757,10 +542,10 @@ Ptr<Window> Window::Create(wstring title, Size2UI size)
 	return CreatePtr<WindowImpl>(move(title), size);
 }
 
-void Window::SetRawWindowsMessageHook(void const* hook)
+WindowEvents& Window::GetEvents()
 {
 	auto thiz = static_cast<WindowImpl*>(this);
-	thiz->messageHook_ = *static_cast<std::function<void(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)> const*>(hook);
+	return thiz->events_;
 }
 
 
@@ -781,18 +566,6 @@ void Window::Recreate()
 	thiz->DoRecreate();
 }
 
-void Window::SetMessageIdle(function<void()> messageIdle)
-{
-	auto thiz = static_cast<WindowImpl*>(this);
-	thiz->messageIdle_ = move(messageIdle);
-}
-
-void Window::SetResizeHandler(function<void(uint32 width, uint32 height)> onResize)
-{
-	auto thiz = static_cast<WindowImpl*>(this);
-	thiz->onResize_ = move(onResize);
-}
-
 void Window::SetInputHandler(Ptr<InputHandler> inputHanlder)
 {
 	auto thiz = static_cast<WindowImpl*>(this);
@@ -884,3 +657,12 @@ void Window::SetTitleText(std::wstring const& text)
 	::SetWindowText(thiz->hWnd_, text.c_str());
 }
 
+void Window::SetTitleText(char const* text)
+{
+	sint32 length = ::MultiByteToWideChar(CP_UTF8, 0, text, -1, nullptr, 0);
+	std::wstring title(length > 0 ? length : 1, L'\0');
+	::MultiByteToWideChar(CP_UTF8, 0, text, -1, &title[0], sint32(title.size()));
+	auto thiz = static_cast<WindowImpl const*>(this);
+	::SetWindowText(thiz->hWnd_, title.c_str());
+}
+
@@ -2,12 +2,44 @@
 #include "GeometryFoundation.h"
 #include "ReferenceCount.h"
 #include "Input.h"
-#include <functional>
+#include "EventBus.h"
+#include <cstdint>
 #include <string>
 #include <memory>
 
 namespace X
 {
+	/*
+	*	Every message the window procedure gets, before the window handles it. Windows types as integers, to keep
+	*	windows.h out of this header.
+	*/
+	struct WindowMessageEvent
+	{
+		void* window;			// HWND
+		uint32 message;
+		uintptr_t wParam;
+		intptr_t lParam;
+	};
+
+	/*
+	*	Queued by the window procedure and delivered before the next WindowIdleEvent, so subscribers may wait for the
+	*	frames in flight. Dragging the frame delivers several at once.
+	*/
+	struct WindowResizeEvent
+	{
+		uint32 width;
+		uint32 height;
+	};
+
+	/*
+	*	The message queue is empty, time for a frame.
+	*/
+	struct WindowIdleEvent
+	{
+	};
+
+	typedef EventBus<WindowMessageEvent, WindowResizeEvent, WindowIdleEvent> WindowEvents;
+
 	class Window : public ReferenceCountBase<true>
 	{
 	public:
@@ -40,12 +72,10 @@ namespace X
 
 		std::wstring GetTitleText() const;
 		void SetTitleText(std::wstring const& text);
-
 		/*
-		*	@hook: pointer is type: std::function<void(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)>*
-		*		the pointer will be cast to the type above and make a copy of the function object.
+		*	@text: UTF-8, e.g. from Localization.
 		*/
-		void SetRawWindowsMessageHook(void const* hook);
+		void SetTitleText(char const* text);
 
 		/*
 		*	@return: actual type is HWND, return void* to remove windows.h dependency from hpp.
@@ -54,8 +84,10 @@ namespace X
 
 		void Recreate();
 
-		void SetMessageIdle(std::function<void()> messageIdle);
-		void SetResizeHandler(std::function<void(uint32 width, uint32 height)> onResize);
+		/*
+		*	Published from the message loop on the thread calling StartHandlingMessages. Subscriptions end when it returns.
+		*/
+		WindowEvents& GetEvents();
 		void SetInputHandler(Ptr<InputHandler> inputHanlder);
 
 	protected:
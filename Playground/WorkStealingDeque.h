@@ -0,0 +1,134 @@
+#pragma once
+#include "BasicType.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace X
+{
+	/*
+	*	Chase-Lev deque of pointers: the owning thread pushes and takes at the bottom, the other threads steal from the top.
+	*	Follows "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013), except that an item is
+	*	published through the release store of bottom so thread sanitizers can follow it without understanding fences.
+	*
+	*	Push and Take only from the owner, Steal from any thread. The deque does not own the items.
+	*/
+	template <class T>
+	class WorkStealingDeque
+	{
+	public:
+		WorkStealingDeque()
+		{
+			_arrays.push_back(std::make_unique<Array>(256));
+			_array.store(_arrays.back().get(), std::memory_order_relaxed);
+		}
+
+		void Push(T* item)
+		{
+			sint64 bottom = _bottom.load(std::memory_order_relaxed);
+			sint64 top = _top.load(std::memory_order_acquire);
+			Array* array = _array.load(std::memory_order_relaxed);
+			if (bottom - top >= sint64(array->size))
+			{
+				array = Grow(array, top, bottom);
+			}
+			array->Put(bottom, item);
+			_bottom.store(bottom + 1, std::memory_order_release);
+		}
+
+		/*
+		*	Newest first.
+		*	@return: nullptr if the deque is empty or a thief got the last item.
+		*/
+		T* Take()
+		{
+			sint64 bottom = _bottom.load(std::memory_order_relaxed) - 1;
+			Array* array = _array.load(std::memory_order_relaxed);
+			_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			sint64 top = _top.load(std::memory_order_relaxed);
+
+			T* item = nullptr;
+			if (top <= bottom)
+			{
+				item = array->Get(bottom);
+				if (top == bottom)
+				{
+					// Last item, race the thieves for it.
+					if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					{
+						item = nullptr;
+					}
+					_bottom.store(bottom + 1, std::memory_order_relaxed);
+				}
+			}
+			else
+			{
+				_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		/*
+		*	Oldest first.
+		*	@return: nullptr if the deque is empty or another thread got the item, a failed steal is worth retrying.
+		*/
+		T* Steal()
+		{
+			sint64 top = _top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			sint64 bottom = _bottom.load(std::memory_order_acquire);
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+			Array* array = _array.load(std::memory_order_acquire);
+			T* item = array->Get(top);
+			if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return item;
+		}
+
+	private:
+		struct Array
+		{
+			explicit Array(size_t size) :
+				size(size),
+				slots(new std::atomic<T*>[size])
+			{
+			}
+
+			T* Get(sint64 index) const
+			{
+				return slots[size_t(index) & (size - 1)].load(std::memory_order_relaxed);
+			}
+			void Put(sint64 index, T* item)
+			{
+				slots[size_t(index) & (size - 1)].store(item, std::memory_order_relaxed);
+			}
+
+			size_t size;
+			std::unique_ptr<std::atomic<T*>[]> slots;
+		};
+
+		Array* Grow(Array* array, sint64 top, sint64 bottom)
+		{
+			// Thieves may still read the old array, it is kept until the deque goes away.
+			_arrays.push_back(std::make_unique<Array>(array->size * 2));
+			Array* grown = _arrays.back().get();
+			for (sint64 i = top; i < bottom; ++i)
+			{
+				grown->Put(i, array->Get(i));
+			}
+			_array.store(grown, std::memory_order_release);
+			return grown;
+		}
+
+		std::atomic<sint64> _top{ 0 };
+		std::atomic<sint64> _bottom{ 0 };
+		std::atomic<Array*> _array;
+		std::vector<std::unique_ptr<Array>> _arrays;
+	};
+}
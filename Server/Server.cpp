@@ -0,0 +1,204 @@
+/*
+*	Hosts battles without a window, a device or ImGui.
+*
+*	Server [matches] [seconds] [commands per player per second] [port]
+*
+*	Listens on 127.0.0.1, on a free port unless one is given. The players are bots in the same process that connect
+*	over TCP like any client would, two for each match, and send random commands; most of them are refused, which
+*	costs the server the same. Clients connecting later are accepted but play in no match. Every second it prints the
+*	load: commands handled, reply latency and how many matches a core would hold at this rate. At the start it prints
+*	the memory the matches took, the heap is tracked by MemoryTracker.
+*/
+#include "BattleServer.h"
+#include "MemoryTracker.h"
+#include "SocketTransport.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	Ptr<BattleMap> MakeMap()
+	{
+		string text = "size 16 16\ntiles\n";
+		char const terrain[] = "..f.^";
+		for (uint32 y = 0; y < 16; ++y)
+		{
+			for (uint32 x = 0; x < 16; ++x)
+			{
+				text += terrain[(x / 3 + y / 2) % 5];
+			}
+			text += '\n';
+		}
+		for (uint32 unit = 0; unit < 4; ++unit)
+		{
+			text += "unit " + to_string(unit * 3 + 2) + " 6 0 s Soldier\n";
+			text += "unit " + to_string(unit * 3 + 2) + " 9 1 n Soldier\n";
+		}
+		vector<uint8> file;
+		string error = ConvertBattleMapText(text, file);
+		if (!error.empty())
+		{
+			fprintf(stderr, "Server: %s\n", error.c_str());
+			return nullptr;
+		}
+		return BattleMap::Create(move(file));
+	}
+
+	/*
+	*	Both ends of every bot connection are in this process, the usual limit of 1024 files is not enough for 256 matches.
+	*/
+	void RaiseOpenFileLimit()
+	{
+#ifndef _WIN32
+		rlimit limit;
+		if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+		{
+			limit.rlim_cur = limit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &limit);
+		}
+#endif
+	}
+
+	struct Player
+	{
+		Ptr<SocketClient> client;
+		uint32 match;
+		uint32 nextSequence;
+		float64 budget;
+	};
+
+	/*
+	*	Sends commands at the given rate for every player and reads the replies, until stop is set.
+	*/
+	void RunBots(vector<Player>& players, float64 commandsPerSecond, atomic<bool>& stop, atomic<uint64>& accepted)
+	{
+		uint32 random = 12345;
+		auto next = [&random](uint32 range)
+		{
+			random = random * 1664525u + 1013904223u;
+			return (random >> 8) % range;
+		};
+		chrono::steady_clock::time_point last = chrono::steady_clock::now();
+		vector<vector<uint8>> replies;
+		while (!stop.load(memory_order_relaxed))
+		{
+			this_thread::sleep_for(chrono::milliseconds(5));
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			float64 elapsed = chrono::duration<float64>(now - last).count();
+			last = now;
+			for (Player& player : players)
+			{
+				for (player.budget += elapsed * commandsPerSecond; player.budget >= 1; player.budget -= 1)
+				{
+					ServerCommand command = { player.match, player.nextSequence++, {} };
+					uint32 kind = next(10);
+					command.command.type = kind < 6 ? BattleCommand::Type::Move : kind < 8 ? BattleCommand::Type::Attack :
+						kind < 9 ? BattleCommand::Type::Wait : BattleCommand::Type::EndTurn;
+					command.command.unit = uint16(next(8));
+					command.command.x = uint16(next(16));
+					command.command.y = uint16(next(16));
+					command.command.target = uint16(next(8));
+					player.client->Send(EncodeServerCommand(command));
+				}
+				replies.clear();
+				player.client->Receive(replies);
+				for (vector<uint8> const& bytes : replies)
+				{
+					ServerReply reply;
+					if (DecodeServerReply(bytes, reply) && reply.accepted)
+					{
+						accepted.fetch_add(1, memory_order_relaxed);
+					}
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32 matchCount = argc > 1 ? uint32(atoi(argv[1])) : 256;
+	uint32 seconds = argc > 2 ? uint32(atoi(argv[2])) : 10;
+	float64 commandsPerSecond = argc > 3 ? atof(argv[3]) : 2.0;
+	uint16 port = argc > 4 ? uint16(atoi(argv[4])) : 0;
+
+	Ptr<BattleMap> map = MakeMap();
+	if (!map)
+	{
+		return 1;
+	}
+
+	RaiseOpenFileLimit();
+	Ptr<SocketTransport> transport = SocketTransport::Listen(port);
+	if (!transport)
+	{
+		fprintf(stderr, "Server: can not listen on port %u\n", port);
+		return 1;
+	}
+	printf("Listening on 127.0.0.1:%u\n", transport->GetPort());
+
+	Ptr<JobSystem> jobs = JobSystem::Create();
+	BattleServer server(*jobs, *transport);
+	vector<Player> players;
+	for (uint32 i = 0; i < matchCount; ++i)
+	{
+		Ptr<SocketClient> clients[2];
+		uint32 connections[2];
+		for (uint32 player = 0; player < 2; ++player)
+		{
+			clients[player] = SocketClient::Connect(transport->GetPort());
+			if (!clients[player] || !transport->Accept(connections[player], chrono::steady_clock::now() + chrono::seconds(5)))
+			{
+				fprintf(stderr, "Server: bot %u could not connect\n", i * 2 + player);
+				return 1;
+			}
+		}
+		uint32 match;
+		{
+			MemoryTagScope tag(MemoryTag::Simulation);
+			match = server.CreateMatch(map, i + 1, { connections[0], connections[1] });
+		}
+		players.push_back({ clients[0], match, 0, 0 });
+		players.push_back({ clients[1], match, 0, 0 });
+	}
+	if (MemoryTracker::IsEnabled())
+	{
+		MemoryTagStatistics memory = MemoryTracker::GetStatistics(MemoryTag::Simulation);
+		printf("%.1f MB in %lld allocations for the matches, %.1f KB per match\n", memory.bytes / (1024.0 * 1024.0),
+			(long long)memory.liveAllocations, memory.bytes / 1024.0 / max(matchCount, 1u));
+	}
+
+	atomic<bool> stop{ false };
+	atomic<uint64> accepted{ 0 };
+	thread bots([&] { RunBots(players, commandsPerSecond, stop, accepted); });
+
+	printf("%u matches on %u threads, %.1f commands per player per second\n", matchCount, jobs->GetWorkerCount() + 1, commandsPerSecond);
+	chrono::steady_clock::time_point end = chrono::steady_clock::now() + chrono::seconds(seconds);
+	chrono::steady_clock::time_point report = chrono::steady_clock::now() + chrono::seconds(1);
+	while (chrono::steady_clock::now() < end)
+	{
+		server.Poll();
+		if (chrono::steady_clock::now() >= report)
+		{
+			report += chrono::seconds(1);
+			BattleServer::Statistics statistics = server.TakeStatistics();
+			printf("%8.0f commands/s %6.0f ticks/s %6llu accepted  latency p50 %.3f ms p99 %.3f ms  %.3f cores busy, %.0f matches/core\n",
+				statistics.commands / statistics.seconds, statistics.ticks / statistics.seconds, (unsigned long long)accepted.exchange(0),
+				statistics.p50LatencyMs, statistics.p99LatencyMs, statistics.busyCores, statistics.matchesPerCore);
+		}
+	}
+
+	stop = true;
+	bots.join();
+	return 0;
+}
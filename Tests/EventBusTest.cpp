@@ -0,0 +1,151 @@
+#include "Test.h"
+#include "EventBus.h"
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	struct Hit
+	{
+		sint32 damage;
+	};
+
+	struct Died
+	{
+		uint32 unit;
+	};
+
+	typedef EventBus<Hit, Died> TestBus;
+
+	struct Log
+	{
+		vector<sint32> entries;
+
+		void OnHit(Hit const& hit)
+		{
+			entries.push_back(hit.damage);
+		}
+	};
+
+	void TestDelegate()
+	{
+		Delegate<sint32(sint32)> empty;
+		SRPG_CHECK(!empty);
+
+		sint32 base = 10;
+		Delegate<sint32(sint32)> add([&base](sint32 value) { return base + value; });
+		SRPG_CHECK(add && add(5) == 15);
+		base = 20;
+		Delegate<sint32(sint32)> copy = add;
+		SRPG_CHECK(copy(5) == 25);
+
+		Log log;
+		Delegate<void(Hit const&)> bound = Delegate<void(Hit const&)>::Bind<Log, &Log::OnHit>(&log);
+		bound(Hit{ 7 });
+		SRPG_CHECK(log.entries == vector<sint32>({ 7 }));
+	}
+
+	/*
+	*	Publish delivers right away, in the order of subscription. Queued events wait for Dispatch, which delivers them in
+	*	the order they were queued, all of the first declared type before the second.
+	*/
+	void TestOrdering()
+	{
+		TestBus bus;
+		vector<sint32> seen;
+		bus.Subscribe<Hit>([&seen](Hit const& hit) { seen.push_back(100 + hit.damage); });
+		bus.Subscribe<Hit>([&seen](Hit const& hit) { seen.push_back(200 + hit.damage); });
+		bus.Subscribe<Died>([&seen](Died const& died) { seen.push_back(-sint32(died.unit)); });
+
+		bus.Publish(Hit{ 1 });
+		SRPG_CHECK(seen == vector<sint32>({ 101, 201 }));
+
+		seen.clear();
+		bus.Queue(Died{ 5 });
+		bus.Queue(Hit{ 2 });
+		bus.Queue(Hit{ 3 });
+		bus.Queue(Died{ 6 });
+		SRPG_CHECK(seen.empty());
+		bus.Dispatch();
+		SRPG_CHECK(seen == vector<sint32>({ 102, 202, 103, 203, -5, -6 }));
+
+		seen.clear();
+		bus.Dispatch();
+		SRPG_CHECK(seen.empty());
+	}
+
+	/*
+	*	Events queued while others are delivered wait for the next Dispatch, even of the type being delivered.
+	*/
+	void TestQueueDuringDispatch()
+	{
+		TestBus bus;
+		vector<sint32> seen;
+		bus.Subscribe<Hit>([&bus, &seen](Hit const& hit)
+		{
+			seen.push_back(hit.damage);
+			if (hit.damage > 0)
+			{
+				bus.Queue(Hit{ hit.damage - 1 });
+				bus.Queue(Died{ uint32(hit.damage) });
+			}
+		});
+		bus.Subscribe<Died>([&seen](Died const& died) { seen.push_back(-sint32(died.unit)); });
+
+		bus.Queue(Hit{ 2 });
+		bus.Dispatch();
+		// Died is declared after Hit, so the one queued from the Hit subscriber still makes this Dispatch.
+		SRPG_CHECK(seen == vector<sint32>({ 2, -2 }));
+		bus.Dispatch();
+		SRPG_CHECK(seen == vector<sint32>({ 2, -2, 1, -1 }));
+		bus.Dispatch();
+		SRPG_CHECK(seen == vector<sint32>({ 2, -2, 1, -1, 0 }));
+		bus.Dispatch();
+		SRPG_CHECK(seen.size() == 5);
+	}
+
+	void TestUnsubscribe()
+	{
+		TestBus bus;
+		vector<sint32> seen;
+		TestBus::SubscriptionID ids[5];
+		for (sint32 index = 0; index < 5; ++index)
+		{
+			ids[index] = bus.Subscribe<Hit>([&seen, index](Hit const&) { seen.push_back(index); });
+		}
+		bus.Unsubscribe<Hit>(ids[1]);
+		bus.Unsubscribe<Hit>(ids[3]);
+		// Unknown ids and ids of another type change nothing.
+		bus.Unsubscribe<Hit>(ids[1]);
+		bus.Unsubscribe<Died>(ids[0]);
+		bus.Publish(Hit{ 0 });
+		SRPG_CHECK(seen == vector<sint32>({ 0, 2, 4 }));
+
+		seen.clear();
+		ids[1] = bus.Subscribe<Hit>([&seen](Hit const&) { seen.push_back(5); });
+		bus.Unsubscribe<Hit>(ids[0]);
+		bus.Publish(Hit{ 0 });
+		SRPG_CHECK(seen == vector<sint32>({ 2, 4, 5 }));
+
+		seen.clear();
+		for (uint32 index = 0; index < TestBus::MaxSubscribers - 3; ++index)
+		{
+			bus.Subscribe<Hit>([&seen](Hit const&) { seen.push_back(6); });
+		}
+		bus.UnsubscribeAll();
+		bus.Publish(Hit{ 0 });
+		SRPG_CHECK(seen.empty());
+	}
+
+	void RunEventBusTests()
+	{
+		TestDelegate();
+		TestOrdering();
+		TestQueueDuringDispatch();
+		TestUnsubscribe();
+	}
+
+	TestRegistration registration("EventBus", &RunEventBusTests);
+}
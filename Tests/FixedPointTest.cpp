@@ -0,0 +1,205 @@
+#include "Test.h"
+#include "FixedPoint.h"
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 NextRandom(uint32& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	/*
+	*	Raw values of every magnitude, a random one shifted right by 0 to 24 bits, and every 16th one from the edges.
+	*/
+	sint32 RandomRaw32(uint32& state)
+	{
+		uint32 bits = NextRandom(state);
+		sint32 const edges[] = { 0, 1, -1, INT32_MAX, INT32_MIN, INT32_MAX - 1, INT32_MIN + 1, 1 << 16, -(1 << 16) };
+		if (bits % 16 == 0)
+		{
+			return edges[bits / 16 % (sizeof(edges) / sizeof(edges[0]))];
+		}
+		return sint32(NextRandom(state)) >> (bits % 25);
+	}
+
+	sint64 RandomRaw64(uint32& state)
+	{
+		uint32 bits = NextRandom(state);
+		sint64 const edges[] = { 0, 1, -1, INT64_MAX, INT64_MIN, INT64_MAX - 1, INT64_MIN + 1, sint64(1) << 32, -(sint64(1) << 32) };
+		if (bits % 16 == 0)
+		{
+			return edges[bits / 16 % (sizeof(edges) / sizeof(edges[0]))];
+		}
+		uint64 high = NextRandom(state);
+		return sint64(high << 32 | NextRandom(state)) >> (bits % 57);
+	}
+
+#ifdef __SIZEOF_INT128__
+	/*
+	*	The same results straight from 128 bit integers, where the compiler has them.
+	*/
+	typedef __int128 sint128;
+	typedef unsigned __int128 uint128;
+
+	template <class Raw>
+	Raw Saturate(sint128 value)
+	{
+		return value > numeric_limits<Raw>::max() ? numeric_limits<Raw>::max() : value < numeric_limits<Raw>::min() ?
+			numeric_limits<Raw>::min() : Raw(value);
+	}
+
+	template <class Raw>
+	Raw ReferenceMultiply(Raw a, Raw b, uint32 fractionBits)
+	{
+		return Saturate<Raw>((sint128(a) * b + (sint128(1) << (fractionBits - 1))) >> fractionBits);
+	}
+
+	template <class Raw>
+	Raw ReferenceDivide(Raw a, Raw b, uint32 fractionBits)
+	{
+		if (b == 0)
+		{
+			return a < 0 ? numeric_limits<Raw>::min() : numeric_limits<Raw>::max();
+		}
+		return Saturate<Raw>(sint128(a) * (sint128(1) << fractionBits) / b);
+	}
+
+	template <class Raw>
+	Raw ReferenceSqrt(Raw value, uint32 fractionBits)
+	{
+		if (value <= 0)
+		{
+			return 0;
+		}
+		uint128 square = uint128(value) << fractionBits;
+		uint128 root = 0;
+		for (sint32 bit = 63; bit >= 0; --bit)
+		{
+			uint128 candidate = root | uint128(1) << bit;
+			if (candidate * candidate <= square)
+			{
+				root = candidate;
+			}
+		}
+		return Raw(root);
+	}
+
+	template <class Value, class Random>
+	void TestAgainstReference(Random random)
+	{
+		typedef typename Value::RawType Raw;
+		uint32 state = 77;
+		for (uint32 index = 0; index < 200000; ++index)
+		{
+			Value a = Value::FromRaw(random(state)), b = Value::FromRaw(random(state));
+			SRPG_CHECK((a * b).GetRaw() == ReferenceMultiply<Raw>(a.GetRaw(), b.GetRaw(), Value::Fraction));
+			SRPG_CHECK((a / b).GetRaw() == ReferenceDivide<Raw>(a.GetRaw(), b.GetRaw(), Value::Fraction));
+			SRPG_CHECK(Sqrt(a).GetRaw() == ReferenceSqrt<Raw>(a.GetRaw(), Value::Fraction));
+		}
+	}
+#endif
+
+	/*
+	*	Counts around the 4 values an instruction takes, so the loops run with every remainder.
+	*/
+	void TestBatches()
+	{
+		size_t const counts[] = { 0, 1, 3, 4, 5, 7, 9, 13, 31, 1001 };
+		uint32 state = 5;
+		for (size_t count : counts)
+		{
+			vector<Fixed16> a(count), b(count), c(count), result(count);
+			for (size_t index = 0; index < count; ++index)
+			{
+				a[index] = Fixed16::FromRaw(RandomRaw32(state));
+				b[index] = Fixed16::FromRaw(RandomRaw32(state));
+				c[index] = Fixed16::FromRaw(RandomRaw32(state));
+			}
+
+			AddBatch(a.data(), b.data(), result.data(), count);
+			for (size_t index = 0; index < count; ++index)
+			{
+				SRPG_CHECK(result[index] == a[index] + b[index]);
+			}
+			MultiplyBatch(a.data(), b.data(), result.data(), count);
+			for (size_t index = 0; index < count; ++index)
+			{
+				SRPG_CHECK(result[index] == a[index] * b[index]);
+			}
+			MultiplyAddBatch(a.data(), b.data(), c.data(), result.data(), count);
+			for (size_t index = 0; index < count; ++index)
+			{
+				SRPG_CHECK(result[index] == a[index] * b[index] + c[index]);
+			}
+
+			// In place, as the particles update their positions.
+			vector<Fixed16> inPlace = c;
+			MultiplyAddBatch(a.data(), b.data(), inPlace.data(), inPlace.data(), count);
+			SRPG_CHECK(inPlace == result);
+			inPlace = a;
+			AddBatch(inPlace.data(), inPlace.data(), inPlace.data(), count);
+			for (size_t index = 0; index < count; ++index)
+			{
+				SRPG_CHECK(inPlace[index] == a[index] + a[index]);
+			}
+		}
+	}
+
+	/*
+	*	FNV-1a over a fixed workload touching every operation, edge cases included. A different hash means this build
+	*	computes different bits than the others, whichever compiler, configuration or machine it is.
+	*/
+	uint32 HashReferenceResults()
+	{
+		uint32 hash = 2166136261u;
+		auto mix = [&hash](uint64 value)
+		{
+			for (uint32 shift = 0; shift < 64; shift += 8)
+			{
+				hash = (hash ^ uint32((value >> shift) & 0xFF)) * 16777619u;
+			}
+		};
+		uint32 state = 12345;
+		for (uint32 index = 0; index < 100000; ++index)
+		{
+			uint32 bits = NextRandom(state);
+			// Small, medium and saturating magnitudes.
+			sint32 a = sint32(bits) >> (index % 3 * 8);
+			sint32 b = sint32(NextRandom(state)) >> (index % 5 * 6);
+			Fixed16 x = Fixed16::FromRaw(a), y = Fixed16::FromRaw(b);
+			mix(uint32((x * y).GetRaw()));
+			mix(uint32((x / y).GetRaw()));
+			mix(uint32((x + y).GetRaw()));
+			mix(uint32(Sqrt(x).GetRaw()));
+			mix(uint32(Sin<Fixed16>(bits).GetRaw()));
+
+			Fixed32 p = Fixed32::FromRaw(sint64(uint64(bits) << 32 | NextRandom(state)) >> (index % 4 * 12));
+			Fixed32 q = Fixed32::FromRaw(sint64(uint64(NextRandom(state)) << 32 | NextRandom(state)) >> (index % 7 * 8));
+			mix(uint64((p * q).GetRaw()));
+			mix(uint64((p / q).GetRaw()));
+			mix(uint64((p - q).GetRaw()));
+			mix(uint64(Sqrt(p).GetRaw()));
+			mix(uint64(Cos<Fixed32>(bits).GetRaw()));
+		}
+		return hash;
+	}
+
+	void RunFixedPointTests()
+	{
+#ifdef __SIZEOF_INT128__
+		TestAgainstReference<Fixed16>(&RandomRaw32);
+		TestAgainstReference<Fixed32>(&RandomRaw64);
+#endif
+		TestBatches();
+		SRPG_CHECK(HashReferenceResults() == 0xce2363bf);
+	}
+
+	TestRegistration registration("FixedPoint", &RunFixedPointTests);
+}
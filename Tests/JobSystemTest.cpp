@@ -0,0 +1,247 @@
+#include "Test.h"
+#include "JobSystem.h"
+#include "WorkStealingDeque.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	/*
+	*	The owner pushes in bursts that make the array grow and takes back part of them while thieves steal, every item
+	*	has to come out exactly once.
+	*/
+	void TestDequeRaces()
+	{
+		uint32 const ItemCount = 100000;
+		uint32 const ThiefCount = 3;
+		vector<uint32> items(ItemCount);
+		unique_ptr<atomic<uint32>[]> taken(new atomic<uint32>[ItemCount]);
+		for (uint32 i = 0; i < ItemCount; ++i)
+		{
+			items[i] = i;
+			taken[i].store(0, memory_order_relaxed);
+		}
+
+		WorkStealingDeque<uint32> deque;
+		atomic<uint32> consumed{ 0 };
+		atomic<bool> ownerDone{ false };
+		auto consume = [&](uint32* item)
+		{
+			taken[*item].fetch_add(1, memory_order_relaxed);
+			consumed.fetch_add(1, memory_order_relaxed);
+		};
+
+		vector<thread> thieves;
+		for (uint32 t = 0; t < ThiefCount; ++t)
+		{
+			thieves.emplace_back([&]
+			{
+				while (!ownerDone.load(memory_order_acquire) || consumed.load(memory_order_relaxed) < ItemCount)
+				{
+					if (uint32* item = deque.Steal())
+					{
+						consume(item);
+					}
+					else
+					{
+						this_thread::yield();
+					}
+				}
+			});
+		}
+
+		uint32 next = 0;
+		while (next < ItemCount)
+		{
+			// Up to 1000 at once, more than the initial 256 slots.
+			uint32 burst = min(ItemCount - next, 1 + next % 1000);
+			for (uint32 i = 0; i < burst; ++i)
+			{
+				deque.Push(&items[next++]);
+			}
+			for (uint32 i = 0; i < burst / 2; ++i)
+			{
+				if (uint32* item = deque.Take())
+				{
+					consume(item);
+				}
+			}
+		}
+		while (uint32* item = deque.Take())
+		{
+			consume(item);
+		}
+		ownerDone.store(true, memory_order_release);
+		for (auto& thief : thieves)
+		{
+			thief.join();
+		}
+
+		SRPG_CHECK(consumed.load() == ItemCount);
+		uint32 wrong = 0;
+		for (uint32 i = 0; i < ItemCount; ++i)
+		{
+			wrong += taken[i].load() != 1;
+		}
+		SRPG_CHECK(wrong == 0);
+		SRPG_CHECK(deque.Take() == nullptr);
+		SRPG_CHECK(deque.Steal() == nullptr);
+	}
+
+	/*
+	*	All workers are blocked, so the jobs only finish because Wait runs them on the calling thread.
+	*/
+	void TestWaitHelps()
+	{
+		uint32 const WorkerCount = 2;
+		Ptr<JobSystem> jobs = JobSystem::Create(WorkerCount);
+
+		atomic<uint32> blocked{ 0 };
+		atomic<bool> release{ false };
+		JobCounter blockers;
+		for (uint32 i = 0; i < WorkerCount; ++i)
+		{
+			jobs->Run([&]
+			{
+				blocked.fetch_add(1);
+				while (!release.load())
+				{
+					this_thread::yield();
+				}
+			}, &blockers);
+		}
+		while (blocked.load() < WorkerCount)
+		{
+			this_thread::yield();
+		}
+
+		thread::id const caller = this_thread::get_id();
+		atomic<uint32> ranOnCaller{ 0 };
+		JobCounter counter;
+		for (uint32 i = 0; i < 100; ++i)
+		{
+			jobs->Run([&]
+			{
+				ranOnCaller.fetch_add(this_thread::get_id() == caller);
+			}, &counter);
+		}
+		jobs->Wait(counter);
+		SRPG_CHECK(counter.IsDone());
+		SRPG_CHECK(ranOnCaller.load() == 100);
+
+		release.store(true);
+		jobs->Wait(blockers);
+	}
+
+	/*
+	*	Jobs start jobs and wait for them on the workers, three levels deep with more jobs than threads.
+	*/
+	void TestNestedJobs()
+	{
+		Ptr<JobSystem> jobs = JobSystem::Create(3);
+		uint32 const FanOut = 6;
+		atomic<uint32> leaves{ 0 };
+
+		struct Spawn
+		{
+			JobSystem* jobs;
+			atomic<uint32>* leaves;
+
+			void operator()(uint32 depth) const
+			{
+				if (depth == 0)
+				{
+					leaves->fetch_add(1, memory_order_relaxed);
+					return;
+				}
+				JobCounter children;
+				Spawn spawn = *this;
+				for (uint32 i = 0; i < FanOut; ++i)
+				{
+					jobs->Run([spawn, depth] { spawn(depth - 1); }, &children);
+				}
+				jobs->Wait(children);
+			}
+		};
+
+		for (uint32 round = 0; round < 20; ++round)
+		{
+			leaves.store(0);
+			JobCounter root;
+			Spawn spawn = { &*jobs, &leaves };
+			jobs->Run([spawn] { spawn(3); }, &root);
+			jobs->Wait(root);
+			SRPG_CHECK(leaves.load() == FanOut * FanOut * FanOut);
+		}
+	}
+
+	/*
+	*	Every index exactly once, in non-empty ranges, for counts around the grain size.
+	*/
+	void TestParallelForGrains()
+	{
+		Ptr<JobSystem> jobs = JobSystem::Create(3);
+		uint32 const Grain = 16;
+		uint32 const counts[] = { 0, 1, Grain - 1, Grain, Grain + 1, 2 * Grain, 2 * Grain + 1, 1000 };
+		uint32 const grains[] = { 0, 1, Grain, 100000 };
+		for (uint32 grain : grains)
+		{
+			for (uint32 count : counts)
+			{
+				vector<atomic<uint32>> hits(count);
+				for (auto& hit : hits)
+				{
+					hit.store(0);
+				}
+				atomic<uint32> badRanges{ 0 };
+				atomic<uint32> calls{ 0 };
+				jobs->ParallelFor(count, grain, [&](uint32 begin, uint32 end)
+				{
+					calls.fetch_add(1);
+					if (begin >= end || end > count || (grain != 0 && end - begin > grain))
+					{
+						badRanges.fetch_add(1);
+						return;
+					}
+					for (uint32 i = begin; i < end; ++i)
+					{
+						hits[i].fetch_add(1);
+					}
+				});
+				SRPG_CHECK(badRanges.load() == 0);
+				SRPG_CHECK(count != 0 || calls.load() == 0);
+				SRPG_CHECK(all_of(hits.begin(), hits.end(), [](atomic<uint32> const& hit) { return hit.load() == 1; }));
+			}
+		}
+
+		// Ranges that end past the largest count must not wrap.
+		mutex rangesMutex;
+		vector<pair<uint32, uint32>> ranges;
+		jobs->ParallelFor(0xFFFFFFFFu, 0x80000000u, [&](uint32 begin, uint32 end)
+		{
+			lock_guard<mutex> lock(rangesMutex);
+			ranges.emplace_back(begin, end);
+		});
+		sort(ranges.begin(), ranges.end());
+		SRPG_CHECK(ranges.size() == 2);
+		SRPG_CHECK(ranges.size() == 2 && ranges[0] == make_pair(0u, 0x80000000u) && ranges[1] == make_pair(0x80000000u, 0xFFFFFFFFu));
+	}
+
+	void RunJobSystemTests()
+	{
+		TestDequeRaces();
+		TestWaitHelps();
+		TestNestedJobs();
+		TestParallelForGrains();
+	}
+
+	TestRegistration registration("JobSystem", &RunJobSystemTests);
+}
@@ -0,0 +1,52 @@
+#include "Test.h"
+#include "Localization.h"
+#include <cstring>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	/*
+	*	Text that does not fit is cut before the character that would not fit whole, never inside it.
+	*/
+	void TestTruncation()
+	{
+		// "ab" and two 3 byte characters, then a 4 byte one.
+		char const* const text = "ab\xE5\xBC\x80\xE5\xA7\x8B\xF0\x9F\x98\x80";
+		struct Case
+		{
+			uint32 capacity;
+			size_t kept;
+		};
+		Case const cases[] = { { 1, 0 }, { 2, 1 }, { 3, 2 }, { 5, 2 }, { 6, 5 }, { 8, 5 }, { 9, 8 }, { 12, 8 }, { 13, 12 } };
+		for (Case const& test : cases)
+		{
+			TextScratch appended(test.capacity);
+			char const* copy = appended.Append(text, strlen(text));
+			SRPG_CHECK(strlen(copy) == test.kept && memcmp(copy, text, test.kept) == 0);
+			SRPG_CHECK(appended.GetOverflowCount() == (test.kept < strlen(text) ? 1u : 0u));
+
+			TextScratch printed(test.capacity);
+			char const* formatted = printed.Print("%s", text);
+			SRPG_CHECK(strlen(formatted) == test.kept && memcmp(formatted, text, test.kept) == 0);
+			SRPG_CHECK(printed.GetOverflowCount() == (test.kept < strlen(text) ? 1u : 0u));
+		}
+
+		// Later strings of the frame only get what the earlier ones left.
+		TextScratch scratch(8);
+		SRPG_CHECK(strcmp(scratch.Print("%d", 1234), "1234") == 0);
+		SRPG_CHECK(strcmp(scratch.Print("%s", text), "ab") == 0);
+		SRPG_CHECK(strcmp(scratch.Print("%s", "x"), "") == 0);
+		SRPG_CHECK(scratch.GetOverflowCount() == 2);
+		scratch.Reset();
+		SRPG_CHECK(strcmp(scratch.Print("%s", "x"), "x") == 0);
+	}
+
+	void RunLocalizationTests()
+	{
+		TestTruncation();
+	}
+
+	TestRegistration registration("Localization", &RunLocalizationTests);
+}
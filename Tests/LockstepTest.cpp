@@ -0,0 +1,142 @@
+#include "Test.h"
+#include "Lockstep.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const Ticks = 240;
+
+	Ptr<BattleMap> MakeMap()
+	{
+		string text = "size 16 16\ntiles\n";
+		for (uint32 y = 0; y < 16; ++y)
+		{
+			for (uint32 x = 0; x < 16; ++x)
+			{
+				text += (x + y * 2) % 7 == 0 ? 'f' : '.';
+			}
+			text += '\n';
+		}
+		for (uint32 index = 0; index < 6; ++index)
+		{
+			text += "unit " + to_string(2 + index * 2) + " 6 0 s Blue\n";
+			text += "unit " + to_string(2 + index * 2) + " 9 1 n Red\n";
+		}
+		vector<uint8> file;
+		SRPG_CHECK(ConvertBattleMapText(text, file).empty());
+		return BattleMap::Create(move(file));
+	}
+
+	struct Match
+	{
+		vector<uint32> checksums[2];		// of each side after every tick
+		bool desynced[2];
+		uint32 desyncTick[2];
+		uint32 checksumsCompared[2];
+	};
+
+	/*
+	*	Both players move, attack and end their turn now and then, including commands the simulation refuses, until
+	*	both sides ran Ticks ticks or gave up.
+	*/
+	Match Play(Ptr<BattleMap> const& map, SimulatedNetwork::Settings const& network, uint32 inputDelay, uint64 seeds[2])
+	{
+		BattleSimulation simulations[2] = { BattleSimulation(map, seeds[0]), BattleSimulation(map, seeds[1]) };
+		SimulatedNetwork connection(network);
+		LockstepSession session0(simulations[0], connection.GetEndpoint(0), 0, inputDelay);
+		LockstepSession session1(simulations[1], connection.GetEndpoint(1), 1, inputDelay);
+		LockstepSession* sessions[2] = { &session0, &session1 };
+
+		Match match;
+		for (uint32 step = 0; step < Ticks * 40 && (session0.GetTick() < Ticks || session1.GetTick() < Ticks) &&
+			!session0.IsDesynced() && !session1.IsDesynced(); ++step)
+		{
+			for (uint8 player = 0; player < 2; ++player)
+			{
+				if (step % 6 == player * 3)
+				{
+					uint16 unit = uint16((step / 6) % 6 * 2 + player);
+					BattleUnit const& placed = simulations[player].GetUnits()[unit];
+					BattleCommand::Type type = step % 4 == 0 ? BattleCommand::Type::Attack : BattleCommand::Type::Move;
+					sessions[player]->Queue({ type, unit, uint16(placed.x + step % 3), uint16(placed.y + (player ? -1 : 1)), uint16(unit ^ 1) });
+					sessions[player]->Queue({ BattleCommand::Type::EndTurn, 0, 0, 0, 0 });
+				}
+			}
+			connection.Advance(1000.0 / 60);
+			for (uint8 player = 0; player < 2; ++player)
+			{
+				// One tick at a time, to see the simulation after each of them.
+				for (uint32 tick = 0; tick < 2 && sessions[player]->Update(1) == 1; ++tick)
+				{
+					match.checksums[player].push_back(simulations[player].GetChecksum());
+				}
+			}
+		}
+		for (uint8 player = 0; player < 2; ++player)
+		{
+			match.desynced[player] = sessions[player]->IsDesynced();
+			match.desyncTick[player] = sessions[player]->GetDesyncTick();
+			match.checksumsCompared[player] = sessions[player]->GetStatistics().checksumsCompared;
+		}
+		return match;
+	}
+
+	void TestNoDesync(Ptr<BattleMap> const& map)
+	{
+		float64 const lossRates[] = { 0, 0.1, 0.3, 0.6 };
+		uint32 const inputDelays[] = { 0, 2, 6 };
+		for (float64 loss : lossRates)
+		{
+			for (uint32 inputDelay : inputDelays)
+			{
+				uint64 seeds[2] = { 5, 5 };
+				Match match = Play(map, { 60, 15, loss, 11 + uint64(loss * 10) + inputDelay }, inputDelay, seeds);
+				SRPG_CHECK(!match.desynced[0] && !match.desynced[1]);
+				SRPG_CHECK(match.checksums[0].size() >= Ticks && match.checksums[1].size() >= Ticks &&
+					equal(match.checksums[0].begin(), match.checksums[0].begin() + Ticks, match.checksums[1].begin()));
+				// Every interval is exchanged once, in the packet of that tick, lost ones are not compared.
+				SRPG_CHECK(match.checksumsCompared[0] > 0 && match.checksumsCompared[1] > 0);
+				SRPG_CHECK(loss > 0 || (match.checksumsCompared[0] == Ticks / LockstepSession::ChecksumInterval && match.checksumsCompared[1] == match.checksumsCompared[0]));
+			}
+		}
+	}
+
+	/*
+	*	Different seeds give different random state from the start, the first checksum exchange has to notice.
+	*/
+	void TestSeedMismatch(Ptr<BattleMap> const& map)
+	{
+		float64 const lossRates[] = { 0, 0.3 };
+		for (float64 loss : lossRates)
+		{
+			uint64 seeds[2] = { 5, 6 };
+			Match match = Play(map, { 60, 15, loss, 3 }, 2, seeds);
+			SRPG_CHECK(match.desynced[0] || match.desynced[1]);
+			for (uint8 player = 0; player < 2; ++player)
+			{
+				SRPG_CHECK(!match.desynced[player] || match.desyncTick[player] % LockstepSession::ChecksumInterval == 0);
+				// The session stops at the desync instead of running on.
+				SRPG_CHECK(!match.desynced[player] || match.checksums[player].size() < Ticks);
+			}
+		}
+	}
+
+	void RunLockstepTests()
+	{
+		Ptr<BattleMap> map = MakeMap();
+		SRPG_CHECK(map);
+		if (!map)
+		{
+			return;
+		}
+		TestNoDesync(map);
+		TestSeedMismatch(map);
+	}
+
+	TestRegistration registration("Lockstep", &RunLockstepTests);
+}
@@ -0,0 +1,142 @@
+#include "Test.h"
+#include "Profiler.h"
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint32 const WriterCount = 3;
+	uint32 const NamesPerWriter = 4;
+
+	/*
+	*	Writers end zones whose start ticks carry a sequence number and the index of their name, so a record mixing two
+	*	writes shows. They end zones faster than the ring holds them, and threads that end hand their rings to new ones,
+	*	while a reader captures and writes traces the whole time.
+	*/
+	void RunProfilerTests()
+	{
+		vector<char const*> names;
+		for (uint32 writer = 0; writer < WriterCount; ++writer)
+		{
+			for (uint32 name = 0; name < NamesPerWriter; ++name)
+			{
+				names.push_back(Profiler::InternName("ProfilerTest " + to_string(writer) + "." + to_string(name)));
+			}
+		}
+		auto findName = [&names](char const* name) -> sint32
+		{
+			for (uint32 index = 0; index < names.size(); ++index)
+			{
+				if (names[index] == name)
+				{
+					return sint32(index);
+				}
+			}
+			return -1;
+		};
+
+		atomic<bool> stop{ false };
+		atomic<uint32> torn{ 0 };
+		atomic<uint32> captured{ 0 };
+		atomic<uint32> passes{ 0 };
+		thread reader([&]
+		{
+			while (!stop.load())
+			{
+				ProfileZoneRecord const* previous = nullptr;
+				vector<ProfileZoneRecord> zones = Profiler::Capture(0);
+				for (ProfileZoneRecord const& zone : zones)
+				{
+					sint32 name = findName(zone.name);
+					if (name < 0)
+					{
+						previous = nullptr;
+						continue;
+					}
+					captured.fetch_add(1, memory_order_relaxed);
+					// Start ticks are sequence * NamesPerWriter + name, the depth alternates with the sequence.
+					uint64 sequence = zone.startTicks / NamesPerWriter;
+					if (zone.startTicks % NamesPerWriter != uint32(name) % NamesPerWriter || zone.depth != sequence % 2)
+					{
+						torn.fetch_add(1, memory_order_relaxed);
+					}
+					// Slots the owner overwrote during the copy would show as a jump in the sequence.
+					if (previous && previous->thread == zone.thread && previous->startTicks / NamesPerWriter + 1 != sequence)
+					{
+						torn.fetch_add(1, memory_order_relaxed);
+					}
+					previous = &zone;
+				}
+				ostringstream trace;
+				Profiler::WriteChromeTrace(trace);
+				SRPG_CHECK(trace.str().size() > 0);
+				Profiler::GetThreads();
+				passes.fetch_add(1);
+			}
+		});
+
+		for (uint32 generation = 0; generation < 4; ++generation)
+		{
+			vector<thread> writers;
+			// Until the reader went over the rings a few times while they were written, with one core as well.
+			uint32 passesUntil = passes.load() + 3;
+			for (uint32 writer = 0; writer < WriterCount; ++writer)
+			{
+				writers.emplace_back([&names, &passes, passesUntil, writer, generation]
+				{
+					Profiler::SetThreadName(("ProfilerTest writer " + to_string(writer) + "/" + to_string(generation)).c_str());
+					for (uint64 sequence = 0; sequence < 40000 || passes.load(memory_order_relaxed) < passesUntil; ++sequence)
+					{
+						uint32 name = uint32(sequence % NamesPerWriter);
+						// The odd zones are nested in a zone that never ends, so depth 1.
+						bool nested = sequence % 2 == 1;
+						Profiler::GetDepth() += nested ? 2 : 1;
+						Profiler::EndZone(names[writer * NamesPerWriter + name], sequence * NamesPerWriter + name);
+						Profiler::GetDepth() -= nested ? 1 : 0;
+						if (sequence % 4096 == 0)
+						{
+							Profiler::MarkFrame();
+						}
+					}
+				});
+			}
+			for (auto& writer : writers)
+			{
+				writer.join();
+			}
+		}
+		stop.store(true);
+		reader.join();
+
+		SRPG_CHECK(torn.load() == 0);
+		SRPG_CHECK(captured.load() > 0);
+
+		// Quiet now, the newest zones of each ring have to be there in order.
+		vector<ProfileZoneRecord> zones = Profiler::Capture(0);
+		uint32 ours = 0;
+		uint32 outOfOrder = 0;
+		for (size_t index = 0; index < zones.size(); ++index)
+		{
+			if (findName(zones[index].name) < 0)
+			{
+				continue;
+			}
+			++ours;
+			// A ring taken over by the next generation only shows the zones of its new owner.
+			if (index > 0 && zones[index - 1].thread == zones[index].thread && findName(zones[index - 1].name) >= 0)
+			{
+				outOfOrder += zones[index - 1].startTicks / NamesPerWriter + 1 != zones[index].startTicks / NamesPerWriter;
+			}
+		}
+		SRPG_CHECK(ours > 0);
+		SRPG_CHECK(outOfOrder == 0);
+	}
+
+	TestRegistration registration("Profiler", &RunProfilerTests);
+}
@@ -0,0 +1,231 @@
+#include "Test.h"
+#include "BattleInput.h"
+#include "Replay.h"
+#include "Varint.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	uint64 const Seed = 7;
+	uint32 const ChecksumInterval = 10;
+	// Ticks the player takes between two clicks, not a multiple of the interval so commands fall between checksums.
+	uint32 const TicksPerClick = 15;
+
+	// Where the map is drawn inside the window, as the battle panel does.
+	uint32 const ViewLeft = 10, ViewTop = 20, TileSize = 16, ViewHeight = 600;
+
+	Ptr<BattleMap> MakeMap()
+	{
+		string text = "size 8 6\ntiles\n";
+		for (uint32 y = 0; y < 6; ++y)
+		{
+			text += y == 5 ? "..ff....\n" : "........\n";
+		}
+		text += "unit 1 1 0 e Blue\n";
+		text += "unit 6 1 1 w Red\n";
+		text += "unit 1 3 0 e Blue\n";
+		text += "unit 6 3 1 w Red\n";
+		vector<uint8> file;
+		SRPG_CHECK(ConvertBattleMapText(text, file).empty());
+		return BattleMap::Create(move(file));
+	}
+
+	struct Recording
+	{
+		Recording(Ptr<BattleMap> map) :
+			simulation(map, Seed),
+			recorder("Test", simulation, Seed, ChecksumInterval),
+			commands(0)
+		{
+		}
+
+		BattleSimulation simulation;
+		ReplayRecorder recorder;
+		uint32 commands;
+	};
+
+	/*
+	*	Clicks the middle of a tile the way Window reports it, from the bottom left of the view, then lets time pass.
+	*/
+	void Click(Recording& recording, BattleInputController& input, uint32 x, uint32 y)
+	{
+		uint32 pixelX = ViewLeft + x * TileSize + TileSize / 2;
+		uint32 pixelY = ViewHeight - 1 - (ViewTop + y * TileSize + TileSize / 2);
+		input.OnMouseMove(InputSemantic::M_Move, pixelX, pixelY);
+		SRPG_CHECK(input.GetCursorX() == x && input.GetCursorY() == y);
+		input.OnMouseDown(InputSemantic::M_Button0, pixelX, pixelY);
+		input.OnMouseUp(InputSemantic::M_Button0, pixelX, pixelY);
+		for (uint32 tick = 0; tick < TicksPerClick; ++tick)
+		{
+			recording.recorder.Tick(recording.simulation);
+		}
+	}
+
+	void Press(Recording& recording, BattleInputController& input, InputSemantic key)
+	{
+		input.OnKeyDown(key);
+		input.OnKeyUp(key);
+		for (uint32 tick = 0; tick < TicksPerClick; ++tick)
+		{
+			recording.recorder.Tick(recording.simulation);
+		}
+	}
+
+	/*
+	*	Two turns each played through the input controller, every command it sends goes into the replay.
+	*/
+	vector<uint8> RecordMatch(Ptr<BattleMap> map, uint32& commandCount)
+	{
+		Recording recording(map);
+		BattleInputController input(recording.simulation, BattleInputController::CommandSink([&recording](BattleCommand const& command)
+		{
+			SRPG_CHECK(recording.recorder.Apply(recording.simulation, command));
+			++recording.commands;
+		}));
+		input.SetView(ViewLeft, ViewTop, TileSize, ViewHeight);
+
+		// Blue walks up to the red unit, the other waits.
+		Click(recording, input, 1, 1);
+		SRPG_CHECK(input.GetSelectedUnit() == 0);
+		Click(recording, input, 4, 1);
+		Press(recording, input, InputSemantic::K_W);
+		Click(recording, input, 1, 3);
+		Press(recording, input, InputSemantic::K_W);
+		Press(recording, input, InputSemantic::K_E);
+		// Red closes in and attacks.
+		Click(recording, input, 6, 1);
+		Click(recording, input, 5, 1);
+		Click(recording, input, 4, 1);
+		Press(recording, input, InputSemantic::K_E);
+		// Blue strikes back.
+		Click(recording, input, 4, 1);
+		Click(recording, input, 5, 1);
+		Press(recording, input, InputSemantic::K_E);
+
+		SRPG_CHECK(recording.commands == 9);
+		SRPG_CHECK(recording.simulation.GetUnits()[0].x == 4 && recording.simulation.GetUnits()[1].x == 5);
+		SRPG_CHECK(recording.simulation.GetUnits()[0].health < BattleSimulation::StartHealth);
+		SRPG_CHECK(recording.simulation.GetUnits()[1].health < BattleSimulation::StartHealth);
+		commandCount = recording.commands;
+		return recording.recorder.Finish(recording.simulation);
+	}
+
+	struct RecordedCommand
+	{
+		size_t begin, end;		// of the command's bytes after the event header
+		uint32 tick;
+		BattleCommand command;
+	};
+
+	/*
+	*	Walks the event stream the way ReplayPlayer does, to tamper with single commands.
+	*/
+	vector<RecordedCommand> FindCommands(vector<uint8> const& data)
+	{
+		vector<RecordedCommand> commands;
+		uint8 const* position = data.data() + 4;
+		uint8 const* end = data.data() + data.size();
+		uint64 value, pathLength;
+		SRPG_CHECK(ReadVarint(position, end, value) && ReadVarint(position, end, value) && ReadVarint(position, end, value));
+		SRPG_CHECK(ReadVarint(position, end, pathLength));
+		position += pathLength;
+		uint32 tick = 0;
+		uint64 header;
+		while (ReadVarint(position, end, header))
+		{
+			tick += uint32(header >> 2);
+			if ((header & 3) == 0)
+			{
+				RecordedCommand recorded;
+				recorded.begin = size_t(position - data.data());
+				recorded.tick = tick;
+				SRPG_CHECK(ReadBattleCommand(position, end, recorded.command));
+				recorded.end = size_t(position - data.data());
+				commands.push_back(recorded);
+			}
+			else
+			{
+				position += 4;
+			}
+		}
+		return commands;
+	}
+
+	vector<uint8> ReplaceCommand(vector<uint8> data, RecordedCommand const& recorded, BattleCommand const& command)
+	{
+		vector<uint8> bytes;
+		AppendBattleCommand(bytes, command);
+		data.erase(data.begin() + recorded.begin, data.begin() + recorded.end);
+		data.insert(data.begin() + recorded.begin, bytes.begin(), bytes.end());
+		return data;
+	}
+
+	ReplayPlayer::Result Play(Ptr<BattleMap> map, vector<uint8> data)
+	{
+		ReplayPlayer player;
+		SRPG_CHECK(player.Load(move(data)));
+		BattleSimulation simulation(map, player.GetSeed());
+		return player.Play(simulation);
+	}
+
+	void RunReplayTests()
+	{
+		Ptr<BattleMap> map = MakeMap();
+		SRPG_CHECK(map);
+		if (!map)
+		{
+			return;
+		}
+		uint32 commandCount = 0;
+		vector<uint8> data = RecordMatch(map, commandCount);
+
+		ReplayPlayer::Result result = Play(map, data);
+		SRPG_CHECK(result.completed);
+		SRPG_CHECK(result.desyncTick == ~0u);
+		SRPG_CHECK(result.commands == commandCount);
+		SRPG_CHECK(result.ticks == 13 * TicksPerClick);
+		SRPG_CHECK(result.checksumsVerified == 13 * TicksPerClick / ChecksumInterval + 2);
+
+		// A different seed, stored as the single varint byte after the magic and the version, is caught by the first
+		// checksum before anything is played.
+		vector<uint8> reseeded = data;
+		SRPG_CHECK(reseeded[5] == Seed);
+		reseeded[5] = uint8(Seed + 1);
+		result = Play(map, reseeded);
+		SRPG_CHECK(!result.completed && result.desyncTick == 0 && result.commands == 0);
+
+		vector<RecordedCommand> commands = FindCommands(data);
+		SRPG_CHECK(commands.size() == commandCount);
+		if (commands.size() != commandCount)
+		{
+			return;
+		}
+		RecordedCommand const& firstMove = commands[0];
+		SRPG_CHECK(firstMove.command.type == BattleCommand::Type::Move && firstMove.tick == TicksPerClick);
+
+		// A command the simulation rejects is reported at its own tick.
+		BattleCommand invalid = firstMove.command;
+		invalid.unit = 100;
+		result = Play(map, ReplaceCommand(data, firstMove, invalid));
+		SRPG_CHECK(!result.completed && result.desyncTick == firstMove.tick && result.commands == 1);
+
+		// One that is valid but does something else shows at the next checksum.
+		BattleCommand shorter = firstMove.command;
+		--shorter.x;
+		result = Play(map, ReplaceCommand(data, firstMove, shorter));
+		SRPG_CHECK(!result.completed && result.desyncTick == (firstMove.tick / ChecksumInterval + 1) * ChecksumInterval);
+
+		// The same for the attack, its damage draws from the random numbers the checksum covers.
+		RecordedCommand const& attack = commands[5];
+		SRPG_CHECK(attack.command.type == BattleCommand::Type::Attack);
+		BattleCommand waited = { BattleCommand::Type::Wait, attack.command.unit, 0, 0, 0 };
+		result = Play(map, ReplaceCommand(data, attack, waited));
+		SRPG_CHECK(!result.completed && result.desyncTick == (attack.tick / ChecksumInterval + 1) * ChecksumInterval);
+	}
+
+	TestRegistration registration("Replay", &RunReplayTests);
+}
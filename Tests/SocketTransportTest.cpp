@@ -0,0 +1,207 @@
+#include "Test.h"
+#include "SocketTransport.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	chrono::steady_clock::time_point Seconds(uint32 seconds)
+	{
+		return chrono::steady_clock::now() + chrono::seconds(seconds);
+	}
+
+	vector<uint8> MakeMessage(uint32 size, uint8 first)
+	{
+		vector<uint8> bytes(size);
+		for (uint32 i = 0; i < size; ++i)
+		{
+			bytes[i] = uint8(first + i * 7);
+		}
+		return bytes;
+	}
+
+	/*
+	*	Receives until count messages are there or the deadline passed.
+	*/
+	vector<ServerPacket> ReceiveAtLeast(SocketTransport& transport, size_t count)
+	{
+		vector<ServerPacket> packets;
+		chrono::steady_clock::time_point deadline = Seconds(5);
+		while (packets.size() < count && chrono::steady_clock::now() < deadline)
+		{
+			transport.Receive(packets, deadline);
+		}
+		return packets;
+	}
+
+	vector<vector<uint8>> ClientReceiveAtLeast(SocketClient& client, size_t count)
+	{
+		vector<vector<uint8>> messages;
+		chrono::steady_clock::time_point deadline = Seconds(5);
+		while (messages.size() < count && chrono::steady_clock::now() < deadline && client.Receive(messages))
+		{
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		return messages;
+	}
+
+	/*
+	*	Messages arrive whole and in order per connection, from empty ones to ones larger than a socket buffer.
+	*/
+	void TestMessages()
+	{
+		Ptr<SocketTransport> transport = SocketTransport::Listen(0);
+		SRPG_CHECK(transport && transport->GetPort() != 0);
+		if (!transport)
+		{
+			return;
+		}
+		Ptr<SocketClient> clients[3];
+		uint32 connections[3];
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			clients[i] = SocketClient::Connect(transport->GetPort());
+			SRPG_CHECK(clients[i] && transport->Accept(connections[i], Seconds(5)));
+			if (!clients[i])
+			{
+				return;
+			}
+		}
+		SRPG_CHECK(connections[0] != connections[1] && connections[1] != connections[2]);
+
+		uint32 const sizes[] = { 0, 1, 13, 4096, SocketTransport::MaxMessageSize };
+		// The largest messages from the three clients together are more than the socket buffers take at once.
+		thread sender([&clients, &sizes]
+		{
+			for (uint32 round = 0; round < 4; ++round)
+			{
+				for (uint32 size : sizes)
+				{
+					for (uint32 i = 0; i < 3; ++i)
+					{
+						SRPG_CHECK(clients[i]->Send(MakeMessage(size, uint8(round + i))));
+					}
+				}
+			}
+		});
+		vector<ServerPacket> packets = ReceiveAtLeast(*transport, 3 * 4 * 5);
+		sender.join();
+		SRPG_CHECK(packets.size() == 3 * 4 * 5);
+		uint32 received[3] = {};
+		for (ServerPacket const& packet : packets)
+		{
+			uint32 client = 0;
+			while (client < 3 && connections[client] != packet.connection)
+			{
+				++client;
+			}
+			SRPG_CHECK(client < 3);
+			if (client < 3)
+			{
+				uint32 index = received[client]++;
+				SRPG_CHECK(packet.bytes == MakeMessage(sizes[index % 5], uint8(index / 5 + client)));
+			}
+		}
+
+		// Replies from several threads at once, as the match jobs send them.
+		vector<thread> repliers;
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			repliers.emplace_back([&transport, &connections, i]
+			{
+				for (uint32 reply = 0; reply < 200; ++reply)
+				{
+					transport->Send(connections[i], MakeMessage(reply % 50 * 1300, uint8(reply)));
+				}
+			});
+		}
+		for (auto& replier : repliers)
+		{
+			replier.join();
+		}
+		// What did not fit the socket buffers goes out while the server receives.
+		atomic<bool> repliesReceived{ false };
+		thread pump([&transport, &repliesReceived]
+		{
+			vector<ServerPacket> none;
+			while (!repliesReceived.load())
+			{
+				transport->Receive(none, chrono::steady_clock::now() + chrono::milliseconds(10));
+			}
+		});
+		for (uint32 i = 0; i < 3; ++i)
+		{
+			vector<vector<uint8>> replies = ClientReceiveAtLeast(*clients[i], 200);
+			SRPG_CHECK(replies.size() == 200);
+			for (uint32 reply = 0; reply < replies.size(); ++reply)
+			{
+				SRPG_CHECK(replies[reply] == MakeMessage(reply % 50 * 1300, uint8(reply)));
+			}
+		}
+		repliesReceived.store(true);
+		pump.join();
+	}
+
+	/*
+	*	A client that leaves or sends a message larger than allowed loses only its own connection.
+	*/
+	void TestDisconnects()
+	{
+		Ptr<SocketTransport> transport = SocketTransport::Listen(0);
+		SRPG_CHECK(transport);
+		if (!transport)
+		{
+			return;
+		}
+		uint32 leaving, oversized, staying;
+		Ptr<SocketClient> leavingClient = SocketClient::Connect(transport->GetPort());
+		Ptr<SocketClient> oversizedClient = SocketClient::Connect(transport->GetPort());
+		Ptr<SocketClient> stayingClient = SocketClient::Connect(transport->GetPort());
+		SRPG_CHECK(leavingClient && oversizedClient && stayingClient);
+		if (!leavingClient || !oversizedClient || !stayingClient)
+		{
+			return;
+		}
+		SRPG_CHECK(transport->Accept(leaving, Seconds(5)) && transport->Accept(oversized, Seconds(5)) && transport->Accept(staying, Seconds(5)));
+		uint32 none;
+		SRPG_CHECK(!transport->Accept(none, chrono::steady_clock::now() + chrono::milliseconds(20)));
+
+		leavingClient->Send(MakeMessage(10, 1));
+		leavingClient = nullptr;
+		oversizedClient->Send(MakeMessage(SocketTransport::MaxMessageSize + 1, 2));
+		stayingClient->Send(MakeMessage(10, 3));
+		vector<ServerPacket> packets = ReceiveAtLeast(*transport, 2);
+		SRPG_CHECK(packets.size() == 2);
+
+		// Both are closed by now, sending to them is dropped.
+		vector<ServerPacket> more;
+		transport->Receive(more, chrono::steady_clock::now() + chrono::milliseconds(50));
+		transport->Send(leaving, MakeMessage(10, 4));
+		transport->Send(oversized, MakeMessage(10, 5));
+		transport->Send(staying, MakeMessage(10, 6));
+		SRPG_CHECK(ClientReceiveAtLeast(*stayingClient, 1).size() == 1);
+
+		vector<vector<uint8>> messages;
+		chrono::steady_clock::time_point deadline = Seconds(5);
+		while (oversizedClient->Receive(messages) && chrono::steady_clock::now() < deadline)
+		{
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		SRPG_CHECK(messages.empty() && !oversizedClient->Receive(messages));
+		SRPG_CHECK(!oversizedClient->Send(MakeMessage(1, 0)));
+	}
+
+	void RunSocketTransportTests()
+	{
+		TestMessages();
+		TestDisconnects();
+		SRPG_CHECK(!SocketClient::Connect(0));
+	}
+
+	TestRegistration registration("SocketTransport", &RunSocketTransportTests);
+}
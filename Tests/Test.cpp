@@ -0,0 +1,72 @@
+#include "Test.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	struct RegisteredTest
+	{
+		char const* name;
+		void(*function)();
+	};
+
+	vector<RegisteredTest>& GetRegistry()
+	{
+		static vector<RegisteredTest> registry;
+		return registry;
+	}
+
+	atomic<uint32> failures{ 0 };
+	mutex outputMutex;
+}
+
+void X::ReportFailure(char const* condition, char const* file, int line)
+{
+	// Only the first failures of a check that fails in a loop are interesting.
+	if (failures.fetch_add(1, memory_order_relaxed) < 32)
+	{
+		lock_guard<mutex> lock(outputMutex);
+		fprintf(stderr, "%s(%d): check failed: %s\n", file, line, condition);
+	}
+}
+
+TestRegistration::TestRegistration(char const* name, void(*function)())
+{
+	GetRegistry().push_back({ name, function });
+}
+
+/*
+*	Usage: Tests [filter]
+*	Only tests whose registered name contains filter are run. Returns 1 if any check failed.
+*/
+int main(int argc, char** argv)
+{
+	char const* filter = argc > 1 ? argv[1] : nullptr;
+	uint32 run = 0;
+	for (auto const& test : GetRegistry())
+	{
+		if (filter != nullptr && strstr(test.name, filter) == nullptr)
+		{
+			continue;
+		}
+		uint32 failuresBefore = failures.load();
+		auto start = chrono::steady_clock::now();
+		test.function();
+		float64 seconds = chrono::duration<float64>(chrono::steady_clock::now() - start).count();
+		printf("%-32s %s %8.3f s\n", test.name, failures.load() == failuresBefore ? "passed" : "FAILED", seconds);
+		++run;
+	}
+	if (run == 0)
+	{
+		fprintf(stderr, "No test matches %s\n", filter);
+		return 1;
+	}
+	return failures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "BasicType.h"
+
+/*
+*	SRPG_CHECK(condition) reports a failure with its location and carries on, so one run shows every broken check.
+*	Safe to use from any thread.
+*/
+#define SRPG_CHECK(condition) ((condition) ? (void)0 : ::X::ReportFailure(#condition, __FILE__, __LINE__))
+
+namespace X
+{
+	void ReportFailure(char const* condition, char const* file, int line);
+
+	/*
+	*	Tests register themselves through a static TestRegistration in their own translation unit.
+	*/
+	struct TestRegistration
+	{
+		TestRegistration(char const* name, void(*function)());
+	};
+}
@@ -0,0 +1,292 @@
+#include "Test.h"
+#include "TextureStreamer.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace X;
+
+namespace
+{
+	/*
+	*	Runs nothing by itself. The test picks which queued job finishes next, so decodes and uploads complete in the
+	*	order it wants.
+	*/
+	class ManualJobSystem : public JobSystem
+	{
+	public:
+		virtual void Run(function<void()> job, JobCounter* counter) override
+		{
+			if (counter)
+			{
+				counter->Add(1);
+			}
+			_pending.push_back({ move(job), counter });
+		}
+
+		virtual void Wait(JobCounter& counter) override
+		{
+			while (!counter.IsDone() && !_pending.empty())
+			{
+				RunJob(0);
+			}
+		}
+
+		virtual uint32 GetWorkerCount() const override
+		{
+			return 0;
+		}
+
+		size_t GetPendingCount() const
+		{
+			return _pending.size();
+		}
+
+		void RunJob(size_t index)
+		{
+			Pending pending = move(_pending[index]);
+			_pending.erase(_pending.begin() + index);
+			pending.job();
+			if (pending.counter)
+			{
+				pending.counter->Done();
+			}
+		}
+
+		void RunAll()
+		{
+			while (!_pending.empty())
+			{
+				RunJob(0);
+			}
+		}
+
+	private:
+		struct Pending
+		{
+			function<void()> job;
+			JobCounter* counter;
+		};
+
+		vector<Pending> _pending;
+	};
+
+	struct FakeTexture
+	{
+		uint32 width;
+		uint32 height;
+		bool released;
+	};
+
+	class FakeTextureDevice : public TextureDevice
+	{
+	public:
+		virtual void* CreateTexture(uint32 width, uint32 height, void const*) override
+		{
+			_textures.push_back(make_unique<FakeTexture>(FakeTexture{ width, height, false }));
+			return _textures.back().get();
+		}
+
+		virtual void ReleaseTexture(void* texture) override
+		{
+			FakeTexture* fake = static_cast<FakeTexture*>(texture);
+			SRPG_CHECK(!fake->released);
+			fake->released = true;
+		}
+
+		/*
+		*	Widths of the created textures in creation order, without the placeholder.
+		*/
+		vector<uint32> GetCreatedWidths() const
+		{
+			vector<uint32> widths;
+			for (size_t index = 1; index < _textures.size(); ++index)
+			{
+				widths.push_back(_textures[index]->width);
+			}
+			return widths;
+		}
+
+		uint32 GetLiveCount() const
+		{
+			uint32 live = 0;
+			for (auto const& texture : _textures)
+			{
+				live += !texture->released;
+			}
+			return live;
+		}
+
+	private:
+		vector<unique_ptr<FakeTexture>> _textures;
+	};
+
+	/*
+	*	Paths start with the square size in pixels, what follows only tells equal sizes apart. "failed" does not decode.
+	*/
+	bool LoadFake(string const& path, TextureData& texture)
+	{
+		if (path == "failed")
+		{
+			return false;
+		}
+		texture.width = texture.height = uint32(stoul(path));
+		texture.pixels.assign(size_t(texture.width) * texture.height * 4, 0xFF);
+		return true;
+	}
+
+	uint32 GetWidth(TextureStreamer const& streamer, TextureStreamer::TextureHandle texture)
+	{
+		return static_cast<FakeTexture*>(streamer.GetTexture(texture))->width;
+	}
+
+	/*
+	*	Textures are admitted for upload in the order their decodes finished, and show the placeholder until the Update
+	*	after their creation.
+	*/
+	void TestOutOfOrderDecodes()
+	{
+		Ptr<FakeTextureDevice> device = CreatePtr<FakeTextureDevice>();
+		Ptr<ManualJobSystem> jobs = CreatePtr<ManualJobSystem>();
+		{
+			TextureStreamer streamer(device, jobs, 1 << 20, &LoadFake);
+			TextureStreamer::TextureHandle a = streamer.Request("16");
+			void* placeholder = streamer.GetTexture(a);
+			TextureStreamer::TextureHandle b = streamer.Request("32");
+			TextureStreamer::TextureHandle c = streamer.Request("4");
+			TextureStreamer::TextureHandle failed = streamer.Request("failed");
+			SRPG_CHECK(jobs->GetPendingCount() == 4);
+
+			// c, then a.
+			jobs->RunJob(2);
+			jobs->RunJob(0);
+			streamer.Update();
+			SRPG_CHECK(streamer.GetStatistics().uploading == 2);
+			SRPG_CHECK(streamer.GetStatistics().uploadedBytesLastFrame == (16 * 16 + 4 * 4) * 4);
+			SRPG_CHECK(streamer.GetTexture(a) == placeholder && streamer.GetTexture(c) == placeholder);
+
+			// The two creation jobs, queued after the decodes of b and failed.
+			jobs->RunJob(2);
+			jobs->RunJob(2);
+			SRPG_CHECK(device->GetCreatedWidths() == vector<uint32>({ 4, 16 }));
+			SRPG_CHECK(streamer.GetTexture(a) == placeholder && !streamer.IsResident(c));
+			streamer.Update();
+			SRPG_CHECK(streamer.IsResident(a) && streamer.IsResident(c));
+			SRPG_CHECK(GetWidth(streamer, a) == 16 && GetWidth(streamer, c) == 4);
+			SRPG_CHECK(streamer.GetTexture(b) == placeholder);
+
+			jobs->RunAll();
+			streamer.Update();
+			jobs->RunAll();
+			streamer.Update();
+			SRPG_CHECK(streamer.IsResident(b) && GetWidth(streamer, b) == 32);
+			SRPG_CHECK(!streamer.IsResident(failed) && streamer.GetTexture(failed) == placeholder);
+			TextureStreamer::Statistics statistics = streamer.GetStatistics();
+			SRPG_CHECK(statistics.resident == 3 && statistics.failed == 1 && statistics.loading == 0);
+		}
+		SRPG_CHECK(device->GetLiveCount() == 0);
+	}
+
+	/*
+	*	Oldest decode first, as many as fit in the budget, one that is larger than the budget alone.
+	*/
+	void TestUploadBudget()
+	{
+		Ptr<FakeTextureDevice> device = CreatePtr<FakeTextureDevice>();
+		Ptr<ManualJobSystem> jobs = CreatePtr<ManualJobSystem>();
+		{
+			uint64 const Budget = (16 * 16 + 8 * 8) * 4;
+			TextureStreamer streamer(device, jobs, Budget, &LoadFake);
+			char const* paths[] = { "16", "8", "9", "64", "4", "16x" };
+			for (char const* path : paths)
+			{
+				streamer.Request(path);
+			}
+			jobs->RunAll();
+
+			vector<uint64> uploaded;
+			for (uint32 frame = 0; frame < 10 && streamer.GetStatistics().resident < 6; ++frame)
+			{
+				streamer.Update();
+				uploaded.push_back(streamer.GetStatistics().uploadedBytesLastFrame);
+				jobs->RunAll();
+			}
+			vector<uint64> expected = { (16 * 16 + 8 * 8) * 4, 9 * 9 * 4, 64 * 64 * 4, (4 * 4 + 16 * 16) * 4, 0 };
+			SRPG_CHECK(uploaded == expected);
+			SRPG_CHECK(device->GetCreatedWidths() == vector<uint32>({ 16, 8, 9, 64, 4, 16 }));
+
+			streamer.SetUploadBudget(0);
+			streamer.Request("2");
+			streamer.Request("3");
+			jobs->RunAll();
+			streamer.Update();
+			SRPG_CHECK(streamer.GetStatistics().uploadedBytesLastFrame == 2 * 2 * 4);
+			SRPG_CHECK(streamer.GetStatistics().waitingForUpload == 1);
+		}
+		SRPG_CHECK(device->GetLiveCount() == 0);
+	}
+
+	void TestCancel()
+	{
+		Ptr<FakeTextureDevice> device = CreatePtr<FakeTextureDevice>();
+		Ptr<ManualJobSystem> jobs = CreatePtr<ManualJobSystem>();
+		{
+			TextureStreamer streamer(device, jobs, 1, &LoadFake);
+			void* placeholder = streamer.GetTexture(streamer.Request("1"));
+			jobs->RunAll();
+			streamer.Update();
+			jobs->RunAll();
+			streamer.Update();
+
+			// While loading: the decode is dropped, a new request starts over.
+			TextureStreamer::TextureHandle loading = streamer.Request("10");
+			streamer.Cancel(loading);
+			TextureStreamer::TextureHandle again = streamer.Request("10");
+			SRPG_CHECK(again != loading);
+			jobs->RunJob(0);
+			streamer.Update();
+			SRPG_CHECK(streamer.GetStatistics().uploading == 0 && streamer.GetStatistics().cancelled == 1);
+			jobs->RunAll();
+			streamer.Update();
+			jobs->RunAll();
+			streamer.Update();
+			SRPG_CHECK(streamer.IsResident(again) && streamer.GetTexture(loading) == placeholder);
+			SRPG_CHECK(device->GetCreatedWidths() == vector<uint32>({ 1, 10 }));
+
+			// Waiting and uploading: the budget of 1 byte admits one texture per frame.
+			TextureStreamer::TextureHandle uploading = streamer.Request("11");
+			TextureStreamer::TextureHandle waiting = streamer.Request("12");
+			jobs->RunAll();
+			streamer.Update();
+			SRPG_CHECK(streamer.GetStatistics().uploading == 1 && streamer.GetStatistics().waitingForUpload == 1);
+			streamer.Cancel(waiting);
+			streamer.Cancel(uploading);
+			uint32 live = device->GetLiveCount();
+			jobs->RunAll();
+			SRPG_CHECK(device->GetLiveCount() == live + 1);
+			streamer.Update();
+			SRPG_CHECK(device->GetLiveCount() == live);
+			SRPG_CHECK(streamer.GetStatistics().uploadedBytesLastFrame == 0);
+			SRPG_CHECK(streamer.GetTexture(uploading) == placeholder && streamer.GetTexture(waiting) == placeholder);
+			SRPG_CHECK(device->GetCreatedWidths() == vector<uint32>({ 1, 10, 11 }));
+
+			// Resident: released right away.
+			streamer.Cancel(again);
+			SRPG_CHECK(device->GetLiveCount() == live - 1);
+			SRPG_CHECK(streamer.GetTexture(again) == placeholder);
+			SRPG_CHECK(streamer.GetStatistics().cancelled == 4);
+		}
+		SRPG_CHECK(device->GetLiveCount() == 0);
+	}
+
+	void RunTextureStreamerTests()
+	{
+		TestOutOfOrderDecodes();
+		TestUploadBudget();
+		TestCancel();
+	}
+
+	TestRegistration registration("TextureStreamer", &RunTextureStreamerTests);
+}
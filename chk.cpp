@@ -0,0 +1,5 @@
+#include "PakFile.h"
+#include "TextureStreamer.h"
+#include <cstdio>
+using namespace X;
+int main(){ Ptr<PakFile> p=PakFile::Open("/tmp/dc/Data.pak"); std::vector<uint8> f; TextureData t; bool ok=p && p->Read("Textures/Portrait.tga",f) && DecodeTGA(f.data(),f.size(),t); printf("%d %u %u\n",ok,t.width,t.height);}